@@ -154,9 +154,58 @@ void print_tree(bx_param_c *node, int level = 0, bool xml = false);
 #if BX_ENABLE_STATISTICS
 // print statistics
 void print_statistics_tree(bx_param_c *node, int level = 0);
+// counter statistics.<group>.<name>.<counter>, created on first use
+BOCHSAPI Bit64u *bx_stats_counter(const char *group, const char *name, const char *counter);
+// metrics export through a local socket (metrics.cc)
+void bx_metrics_start(const char *path);
+void bx_metrics_stop(void);
 #define INC_STAT(stat) (++(stat))
+#define ADD_STAT(stat, n) ((stat) += (n))
+
+// I/O port and MMIO access heatmap (metrics.cc). Counters are kept per
+// port or MMIO page and device in statistics.heatmap_io/heatmap_mmio,
+// the host cycles of every BX_HEATMAP_SAMPLE_RATE-th access are summed up.
+// The rate is a prime, so that regular access patterns (e.g. alternating
+// reads and writes) do not always sample the same port.
+#define BX_HEATMAP_SAMPLE_RATE 17
+
+typedef struct {
+  const void *owner;   // handler the counters were looked up for
+  Bit64u *count;
+  Bit64u *cycles;
+  Bit64u *samples;
+} bx_heat_slot_t;
+
+class BOCHSAPI bx_heatmap_c {
+public:
+  bx_heatmap_c(): enabled(0), tick(0), io_slots(NULL) {}
+  void init(void);
+  void report(void);
+  // returns the start timestamp for a sampled access, 0 otherwise
+  BX_CPP_INLINE Bit64u start(void) {
+    return ((++tick % BX_HEATMAP_SAMPLE_RATE) == 0) ? bx_host_cycles() : 0;
+  }
+  void io_access(Bit16u port, bool write, const void *handler, const char *name,
+                 Bit64u start);
+  void mmio_access(bx_heat_slot_t **slots, void *param, bx_phy_address addr,
+                   bool write, Bit64u start);
+
+  bool enabled;
+private:
+  void account(bx_heat_slot_t *slot, Bit64u start) {
+    (*slot->count)++;
+    if (start) {
+      *slot->cycles += bx_host_cycles() - start;
+      (*slot->samples)++;
+    }
+  }
+  Bit32u tick;
+  bx_heat_slot_t *io_slots;
+};
+BOCHSAPI extern bx_heatmap_c bx_heatmap;
 #else
 #define INC_STAT(stat)
+#define ADD_STAT(stat, n)
 #endif
 
 //
@@ -250,18 +299,25 @@ void print_statistics_tree(bx_param_c *node, int level = 0);
 // memory trace callbacks from CPU
 extern void bx_dbg_lin_memory_access(unsigned cpu, bx_address lin, bx_phy_address phy, unsigned len, unsigned memtype, unsigned rw,                Bit8u *data);
 extern void bx_dbg_phy_memory_access(unsigned cpu,                 bx_phy_address phy, unsigned len, unsigned memtype, unsigned rw, unsigned attr, Bit8u *data);
+extern void bx_dbg_check_memory_watchpoints(unsigned cpu, bx_phy_address phy, unsigned len, unsigned rw);
 #endif
 
 #if BX_DEBUGGER
+// memory watchpoints are checked on the physical access slow path, the pages
+// they cover are never accessed directly through the host pointer
 #  define BX_DBG_LIN_MEMORY_ACCESS(cpu, lin, phy, len, memtype, rw, data) \
-   if (bx_dbg.debugger_active) \
+   if (bx_dbg.debugger_active && BX_CPU(cpu)->trace_mem) \
        bx_dbg_lin_memory_access(cpu, lin, phy, len, memtype, rw, data);
 #  define BX_DBG_PHY_MEMORY_ACCESS(cpu, phy, len, memtype, rw, why, data) \
-   if (bx_dbg.debugger_active) \
+   if (bx_dbg.debugger_active && BX_CPU(cpu)->trace_mem) \
        bx_dbg_phy_memory_access(cpu, phy, len, memtype, rw, why, data);
+#  define BX_DBG_CHECK_WATCHPOINTS(cpu, phy, len, rw) \
+   if (bx_dbg.debugger_active) \
+       bx_dbg_check_memory_watchpoints(cpu, phy, len, rw);
 #else
 #  define BX_DBG_LIN_MEMORY_ACCESS(cpu, lin, phy, len, memtype, rw, data)       /* empty */
 #  define BX_DBG_PHY_MEMORY_ACCESS(cpu,      phy, len, memtype, rw, attr, data) /* empty */
+#  define BX_DBG_CHECK_WATCHPOINTS(cpu, phy, len, rw)                           /* empty */
 #endif
 
 #include "logio.h"
@@ -314,6 +370,7 @@ typedef struct {
   bool dbg_gui_globalini;
 #endif
   Bit8u magic_break;
+  bool fast_continue; // breakpoints are checked by traps inserted into the traces
 #endif
 #if BX_GDBSTUB
   bool gdbstub_enabled;
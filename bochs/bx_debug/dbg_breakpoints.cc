@@ -50,6 +50,54 @@ void bx_dbg_breakpoint_changed(void)
 #endif
 }
 
+// The fast continue checks the breakpoints only for the instructions found
+// at the page offsets marked in this map. A virtual breakpoint can be hit
+// with any CS base, so its offset is marked for every CS base (page offset)
+// the CPU has run with since the map was built, see bx_dbg_map_vir_bpoints().
+Bit8u bx_dbg_bpoint_offset_map[4096 / 8];
+Bit8u bx_dbg_bpoint_base_map[4096 / 8];
+
+static void bx_dbg_map_bpoint_offset(bx_address laddr)
+{
+  Bit32u offset = (Bit32u) laddr & 0xfff;
+  bx_dbg_bpoint_offset_map[offset >> 3] |= 1 << (offset & 7);
+}
+
+void bx_dbg_map_vir_bpoints(bx_address cs_base)
+{
+  Bit32u offset = (Bit32u) cs_base & 0xfff;
+  bx_dbg_bpoint_base_map[offset >> 3] |= 1 << (offset & 7);
+
+#if (BX_DBG_MAX_VIR_BPOINTS > 0)
+  for (unsigned n=0; n<bx_guard.iaddr.num_virtual; n++) {
+    if (bx_guard.iaddr.vir[n].enabled)
+      bx_dbg_map_bpoint_offset(cs_base + bx_guard.iaddr.vir[n].eip);
+  }
+#endif
+}
+
+void bx_dbg_map_bpoint_offsets(bx_address cs_base)
+{
+  memset(bx_dbg_bpoint_offset_map, 0, sizeof(bx_dbg_bpoint_offset_map));
+  memset(bx_dbg_bpoint_base_map, 0, sizeof(bx_dbg_bpoint_base_map));
+
+  bx_dbg_map_vir_bpoints(cs_base);
+
+#if (BX_DBG_MAX_LIN_BPOINTS > 0)
+  for (unsigned n=0; n<bx_guard.iaddr.num_linear; n++) {
+    if (bx_guard.iaddr.lin[n].enabled)
+      bx_dbg_map_bpoint_offset(bx_guard.iaddr.lin[n].addr);
+  }
+#endif
+
+#if (BX_DBG_MAX_PHY_BPOINTS > 0)
+  for (unsigned n=0; n<bx_guard.iaddr.num_physical; n++) {
+    if (bx_guard.iaddr.phy[n].enabled)
+      bx_dbg_map_bpoint_offset(bx_guard.iaddr.phy[n].addr);
+  }
+#endif
+}
+
 void bx_dbg_en_dis_breakpoint_command(unsigned handle, bool enable)
 {
 #if (BX_DBG_MAX_VIR_BPOINTS > 0)
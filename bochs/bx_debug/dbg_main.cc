@@ -627,6 +627,9 @@ void bx_dbg_watchpoint_continue(bool watch_continue)
   }
 }
 
+// Called only from the physical memory access slow path. The CPU never
+// accesses the pages covered by watchpoints through a direct host pointer,
+// see bx_dbg_watched_page().
 void bx_dbg_check_memory_watchpoints(unsigned cpu, bx_phy_address phy, unsigned len, unsigned rw)
 {
   bx_phy_address phy_end = phy + len - 1;
@@ -638,6 +641,8 @@ void bx_dbg_check_memory_watchpoints(unsigned cpu, bx_phy_address phy, unsigned
       if (watch_end < phy || phy_end < write_watchpoint[i].addr) continue;
       BX_CPU(cpu)->watchpoint  = phy;
       BX_CPU(cpu)->break_point = BREAK_POINT_WRITE;
+      // stop the trace after the current instruction
+      BX_CPU(cpu)->async_event |= BX_ASYNC_EVENT_STOP_TRACE;
       break;
     }
   }
@@ -648,11 +653,38 @@ void bx_dbg_check_memory_watchpoints(unsigned cpu, bx_phy_address phy, unsigned
       if (watch_end < phy || phy_end < read_watchpoint[i].addr) continue;
       BX_CPU(cpu)->watchpoint  = phy;
       BX_CPU(cpu)->break_point = BREAK_POINT_READ;
+      BX_CPU(cpu)->async_event |= BX_ASYNC_EVENT_STOP_TRACE;
       break;
     }
   }
 }
 
+static bool bx_dbg_watch_covers_page(const bx_watchpoint *wp, unsigned num, bx_phy_address ppf)
+{
+  for (unsigned i = 0; i < num; i++) {
+    if (PPFOf(wp[i].addr) <= ppf && ppf <= PPFOf(wp[i].addr + wp[i].len - 1))
+      return true;
+  }
+  return false;
+}
+
+// Returns true if the physical page has a read or write watchpoint. Direct
+// host access is not allowed for such pages, so every access to them goes
+// through the slow path where the watchpoints are checked.
+bool bx_dbg_watched_page(bx_phy_address ppf)
+{
+  return bx_dbg_watch_covers_page(write_watchpoint, num_write_watchpoints, ppf) ||
+         bx_dbg_watch_covers_page(read_watchpoint, num_read_watchpoints, ppf);
+}
+
+// must be called after the watchpoint lists were modified
+void bx_dbg_watchpoints_changed(void)
+{
+  // drop the TLB entries which might allow direct access to watched pages
+  for (unsigned cpu = 0; cpu < BX_SMP_PROCESSORS; cpu++)
+    BX_CPU(cpu)->TLB_flush();
+}
+
 extern const char *get_memtype_name(BxMemtype memtype);
 
 void bx_dbg_print_value(Bit8u *data, unsigned len)
@@ -707,8 +739,6 @@ void bx_dbg_print_value(Bit8u *data, unsigned len)
 
 void bx_dbg_lin_memory_access(unsigned cpu, bx_address lin, bx_phy_address phy, unsigned len, unsigned memtype, unsigned rw, Bit8u *data)
 {
-  bx_dbg_check_memory_watchpoints(cpu, phy, len, rw);
-
   if (! BX_CPU(cpu)->trace_mem)
     return;
 
@@ -725,8 +755,6 @@ void bx_dbg_lin_memory_access(unsigned cpu, bx_address lin, bx_phy_address phy,
 
 void bx_dbg_phy_memory_access(unsigned cpu, bx_phy_address phy, unsigned len, unsigned memtype, unsigned rw, unsigned access, Bit8u *data)
 {
-  bx_dbg_check_memory_watchpoints(cpu, phy, len, rw);
-
   if (! BX_CPU(cpu)->trace_mem)
     return;
 
@@ -2085,6 +2113,7 @@ void bx_dbg_watch(int type, bx_phy_address address, Bit32u len)
     read_watchpoint[num_read_watchpoints].addr = address;
     read_watchpoint[num_read_watchpoints].len = len;
     num_read_watchpoints++;
+    bx_dbg_watchpoints_changed();
     dbg_printf("read watchpoint at 0x" FMT_PHY_ADDRX " len=%d inserted\n", address, len);
   }
   else if (type == BX_WRITE) {
@@ -2095,6 +2124,7 @@ void bx_dbg_watch(int type, bx_phy_address address, Bit32u len)
     write_watchpoint[num_write_watchpoints].addr = address;
     write_watchpoint[num_write_watchpoints].len = len;
     num_write_watchpoints++;
+    bx_dbg_watchpoints_changed();
     dbg_printf("write watchpoint at 0x" FMT_PHY_ADDRX " len=%d inserted\n", address, len);
   }
   else {
@@ -2105,6 +2135,7 @@ void bx_dbg_watch(int type, bx_phy_address address, Bit32u len)
 void bx_dbg_unwatch_all()
 {
   num_read_watchpoints = num_write_watchpoints = 0;
+  bx_dbg_watchpoints_changed();
   dbg_printf("All watchpoints removed\n");
 }
 
@@ -2134,6 +2165,28 @@ void bx_dbg_unwatch(bx_phy_address address)
       break;
     }
   }
+
+  bx_dbg_watchpoints_changed();
+}
+
+// With a single processor the debugger runs full traces while continuing.
+// The breakpoints are checked by traps inserted into the traces in front of
+// the instructions which might hit them, see bx_dbg_map_bpoint_offsets().
+static void bx_dbg_set_fast_continue(bool enable)
+{
+#if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
+  // instruction trace and 'show' need to see every instruction
+  if (BX_SMP_PROCESSORS > 1 || BX_CPU(0)->trace || dbg_show_mask)
+    enable = false;
+
+  if (bx_dbg.fast_continue != enable) {
+    if (enable)
+      bx_dbg_map_bpoint_offsets(BX_CPU(0)->get_segment_base(BX_SEG_REG_CS));
+    bx_dbg.fast_continue = enable;
+    // rebuild the traces with (or without) the breakpoint traps
+    flushICaches();
+  }
+#endif
 }
 
 void bx_dbg_continue_command(bool expression)
@@ -2156,6 +2209,7 @@ one_more:
   SIM->set_display_mode(DISP_MODE_SIM);
 
   bx_guard.interrupt_requested = false;
+  bx_dbg_set_fast_continue(true);
   int stop = 0;
   int which = -1;
   while (!stop && !bx_guard.interrupt_requested) {
@@ -2213,6 +2267,8 @@ one_more:
 #endif
   }
 
+  bx_dbg_set_fast_continue(false);
+
   sim_running->set(0);
   SIM->refresh_ci();
 
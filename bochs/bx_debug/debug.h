@@ -192,6 +192,26 @@ void bx_dbg_phy_memory_access(unsigned cpu,                 bx_phy_address phy,
 
 // check memory access for watchpoints
 void bx_dbg_check_memory_watchpoints(unsigned cpu, bx_phy_address phy, unsigned len, unsigned rw);
+bool bx_dbg_watched_page(bx_phy_address ppf);
+void bx_dbg_watchpoints_changed(void);
+
+// page offsets of the instructions which might hit a breakpoint
+extern Bit8u bx_dbg_bpoint_offset_map[4096 / 8];
+// page offsets of the CS bases the virtual breakpoints are mapped for
+extern Bit8u bx_dbg_bpoint_base_map[4096 / 8];
+void bx_dbg_map_bpoint_offsets(bx_address cs_base);
+void bx_dbg_map_vir_bpoints(bx_address cs_base);
+
+BX_CPP_INLINE bool bx_dbg_bpoint_at_offset(Bit32u page_offset)
+{
+  return (bx_dbg_bpoint_offset_map[page_offset >> 3] >> (page_offset & 7)) & 1;
+}
+
+BX_CPP_INLINE bool bx_dbg_vir_bpoints_mapped(bx_address cs_base)
+{
+  Bit32u offset = (Bit32u) cs_base & 0xfff;
+  return (bx_dbg_bpoint_base_map[offset >> 3] >> (offset & 7)) & 1;
+}
 
 // commands that work with Bochs param tree
 void bx_dbg_restore_command(const char *param_name, const char *path);
@@ -60,6 +60,28 @@
 
 #endif
 
+// Ordered access to variables shared by exactly one producer and one consumer
+// thread (lock-free queues). The store publishes all writes done before it.
+
+#if defined(__GNUC__)
+#define BX_ATOMIC_LOAD(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define BX_ATOMIC_STORE(var,val) __atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+#elif defined(_MSC_VER)
+template <typename T> inline T bx_atomic_load(T *var)
+{
+  T val = *(volatile T*)var;
+  MemoryBarrier();
+  return val;
+}
+template <typename T> inline void bx_atomic_store(T *var, T val)
+{
+  MemoryBarrier();
+  *(volatile T*)var = val;
+}
+#define BX_ATOMIC_LOAD(var) bx_atomic_load(&(var))
+#define BX_ATOMIC_STORE(var,val) bx_atomic_store(&(var), (val))
+#endif
+
 typedef struct
 {
 #if defined(WIN32)
@@ -572,6 +572,18 @@ void bx_init_options()
       "dumpstats mode",
       "dump statistics period",
       0, BX_MAX_BIT32U, 0);
+  // metrics socket, set by command line arg
+  new bx_param_string_c(menu,
+      "metrics_socket",
+      "Metrics socket",
+      "Path of the local socket providing the statistics",
+      "", BX_PATHNAME_LEN);
+  // I/O port and MMIO heatmap, set by command line arg
+  new bx_param_bool_c(menu,
+      "heatmap",
+      "I/O heatmap",
+      "Count and sample the I/O port and MMIO accesses per device",
+      0);
   // unlock disk images
   new bx_param_bool_c(menu,
       "unlock_images",
@@ -1472,6 +1484,17 @@ void bx_init_options()
         BX_ATA_TRANSLATION_NONE);
       translation->set_ask_format("Enter translation type: [%s]");
 
+      static const char *atadevice_timing_names[] = { "realistic", "ssd", "instant", NULL };
+
+      bx_param_enum_c *timing = new bx_param_enum_c(menu,
+        "timing",
+        "Timing model",
+        "Seek / command completion timing (realistic, ssd or instant)",
+        atadevice_timing_names,
+        BX_DISK_TIMING_REALISTIC,
+        BX_DISK_TIMING_REALISTIC);
+      timing->set_ask_format("Enter timing model: [%s]");
+
       // the master/slave menu depends on the ATA channel's enabled flag
       enabled->get_dependent_list()->add(menu);
       // the type selector depends on the ATA channel's enabled flag
@@ -1479,8 +1502,8 @@ void bx_init_options()
 
       // all items depend on the drive type
       type->set_dependent_list(menu->clone(), 0);
-      type->set_dependent_bitmap(BX_ATA_DEVICE_DISK, 0xfe6);
-      type->set_dependent_bitmap(BX_ATA_DEVICE_CDROM, 0x60a);
+      type->set_dependent_bitmap(BX_ATA_DEVICE_DISK, 0x1fe6);
+      type->set_dependent_bitmap(BX_ATA_DEVICE_CDROM, 0x160a);
 
       type->set_handler(bx_param_handler);
     }
@@ -1707,6 +1730,18 @@ void bx_init_options()
   path->set_extension("log");
   path->set_enabled(BX_DEBUGGER);
 
+  new bx_param_bool_c(menu,
+      "async",
+      "Asynchronous log output",
+      "Write the log file from a separate thread",
+      0);
+  new bx_param_num_c(menu,
+      "rate_limit",
+      "Log rate limit",
+      "Maximum number of messages per module and emulated second (0 = no limit)",
+      0, BX_MAX_BIT32U,
+      0);
+
   // runtime options
   menu = new bx_list_c(special_menus, "runtime", "Runtime options");
   bx_list_c *cdrom = new bx_list_c(menu, "cdrom", "CD-ROM options");
@@ -2739,10 +2774,15 @@ static int parse_line_formatted(const char *context, int num_params, char *param
       PARSE_ERR(("%s: floppy_bootsig_check directive malformed.", context));
     }
   } else if (!strcmp(params[0], "log")) {
-    if (num_params != 2) {
+    if (num_params < 2) {
       PARSE_ERR(("%s: log directive has wrong # args.", context));
     }
     SIM->get_param_string(BXPN_LOG_FILENAME)->set(params[1]);
+    for (i=2; i<num_params; i++) {
+      if (bx_parse_param_from_list(context, params[i], (bx_list_c*) SIM->get_param("log")) < 0) {
+        PARSE_ERR(("%s: unknown parameter for log ignored.", context));
+      }
+    }
   } else if (!strcmp(params[0], "logprefix")) {
     if (num_params != 2) {
       PARSE_ERR(("%s: logprefix directive has wrong # args.", context));
@@ -3415,7 +3455,14 @@ int bx_write_log_options(FILE *fp, bx_list_c *base)
   bx_param_num_c *mparam;
   int action, def_action, level, mod;
 
-  fprintf(fp, "log: %s\n", SIM->get_param_string("filename", base)->getptr());
+  fprintf(fp, "log: %s", SIM->get_param_string("filename", base)->getptr());
+  if (SIM->get_param_bool("async", base)->get()) {
+    fprintf(fp, ", async=1");
+  }
+  if (SIM->get_param_num("rate_limit", base)->get() > 0) {
+    fprintf(fp, ", rate_limit=%u", (Bit32u) SIM->get_param_num("rate_limit", base)->get());
+  }
+  fprintf(fp, "\n");
   fprintf(fp, "logprefix: %s\n", SIM->get_param_string("prefix", base)->getptr());
 
   strcpy(pname, "general.logfn");
@@ -57,10 +57,20 @@ void BX_CPU_C::cpu_loop_debugger(void)
   BX_CPU_THIS_PTR break_point = 0;
   BX_CPU_THIS_PTR magic_break = 0;
   BX_CPU_THIS_PTR stop_reason = STOP_NO_REASON;
+  BX_CPU_THIS_PTR guard_found.icount_resume = get_icount();
+#if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
+  BX_CPU_THIS_PTR sync_icount();
+#endif
 
   if (setjmp(BX_CPU_THIS_PTR jmp_buf_env)) {
     // can get here only from exception function or VMEXIT
     BX_CPU_THIS_PTR icount++;
+#if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
+    if (bx_dbg.fast_continue) {
+      BX_SYNC_TIME_IF_SINGLE_PROCESSOR(0);
+    }
+    else
+#endif
     if (BX_SMP_PROCESSORS == 1) BX_TICK1();
     if (dbg_instruction_epilog()) return;
   }
@@ -89,6 +99,35 @@ void BX_CPU_C::cpu_loop_debugger(void)
       }
     }
 
+#if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
+    if (bx_dbg.fast_continue) {
+      // CS changes only between traces; the traps for the virtual
+      // breakpoints have to be added when a new CS base shows up
+      if ((bx_guard.guard_for & BX_DBG_GUARD_IADDR_VIR) &&
+          !bx_dbg_vir_bpoints_mapped(get_segment_base(BX_SEG_REG_CS))) {
+        bx_dbg_map_vir_bpoints(get_segment_base(BX_SEG_REG_CS));
+        flushICaches();
+      }
+      // execute the entire trace, the breakpoint traps inserted into the
+      // trace stop it at the instruction which hits a breakpoint
+      bxICacheEntry_c *entry = getICacheEntry();
+      if (bx_dbg_bpoint_at_offset(PAGE_OFFSET(entry->pAddr)) && dbg_breakpoint_trap())
+        return;
+
+      bxInstruction_c *i = entry->i;
+      BX_INSTR_BEFORE_EXECUTION(BX_CPU_ID, i);
+      RIP += i->ilen();
+      BX_CPU_CALL_METHOD(i->execute1, (i));
+
+      BX_SYNC_TIME_IF_SINGLE_PROCESSOR(0);
+
+      if (dbg_instruction_epilog()) return;
+
+      BX_CPU_THIS_PTR async_event &= ~BX_ASYNC_EVENT_STOP_TRACE;
+      continue;
+    }
+#endif
+
     // stop tracing after every instruction to handle in internal debugger
     BX_CPU_THIS_PTR async_event |= BX_ASYNC_EVENT_STOP_TRACE;
 
@@ -329,6 +368,8 @@ bxICacheEntry_c* BX_CPU_C::getICacheEntry(void)
 
   BX_ASSERT(entry->i->ilen() != 0);
 
+  BX_INSTR_TRACE(BX_CPU_ID, RIP, entry->pAddr, entry->tlen);
+
   return entry;
 }
 
@@ -350,6 +391,10 @@ void BX_CPP_AttrRegparmN(1) BX_CPU_C::linkTrace(bxInstruction_c *i)
   if (bx_dbg.debugger_active)
     return;
 
+  // linked traces would bypass the trace instrumentation callback
+  if (BX_INSTR_TRACE_ACTIVE(BX_CPU_ID))
+    return;
+
 #if BX_SUPPORT_SMP
   if (BX_SMP_PROCESSORS > 1)
     return;
@@ -403,6 +448,10 @@ void BX_CPP_AttrRegparmN(1) BX_CPU_C::linkTrace(bxInstruction_c *i)
   if (bx_dbg.debugger_active)
     return;
 
+  // linked traces would bypass the trace instrumentation callback
+  if (BX_INSTR_TRACE_ACTIVE(BX_CPU_ID))
+    return;
+
 #if BX_SUPPORT_SMP
   if (BX_SMP_PROCESSORS > 1)
     return;
@@ -474,7 +523,7 @@ void BX_CPP_AttrRegparmN(2) BX_CPU_C::repeat(bxInstruction_c *i, BxRepIterationP
     return;
   }
 
-  BX_ASSERT(! bx_dbg.debugger_active || BX_CPU_THIS_PTR async_event);
+  BX_ASSERT(! bx_dbg.debugger_active || bx_dbg.fast_continue || BX_CPU_THIS_PTR async_event);
 
   BX_CPU_THIS_PTR clear_RF();
 
@@ -849,69 +898,95 @@ bool BX_CPU_C::dbg_instruction_epilog(void)
   // Just committed an instruction, before fetching a new one
   // see if debugger is looking for iaddr breakpoint of any type
   if (bx_guard.guard_for) {
-    bx_address debug_eip = RIP;
-    Bit16u cs = BX_CPU_THIS_PTR sregs[BX_SEG_REG_CS].selector.value;
     dbg_get_guard_state(&BX_CPU_THIS_PTR guard_found.guard_state);
 
     if (bx_guard.guard_for & BX_DBG_GUARD_IADDR_ALL) {
+      // during the fast continue the breakpoint traps do the check
+      if (bx_dbg.fast_continue) {
+        if (BX_CPU_THIS_PTR guard_found.guard_found) return true;
+      }
+      else if (dbg_check_iaddr_bpoints()) {
+        return true; // on a breakpoint
+      }
+    }
+
+    // see if debugger requesting icount guard
+    if (bx_guard.guard_for & BX_DBG_GUARD_ICOUNT) {
+      if (get_icount() >= BX_CPU_THIS_PTR guard_found.icount_max) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Called during the fast continue before an instruction which might hit
+// a breakpoint. The instruction the execution was resumed at is not checked.
+bool BX_CPU_C::dbg_breakpoint_trap(void)
+{
+  if (BX_CPU_THIS_PTR icount == BX_CPU_THIS_PTR guard_found.icount_resume)
+    return false;
+
+  dbg_get_guard_state(&BX_CPU_THIS_PTR guard_found.guard_state);
+  return dbg_check_iaddr_bpoints();
+}
+
+// Check the instruction address breakpoints against the guard state
+bool BX_CPU_C::dbg_check_iaddr_bpoints(void)
+{
+  bx_address debug_eip = BX_CPU_THIS_PTR guard_found.guard_state.eip;
+  Bit16u cs = BX_CPU_THIS_PTR guard_found.guard_state.cs;
+
 #if (BX_DBG_MAX_VIR_BPOINTS > 0)
-      if (bx_guard.guard_for & BX_DBG_GUARD_IADDR_VIR) {
-        for (unsigned n=0; n<bx_guard.iaddr.num_virtual; n++) {
-          if (bx_guard.iaddr.vir[n].enabled &&
-             (bx_guard.iaddr.vir[n].cs  == cs) &&
-             (bx_guard.iaddr.vir[n].eip == debug_eip))
-          {
-            if (! bx_guard.iaddr.vir[n].condition || bx_dbg_eval_condition(bx_guard.iaddr.vir[n].condition)) {
-              BX_CPU_THIS_PTR guard_found.guard_found = BX_DBG_GUARD_IADDR_VIR;
-              BX_CPU_THIS_PTR guard_found.iaddr_index = n;
-              return true; // on a breakpoint
-            }
-          }
+  if (bx_guard.guard_for & BX_DBG_GUARD_IADDR_VIR) {
+    for (unsigned n=0; n<bx_guard.iaddr.num_virtual; n++) {
+      if (bx_guard.iaddr.vir[n].enabled &&
+         (bx_guard.iaddr.vir[n].cs  == cs) &&
+         (bx_guard.iaddr.vir[n].eip == debug_eip))
+      {
+        if (! bx_guard.iaddr.vir[n].condition || bx_dbg_eval_condition(bx_guard.iaddr.vir[n].condition)) {
+          BX_CPU_THIS_PTR guard_found.guard_found = BX_DBG_GUARD_IADDR_VIR;
+          BX_CPU_THIS_PTR guard_found.iaddr_index = n;
+          return true; // on a breakpoint
         }
       }
+    }
+  }
 #endif
 #if (BX_DBG_MAX_LIN_BPOINTS > 0)
-      if (bx_guard.guard_for & BX_DBG_GUARD_IADDR_LIN) {
-        for (unsigned n=0; n<bx_guard.iaddr.num_linear; n++) {
-          if (bx_guard.iaddr.lin[n].enabled &&
-             (bx_guard.iaddr.lin[n].addr == BX_CPU_THIS_PTR guard_found.guard_state.laddr))
-          {
-            if (! bx_guard.iaddr.lin[n].condition || bx_dbg_eval_condition(bx_guard.iaddr.lin[n].condition)) {
-              BX_CPU_THIS_PTR guard_found.guard_found = BX_DBG_GUARD_IADDR_LIN;
-              BX_CPU_THIS_PTR guard_found.iaddr_index = n;
-              return true; // on a breakpoint
-            }
-          }
+  if (bx_guard.guard_for & BX_DBG_GUARD_IADDR_LIN) {
+    for (unsigned n=0; n<bx_guard.iaddr.num_linear; n++) {
+      if (bx_guard.iaddr.lin[n].enabled &&
+         (bx_guard.iaddr.lin[n].addr == BX_CPU_THIS_PTR guard_found.guard_state.laddr))
+      {
+        if (! bx_guard.iaddr.lin[n].condition || bx_dbg_eval_condition(bx_guard.iaddr.lin[n].condition)) {
+          BX_CPU_THIS_PTR guard_found.guard_found = BX_DBG_GUARD_IADDR_LIN;
+          BX_CPU_THIS_PTR guard_found.iaddr_index = n;
+          return true; // on a breakpoint
         }
       }
+    }
+  }
 #endif
 #if (BX_DBG_MAX_PHY_BPOINTS > 0)
-      if (bx_guard.guard_for & BX_DBG_GUARD_IADDR_PHY) {
-        bx_phy_address phy;
-        bool valid = dbg_xlate_linear2phy(BX_CPU_THIS_PTR guard_found.guard_state.laddr, &phy);
-        if (valid) {
-          for (unsigned n=0; n<bx_guard.iaddr.num_physical; n++) {
-            if (bx_guard.iaddr.phy[n].enabled && (bx_guard.iaddr.phy[n].addr == phy))
-            {
-              if (! bx_guard.iaddr.phy[n].condition || bx_dbg_eval_condition(bx_guard.iaddr.phy[n].condition)) {
-                BX_CPU_THIS_PTR guard_found.guard_found = BX_DBG_GUARD_IADDR_PHY;
-                BX_CPU_THIS_PTR guard_found.iaddr_index = n;
-                return true; // on a breakpoint
-              }
-            }
+  if (bx_guard.guard_for & BX_DBG_GUARD_IADDR_PHY) {
+    bx_phy_address phy;
+    bool valid = dbg_xlate_linear2phy(BX_CPU_THIS_PTR guard_found.guard_state.laddr, &phy);
+    if (valid) {
+      for (unsigned n=0; n<bx_guard.iaddr.num_physical; n++) {
+        if (bx_guard.iaddr.phy[n].enabled && (bx_guard.iaddr.phy[n].addr == phy))
+        {
+          if (! bx_guard.iaddr.phy[n].condition || bx_dbg_eval_condition(bx_guard.iaddr.phy[n].condition)) {
+            BX_CPU_THIS_PTR guard_found.guard_found = BX_DBG_GUARD_IADDR_PHY;
+            BX_CPU_THIS_PTR guard_found.iaddr_index = n;
+            return true; // on a breakpoint
           }
         }
       }
-#endif
-    }
-
-    // see if debugger requesting icount guard
-    if (bx_guard.guard_for & BX_DBG_GUARD_ICOUNT) {
-      if (get_icount() >= BX_CPU_THIS_PTR guard_found.icount_max) {
-        return true;
-      }
     }
   }
+#endif
 
   return false;
 }
@@ -869,6 +869,7 @@ typedef struct bx_dbg_guard_state_t {
 typedef struct bx_guard_found_t {
   unsigned guard_found;
   Bit64u icount_max; // stop after completing this many instructions
+  Bit64u icount_resume; // breakpoint traps ignore the instruction execution resumed at
   unsigned iaddr_index;
   bx_dbg_guard_state_t guard_state;
 } bx_guard_found_t;
@@ -4423,6 +4424,9 @@ public: // for now...
   BX_SMF void BxError(bxInstruction_c *) BX_CPP_AttrRegparmN(1);
 #if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
   BX_SMF void BxEndTrace(bxInstruction_c *) BX_CPP_AttrRegparmN(1);
+#if BX_DEBUGGER
+  BX_SMF void BxDebugTrap(bxInstruction_c *) BX_CPP_AttrRegparmN(1);
+#endif
 #endif
 
   BX_SMF void BxNoFPU(bxInstruction_c *) BX_CPP_AttrRegparmN(1);
@@ -4466,6 +4470,8 @@ public: // for now...
 #endif
 #if BX_DEBUGGER
   BX_SMF bool dbg_instruction_epilog(void);
+  BX_SMF bool dbg_check_iaddr_bpoints(void);
+  BX_SMF bool dbg_breakpoint_trap(void);
 #endif
 #if BX_GDBSTUB
   BX_SMF bool gdbstub_instruction_epilog(void);
@@ -26,9 +26,9 @@
 
 #define InstrumentICACHE 0
 #define InstrumentTLB 0
-#define InstrumentTLBFlush 0
+#define InstrumentTLBFlush 1
 #define InstrumentStackPrefetch 0
-#define InstrumentSMC 0
+#define InstrumentSMC 1
 
 // indicate if any of the CPU statistics was compiled in
 #define InstrumentCPU (InstrumentICACHE + InstrumentTLB + InstrumentTLBFlush + InstrumentStackPrefetch + InstrumentSMC)
@@ -225,6 +225,7 @@ void BX_CPP_AttrRegparmN(1) BX_CPU_C::XCHG_EwGwR(bxInstruction_c *i)
   */
   if (bx_dbg.debugger_active && bx_dbg.magic_break && i->src() == i->dst() && (bx_dbg.magic_break & (1 << (i->src())))) {
     BX_CPU_THIS_PTR magic_break = 1;
+    BX_CPU_THIS_PTR async_event |= BX_ASYNC_EVENT_STOP_TRACE;
     BX_NEXT_INSTR(i);
   }
 #endif
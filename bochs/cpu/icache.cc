@@ -32,8 +32,18 @@
 
 #include "decoder/ia_opcodes.h"
 
+#include "bx_debug/debug.h"
+
 bxPageWriteStampTable pageWriteStampTable;
 
+// The internal debugger single steps through one instruction traces, unless
+// it continues with the breakpoint traps inserted into the traces
+#if BX_DEBUGGER
+#define BX_DBG_SINGLE_STEP_TRACES (bx_dbg.debugger_active && ! bx_dbg.fast_continue)
+#else
+#define BX_DBG_SINGLE_STEP_TRACES (bx_dbg.debugger_active)
+#endif
+
 extern int fetchDecode32(const Bit8u *fetchPtr, bool is_32, bxInstruction_c *i, unsigned remainingInPage);
 #if BX_SUPPORT_X86_64
 extern int fetchDecode64(const Bit8u *fetchPtr, bxInstruction_c *i, unsigned remainingInPage);
@@ -51,9 +61,10 @@ void flushICaches(void)
 
 void handleSMC(bx_phy_address pAddr, Bit32u mask)
 {
-  INC_SMC_STAT(smc);
-
   for (unsigned i=0; i<BX_SMP_PROCESSORS; i++) {
+#if InstrumentSMC
+    INC_STAT(BX_CPU(i)->stats->smc);
+#endif
     BX_CPU(i)->async_event |= BX_ASYNC_EVENT_STOP_TRACE;
     BX_CPU(i)->iCache.handleSMC(pAddr, mask);
   }
@@ -64,7 +75,7 @@ void flushSMC(bxICacheEntry_c *e)
   if (e->pAddr != BX_ICACHE_INVALID_PHY_ADDRESS) {
     e->pAddr = BX_ICACHE_INVALID_PHY_ADDRESS;
 #if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
-    if (! bx_dbg.debugger_active) {
+    if (! BX_DBG_SINGLE_STEP_TRACES) {
       extern void genDummyICacheEntry(bxInstruction_c *i);
 //    for (unsigned instr=0;instr < e->tlen; instr++)
 //      genDummyICacheEntry(e->i + instr);
@@ -90,6 +101,29 @@ void genDummyICacheEntry(bxInstruction_c *i)
   i->execute1 = &BX_CPU_C::BxEndTrace;
 }
 
+#if BX_DEBUGGER
+
+void BX_CPU_C::BxDebugTrap(bxInstruction_c *i)
+{
+  // the next instruction might hit a breakpoint
+  if (dbg_breakpoint_trap()) {
+    BX_CPU_THIS_PTR async_event |= BX_ASYNC_EVENT_STOP_TRACE;
+    return;
+  }
+
+  ++i;
+  BX_EXECUTE_INSTRUCTION(i);
+}
+
+static void genDebugTrapICacheEntry(bxInstruction_c *i)
+{
+  i->setILen(0);
+  i->setIaOpcode(BX_INSERTED_OPCODE);
+  i->execute1 = &BX_CPU_C::BxDebugTrap;
+}
+
+#endif
+
 #endif
 
 bxICacheEntry_c* BX_CPU_C::serveICacheMiss(Bit32u eipBiased, bx_phy_address pAddr)
@@ -118,16 +152,25 @@ bxICacheEntry_c* BX_CPU_C::serveICacheMiss(Bit32u eipBiased, bx_phy_address pAdd
 #endif
 
   // Don't allow traces longer than cpu_loop can execute
-  static unsigned quantum =
+  static unsigned max_quantum =
 #if BX_SUPPORT_SMP
     (BX_SMP_PROCESSORS > 1) ? SIM->get_param_num(BXPN_SMP_QUANTUM)->get() :
 #endif
     BX_MAX_TRACE_LENGTH;
-  if (bx_dbg.debugger_active)
-    quantum = 1;
+  unsigned quantum = BX_DBG_SINGLE_STEP_TRACES ? 1 : max_quantum;
 
   for (unsigned n=0;n < quantum;n++)
   {
+#if BX_DEBUGGER && BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
+    // the first instruction of the trace is checked by the debugger loop
+    if (n > 0 && bx_dbg.fast_continue && bx_dbg_bpoint_at_offset(pageOffset)) {
+      // the trap takes a trace slot, keep room for the instruction itself
+      if (++n == quantum) break;
+      genDebugTrapICacheEntry(i++);
+      entry->tlen++;
+    }
+#endif
+
 #if BX_SUPPORT_X86_64
     if (BX_CPU_THIS_PTR cpu_mode == BX_MODE_LONG_64)
       ret = fetchDecode64(fetchPtr, i, remainingInPage);
@@ -155,7 +198,7 @@ bxICacheEntry_c* BX_CPU_C::serveICacheMiss(Bit32u eipBiased, bx_phy_address pAdd
       pageWriteStampTable.markICacheMask(entry->pAddr, entry->traceMask);
       pageWriteStampTable.markICacheMask(BX_CPU_THIS_PTR pAddrFetchPage, 0x1);
 
-      if (! bx_dbg.debugger_active) {
+      if (! BX_DBG_SINGLE_STEP_TRACES) {
 #if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
         entry->tlen++; /* Add the inserted end of trace opcode */
         genDummyICacheEntry(++i);
@@ -191,7 +234,7 @@ bxICacheEntry_c* BX_CPU_C::serveICacheMiss(Bit32u eipBiased, bx_phy_address pAdd
     fetchPtr += iLen;
 
     // try to find a trace starting from current pAddr and merge
-    if (!bx_dbg.debugger_active) {
+    if (! BX_DBG_SINGLE_STEP_TRACES) {
       if (remainingInPage >= 15) { // avoid merging with page split trace
         if (mergeTraces(entry, i, pAddr)) {
           entry->traceMask |= traceMask;
@@ -207,7 +250,7 @@ bxICacheEntry_c* BX_CPU_C::serveICacheMiss(Bit32u eipBiased, bx_phy_address pAdd
 
   pageWriteStampTable.markICacheMask(pAddr, entry->traceMask);
 
-  if (! bx_dbg.debugger_active) {
+  if (! BX_DBG_SINGLE_STEP_TRACES) {
 #if BX_SUPPORT_HANDLERS_CHAINING_SPEEDUPS
     entry->tlen++; /* Add the inserted end of trace opcode */
     genDummyICacheEntry(i);
@@ -221,7 +264,13 @@ bxICacheEntry_c* BX_CPU_C::serveICacheMiss(Bit32u eipBiased, bx_phy_address pAdd
 
 bool BX_CPU_C::mergeTraces(bxICacheEntry_c *entry, bxInstruction_c *i, bx_phy_address pAddr)
 {
-  BX_ASSERT(!bx_dbg.debugger_active);
+  BX_ASSERT(! BX_DBG_SINGLE_STEP_TRACES);
+
+#if BX_DEBUGGER
+  // the first instruction of the merged trace has no breakpoint trap
+  if (bx_dbg.fast_continue && bx_dbg_bpoint_at_offset(PAGE_OFFSET(pAddr)))
+    return false;
+#endif
 
   bxICacheEntry_c *e = BX_CPU_THIS_PTR iCache.find_entry(pAddr, BX_CPU_THIS_PTR fetchModeMask);
 
@@ -255,7 +255,11 @@ void BX_CPU_C::init_statistics(void)
 #if InstrumentCPU
   stats = new bx_cpu_statistics;
 
-  bx_list_c *cpu = new bx_list_c(SIM->get_statistics_root(), get_name(), get_name());
+  bx_list_c *list = (bx_list_c*) SIM->get_statistics_root()->get_by_name("cpu");
+  if (list == NULL) {
+    list = new bx_list_c(SIM->get_statistics_root(), "cpu", "CPU statistics");
+  }
+  bx_list_c *cpu = new bx_list_c(list, get_name(), get_name());
 
 #if InstrumentICACHE
   new bx_shadow_num_c(cpu, "iCacheLookups", &stats->iCacheLookups);
@@ -1495,6 +1495,9 @@ bx_phy_address BX_CPU_C::translate_linear(bx_TLB_entry *tlbEntry, bx_address lad
     // All access allowed also via direct pointer
 #if BX_X86_DEBUGGER
     if (! hwbreakpoint_check(laddr, BX_HWDebugMemW, BX_HWDebugMemRW))
+#endif
+#if BX_DEBUGGER
+    if (! bx_dbg_watched_page(ppf)) // watchpoints are checked in the slow path
 #endif
        tlbEntry->lpf = lpf; // allow direct access with HostPtr
   }
@@ -2509,6 +2512,8 @@ bx_hostpageaddr_t BX_CPU_C::getHostMemAddr(bx_phy_address paddr, unsigned rw)
 
 void BX_CPU_C::access_read_physical(bx_phy_address paddr, unsigned len, void *data)
 {
+  BX_DBG_CHECK_WATCHPOINTS(BX_CPU_ID, paddr, len, BX_READ);
+
 #if BX_SUPPORT_VMX && BX_SUPPORT_X86_64
   if (is_virtual_apic_page(paddr)) {
     paddr = VMX_Virtual_Apic_Read(paddr, len, data);
@@ -2559,6 +2564,8 @@ Bit64u BX_CPU_C::read_physical_qword(bx_phy_address paddr, BxMemtype memtype, Ac
 
 void BX_CPU_C::access_write_physical(bx_phy_address paddr, unsigned len, void *data)
 {
+  BX_DBG_CHECK_WATCHPOINTS(BX_CPU_ID, paddr, len, BX_WRITE);
+
 #if BX_SUPPORT_VMX && BX_SUPPORT_X86_64
   if (is_virtual_apic_page(paddr)) {
     VMX_Virtual_Apic_Write(paddr, len, data);
@@ -66,7 +66,14 @@ static int hex(char ch)
   return(-1);
 }
 
-static char buf[4096], *bufptr = buf;
+// The remote protocol is read and written through buffers, so that
+// a packet costs a few socket calls instead of one call per character.
+#define GDBSTUB_PACKET_SIZE (0x20000)
+
+static char buf[16384], *bufptr = buf;
+static char inbuf[4096];
+static int inbuf_pos = 0, inbuf_len = 0;
+static bool no_ack_mode = 0;
 
 static void flush_debug_buffer()
 {
@@ -89,51 +96,99 @@ static void put_debug_char(char ch)
   *bufptr++ = ch;
 }
 
-static char get_debug_char(void)
+// refill the input buffer, returns 0 if no data is available
+static bool fill_debug_buffer(bool wait)
 {
-  char ch;
+  int n;
 
-  recv(socket_fd, &ch, 1, 0);
+#if defined(__CYGWIN__) || defined(__MINGW32__) || defined(_MSC_VER)
+  if (!wait) {
+    fd_set fds;
+    struct timeval tv = {0, 0};
+    FD_ZERO(&fds);
+    FD_SET(socket_fd, &fds);
+    if (select(socket_fd + 1, &fds, NULL, NULL, &tv) != 1)
+      return 0;
+  }
+  n = recv(socket_fd, inbuf, sizeof(inbuf), 0);
+#else
+  n = recv(socket_fd, inbuf, sizeof(inbuf), wait ? 0 : MSG_DONTWAIT);
+#endif
+  if (n <= 0) {
+    if (!wait && n < 0)
+      return 0;
+    BX_PANIC(("gdb connection closed"));
+    return 0;
+  }
+  inbuf_pos = 0;
+  inbuf_len = n;
+  return 1;
+}
 
-  return(ch);
+static bool debug_input_pending(void)
+{
+  return (inbuf_pos < inbuf_len) || fill_debug_buffer(0);
+}
+
+static char get_debug_char(void)
+{
+  if (inbuf_pos == inbuf_len) {
+    if (!fill_debug_buffer(1))
+      return 0;
+  }
+
+  return inbuf[inbuf_pos++];
 }
 
 static const char hexchars[]="0123456789abcdef";
 
-static void put_reply(const char* buffer)
+// Send a reply packet. Binary data has '#', '$', '}' and '*' escaped.
+static void put_packet(const char* buffer, int len, bool binary)
 {
   unsigned char csum;
   int i;
 
-  BX_DEBUG(("put_buffer '%s'", buffer));
+  BX_DEBUG(("put_buffer '%.*s'", binary ? 0 : len, buffer));
 
   do {
     put_debug_char('$');
 
     csum = 0;
 
-    i = 0;
-    while (buffer[i] != 0)
+    for (i = 0; i < len; i++)
     {
-      put_debug_char(buffer[i]);
-      csum = csum + buffer[i];
-      i++;
+      char ch = buffer[i];
+      if (binary && (ch == '#' || ch == '$' || ch == '}' || ch == '*'))
+      {
+        put_debug_char('}');
+        csum = csum + '}';
+        ch ^= 0x20;
+      }
+      put_debug_char(ch);
+      csum = csum + ch;
     }
 
     put_debug_char('#');
     put_debug_char(hexchars[csum >> 4]);
     put_debug_char(hexchars[csum % 16]);
     flush_debug_buffer();
-  } while (get_debug_char() != '+');
+  } while (!no_ack_mode && get_debug_char() != '+');
+}
+
+static void put_reply(const char* buffer)
+{
+  put_packet(buffer, strlen(buffer), 0);
 }
 
-static void get_command(char* buffer)
+// Receive a command packet into buffer (GDBSTUB_PACKET_SIZE + 1 bytes) and
+// return its length. Binary data in the packet is left escaped.
+static int get_command(char* buffer)
 {
   unsigned char checksum;
   unsigned char xmitcsum;
   char ch;
-  unsigned int count;
-  unsigned int i;
+  int count;
+  int i;
 
   do {
     while ((ch = get_debug_char()) != '$');
@@ -147,19 +202,18 @@ static void get_command(char* buffer)
       ch = get_debug_char();
       if (ch == '#') break;
       checksum = checksum + ch;
-      buffer[count] = ch;
+      if (count < GDBSTUB_PACKET_SIZE)
+        buffer[count] = ch;
       count++;
     }
-    buffer[count] = 0;
 
-    if (ch == '#')
+    xmitcsum = hex(get_debug_char()) << 4;
+    xmitcsum += hex(get_debug_char());
+    if (checksum != xmitcsum)
     {
-      xmitcsum = hex(get_debug_char()) << 4;
-      xmitcsum += hex(get_debug_char());
-      if (checksum != xmitcsum)
-      {
-        BX_INFO(("Bad checksum"));
-      }
+      BX_INFO(("Bad checksum"));
+      // there is no retransmission in no-ack mode
+      if (no_ack_mode) break;
     }
 
     if (checksum != xmitcsum)
@@ -167,22 +221,31 @@ static void get_command(char* buffer)
       put_debug_char('-');
       flush_debug_buffer();
     }
-    else
+    else if (!no_ack_mode)
     {
       put_debug_char('+');
-      if (buffer[2] == ':')
-      {
-        put_debug_char(buffer[0]);
-        put_debug_char(buffer[1]);
-        count = strlen(buffer);
-        for (i = 3; i <= count; i++)
-        {
-          buffer[i - 3] = buffer[i];
-        }
-      }
       flush_debug_buffer();
     }
   } while (checksum != xmitcsum);
+
+  if (count > GDBSTUB_PACKET_SIZE)
+  {
+    BX_INFO(("Packet too long"));
+    count = GDBSTUB_PACKET_SIZE;
+  }
+  buffer[count] = 0;
+  if (count >= 3 && buffer[2] == ':' && !no_ack_mode)
+  {
+    put_debug_char(buffer[0]);
+    put_debug_char(buffer[1]);
+    flush_debug_buffer();
+    count -= 3;
+    for (i = 0; i <= count; i++)
+    {
+      buffer[i] = buffer[i + 3];
+    }
+  }
+  return count;
 }
 
 void hex2mem(char* buf, unsigned char* mem, int count)
@@ -261,13 +324,6 @@ int bx_gdbstub_check(Bit64u eip)
 {
   unsigned int i;
   unsigned char ch;
-  int r;
-#if defined(__CYGWIN__) || defined(__MINGW32__) || defined(_MSC_VER)
-  fd_set fds;
-  struct timeval tv = {0, 0};
-#else
-  long arg;
-#endif
 
   if (bx_enter_gdbstub)
   {
@@ -278,28 +334,12 @@ int bx_gdbstub_check(Bit64u eip)
 
   instr_count++;
 
-  if ((instr_count % 500) == 0)
+  if ((instr_count % 500) == 0 && debug_input_pending())
   {
-#if defined(__CYGWIN__) || defined(__MINGW32__) || defined(_MSC_VER)
-    FD_ZERO(&fds);
-    FD_SET(socket_fd, &fds);
-    r = select(socket_fd + 1, &fds, NULL, NULL, &tv);
-    if (r == 1)
-    {
-      r = recv(socket_fd, (char *)&ch, 1, 0);
-    }
-#else
-    arg = fcntl(socket_fd, F_GETFL);
-    fcntl(socket_fd, F_SETFL, arg | O_NONBLOCK);
-    r = recv(socket_fd, &ch, 1, 0);
-    fcntl(socket_fd, F_SETFL, arg);
-#endif
-    if (r == 1)
-    {
-      BX_INFO(("Got byte %x", (unsigned int)ch));
-      last_stop_reason = GDBSTUB_USER_BREAK;
-      return GDBSTUB_USER_BREAK;
-    }
+    ch = get_debug_char();
+    BX_INFO(("Got byte %x", (unsigned int)ch));
+    last_stop_reason = GDBSTUB_USER_BREAK;
+    return GDBSTUB_USER_BREAK;
   }
 
   for (i = 0; i < nr_breakpoints; i++)
@@ -395,52 +435,258 @@ static void write_signal(char* buf, int signal)
   buf[2] = 0;
 }
 
-static int access_linear(Bit64u laddress,
-                        unsigned len,
-                        unsigned int rw,
-                        Bit8u* data)
+static bool access_linear(Bit64u laddress,
+                          unsigned len,
+                          unsigned int rw,
+                          Bit8u* data)
 {
   bx_phy_address phys;
   bool valid;
 
-  if (((laddress & 0xfff) + len) > 4096)
+  // translate and copy one page at a time
+  while (len > 0)
   {
-    valid = access_linear(laddress,
-                          4096 - (laddress & 0xfff),
-                          rw,
-                          data);
+    unsigned chunk = 4096 - (unsigned)(laddress & 0xfff);
+    if (chunk > len) chunk = len;
+
+    valid = BX_CPU(0)->dbg_xlate_linear2phy(laddress, (bx_phy_address*)&phys);
+    if (!valid || !IsValidPhyAddr(phys)) return(0);
+
+    if (rw & 1) {
+      valid = BX_MEM(0)->dbg_set_mem(BX_CPU(0), phys, chunk, data);
+    } else {
+      valid = BX_MEM(0)->dbg_fetch_mem(BX_CPU(0), phys, chunk, data);
+    }
     if (!valid) return(0);
 
-    valid = access_linear(laddress,
-                          len + (laddress & 0xfff) - 4096,
-                          rw,
-                          (Bit8u *)(data + (4096 - (laddress & 0xfff))));
-    return(valid);
+    laddress += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+
+  return(1);
+}
+
+static char buffer[GDBSTUB_PACKET_SIZE + 1];
+static char obuf[GDBSTUB_PACKET_SIZE + 1];
+static Bit8u mem[GDBSTUB_PACKET_SIZE];
+
+static void write_memory(Bit64u addr, int len, Bit8u *data)
+{
+  if (len == 1 && data[0] == 0xcc)
+  {
+    insert_breakpoint(addr);
+    put_reply("OK");
+  }
+  else if (remove_breakpoint(addr, len))
+  {
+    put_reply("OK");
+  }
+  else
+  {
+    if (access_linear(addr, len, BX_WRITE, data))
+    {
+      put_reply("OK");
+    }
+    else
+    {
+      put_reply("Eff");
+    }
+  }
+}
+
+static void set_register(int reg, Bit64u value)
+{
+  BX_INFO(("reg %d set to " FMT_ADDRX64, reg, value));
+#if BX_SUPPORT_X86_64 == 0
+  switch (reg)
+  {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    case 5:
+    case 6:
+    case 7:
+      BX_CPU_THIS_PTR set_reg32(reg, value);
+      break;
+
+    case 8:
+      EIP = value;
+      BX_CPU_THIS_PTR invalidate_prefetch_q();
+      break;
+
+    default:
+      break;
   }
+#else
+  // gdb register numbers are rax, rbx, rcx, rdx, rsi, rdi, rbp, rsp, r8-r15
+  static const int gdb_regs[16] = {
+    BX_64BIT_REG_RAX, BX_64BIT_REG_RBX, BX_64BIT_REG_RCX, BX_64BIT_REG_RDX,
+    BX_64BIT_REG_RSI, BX_64BIT_REG_RDI, BX_64BIT_REG_RBP, BX_64BIT_REG_RSP,
+    BX_64BIT_REG_R8,  BX_64BIT_REG_R9,  BX_64BIT_REG_R10, BX_64BIT_REG_R11,
+    BX_64BIT_REG_R12, BX_64BIT_REG_R13, BX_64BIT_REG_R14, BX_64BIT_REG_R15
+  };
+
+  switch (reg)
+  {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    case 5:
+    case 6:
+    case 7:
+    case 8:
+    case 9:
+    case 10:
+    case 11:
+    case 12:
+    case 13:
+    case 14:
+    case 15:
+      BX_CPU_THIS_PTR set_reg64(gdb_regs[reg], value);
+      break;
 
-  valid = BX_CPU(0)->dbg_xlate_linear2phy(laddress, (bx_phy_address*)&phys);
-  if (!valid) return(0);
+    case 16:
+      RIP = value;
+      BX_CPU_THIS_PTR invalidate_prefetch_q();
+      break;
 
-  if (rw & 1) {
-    valid = BX_MEM(0)->dbg_set_mem(BX_CPU(0), phys, len, data);
-  } else {
-    valid = BX_MEM(0)->dbg_fetch_mem(BX_CPU(0), phys, len, data);
+    default:
+      break;
   }
+#endif
+}
+
+static void resume(bool step)
+{
+  stub_trace_flag = step;
+  bx_cpu.cpu_loop();
+  SIM->refresh_vga();
+  stub_trace_flag = 0;
+}
+
+static void put_stop_reply(bool step)
+{
+  char buf[8];
 
-  return(valid);
+  BX_INFO(("stopped with %x", last_stop_reason));
+  buf[0] = 'S';
+  if (step || last_stop_reason == GDBSTUB_EXECUTION_BREAKPOINT ||
+      last_stop_reason == GDBSTUB_TRACE)
+  {
+    write_signal(&buf[1], SIGTRAP);
+  }
+  else
+  {
+    write_signal(&buf[1], 0);
+  }
+  put_reply(buf);
 }
 
+// 'vCont[;action[:thread-id]]...' The only thread is CPU 0 (thread 1),
+// the leftmost action that applies to it is performed.
+static void do_vcont(char *p)
+{
+  if (*p == '?')
+  {
+    put_reply("vCont;c;C;s;S");
+    return;
+  }
+
+  while (*p == ';')
+  {
+    char action = p[1];
+    long thread = -1;
+
+    p += 2;
+    if (action == 'C' || action == 'S')
+      strtoul(p, &p, 16); // signals are not delivered to the guest
+    if (*p == ':')
+      thread = strtol(p + 1, &p, 16);
+    if (thread == -1 || thread == 1)
+    {
+      if (action == 'c' || action == 'C' || action == 's' || action == 'S')
+      {
+        bool step = (action == 's' || action == 'S');
+        resume(step);
+        put_stop_reply(step);
+        return;
+      }
+      break;
+    }
+    while (*p != 0 && *p != ';') p++;
+  }
+  put_reply("E01");
+}
+
+// Reply to 'qXfer:object:read:annex:offset,length' with a part of doc
+static void xfer_reply(const char *doc, char *p)
+{
+  char *ebuf;
+  unsigned long offset = strtoul(p, &ebuf, 16);
+  unsigned long len = strtoul(ebuf + 1, NULL, 16);
+  unsigned long size = strlen(doc);
+
+  if (offset >= size)
+  {
+    put_reply("l");
+    return;
+  }
+  if (len > GDBSTUB_PACKET_SIZE - 1)
+    len = GDBSTUB_PACKET_SIZE - 1;
+  if (len >= size - offset)
+  {
+    len = size - offset;
+    obuf[0] = 'l';
+  }
+  else
+  {
+    obuf[0] = 'm';
+  }
+  memcpy(obuf + 1, doc + offset, len);
+  put_packet(obuf, len + 1, 1);
+}
+
+// Only the architecture is described, gdb uses its default register set
+// for it which matches the 'g' packet layout.
+static const char target_xml[] =
+  "<?xml version=\"1.0\"?>"
+  "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+  "<target>"
+#if BX_SUPPORT_X86_64
+  "<architecture>i386:x86-64</architecture>"
+#else
+  "<architecture>i386</architecture>"
+#endif
+  "</target>";
+
+// gdb addresses are linear and go through the page tables, so the whole
+// address space is reported as RAM.
+static const char memory_map_xml[] =
+  "<?xml version=\"1.0\"?>"
+  "<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\""
+  " \"http://sourceware.org/gdb/gdb-memory-map.dtd\">"
+  "<memory-map>"
+#if BX_SUPPORT_X86_64
+  "<memory type=\"ram\" start=\"0x0\" length=\"0xffffffffffffffff\"/>"
+#else
+  "<memory type=\"ram\" start=\"0x0\" length=\"0x100000000\"/>"
+#endif
+  "</memory-map>";
+
 static void debug_loop(void)
 {
-  char buffer[255];
-  char obuf[1024];
   int ne = 0;
-  Bit8u mem[255];
+  int packet_len;
 
   while (ne == 0)
   {
     SIM->get_param_bool(BXPN_MOUSE_ENABLED)->set(0);
-    get_command(buffer);
+    packet_len = get_command(buffer);
     BX_DEBUG(("get_buffer '%s'", buffer));
 
     // At a minimum, a stub is required to support the g and G commands for register access,
@@ -456,12 +702,11 @@ static void debug_loop(void)
       // This packet is deprecated for multi-threading support. See [vCont packet]
       case 'c':
       {
-        char buf[255];
         Bit32u new_eip;
 
         if (buffer[1] != 0)
         {
-          new_eip = (Bit32u) atoi(buffer + 1);
+          new_eip = (Bit32u) strtoul(buffer + 1, NULL, 16);
 
           BX_INFO(("continuing at %x", new_eip));
 
@@ -473,10 +718,7 @@ static void debug_loop(void)
           BX_CPU_THIS_PTR gen_reg[BX_32BIT_REG_EIP].dword.erx = new_eip;
         }
 
-        stub_trace_flag = 0;
-        bx_cpu.cpu_loop();
-
-        SIM->refresh_vga();
+        resume(0);
 
         if (buffer[1] != 0)
         {
@@ -484,18 +726,7 @@ static void debug_loop(void)
           BX_CPU_THIS_PTR gen_reg[BX_32BIT_REG_EIP].dword.erx = saved_eip;
         }
 
-        BX_INFO(("stopped with %x", last_stop_reason));
-        buf[0] = 'S';
-        if (last_stop_reason == GDBSTUB_EXECUTION_BREAKPOINT ||
-            last_stop_reason == GDBSTUB_TRACE)
-        {
-          write_signal(&buf[1], SIGTRAP);
-        }
-        else
-        {
-          write_signal(&buf[1], 0);
-        }
-        put_reply(buf);
+        put_stop_reply(0);
         break;
       }
 
@@ -503,60 +734,76 @@ static void debug_loop(void)
       // If addr is omitted, resume at same address.
       // This packet is deprecated for multi-threading support. See [vCont packet]
       case 's':
-      {
-        char buf[255];
-
         BX_INFO(("stepping"));
-        stub_trace_flag = 1;
-        bx_cpu.cpu_loop();
-        SIM->refresh_vga();
-        stub_trace_flag = 0;
-        BX_INFO(("stopped with %x", last_stop_reason));
-        buf[0] = 'S';
-        if (last_stop_reason == GDBSTUB_EXECUTION_BREAKPOINT ||
-            last_stop_reason == GDBSTUB_TRACE)
+        resume(1);
+        put_stop_reply(1);
+        break;
+
+      // v Packets starting with v are identified by a multi-letter name.
+      case 'v':
+        if (strncmp(&buffer[1], "Cont", strlen("Cont")) == 0)
         {
-          write_signal(&buf[1], SIGTRAP);
+          do_vcont(&buffer[5]);
         }
         else
         {
-          write_signal(&buf[1], SIGTRAP);
+          put_reply("");
         }
-        put_reply(buf);
         break;
-      }
 
       // M addr,length:XX...
       // Write length bytes of memory starting at address addr. XX... is the data;
       // each byte is transmitted as a two-digit hexadecimal number.
       case 'M':
       {
-        unsigned char mem[255];
         char* ebuf;
 
         Bit64u addr = strtoull(&buffer[1], &ebuf, 16);
-        int len = strtoul(ebuf + 1, &ebuf, 16);
+        unsigned long ulen = strtoul(ebuf + 1, &ebuf, 16);
+        if (ulen > sizeof(mem) || strlen(ebuf + 1) < ulen * 2)
+        {
+          put_reply("E01");
+          break;
+        }
+        int len = (int) ulen;
         hex2mem(ebuf + 1, mem, len);
+        write_memory(addr, len, mem);
+        break;
+      }
+
+      // X addr,length:XX...
+      // Write data to memory, where the data is transmitted in binary.
+      case 'X':
+      {
+        char* ebuf;
 
-        if (len == 1 && mem[0] == 0xcc)
+        Bit64u addr = strtoull(&buffer[1], &ebuf, 16);
+        int len = strtoul(ebuf + 1, &ebuf, 16);
+        char* end = buffer + packet_len;
+        int n = 0;
+        if (*ebuf++ != ':')
         {
-          insert_breakpoint(addr);
-          put_reply("OK");
+          put_reply("E01");
+          break;
         }
-        else if (remove_breakpoint(addr, len))
+        while (ebuf < end && n < (int) sizeof(mem))
+        {
+          char ch = *ebuf++;
+          if (ch == '}' && ebuf < end)
+            ch = *ebuf++ ^ 0x20;
+          mem[n++] = ch;
+        }
+        if (n != len)
+        {
+          put_reply("E01");
+        }
+        else if (len == 0)
         {
           put_reply("OK");
         }
         else
         {
-          if (access_linear(addr, len, BX_WRITE, mem))
-          {
-            put_reply("OK");
-          }
-          else
-          {
-            put_reply("Eff");
-          }
+          write_memory(addr, len, mem);
         }
         break;
       }
@@ -573,16 +820,55 @@ static void debug_loop(void)
       case 'm':
       {
         Bit64u addr;
+        unsigned long ulen;
         int len;
         char* ebuf;
 
         addr = strtoull(&buffer[1], &ebuf, 16);
-        len = strtoul(ebuf + 1, NULL, 16);
-        BX_INFO(("addr " FMT_ADDRX64 " len %x", addr, len));
+        ulen = strtoul(ebuf + 1, NULL, 16);
+        if (ulen > GDBSTUB_PACKET_SIZE / 2)
+          ulen = GDBSTUB_PACKET_SIZE / 2;
+        len = (int) ulen;
+        BX_DEBUG(("addr " FMT_ADDRX64 " len %x", addr, len));
 
-        access_linear(addr, len, BX_READ, mem);
-        mem2hex(mem, obuf, len);
-        put_reply(obuf);
+        if (access_linear(addr, len, BX_READ, mem))
+        {
+          mem2hex(mem, obuf, len);
+          put_reply(obuf);
+        }
+        else
+        {
+          put_reply("E14");
+        }
+        break;
+      }
+
+      // x addr,length
+      // Read length bytes of memory starting at address addr. The reply is
+      // 'b' followed by the data in binary.
+      case 'x':
+      {
+        Bit64u addr;
+        unsigned long ulen;
+        int len;
+        char* ebuf;
+
+        addr = strtoull(&buffer[1], &ebuf, 16);
+        ulen = strtoul(ebuf + 1, NULL, 16);
+        if (ulen > GDBSTUB_PACKET_SIZE - 1)
+          ulen = GDBSTUB_PACKET_SIZE - 1;
+        len = (int) ulen;
+        BX_DEBUG(("addr " FMT_ADDRX64 " len %x", addr, len));
+
+        if (access_linear(addr, len, BX_READ, (Bit8u*) obuf + 1))
+        {
+          obuf[0] = 'b';
+          put_packet(obuf, len + 1, 1);
+        }
+        else
+        {
+          put_reply("E14");
+        }
         break;
       }
 
@@ -599,62 +885,35 @@ static void debug_loop(void)
         ++ebuf;
         value = read_little_endian_hex(ebuf);
 
-        BX_INFO(("reg %d set to " FMT_ADDRX64, reg, value));
+        set_register(reg, value);
+        put_reply("OK");
+
+        break;
+      }
+
+      // G XX... Write general registers, in the same layout as the 'g' reply.
+      // Only the general purpose registers and the instruction pointer are written.
+      case 'G':
+      {
+        char* p = &buffer[1];
 #if BX_SUPPORT_X86_64 == 0
-        switch (reg)
-        {
-          case 0:
-          case 1:
-          case 2:
-          case 3:
-          case 4:
-          case 5:
-          case 6:
-          case 7:
-            BX_CPU_THIS_PTR set_reg32(reg, value);
-            break;
-
-          case 8:
-            EIP = value;
-            BX_CPU_THIS_PTR invalidate_prefetch_q();
-            break;
-
-          default:
-            break;
-        }
+        const int nregs = 9, size = 4;
 #else
-        switch (reg)
-        {
-          case 0:
-          case 1:
-          case 2:
-          case 3:
-          case 4:
-          case 5:
-          case 6:
-          case 7:
-          case 8:
-          case 9:
-          case 10:
-          case 11:
-          case 12:
-          case 13:
-          case 14:
-          case 15:
-            BX_CPU_THIS_PTR set_reg64(reg, value);
-            break;
-
-          case 16:
-            RIP = value;
-            BX_CPU_THIS_PTR invalidate_prefetch_q();
-            break;
-
-          default:
-            break;
-        }
+        const int nregs = 17, size = 8;
 #endif
+        if (strlen(p) < (size_t)(nregs * size * 2))
+        {
+          put_reply("E01");
+          break;
+        }
+        for (int reg = 0; reg < nregs; reg++)
+        {
+          Bit64u value = 0;
+          for (int n = 0; n < size; n++, p += 2)
+            value |= (Bit64u)((hex(p[0]) << 4) | hex(p[1])) << (n*8);
+          set_register(reg, value);
+        }
         put_reply("OK");
-
         break;
       }
 
@@ -769,8 +1028,7 @@ static void debug_loop(void)
       case 'q':
         if (buffer[1] == 'C')
         {
-          sprintf(obuf, FMT_ADDRX64, (Bit64u)1);
-          put_reply(obuf);
+          put_reply("QC1");
         }
         else if (strncmp(&buffer[1], "Offsets", strlen("Offsets")) == 0)
         {
@@ -782,7 +1040,38 @@ static void debug_loop(void)
         }
         else if (strncmp(&buffer[1], "Supported", strlen("Supported")) == 0)
         {
-          put_reply("");
+          sprintf(obuf, "PacketSize=%x;qXfer:features:read+;qXfer:memory-map:read+;"
+                  "QStartNoAckMode+;binary-upload+;vContSupported+", GDBSTUB_PACKET_SIZE);
+          put_reply(obuf);
+        }
+        else if (strncmp(&buffer[1], "Xfer:features:read:target.xml:", strlen("Xfer:features:read:target.xml:")) == 0)
+        {
+          xfer_reply(target_xml, &buffer[1 + strlen("Xfer:features:read:target.xml:")]);
+        }
+        else if (strncmp(&buffer[1], "Xfer:memory-map:read::", strlen("Xfer:memory-map:read::")) == 0)
+        {
+          xfer_reply(memory_map_xml, &buffer[1 + strlen("Xfer:memory-map:read::")]);
+        }
+        // the CPU is reported as the only thread
+        else if (strcmp(&buffer[1], "fThreadInfo") == 0)
+        {
+          put_reply("m1");
+        }
+        else if (strcmp(&buffer[1], "sThreadInfo") == 0)
+        {
+          put_reply("l");
+        }
+        else
+        {
+          put_reply(""); /* not supported */
+        }
+        break;
+
+      case 'Q':
+        if (strcmp(&buffer[1], "StartNoAckMode") == 0)
+        {
+          put_reply("OK");
+          no_ack_mode = 1;
         }
         else
         {
@@ -790,6 +1079,11 @@ static void debug_loop(void)
         }
         break;
 
+      // T thread-id Find out if the thread thread-id is alive.
+      case 'T':
+        put_reply(strtol(&buffer[1], NULL, 16) == 1 ? "OK" : "E01");
+        break;
+
       // z type,addr,kind
       // Z type,addr,kind
       // Insert (Z) or remove (z) a type breakpoint or watchpoint starting at address
@@ -0,0 +1,571 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+// Headless capture GUI: the guest display is rendered into the common
+// off-screen compositor (see gui.cc) and the changed frames are written
+// out at a fixed frame rate (based on the emulated time), either as a raw
+// stream with damage rectangles or as QOI snapshots. Encoding and file I/O
+// are done by a background thread. If it is still busy when the next frame
+// is due, the damage is kept and written with the following frame, so the
+// simulation never waits for the disk.
+//
+// Raw stream format (all values little endian):
+//   file header:  "BXCAP001"
+//   frame header: Bit32u frame number, Bit64u emulated time in usec,
+//                 Bit16u width, Bit16u height, Bit32u number of rectangles
+//   rectangle:    Bit16u x, y, w, h followed by w * h pixels (B, G, R, 0)
+
+// Define BX_PLUGGABLE in files that can be compiled into plugins.  For
+// platforms that require a special tag on exported symbols, BX_PLUGGABLE
+// is used to know when we are exporting symbols and when we are importing.
+#define BX_PLUGGABLE
+
+#include "param_names.h"
+#include "iodev.h"
+#include "pc_system.h"
+
+#if BX_WITH_CAPTURE
+
+#include "icon_bochs.h"
+#include "bxthread.h"
+
+class bx_capture_gui_c : public bx_gui_c {
+public:
+  bx_capture_gui_c(void) {}
+  DECLARE_GUI_VIRTUAL_METHODS()
+  DECLARE_GUI_NEW_VIRTUAL_METHODS()
+  void draw_char(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
+                 Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
+                 bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2);
+private:
+  void capture_frame(bool force);
+};
+
+// declare one instance of the gui object and call macro to insert the
+// plugin code
+static bx_capture_gui_c *theGui = NULL;
+IMPLEMENT_GUI_PLUGIN_CODE(capture)
+
+#define LOG_THIS theGui->
+
+#define CAPTURE_DEF_FPS     10
+
+enum {
+  CAPTURE_FORMAT_RAW,
+  CAPTURE_FORMAT_QOI
+};
+
+static const char *capture_format_names[] = { "raw", "qoi" };
+
+// emulation thread state
+static Bit64u captureFrameInterval;
+static Bit64u captureLastFrame = 0;
+static bool captureFirstFrame = 1;
+
+// settings
+static char capturePath[BX_PATHNAME_LEN];
+static unsigned captureFormat = CAPTURE_FORMAT_QOI;
+
+// frame handed over to the encoder thread
+static struct {
+  Bit32u number;
+  Bit64u time;
+  unsigned xres, yres;
+  unsigned nrects;
+  bx_gui_rect_t *rects;
+  Bit32u *pixels;
+} captureFrame;
+
+static bool captureKeepAlive = 0;
+static bool captureEncoderBusy = 0;
+static BX_MUTEX(captureMutex);
+static bx_thread_sem_t captureEncoderSem;
+static BX_THREAD_VAR(captureThreadVar);
+static FILE *captureFile = NULL;
+static Bit8u *captureOutBuf = NULL;
+static Bit32u captureFrameCount = 0;
+
+BX_THREAD_FUNC(captureEncoderThread, indata);
+
+
+// CAPTURE implementation of the bx_gui_c methods (see nogui.cc for details)
+
+void bx_capture_gui_c::specific_init(int argc, char **argv, unsigned headerbar_y)
+{
+  int i, fps = CAPTURE_DEF_FPS;
+
+  put("CAPTURE");
+  UNUSED(headerbar_y);
+  UNUSED(bochs_icon_bits);
+
+  strcpy(capturePath, "capture");
+
+  // parse capture specific options
+  if (argc > 1) {
+    for (i = 1; i < argc; i++) {
+      if (!strncmp(argv[i], "file=", 5)) {
+        strncpy(capturePath, &argv[i][5], BX_PATHNAME_LEN - 1);
+        capturePath[BX_PATHNAME_LEN - 1] = 0;
+      } else if (!strncmp(argv[i], "format=", 7)) {
+        if (!strcmp(&argv[i][7], "raw")) {
+          captureFormat = CAPTURE_FORMAT_RAW;
+        } else if (!strcmp(&argv[i][7], "qoi")) {
+          captureFormat = CAPTURE_FORMAT_QOI;
+        } else {
+          BX_PANIC(("Unknown capture format '%s'", &argv[i][7]));
+        }
+      } else if (!strncmp(argv[i], "fps=", 4)) {
+        fps = atoi(&argv[i][4]);
+        if ((fps < 1) || (fps > 1000)) {
+          BX_PANIC(("invalid frame rate: %d", fps));
+          fps = CAPTURE_DEF_FPS;
+        }
+      } else if (!parse_common_gui_options(argv[i], BX_GUI_OPT_HIDE_IPS)) {
+        BX_PANIC(("Unknown capture option '%s'", argv[i]));
+      }
+    }
+  }
+
+  if (SIM->get_param_bool(BXPN_PRIVATE_COLORMAP)->get()) {
+    BX_INFO(("private_colormap option ignored."));
+  }
+
+  captureFrameInterval = 1000000 / fps;
+  // blocks redrawn with the same contents (e.g. blinking text) are not
+  // written again
+  shadow_init(1);
+  captureFrame.rects = new bx_gui_rect_t[shadow_max_rects()];
+  captureFrame.pixels = new Bit32u[max_xres * max_yres];
+  // worst case QOI output: 4 bytes per pixel plus header and end marker
+  captureOutBuf = new Bit8u[max_xres * max_yres * 5 + 64];
+
+  if (captureFormat == CAPTURE_FORMAT_RAW) {
+    char filename[BX_PATHNAME_LEN + 8];
+    sprintf(filename, "%s.raw", capturePath);
+    captureFile = fopen(filename, "wb");
+    if (captureFile == NULL) {
+      BX_PANIC(("failed to create capture file '%s'", filename));
+    } else {
+      fwrite("BXCAP001", 1, 8, captureFile);
+    }
+  }
+  BX_INFO(("capturing %s frames to '%s' at %d fps",
+           capture_format_names[captureFormat], capturePath, fps));
+
+  BX_INIT_MUTEX(captureMutex);
+  bx_create_sem(&captureEncoderSem);
+  captureKeepAlive = 1;
+  BX_THREAD_CREATE(captureEncoderThread, NULL, captureThreadVar);
+
+  new_gfx_api = 1;
+  new_text_api = 1;
+}
+
+void bx_capture_gui_c::handle_events(void)
+{
+}
+
+void bx_capture_gui_c::flush(void)
+{
+  capture_frame(0);
+}
+
+void bx_capture_gui_c::clear_screen(void)
+{
+  shadow_clear();
+}
+
+void bx_capture_gui_c::draw_char(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
+                                 Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
+                                 bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2)
+{
+  shadow_draw_char(ch, fc, bc, xc, yc, fw, fh, fx, fy, gfxcharw9, cs, ce, curs, font2);
+}
+
+void bx_capture_gui_c::text_update(Bit8u *old_text, Bit8u *new_text,
+                                   unsigned long cursor_x, unsigned long cursor_y,
+                                   bx_vga_tminfo_t *tm_info)
+{
+  // present for compatibility
+}
+
+int bx_capture_gui_c::get_clipboard_text(Bit8u **bytes, Bit32s *nbytes)
+{
+  UNUSED(bytes);
+  UNUSED(nbytes);
+  return 0;
+}
+
+int bx_capture_gui_c::set_clipboard_text(char *text_snapshot, Bit32u len)
+{
+  UNUSED(text_snapshot);
+  UNUSED(len);
+  return 0;
+}
+
+bool bx_capture_gui_c::palette_change(Bit8u index, Bit8u red, Bit8u green, Bit8u blue)
+{
+  // the compositor palette is updated by palette_change_common()
+  return 1;
+}
+
+void bx_capture_gui_c::graphics_tile_update(Bit8u *tile, unsigned x0, unsigned y0)
+{
+  shadow_tile_update(tile, x0, y0);
+}
+
+bx_svga_tileinfo_t *bx_capture_gui_c::graphics_tile_info(bx_svga_tileinfo_t *info)
+{
+  return shadow_tile_info(info);
+}
+
+Bit8u *bx_capture_gui_c::graphics_tile_get(unsigned x0, unsigned y0,
+                                           unsigned *w, unsigned *h)
+{
+  return shadow_tile_get(x0, y0, w, h);
+}
+
+void bx_capture_gui_c::graphics_tile_update_in_place(unsigned x0, unsigned y0,
+                                                     unsigned w, unsigned h)
+{
+  shadow_mark_dirty(x0, y0, w, h);
+}
+
+void bx_capture_gui_c::dimension_update(unsigned x, unsigned y, unsigned fheight,
+                                        unsigned fwidth, unsigned bpp)
+{
+  if ((bpp == 8) || (bpp == 15) || (bpp == 16) || (bpp == 24) || (bpp == 32)) {
+    guest_bpp = bpp;
+  } else {
+    BX_PANIC(("%d bpp graphics mode not supported", bpp));
+  }
+  guest_textmode = (fheight > 0);
+  guest_fwidth = fwidth;
+  guest_fheight = fheight;
+  guest_xres = x;
+  guest_yres = y;
+  if ((x > max_xres) || (y > max_yres)) {
+    BX_PANIC(("dimension_update(): capture doesn't support graphics mode %dx%d", x, y));
+    return;
+  }
+  shadow_resize(x, y);
+}
+
+unsigned bx_capture_gui_c::create_bitmap(const unsigned char *bmap, unsigned xdim,
+                                         unsigned ydim)
+{
+  UNUSED(bmap);
+  UNUSED(xdim);
+  UNUSED(ydim);
+  return 0;
+}
+
+unsigned bx_capture_gui_c::headerbar_bitmap(unsigned bmap_id, unsigned alignment,
+                                            void (*f)(void))
+{
+  UNUSED(bmap_id);
+  UNUSED(alignment);
+  UNUSED(f);
+  return 0;
+}
+
+void bx_capture_gui_c::show_headerbar(void)
+{
+}
+
+void bx_capture_gui_c::replace_bitmap(unsigned hbar_id, unsigned bmap_id)
+{
+  UNUSED(hbar_id);
+  UNUSED(bmap_id);
+}
+
+void bx_capture_gui_c::exit(void)
+{
+  if (captureKeepAlive) {
+    // write out the pending changes, then stop the encoder thread
+    capture_frame(1);
+    BX_LOCK(captureMutex);
+    captureKeepAlive = 0;
+    BX_UNLOCK(captureMutex);
+    bx_set_sem(&captureEncoderSem);
+    BX_THREAD_JOIN(captureThreadVar);
+    bx_destroy_sem(&captureEncoderSem);
+    BX_FINI_MUTEX(captureMutex);
+    BX_INFO(("%u frames captured", captureFrameCount));
+  }
+  if (captureFile != NULL) {
+    fclose(captureFile);
+    captureFile = NULL;
+  }
+  shadow_cleanup();
+  delete [] captureFrame.rects;
+  delete [] captureFrame.pixels;
+  delete [] captureOutBuf;
+  captureFrame.rects = NULL;
+  captureFrame.pixels = NULL;
+  captureOutBuf = NULL;
+}
+
+void bx_capture_gui_c::mouse_enabled_changed_specific(bool val)
+{
+}
+
+// Frame pacing (emulation thread)
+
+void bx_capture_gui_c::capture_frame(bool force)
+{
+  unsigned i, j, nrects;
+  unsigned x, y, w, h, xres = shadow.xres, yres = shadow.yres;
+  Bit32u *dst;
+  bool busy;
+  Bit64u now = bx_pc_system.time_usec();
+
+  if (!shadow_damage_pending())
+    return;
+
+  if (!force && !captureFirstFrame && ((now - captureLastFrame) < captureFrameInterval))
+    return;
+
+  while (1) {
+    BX_LOCK(captureMutex);
+    busy = captureEncoderBusy;
+    BX_UNLOCK(captureMutex);
+    if (!busy)
+      break;
+    if (!force)
+      return;
+    // wait for the encoder to finish the previous frame
+#ifdef WIN32
+    Sleep(10);
+#else
+    usleep(10000);
+#endif
+  }
+
+  nrects = shadow_get_damage(captureFrame.rects);
+  if (nrects == 0)
+    return;
+  captureFirstFrame = 0;
+  captureLastFrame = now;
+
+  // snapshot the data the encoder needs: the changed rectangles for the raw
+  // stream, the whole screen for the image formats
+  if (captureFormat == CAPTURE_FORMAT_RAW) {
+    dst = captureFrame.pixels;
+    for (i = 0; i < nrects; i++) {
+      x = captureFrame.rects[i].x;
+      y = captureFrame.rects[i].y;
+      w = captureFrame.rects[i].w;
+      h = captureFrame.rects[i].h;
+      for (j = 0; j < h; j++) {
+        memcpy(dst, &shadow.screen[(y + j) * xres + x], w * sizeof(Bit32u));
+        dst += w;
+      }
+    }
+  } else {
+    memcpy(captureFrame.pixels, shadow.screen, xres * yres * sizeof(Bit32u));
+  }
+  captureFrame.number = captureFrameCount++;
+  captureFrame.time = now;
+  captureFrame.xres = xres;
+  captureFrame.yres = yres;
+  captureFrame.nrects = nrects;
+
+  BX_LOCK(captureMutex);
+  captureEncoderBusy = 1;
+  BX_UNLOCK(captureMutex);
+  bx_set_sem(&captureEncoderSem);
+}
+
+// Encoder thread
+
+static Bit8u *capture_put16le(Bit8u *p, Bit16u value)
+{
+  *p++ = (Bit8u)value;
+  *p++ = (Bit8u)(value >> 8);
+  return p;
+}
+
+static Bit8u *capture_put32le(Bit8u *p, Bit32u value)
+{
+  p = capture_put16le(p, (Bit16u)value);
+  return capture_put16le(p, (Bit16u)(value >> 16));
+}
+
+static Bit8u *capture_put32be(Bit8u *p, Bit32u value)
+{
+  *p++ = (Bit8u)(value >> 24);
+  *p++ = (Bit8u)(value >> 16);
+  *p++ = (Bit8u)(value >> 8);
+  *p++ = (Bit8u)value;
+  return p;
+}
+
+static void capture_write_raw(void)
+{
+  Bit8u *p = captureOutBuf;
+  Bit32u *src = captureFrame.pixels;
+  unsigned i, j, n;
+
+  if (captureFile == NULL)
+    return;
+
+  p = capture_put32le(p, captureFrame.number);
+  p = capture_put32le(p, (Bit32u)captureFrame.time);
+  p = capture_put32le(p, (Bit32u)(captureFrame.time >> 32));
+  p = capture_put16le(p, captureFrame.xres);
+  p = capture_put16le(p, captureFrame.yres);
+  p = capture_put32le(p, captureFrame.nrects);
+  fwrite(captureOutBuf, 1, p - captureOutBuf, captureFile);
+  for (i = 0; i < captureFrame.nrects; i++) {
+    p = captureOutBuf;
+    p = capture_put16le(p, captureFrame.rects[i].x);
+    p = capture_put16le(p, captureFrame.rects[i].y);
+    p = capture_put16le(p, captureFrame.rects[i].w);
+    p = capture_put16le(p, captureFrame.rects[i].h);
+    n = captureFrame.rects[i].w * captureFrame.rects[i].h;
+    for (j = 0; j < n; j++) {
+      p = capture_put32le(p, *src++);
+    }
+    fwrite(captureOutBuf, 1, p - captureOutBuf, captureFile);
+  }
+  fflush(captureFile);
+}
+
+// QOI image encoder (see https://qoiformat.org/qoi-specification.pdf)
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+
+static unsigned capture_encode_qoi(Bit8u *out, const Bit32u *pixels,
+                                   unsigned width, unsigned height)
+{
+  Bit32u index[64], prev = 0, px;
+  Bit8u *p = out;
+  unsigned run = 0, i, n = width * height;
+  int vr, vg, vb, vg_r, vg_b;
+
+  memcpy(p, "qoif", 4);
+  p = capture_put32be(p + 4, width);
+  p = capture_put32be(p, height);
+  *p++ = 3; // RGB
+  *p++ = 0; // sRGB with linear alpha
+  memset(index, 0, sizeof(index));
+  // the alpha channel is always 255, so the initial previous pixel
+  // (0, 0, 0, 255) is represented as 0 here
+  for (i = 0; i < n; i++) {
+    px = pixels[i] & 0xffffff;
+    if (px == prev) {
+      run++;
+      if ((run == 62) || (i == (n - 1))) {
+        *p++ = QOI_OP_RUN | (run - 1);
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      *p++ = QOI_OP_RUN | (run - 1);
+      run = 0;
+    }
+    unsigned r = (px >> 16) & 0xff, g = (px >> 8) & 0xff, b = px & 0xff;
+    unsigned hash = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63;
+    if (index[hash] == (px | 0x01000000)) {
+      *p++ = QOI_OP_INDEX | hash;
+    } else {
+      index[hash] = px | 0x01000000;
+      vr = (int)r - (int)((prev >> 16) & 0xff);
+      vg = (int)g - (int)((prev >> 8) & 0xff);
+      vb = (int)b - (int)(prev & 0xff);
+      // differences wrap around
+      vr = (Bit8s)vr;
+      vg = (Bit8s)vg;
+      vb = (Bit8s)vb;
+      vg_r = vr - vg;
+      vg_b = vb - vg;
+      if ((vr > -3) && (vr < 2) && (vg > -3) && (vg < 2) && (vb > -3) && (vb < 2)) {
+        *p++ = QOI_OP_DIFF | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2);
+      } else if ((vg_r > -9) && (vg_r < 8) && (vg > -33) && (vg < 32) &&
+                 (vg_b > -9) && (vg_b < 8)) {
+        *p++ = QOI_OP_LUMA | (vg + 32);
+        *p++ = ((vg_r + 8) << 4) | (vg_b + 8);
+      } else {
+        *p++ = QOI_OP_RGB;
+        *p++ = r;
+        *p++ = g;
+        *p++ = b;
+      }
+    }
+    prev = px;
+  }
+  // end marker
+  memset(p, 0, 7);
+  p[7] = 0x01;
+  p += 8;
+  return p - out;
+}
+
+static void capture_write_qoi(void)
+{
+  char filename[BX_PATHNAME_LEN + 16];
+  unsigned len;
+  FILE *fp;
+
+  len = capture_encode_qoi(captureOutBuf, captureFrame.pixels,
+                           captureFrame.xres, captureFrame.yres);
+  sprintf(filename, "%s%06u.qoi", capturePath, captureFrame.number);
+  fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    BX_ERROR(("failed to create capture file '%s'", filename));
+    return;
+  }
+  fwrite(captureOutBuf, 1, len, fp);
+  fclose(fp);
+}
+
+BX_THREAD_FUNC(captureEncoderThread, indata)
+{
+  while (1) {
+    bx_wait_sem(&captureEncoderSem);
+    BX_LOCK(captureMutex);
+    if (!captureEncoderBusy) {
+      if (!captureKeepAlive) {
+        BX_UNLOCK(captureMutex);
+        break;
+      }
+      BX_UNLOCK(captureMutex);
+      continue;
+    }
+    BX_UNLOCK(captureMutex);
+    if (captureFormat == CAPTURE_FORMAT_RAW) {
+      capture_write_raw();
+    } else {
+      capture_write_qoi();
+    }
+    BX_LOCK(captureMutex);
+    captureEncoderBusy = 0;
+    BX_UNLOCK(captureMutex);
+  }
+  BX_THREAD_EXIT;
+}
+
+#endif /* if BX_WITH_CAPTURE */
@@ -2728,6 +2728,7 @@ void SetWatchpoint(unsigned *num_watchpoints, bx_watchpoint *watchpoint)
             ++(*num_watchpoints);
         }
     }
+    bx_dbg_watchpoints_changed();
     Invalidate(DUMP_WND);   // redraw the MemDump window -- colors may have changed
 }
 
@@ -156,6 +156,9 @@ bx_gui_c::bx_gui_c(void): disp_mode(DISP_MODE_SIM)
   memset(palette, 0, sizeof(palette));
   memset(vga_charmap[0], 0, 0x2000);
   memset(vga_charmap[1], 0, 0x2000);
+  glyph_cache = NULL;
+  memset(glyph_state, 0, sizeof(glyph_state));
+  memset(&shadow, 0, sizeof(shadow));
   memset(&gui_opts, 0, sizeof(gui_opts));
 }
 
@@ -164,6 +167,10 @@ bx_gui_c::~bx_gui_c()
   if (framebuffer != NULL) {
     delete [] framebuffer;
   }
+  if (glyph_cache != NULL) {
+    delete [] glyph_cache;
+  }
+  shadow_cleanup();
 #if BX_USE_GUI_CONSOLE
   if (console.running) {
     console_cleanup();
@@ -960,6 +967,7 @@ void bx_gui_c::set_text_charmap(Bit8u map, Bit8u *fbuffer)
 {
   memcpy(& BX_GUI_THIS vga_charmap[map], fbuffer, 0x2000);
   for (unsigned i=0; i<256; i++) BX_GUI_THIS char_changed[map][i] = 1;
+  memset(&BX_GUI_THIS glyph_state[map << 8], 0, 256);
   BX_GUI_THIS charmap_updated = 1;
 }
 
@@ -1070,6 +1078,7 @@ bool bx_gui_c::palette_change_common(Bit8u index, Bit8u red, Bit8u green, Bit8u
   BX_GUI_THIS palette[index].red = red;
   BX_GUI_THIS palette[index].green = green;
   BX_GUI_THIS palette[index].blue = blue;
+  BX_GUI_THIS shadow.palette[index] = (red << 16) | (green << 8) | blue;
   return palette_change(index, red, green, blue);
 }
 
@@ -1206,12 +1215,88 @@ void bx_gui_c::draw_char_common(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc,
                                 Bit8u fy, bool gfxcharw9, Bit8u cs, Bit8u ce,
                                 bool curs, bool font2)
 {
-  Bit8u *buf, *font_ptr, fontpixels;
+  BX_GUI_THIS draw_char_8bpp(BX_GUI_THIS snapshot_buffer + yc * BX_GUI_THIS guest_xres + xc,
+                             BX_GUI_THIS guest_xres, ch, fc, bc, fw, fh, fx, fy,
+                             gfxcharw9, cs, ce, curs, font2);
+}
+
+// Returns the pixel mask of a character at the current font width. The
+// mask is expanded once from the charmap and reused until the charmap or
+// the font width changes, so that drawing a character is a plain select
+// between foreground and background color.
+const Bit8u *bx_gui_c::get_glyph(Bit8u ch, bool gfxcharw9, bool font2)
+{
+  Bit8u *glyph, *font_ptr, state, fontpixels;
+  Bit16u font_row;
+  unsigned index = ((unsigned)font2 << 8) | ch;
+  bool dwidth;
+
+  if (BX_GUI_THIS glyph_cache == NULL) {
+    BX_GUI_THIS glyph_cache = new Bit8u[BX_GLYPH_CACHE_ENTRIES * BX_GLYPH_ROWS * BX_GLYPH_PITCH];
+  }
+  glyph = BX_GUI_THIS glyph_cache + index * BX_GLYPH_ROWS * BX_GLYPH_PITCH;
+  state = BX_GUI_THIS guest_fwidth | (gfxcharw9 << 7);
+  if (BX_GUI_THIS glyph_state[index] != state) {
+    dwidth = (BX_GUI_THIS guest_fwidth > 9);
+    font_ptr = &vga_charmap[font2][ch << 5];
+    for (int y = 0; y < BX_GLYPH_ROWS; y++) {
+      font_row = *font_ptr++;
+      if (gfxcharw9) {
+        font_row = (font_row << 1) | (font_row & 0x01);
+      } else {
+        font_row <<= 1;
+      }
+      Bit8u *ptr = glyph + y * BX_GLYPH_PITCH;
+      fontpixels = BX_GUI_THIS guest_fwidth;
+      do {
+        *ptr++ = (font_row & 0x100) ? 0xff : 0x00;
+        if (!dwidth || (fontpixels & 1)) font_row <<= 1;
+      } while (--fontpixels);
+    }
+    BX_GUI_THIS glyph_state[index] = state;
+  }
+  return glyph;
+}
+
+void bx_gui_c::draw_char_8bpp(Bit8u *buf, unsigned pitch, Bit8u ch, Bit8u fc,
+                              Bit8u bc, Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
+                              bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs,
+                              bool font2)
+{
+  const Bit8u *glyph_row;
+  Bit8u *font_ptr, fontpixels;
   Bit16u font_row, mask;
+  Bit64u fg64, bg64, m64, p64, inv64;
+  unsigned i;
   bool dwidth;
 
-  buf = BX_GUI_THIS snapshot_buffer + yc * BX_GUI_THIS guest_xres + xc;
   dwidth = (BX_GUI_THIS guest_fwidth > 9);
+  if ((fx == 0) && (fw == BX_GUI_THIS guest_fwidth) &&
+      (BX_GUI_THIS guest_fwidth <= BX_GLYPH_PITCH) &&
+      ((unsigned)fy + fh <= BX_GLYPH_ROWS)) {
+    // full character cell: select colors from the cached mask, 8 pixels
+    // at a time
+    glyph_row = BX_GUI_THIS get_glyph(ch, gfxcharw9, font2) + fy * BX_GLYPH_PITCH;
+    fg64 = (Bit64u)fc * BX_CONST64(0x0101010101010101);
+    bg64 = (Bit64u)bc * BX_CONST64(0x0101010101010101);
+    do {
+      inv64 = (curs && (fy >= cs) && (fy <= ce)) ? ~(Bit64u)0 : 0;
+      for (i = 0; i + 8 <= fw; i += 8) {
+        memcpy(&m64, glyph_row + i, 8);
+        m64 ^= inv64;
+        p64 = (fg64 & m64) | (bg64 & ~m64);
+        memcpy(buf + i, &p64, 8);
+      }
+      for (; i < fw; i++) {
+        buf[i] = ((glyph_row[i] ^ (Bit8u)inv64) != 0) ? fc : bc;
+      }
+      glyph_row += BX_GLYPH_PITCH;
+      buf += pitch;
+      fy++;
+    } while (--fh);
+    return;
+  }
+  // partial character cell (horizontal panning)
   if (font2) {
     font_ptr = &vga_charmap[1][(ch << 5) + fy];
   } else {
@@ -1240,7 +1325,71 @@ void bx_gui_c::draw_char_common(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc,
       buf++;
       if (!dwidth || (fontpixels & 1)) font_row <<= 1;
     } while (--fontpixels);
-    buf += (BX_GUI_THIS guest_xres - fw);
+    buf += (pitch - fw);
+    fy++;
+  } while (--fh);
+}
+
+// Same as draw_char_8bpp() for 32 bpp surfaces, with the colors already
+// converted to the surface format ('pitch' in pixels).
+void bx_gui_c::draw_char_32bpp(Bit32u *buf, unsigned pitch, Bit8u ch,
+                               Bit32u fgcolor, Bit32u bgcolor, Bit8u fw, Bit8u fh,
+                               Bit8u fx, Bit8u fy, bool gfxcharw9, Bit8u cs,
+                               Bit8u ce, bool curs, bool font2)
+{
+  const Bit8u *glyph_row;
+  Bit8u *font_ptr, fontpixels, inv;
+  Bit16u font_row, mask;
+  unsigned i;
+  bool dwidth;
+
+  dwidth = (BX_GUI_THIS guest_fwidth > 9);
+  if ((fx == 0) && (fw == BX_GUI_THIS guest_fwidth) &&
+      (BX_GUI_THIS guest_fwidth <= BX_GLYPH_PITCH) &&
+      ((unsigned)fy + fh <= BX_GLYPH_ROWS)) {
+    // full character cell: select colors from the cached mask
+    glyph_row = BX_GUI_THIS get_glyph(ch, gfxcharw9, font2) + fy * BX_GLYPH_PITCH;
+    do {
+      inv = (curs && (fy >= cs) && (fy <= ce)) ? 0xff : 0x00;
+      for (i = 0; i < fw; i++) {
+        buf[i] = (glyph_row[i] != inv) ? fgcolor : bgcolor;
+      }
+      glyph_row += BX_GLYPH_PITCH;
+      buf += pitch;
+      fy++;
+    } while (--fh);
+    return;
+  }
+  // partial character cell (horizontal panning)
+  if (font2) {
+    font_ptr = &vga_charmap[1][(ch << 5) + fy];
+  } else {
+    font_ptr = &vga_charmap[0][(ch << 5) + fy];
+  }
+  do {
+    font_row = *font_ptr++;
+    if (gfxcharw9) {
+      font_row = (font_row << 1) | (font_row & 0x01);
+    } else {
+      font_row <<= 1;
+    }
+    if (fx > 0) {
+      font_row <<= fx;
+    }
+    fontpixels = fw;
+    if (curs && (fy >= cs) && (fy <= ce))
+      mask = 0x100;
+    else
+      mask = 0x00;
+    do {
+      if ((font_row & 0x100) == mask)
+        *buf = bgcolor;
+      else
+        *buf = fgcolor;
+      buf++;
+      if (!dwidth || (fontpixels & 1)) font_row <<= 1;
+    } while (--fontpixels);
+    buf += (pitch - fw);
     fy++;
   } while (--fh);
 }
@@ -1341,6 +1490,22 @@ void bx_gui_c::text_update_common(Bit8u *old_text, Bit8u *new_text,
       x = 0;
       xc = 0;
       do {
+        // skip unchanged cells 4 at a time (the last cell of a panned line
+        // has a different width and is always checked separately)
+        if (!forceUpdate && ((x > 0) || (tm_info->h_panning == 0))) {
+          Bit64u new64, old64;
+          while (hchars > 4) {
+            memcpy(&new64, new_text, 8);
+            memcpy(&old64, old_text, 8);
+            if (new64 != old64) break;
+            new_text += 8;
+            old_text += 8;
+            offset += 8;
+            x += 4;
+            xc += 4 * BX_GUI_THIS guest_fwidth;
+            hchars -= 4;
+          }
+        }
         cfwidth = BX_GUI_THIS guest_fwidth;
         cfcol = 0;
         if (tm_info->h_panning > 0) {
@@ -1491,6 +1656,263 @@ bx_svga_tileinfo_t * bx_gui_c::graphics_tile_info_common(bx_svga_tileinfo_t *inf
   }
 }
 
+// Off-screen compositor: a 32-bit xRGB shadow of the guest display that
+// backends without a native framebuffer of their own can render into. The
+// display adapter writes xRGB pixels directly (see shadow_tile_info()), text
+// and 8 bpp tiles are converted here, and the changes are collected in
+// blocks and handed out as coalesced rectangles. With 'dedup' set, a copy
+// of the last presented frame is kept and blocks that were redrawn with the
+// same contents (e.g. blinking text) are dropped from the damage.
+
+void bx_gui_c::shadow_init(bool dedup)
+{
+  unsigned size = BX_GUI_THIS max_xres * BX_GUI_THIS max_yres;
+
+  BX_GUI_THIS shadow.screen = new Bit32u[size];
+  memset(BX_GUI_THIS shadow.screen, 0, size * sizeof(Bit32u));
+  if (dedup) {
+    BX_GUI_THIS shadow.last = new Bit32u[size];
+    memset(BX_GUI_THIS shadow.last, 0, size * sizeof(Bit32u));
+  }
+  BX_GUI_THIS shadow.blocks_x = (BX_GUI_THIS max_xres + (1 << BX_SHADOW_BLOCK_SHIFT) - 1) >> BX_SHADOW_BLOCK_SHIFT;
+  BX_GUI_THIS shadow.blocks_y = (BX_GUI_THIS max_yres + (1 << BX_SHADOW_BLOCK_SHIFT) - 1) >> BX_SHADOW_BLOCK_SHIFT;
+  size = BX_GUI_THIS shadow.blocks_x * BX_GUI_THIS shadow.blocks_y;
+  BX_GUI_THIS shadow.dirty = new bool[size];
+  memset(BX_GUI_THIS shadow.dirty, 0, size * sizeof(bool));
+  BX_GUI_THIS shadow.xres = 640;
+  BX_GUI_THIS shadow.yres = 480;
+  BX_GUI_THIS shadow.pending = 0;
+  BX_GUI_THIS shadow.resized = 1;
+}
+
+void bx_gui_c::shadow_cleanup(void)
+{
+  if (BX_GUI_THIS shadow.screen != NULL) {
+    delete [] BX_GUI_THIS shadow.screen;
+    BX_GUI_THIS shadow.screen = NULL;
+  }
+  if (BX_GUI_THIS shadow.last != NULL) {
+    delete [] BX_GUI_THIS shadow.last;
+    BX_GUI_THIS shadow.last = NULL;
+  }
+  if (BX_GUI_THIS shadow.dirty != NULL) {
+    delete [] BX_GUI_THIS shadow.dirty;
+    BX_GUI_THIS shadow.dirty = NULL;
+  }
+}
+
+// Returns 1 if the size has changed. The new contents are all black and
+// completely damaged.
+bool bx_gui_c::shadow_resize(unsigned x, unsigned y)
+{
+  if ((x == BX_GUI_THIS shadow.xres) && (y == BX_GUI_THIS shadow.yres))
+    return 0;
+
+  BX_GUI_THIS shadow.xres = x;
+  BX_GUI_THIS shadow.yres = y;
+  BX_GUI_THIS shadow.resized = 1;
+  BX_GUI_THIS shadow_clear();
+  return 1;
+}
+
+void bx_gui_c::shadow_clear(void)
+{
+  memset(BX_GUI_THIS shadow.screen, 0,
+         BX_GUI_THIS shadow.xres * BX_GUI_THIS shadow.yres * sizeof(Bit32u));
+  BX_GUI_THIS shadow_mark_dirty(0, 0, BX_GUI_THIS shadow.xres, BX_GUI_THIS shadow.yres);
+}
+
+void bx_gui_c::shadow_mark_dirty(unsigned x0, unsigned y0, unsigned w, unsigned h)
+{
+  unsigned bx, by, bx1, by1;
+
+  if ((x0 >= BX_GUI_THIS shadow.xres) || (y0 >= BX_GUI_THIS shadow.yres) ||
+      (w == 0) || (h == 0))
+    return;
+
+  if ((x0 + w) > BX_GUI_THIS shadow.xres) {
+    w = BX_GUI_THIS shadow.xres - x0;
+  }
+  if ((y0 + h) > BX_GUI_THIS shadow.yres) {
+    h = BX_GUI_THIS shadow.yres - y0;
+  }
+  bx1 = (x0 + w - 1) >> BX_SHADOW_BLOCK_SHIFT;
+  by1 = (y0 + h - 1) >> BX_SHADOW_BLOCK_SHIFT;
+  for (by = (y0 >> BX_SHADOW_BLOCK_SHIFT); by <= by1; by++) {
+    for (bx = (x0 >> BX_SHADOW_BLOCK_SHIFT); bx <= bx1; bx++) {
+      BX_GUI_THIS shadow.dirty[by * BX_GUI_THIS shadow.blocks_x + bx] = 1;
+    }
+  }
+  BX_GUI_THIS shadow.pending = 1;
+}
+
+static bool shadow_block_changed(const Bit32u *screen, const Bit32u *last,
+                                 unsigned xres, unsigned yres, unsigned bx, unsigned by)
+{
+  unsigned x = bx << BX_SHADOW_BLOCK_SHIFT, y = by << BX_SHADOW_BLOCK_SHIFT;
+  unsigned w = BX_MIN(1 << BX_SHADOW_BLOCK_SHIFT, xres - x);
+  unsigned h = BX_MIN(1 << BX_SHADOW_BLOCK_SHIFT, yres - y);
+
+  for (unsigned j = 0; j < h; j++) {
+    if (memcmp(&screen[(y + j) * xres + x], &last[(y + j) * xres + x],
+               w * sizeof(Bit32u))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Collects the damaged area as rectangles in pixel units ('rects' must have
+// room for shadow_max_rects() entries) and resets the damage state.
+unsigned bx_gui_c::shadow_get_damage(bx_gui_rect_t *rects)
+{
+  unsigned bx, by, bw, bh, start, i, j, x, y, nrects = 0;
+  unsigned xres = BX_GUI_THIS shadow.xres, yres = BX_GUI_THIS shadow.yres;
+  unsigned bpitch = BX_GUI_THIS shadow.blocks_x;
+  bool *dirty = BX_GUI_THIS shadow.dirty;
+
+  if (!BX_GUI_THIS shadow.pending)
+    return 0;
+
+  bw = (xres + (1 << BX_SHADOW_BLOCK_SHIFT) - 1) >> BX_SHADOW_BLOCK_SHIFT;
+  bh = (yres + (1 << BX_SHADOW_BLOCK_SHIFT) - 1) >> BX_SHADOW_BLOCK_SHIFT;
+  if ((BX_GUI_THIS shadow.last != NULL) && !BX_GUI_THIS shadow.resized) {
+    for (by = 0; by < bh; by++) {
+      for (bx = 0; bx < bw; bx++) {
+        if (dirty[by * bpitch + bx] &&
+            !shadow_block_changed(BX_GUI_THIS shadow.screen, BX_GUI_THIS shadow.last,
+                                  xres, yres, bx, by)) {
+          dirty[by * bpitch + bx] = 0;
+        }
+      }
+    }
+  }
+  // coalesce runs of dirty blocks, extending a rectangle of the previous
+  // block row if it has the same span
+  for (by = 0; by < bh; by++) {
+    bx = 0;
+    while (bx < bw) {
+      if (!dirty[by * bpitch + bx]) {
+        bx++;
+        continue;
+      }
+      start = bx;
+      while ((bx < bw) && dirty[by * bpitch + bx]) {
+        dirty[by * bpitch + bx] = 0;
+        bx++;
+      }
+      for (i = 0; i < nrects; i++) {
+        if ((rects[i].x == start) && (rects[i].w == (bx - start)) &&
+            ((unsigned)(rects[i].y + rects[i].h) == by)) {
+          rects[i].h++;
+          break;
+        }
+      }
+      if (i == nrects) {
+        rects[nrects].x = start;
+        rects[nrects].y = by;
+        rects[nrects].w = bx - start;
+        rects[nrects].h = 1;
+        nrects++;
+      }
+    }
+  }
+  // convert to pixel units, clipped to the screen size
+  for (i = 0; i < nrects; i++) {
+    x = rects[i].x << BX_SHADOW_BLOCK_SHIFT;
+    y = rects[i].y << BX_SHADOW_BLOCK_SHIFT;
+    rects[i].w = BX_MIN((unsigned)(rects[i].x + rects[i].w) << BX_SHADOW_BLOCK_SHIFT, xres) - x;
+    rects[i].h = BX_MIN((unsigned)(rects[i].y + rects[i].h) << BX_SHADOW_BLOCK_SHIFT, yres) - y;
+    rects[i].x = x;
+    rects[i].y = y;
+    if (BX_GUI_THIS shadow.last != NULL) {
+      for (j = 0; j < rects[i].h; j++) {
+        memcpy(&BX_GUI_THIS shadow.last[(y + j) * xres + x],
+               &BX_GUI_THIS shadow.screen[(y + j) * xres + x],
+               rects[i].w * sizeof(Bit32u));
+      }
+    }
+  }
+  BX_GUI_THIS shadow.pending = 0;
+  if (nrects > 0) {
+    BX_GUI_THIS shadow.resized = 0;
+  }
+  return nrects;
+}
+
+void bx_gui_c::shadow_draw_char(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
+                                Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
+                                bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs,
+                                bool font2)
+{
+  if (((unsigned)xc + fw > BX_GUI_THIS shadow.xres) ||
+      ((unsigned)yc + fh > BX_GUI_THIS shadow.yres))
+    return;
+
+  BX_GUI_THIS draw_char_32bpp(BX_GUI_THIS shadow.screen + yc * BX_GUI_THIS shadow.xres + xc,
+                              BX_GUI_THIS shadow.xres, ch, BX_GUI_THIS shadow.palette[fc],
+                              BX_GUI_THIS shadow.palette[bc], fw, fh, fx, fy,
+                              gfxcharw9, cs, ce, curs, font2);
+  BX_GUI_THIS shadow_mark_dirty(xc, yc, fw, fh);
+}
+
+// 8 bpp tiles from the compatibility path
+void bx_gui_c::shadow_tile_update(Bit8u *tile, unsigned x0, unsigned y0)
+{
+  Bit32u *buf;
+  unsigned w, h, i, j;
+
+  if ((x0 >= BX_GUI_THIS shadow.xres) || (y0 >= BX_GUI_THIS shadow.yres))
+    return;
+
+  w = BX_MIN(BX_GUI_THIS x_tilesize, BX_GUI_THIS shadow.xres - x0);
+  h = BX_MIN(BX_GUI_THIS y_tilesize, BX_GUI_THIS shadow.yres - y0);
+  buf = BX_GUI_THIS shadow.screen + y0 * BX_GUI_THIS shadow.xres + x0;
+  for (i = 0; i < h; i++) {
+    for (j = 0; j < w; j++) {
+      buf[j] = BX_GUI_THIS shadow.palette[tile[j]];
+    }
+    tile += BX_GUI_THIS x_tilesize;
+    buf += BX_GUI_THIS shadow.xres;
+  }
+  BX_GUI_THIS shadow_mark_dirty(x0, y0, w, h);
+}
+
+bx_svga_tileinfo_t *bx_gui_c::shadow_tile_info(bx_svga_tileinfo_t *info)
+{
+  info->bpp = 32;
+  info->pitch = BX_GUI_THIS shadow.xres * 4;
+  info->red_shift = 24;
+  info->green_shift = 16;
+  info->blue_shift = 8;
+  info->red_mask = 0xff0000;
+  info->green_mask = 0x00ff00;
+  info->blue_mask = 0x0000ff;
+  info->is_indexed = 0;
+#ifdef BX_LITTLE_ENDIAN
+  info->is_little_endian = 1;
+#else
+  info->is_little_endian = 0;
+#endif
+  return info;
+}
+
+Bit8u *bx_gui_c::shadow_tile_get(unsigned x0, unsigned y0,
+                                 unsigned *w, unsigned *h)
+{
+  if (x0 + BX_GUI_THIS x_tilesize > BX_GUI_THIS shadow.xres) {
+    *w = BX_GUI_THIS shadow.xres - x0;
+  } else {
+    *w = BX_GUI_THIS x_tilesize;
+  }
+  if (y0 + BX_GUI_THIS y_tilesize > BX_GUI_THIS shadow.yres) {
+    *h = BX_GUI_THIS shadow.yres - y0;
+  } else {
+    *h = BX_GUI_THIS y_tilesize;
+  }
+  return (Bit8u *)(BX_GUI_THIS shadow.screen + y0 * BX_GUI_THIS shadow.xres + x0);
+}
+
 #if BX_USE_GUI_CONSOLE
 
 #define BX_CONSOLE_BUFSIZE 4000
@@ -1515,6 +1937,7 @@ void bx_gui_c::console_init(void)
   for (i = 0; i < 256; i++) {
     memcpy(&BX_GUI_THIS vga_charmap[0][0]+i*32, &sdl_font8x16[i], 16);
     BX_GUI_THIS char_changed[0][i] = 1;
+    BX_GUI_THIS glyph_state[i] = 0;
   }
   BX_GUI_THIS charmap_updated = 1;
   console.cursor_x = 0;
@@ -40,6 +40,15 @@
 
 #define BX_MAX_STATUSITEMS 10
 
+// text mode glyph cache: one pixel mask per font (2) and character (256),
+// 32 font rows of up to 18 pixels each (9 dot font in double width mode)
+#define BX_GLYPH_CACHE_ENTRIES 512
+#define BX_GLYPH_ROWS          32
+#define BX_GLYPH_PITCH         24
+
+// off-screen compositor: damage is tracked in blocks of 16x16 pixels
+#define BX_SHADOW_BLOCK_SHIFT  4
+
 // gui dialog capabilities
 #define BX_GUI_DLG_FLOPPY       0x01
 #define BX_GUI_DLG_CDROM        0x02
@@ -110,6 +119,10 @@ typedef struct {
   bool snapshot_mode;
 } bx_svga_tileinfo_t;
 
+typedef struct {
+  Bit16u x, y, w, h;
+} bx_gui_rect_t;
+
 
 BOCHSAPI Bit8u reverse_bitorder(Bit8u);
 
@@ -199,11 +212,33 @@ public:
   void draw_char_common(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
                         Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
                         bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2);
+  void draw_char_8bpp(Bit8u *buf, unsigned pitch, Bit8u ch, Bit8u fc, Bit8u bc,
+                      Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
+                      bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2);
+  void draw_char_32bpp(Bit32u *buf, unsigned pitch, Bit8u ch, Bit32u fgcolor,
+                       Bit32u bgcolor, Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
+                       bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2);
+  const Bit8u *get_glyph(Bit8u ch, bool gfxcharw9, bool font2);
   void text_update_common(Bit8u *old_text, Bit8u *new_text,
                           Bit16u cursor_address, bx_vga_tminfo_t *tm_info);
   void graphics_tile_update_common(Bit8u *tile, unsigned x, unsigned y);
   bx_svga_tileinfo_t *graphics_tile_info_common(bx_svga_tileinfo_t *info);
   Bit8u* get_snapshot_buffer(void) {return snapshot_buffer;}
+  // common off-screen compositor (32-bit xRGB shadow framebuffer)
+  void shadow_init(bool dedup);
+  void shadow_cleanup(void);
+  bool shadow_resize(unsigned x, unsigned y);
+  void shadow_mark_dirty(unsigned x0, unsigned y0, unsigned w, unsigned h);
+  bool shadow_damage_pending(void) {return shadow.pending;}
+  unsigned shadow_max_rects(void) {return shadow.blocks_x * shadow.blocks_y;}
+  unsigned shadow_get_damage(bx_gui_rect_t *rects);
+  void shadow_clear(void);
+  void shadow_draw_char(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
+                        Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
+                        bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2);
+  void shadow_tile_update(Bit8u *tile, unsigned x0, unsigned y0);
+  bx_svga_tileinfo_t *shadow_tile_info(bx_svga_tileinfo_t *info);
+  Bit8u *shadow_tile_get(unsigned x0, unsigned y0, unsigned *w, unsigned *h);
   bool palette_change_common(Bit8u index, Bit8u red, Bit8u green, Bit8u blue);
   void update_drive_status_buttons(void);
   static void     mouse_enabled_changed(bool val);
@@ -311,6 +346,20 @@ protected:
   Bit8u vga_charmap[2][0x2000];
   bool charmap_updated;
   bool char_changed[2][256];
+  // rendered glyph masks (0xff = foreground pixel), built on demand
+  Bit8u *glyph_cache;
+  Bit8u glyph_state[BX_GLYPH_CACHE_ENTRIES];
+  // off-screen compositor state
+  struct {
+    Bit32u *screen;
+    Bit32u *last;
+    bool *dirty;
+    unsigned xres, yres;
+    unsigned blocks_x, blocks_y;
+    bool pending;
+    bool resized;
+    Bit32u palette[256];
+  } shadow;
   // status bar items
   unsigned statusitem_count;
   int led_timer_index;
@@ -26,7 +26,7 @@
 // RFB still to do :
 // - properly handle SetPixelFormat, including big/little-endian flag
 // - depth > 8bpp support
-// - optional compression support
+// - real deflate compression for ZRLE (stored blocks only for now)
 
 
 // Define BX_PLUGGABLE in files that can be compiled into plugins.  For
@@ -67,6 +67,7 @@ public:
 private:
   void rfbMouseMove(int x, int y, int z, int bmask);
   void rfbKeyPressed(Bit32u key, int press_release);
+  void rfbPresent(void);
 };
 
 // declare one instance of the gui object and call macro to insert the
@@ -135,34 +136,60 @@ static struct _rfbKeyboardEvent {
 static unsigned long rfbKeyboardEvents = 0;
 static bool bKeyboardInUse = 0;
 
-// Misc Stuff
-static struct _rfbUpdateRegion {
-    unsigned int x;
-    unsigned int y;
-    unsigned int width;
-    unsigned int height;
-    bool updated;
-} rfbUpdateRegion;
-
 #define BX_RFB_MAX_XDIM 1280
 #define BX_RFB_MAX_YDIM 1024
 #define BX_RFB_DEF_XDIM 720
 #define BX_RFB_DEF_YDIM 480
 
+// Damage tracking: the screen is split into blocks of 16x16 pixels. The
+// emulation thread only marks blocks dirty, the sender thread coalesces them
+// into rectangles and encodes them when the client has requested an update.
+#define RFB_BLOCK_SHIFT 4
+#define RFB_BLOCK_SIZE  (1 << RFB_BLOCK_SHIFT)
+
+static bool *rfbDirtyBlocks = NULL;
+static unsigned rfbBlocksX, rfbBlocksY;
+static bool rfbUpdatePending = 0;
+static bool rfbUpdateRequested = 0;
+static bool rfbFullUpdate = 0;
+BX_MUTEX(rfbUpdateMutex);
+static bx_thread_sem_t rfbSenderSem;
+
+// Sender thread state: snapshot of the dirty blocks and a copy of the
+// framebuffer contents the client currently displays
+static char *rfbFrame = NULL;
+static char *rfbClientScreen = NULL;
+static unsigned rfbClientX, rfbClientY;
+static Bit32u rfbClientEncoding = rfbEncodingRaw;
+static bool rfbClientCopyRect = 0;
+static bool rfbZrleStreamStarted = 0;
+
+typedef struct {
+  Bit8u *data;
+  unsigned size;
+  unsigned len;
+} rfbBuffer;
+
+static rfbBuffer rfbOutBuf = {NULL, 0, 0};
+static rfbBuffer rfbZrleBuf = {NULL, 0, 0};
+
 static Bit8u status_leds[3] = {0x38, 0x07, 0x3f};
 static unsigned char status_gray_text = 0xa4;
 const unsigned char headerbar_bg = 0xff;
 const unsigned char headerbar_fg = 0x00;
 
+// The guest display is rendered by the common compositor (xRGB) and
+// converted to the client pixel format when it is presented. Header bar
+// and status bar are drawn into rfbScreen directly.
 static char *rfbScreen;
-static char rfbPalette[256];
+static Bit8u rfbColorMap[3][256]; // red, green, blue -> client pixel bits
+static bool rfbColorMapValid = 0;
 static bool rfbBGR233Format;
+static bx_gui_rect_t *rfbShadowRects = NULL;
 
 static unsigned rfbWindowX, rfbWindowY;
 static unsigned rfbDimensionX, rfbDimensionY;
 static Bit16u rfbHeaderbarY;
-static unsigned rfbTileX = 0;
-static unsigned rfbTileY = 0;
 static unsigned long rfbOriginLeft = 0;
 static unsigned long rfbOriginRight = 0;
 static bool rfbMouseModeAbsXY = 0;
@@ -190,9 +217,8 @@ void DrawChar(int x, int y, int width, int height, int fontx, int fonty,
               char *bmap, char fg, char bg, bool gfxchar);
 void UpdateScreen(unsigned char *newBits, int x, int y, int width, int height,
         bool update_client);
-void SendUpdate(int x, int y, int width, int height, Bit32u encoding);
-void rfbSetUpdateRegion(unsigned x0, unsigned y0, unsigned w, unsigned h);
 void rfbAddUpdateRegion(unsigned x0, unsigned y0, unsigned w, unsigned h);
+void rfbSendFramebufferUpdate(void);
 void rfbSetStatusText(int element, const char *text, bool active, Bit8u color = 0);
 static Bit32u convertStringToRfbKey(const char *string);
 #if BX_SHOW_IPS && defined(WIN32)
@@ -224,8 +250,6 @@ void bx_rfb_gui_c::specific_init(int argc, char **argv, unsigned headerbar_y)
   rfbDimensionY = BX_RFB_DEF_YDIM;
   rfbWindowX = rfbDimensionX;
   rfbWindowY = rfbDimensionY + rfbHeaderbarY + rfbStatusbarY;
-  rfbTileX = x_tilesize;
-  rfbTileY = y_tilesize;
 
   for (i = 0; i < 256; i++) {
     for (int j = 0; j < 16; j++) {
@@ -264,9 +288,23 @@ void bx_rfb_gui_c::specific_init(int argc, char **argv, unsigned headerbar_y)
   }
 
   rfbScreen = new char[rfbWindowX * rfbWindowY];
-  memset(&rfbPalette, 0, sizeof(rfbPalette));
-
-  rfbSetUpdateRegion(rfbWindowX, rfbWindowY, 0, 0);
+  memset(rfbScreen, 0, rfbWindowX * rfbWindowY);
+  shadow_init(0);
+  shadow_resize(rfbDimensionX, rfbDimensionY);
+  rfbShadowRects = new bx_gui_rect_t[shadow_max_rects()];
+
+  // damage map and sender buffers are sized for the largest resolution
+  rfbBlocksX = (BX_RFB_MAX_XDIM + RFB_BLOCK_SIZE - 1) >> RFB_BLOCK_SHIFT;
+  rfbBlocksY = (BX_RFB_MAX_YDIM + rfbHeaderbarY + rfbStatusbarY + RFB_BLOCK_SIZE - 1) >> RFB_BLOCK_SHIFT;
+  rfbDirtyBlocks = new bool[rfbBlocksX * rfbBlocksY];
+  memset(rfbDirtyBlocks, 0, rfbBlocksX * rfbBlocksY * sizeof(bool));
+  rfbFrame = new char[(rfbBlocksX * rfbBlocksY) << (RFB_BLOCK_SHIFT * 2)];
+  rfbClientScreen = new char[(rfbBlocksX * rfbBlocksY) << (RFB_BLOCK_SHIFT * 2)];
+  memset(rfbFrame, 0, (rfbBlocksX * rfbBlocksY) << (RFB_BLOCK_SHIFT * 2));
+  memset(rfbClientScreen, 0, (rfbBlocksX * rfbBlocksY) << (RFB_BLOCK_SHIFT * 2));
+  rfbClientX = rfbWindowX;
+  rfbClientY = rfbWindowY;
+  BX_INIT_MUTEX(rfbUpdateMutex);
 
   clientEncodingsCount=0;
   clientEncodings=NULL;
@@ -343,45 +381,26 @@ void bx_rfb_gui_c::handle_events(void)
 
 void bx_rfb_gui_c::flush(void)
 {
-  if (rfbUpdateRegion.updated) {
-    SendUpdate(rfbUpdateRegion.x, rfbUpdateRegion.y, rfbUpdateRegion.width,
-               rfbUpdateRegion.height, rfbEncodingRaw);
-    rfbSetUpdateRegion(rfbWindowX, rfbWindowY, 0, 0);
+  rfbPresent();
+  // encoding and sending is done by the sender thread
+  if (rfbUpdatePending && rfbUpdateRequested) {
+    bx_set_sem(&rfbSenderSem);
   }
 }
 
 void bx_rfb_gui_c::clear_screen(void)
 {
+  // the guest area may be larger than the compositor screen
   memset(&rfbScreen[rfbWindowX * rfbHeaderbarY], 0, rfbWindowX * rfbDimensionY);
   rfbAddUpdateRegion(0, rfbHeaderbarY, rfbWindowX, rfbDimensionY);
+  shadow_clear();
 }
 
 void bx_rfb_gui_c::draw_char(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
                              Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
                              bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2)
 {
-  Bit8u fgcol = rfbPalette[fc];
-  Bit8u bgcol = rfbPalette[bc];
-  char *font_ptr;
-
-  yc += rfbHeaderbarY;
-  if (font2) {
-    font_ptr = (char *)&vga_charmap[1][ch << 5];
-  } else {
-    font_ptr = (char *)&vga_charmap[0][ch << 5];
-  }
-  DrawChar(xc, yc, fw, fh, fx, fy, font_ptr, fgcol, bgcol, gfxcharw9);
-  rfbAddUpdateRegion(xc, yc, fw, fh);
-  if (curs && (ce >= fy) && (cs < (fh + fy))) {
-    if (cs > fy) {
-      yc += (cs - fy);
-      fh -= (cs - fy);
-    }
-    if ((ce - cs + 1) < fh) {
-      fh = ce - cs + 1;
-    }
-    DrawChar(xc, yc, fw, fh, fx, cs, font_ptr, bgcol, fgcol, gfxcharw9);
-  }
+  shadow_draw_char(ch, fc, bc, xc, yc, fw, fh, fx, fy, gfxcharw9, cs, ce, curs, font2);
 }
 
 void bx_rfb_gui_c::text_update(Bit8u *old_text, Bit8u *new_text, unsigned long cursor_x, unsigned long cursor_y, bx_vga_tminfo_t *tm_info)
@@ -401,47 +420,21 @@ int bx_rfb_gui_c::set_clipboard_text(char *text_snapshot, Bit32u len)
 
 bool bx_rfb_gui_c::palette_change(Bit8u index, Bit8u red, Bit8u green, Bit8u blue)
 {
-  if (rfbBGR233Format) {
-    rfbPalette[index] = (((red * 7 + 127) / 255) << 0) | (((green * 7 + 127) / 255) << 3) | (((blue * 3 + 127) / 255) << 6);
-  } else {
-    rfbPalette[index] = (((red * 7 + 127) / 255) << 5) | (((green * 7 + 127) / 255) << 2) | (((blue * 3 + 127) / 255) << 0);
-  }
+  // the compositor palette is updated by palette_change_common()
   return 1;
 }
 
 void bx_rfb_gui_c::graphics_tile_update(Bit8u *tile, unsigned x0, unsigned y0)
 {
-  unsigned c, i, h, y;
-
-  switch (guest_bpp) {
-    case 8: /* 8 bpp */
-      y = y0 + rfbHeaderbarY;
-      if ((y0 + rfbTileY) > rfbDimensionY) {
-        h = rfbDimensionY - y0;
-      } else {
-        h = rfbTileY;
-      }
-      for (i = 0; i < h; i++) {
-        for (c = 0; c < rfbTileX; c++) {
-          tile[(i * rfbTileX) + c] = rfbPalette[tile[(i * rfbTileX) + c]];
-        }
-        memcpy(&rfbScreen[y * rfbWindowX + x0], &tile[i * rfbTileX], rfbTileX);
-        y++;
-      }
-      break;
-    default:
-      BX_PANIC(("%u bpp modes handled by new graphics API", guest_bpp));
-      return;
-  }
-  rfbAddUpdateRegion(x0, y0 + rfbHeaderbarY, rfbTileX, h);
+  shadow_tile_update(tile, x0, y0);
 }
 
 void bx_rfb_gui_c::dimension_update(unsigned x, unsigned y, unsigned fheight, unsigned fwidth, unsigned bpp)
 {
-  if (bpp == 8) {
+  if ((bpp == 8) || (bpp == 15) || (bpp == 16) || (bpp == 24) || (bpp == 32)) {
     guest_bpp = bpp;
   } else {
-    BX_PANIC(("%d bpp graphics mode not supported yet", bpp));
+    BX_PANIC(("%d bpp graphics mode not supported", bpp));
   }
   guest_textmode = (fheight > 0);
   guest_fwidth = fwidth;
@@ -453,25 +446,27 @@ void bx_rfb_gui_c::dimension_update(unsigned x, unsigned y, unsigned fheight, un
       if ((x > BX_RFB_MAX_XDIM) || (y > BX_RFB_MAX_YDIM)) {
         BX_PANIC(("dimension_update(): RFB doesn't support graphics mode %dx%d", x, y));
       }
+      // the sender thread notices the new size and sends DesktopSize
+      BX_LOCK(rfbUpdateMutex);
       rfbDimensionX = x;
       rfbDimensionY = y;
       rfbWindowX = rfbDimensionX;
       rfbWindowY = rfbDimensionY + rfbHeaderbarY + rfbStatusbarY;
       delete [] rfbScreen;
       rfbScreen = new char[rfbWindowX * rfbWindowY];
-      SendUpdate(0, 0, rfbWindowX, rfbWindowY, rfbEncodingDesktopSize);
+      BX_UNLOCK(rfbUpdateMutex);
       bx_gui->show_headerbar();
-      rfbSetUpdateRegion(0, 0, rfbWindowX, rfbWindowY);
+      rfbAddUpdateRegion(0, 0, rfbWindowX, rfbWindowY);
     } else {
       if ((x > BX_RFB_DEF_XDIM) || (y > BX_RFB_DEF_YDIM)) {
         BX_PANIC(("dimension_update(): RFB doesn't support graphics mode %dx%d", x, y));
       }
       clear_screen();
-      SendUpdate(0, rfbHeaderbarY, rfbDimensionX, rfbDimensionY, rfbEncodingRaw);
       rfbDimensionX = x;
       rfbDimensionY = y;
     }
   }
+  shadow_resize(x, y);
 }
 
 unsigned bx_rfb_gui_c::create_bitmap(const unsigned char *bmap, unsigned xdim, unsigned ydim)
@@ -569,10 +564,17 @@ void bx_rfb_gui_c::exit(void)
 {
   unsigned int i;
   keep_alive = 0;
+  bx_set_sem(&rfbSenderSem);
 #ifdef BX_RFB_WIN32
   StopWinsock();
 #endif
+  BX_LOCK(rfbUpdateMutex);
   delete [] rfbScreen;
+  rfbScreen = NULL;
+  BX_UNLOCK(rfbUpdateMutex);
+  shadow_cleanup();
+  delete [] rfbShadowRects;
+  rfbShadowRects = NULL;
   for(i = 0; i < rfbBitmapCount; i++) {
     free(rfbBitmaps[i].bmap);
   }
@@ -592,46 +594,63 @@ void bx_rfb_gui_c::mouse_enabled_changed_specific(bool val)
 
 bx_svga_tileinfo_t *bx_rfb_gui_c::graphics_tile_info(bx_svga_tileinfo_t *info)
 {
-  info->bpp = 8;
-  info->pitch = rfbWindowX;
-  info->red_shift = 3;
-  info->green_shift = 6;
-  info->blue_shift = 8;
-  info->red_mask = 0x07;
-  info->green_mask = 0x38;
-  info->blue_mask = 0xc0;
-  info->is_indexed = 0;
-#ifdef BX_LITTLE_ENDIAN
-  info->is_little_endian = 1;
-#else
-  info->is_little_endian = 0;
-#endif
-
-  return info;
+  return shadow_tile_info(info);
 }
 
 Bit8u *bx_rfb_gui_c::graphics_tile_get(unsigned x0, unsigned y0,
                             unsigned *w, unsigned *h)
 {
-  if (x0 + rfbTileX > rfbDimensionX) {
-    *w = rfbDimensionX - x0;
-  } else {
-    *w = rfbTileX;
-  }
-
-  if (y0 + rfbTileY > rfbDimensionY) {
-    *h = rfbDimensionY - y0;
-  } else {
-    *h = rfbTileY;
-  }
-
-  return (Bit8u *)rfbScreen + (rfbHeaderbarY + y0) * rfbWindowX + x0;
+  return shadow_tile_get(x0, y0, w, h);
 }
 
 void bx_rfb_gui_c::graphics_tile_update_in_place(unsigned x0, unsigned y0,
                                         unsigned w, unsigned h)
 {
-  rfbAddUpdateRegion(x0, y0 + rfbHeaderbarY, w, h);
+  shadow_mark_dirty(x0, y0, w, h);
+}
+
+// Converts the damaged parts of the compositor screen to the client pixel
+// format and passes them to the sender thread.
+void bx_rfb_gui_c::rfbPresent(void)
+{
+  unsigned i, j, k, n, r, g, b;
+  Bit32u *src, pixel;
+  Bit8u *dst;
+
+  if (!rfbColorMapValid) {
+    rfbColorMapValid = 1;
+    for (i = 0; i < 256; i++) {
+      r = (i * 7 + 127) / 255;
+      g = (i * 7 + 127) / 255;
+      b = (i * 3 + 127) / 255;
+      if (rfbBGR233Format) {
+        rfbColorMap[0][i] = r << 0;
+        rfbColorMap[1][i] = g << 3;
+        rfbColorMap[2][i] = b << 6;
+      } else {
+        rfbColorMap[0][i] = r << 5;
+        rfbColorMap[1][i] = g << 2;
+        rfbColorMap[2][i] = b << 0;
+      }
+    }
+    shadow_mark_dirty(0, 0, shadow.xres, shadow.yres);
+  }
+  n = shadow_get_damage(rfbShadowRects);
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < rfbShadowRects[i].h; j++) {
+      src = &shadow.screen[(rfbShadowRects[i].y + j) * shadow.xres + rfbShadowRects[i].x];
+      dst = (Bit8u *)&rfbScreen[(rfbHeaderbarY + rfbShadowRects[i].y + j) * rfbWindowX +
+                                rfbShadowRects[i].x];
+      for (k = 0; k < rfbShadowRects[i].w; k++) {
+        pixel = src[k];
+        dst[k] = rfbColorMap[0][(pixel >> 16) & 0xff] |
+                 rfbColorMap[1][(pixel >> 8) & 0xff] |
+                 rfbColorMap[2][pixel & 0xff];
+      }
+    }
+    rfbAddUpdateRegion(rfbShadowRects[i].x, rfbShadowRects[i].y + rfbHeaderbarY,
+                       rfbShadowRects[i].w, rfbShadowRects[i].h);
+  }
 }
 
 
@@ -644,7 +663,7 @@ void bx_rfb_gui_c::get_capabilities(Bit16u *xres, Bit16u *yres, Bit16u *bpp)
     *xres = BX_RFB_DEF_XDIM;
     *yres = BX_RFB_DEF_YDIM;
   }
-  *bpp = 8;
+  *bpp = 32;
 }
 
 void bx_rfb_gui_c::statusbar_setitem_specific(int element, bool active, bool w)
@@ -1206,12 +1225,29 @@ end_of_thread:
   BX_THREAD_EXIT;
 }
 
+BX_THREAD_FUNC(rfbSenderThread, indata)
+{
+  UNUSED(indata);
+  while (keep_alive) {
+    bx_wait_sem(&rfbSenderSem);
+    if (!keep_alive) break;
+    if (sGlobal != INVALID_SOCKET) {
+      rfbSendFramebufferUpdate();
+    }
+  }
+  BX_THREAD_EXIT;
+}
+
 void rfbStartThread()
 {
   BX_THREAD_VAR(thread_var);
+  BX_THREAD_VAR(sender_var);
 
+  bx_create_sem(&rfbSenderSem);
   BX_THREAD_CREATE(rfbServerThreadInit, NULL, thread_var);
+  BX_THREAD_CREATE(rfbSenderThread, NULL, sender_var);
   UNUSED(thread_var);
+  UNUSED(sender_var);
 }
 
 void HandleRfbClient(SOCKET sClient)
@@ -1273,6 +1309,15 @@ void HandleRfbClient(SOCKET sClient)
     return;
   }
 
+  BX_LOCK(rfbUpdateMutex);
+  rfbClientX = rfbWindowX;
+  rfbClientY = rfbWindowY;
+  rfbClientEncoding = rfbEncodingRaw;
+  rfbClientCopyRect = 0;
+  rfbZrleStreamStarted = 0;
+  rfbUpdateRequested = 0;
+  BX_UNLOCK(rfbUpdateMutex);
+
   client_connected = 1;
   sGlobal = sClient;
   while (keep_alive) {
@@ -1304,6 +1349,7 @@ void HandleRfbClient(SOCKET sClient)
           spf.pixelFormat.blueMax = ntohs(spf.pixelFormat.blueMax);
 
           rfbBGR233Format = 1;
+          rfbColorMapValid = 0;
           if (PF_EQ(spf.pixelFormat, RGB332Format)) {
             rfbBGR233Format = 0;
             status_leds[0] = 0x1c;
@@ -1357,6 +1403,24 @@ void HandleRfbClient(SOCKET sClient)
             clientEncodings[i]=ntohl(enc);
           }
 
+          // the first supported encoding in the client's list is used
+          Bit32u encoding = rfbEncodingRaw;
+          bool encoding_found = 0, copyrect = 0;
+          for (i = 0; i < clientEncodingsCount; i++) {
+            if (!encoding_found && ((clientEncodings[i] == rfbEncodingZRLE) ||
+                (clientEncodings[i] == rfbEncodingHextile) ||
+                (clientEncodings[i] == rfbEncodingRaw))) {
+              encoding = clientEncodings[i];
+              encoding_found = 1;
+            } else if (clientEncodings[i] == rfbEncodingCopyRect) {
+              copyrect = 1;
+            }
+          }
+          BX_LOCK(rfbUpdateMutex);
+          rfbClientEncoding = encoding;
+          rfbClientCopyRect = copyrect;
+          BX_UNLOCK(rfbUpdateMutex);
+
           // print supported encodings
           BX_INFO(("rfbSetEncodings : client supported encodings:"));
           for (i = 0; i < clientEncodingsCount; i++) {
@@ -1374,6 +1438,9 @@ void HandleRfbClient(SOCKET sClient)
             }
             if (!found) BX_INFO(("%08x Unknown", clientEncodings[i]));
           }
+          BX_INFO(("using %s encoding%s", (encoding == rfbEncodingZRLE) ? "ZRLE" :
+                   (encoding == rfbEncodingHextile) ? "Hextile" : "Raw",
+                   copyrect ? " and CopyRect" : ""));
           break;
         }
       case rfbFramebufferUpdateRequest:
@@ -1381,15 +1448,18 @@ void HandleRfbClient(SOCKET sClient)
           rfbFramebufferUpdateRequestMessage fur;
 
           ReadExact(sClient, (char *)&fur, sizeof(rfbFramebufferUpdateRequestMessage));
-          if(!fur.incremental) {
-            rfbSetUpdateRegion(0, 0, rfbWindowX, rfbWindowY);
-          } //else {
-          //    if(fur.x < rfbUpdateRegion.x) rfbUpdateRegion.x = fur.x;
-          //    if(fur.y < rfbUpdateRegion.x) rfbUpdateRegion.y = fur.y;
-          //    if(((fur.x + fur.w) - rfbUpdateRegion.x) > rfbUpdateRegion.width) rfbUpdateRegion.width = ((fur.x + fur.w) - rfbUpdateRegion.x);
-          //    if(((fur.y + fur.h) - rfbUpdateRegion.y) > rfbUpdateRegion.height) rfbUpdateRegion.height = ((fur.y + fur.h) - rfbUpdateRegion.y);
-          //}
-          //rfbUpdateRegion.updated = 1;
+          if (!fur.incremental) {
+            rfbAddUpdateRegion(0, 0, rfbWindowX, rfbWindowY);
+          }
+          BX_LOCK(rfbUpdateMutex);
+          if (!fur.incremental) {
+            rfbFullUpdate = 1;
+          }
+          rfbUpdateRequested = 1;
+          BX_UNLOCK(rfbUpdateMutex);
+          if (rfbUpdatePending) {
+            bx_set_sem(&rfbSenderSem);
+          }
           break;
         }
       case rfbKeyEvent:
@@ -1569,99 +1639,608 @@ void UpdateScreen(unsigned char *newBits, int x, int y, int width, int height,
     y++;
   }
   if (update_client) {
-    if(sGlobal == INVALID_SOCKET) return;
-    rfbFramebufferUpdateMessage fum;
-    rfbFramebufferUpdateRectHeader furh;
-    fum.messageType = rfbFramebufferUpdate;
-    fum.numberOfRectangles = htons(1);
-    WriteExact(sGlobal, (char *)&fum, rfbFramebufferUpdateMessageSize);
-    furh.r.xPosition = htons(x0);
-    furh.r.yPosition = htons(y0);
-    furh.r.width = htons((short)width);
-    furh.r.height = htons((short)height);
-    furh.r.encodingType = htonl(rfbEncodingRaw);
-    WriteExact(sGlobal, (char *)&furh, rfbFramebufferUpdateRectHeaderSize);
-    WriteExact(sGlobal, (char *)newBits, width * height);
+    rfbAddUpdateRegion(x0, y0, width, height);
   }
 }
 
-void SendUpdate(int x, int y, int width, int height, Bit32u encoding)
+void rfbAddUpdateRegion(unsigned x0, unsigned y0, unsigned w, unsigned h)
 {
-    char *newBits;
+  unsigned bx, by, bx1, by1;
 
-    if(x < 0 || y < 0 || (x + width) > (int)rfbWindowX || (y + height) > (int)rfbWindowY) {
-        BX_ERROR(("Dimensions out of bounds.  x=%i y=%i w=%i h=%i", x, y, width, height));
+  if ((x0 >= rfbWindowX) || (y0 >= rfbWindowY) || (w == 0) || (h == 0)) {
+    return;
+  }
+  if ((x0 + w) > rfbWindowX) {
+    w = rfbWindowX - x0;
+  }
+  if ((y0 + h) > rfbWindowY) {
+    h = rfbWindowY - y0;
+  }
+  bx1 = (x0 + w - 1) >> RFB_BLOCK_SHIFT;
+  by1 = (y0 + h - 1) >> RFB_BLOCK_SHIFT;
+  BX_LOCK(rfbUpdateMutex);
+  for (by = (y0 >> RFB_BLOCK_SHIFT); by <= by1; by++) {
+    for (bx = (x0 >> RFB_BLOCK_SHIFT); bx <= bx1; bx++) {
+      rfbDirtyBlocks[by * rfbBlocksX + bx] = 1;
     }
-    if(sGlobal != INVALID_SOCKET) {
-        rfbFramebufferUpdateMessage fum;
-        rfbFramebufferUpdateRectHeader furh;
-
-        fum.messageType = rfbFramebufferUpdate;
-        fum.numberOfRectangles = htons(1);
-
-        furh.r.xPosition = htons(x);
-        furh.r.yPosition = htons(y);
-        furh.r.width = htons((short)width);
-        furh.r.height = htons((short)height);
-        furh.r.encodingType = htonl(encoding);
-
-        WriteExact(sGlobal, (char *)&fum, rfbFramebufferUpdateMessageSize);
-        WriteExact(sGlobal, (char *)&furh, rfbFramebufferUpdateRectHeaderSize);
-
-        if (encoding == rfbEncodingRaw) {
-          newBits = new char[width * height];
-          for(int i = 0; i < height; i++) {
-            memcpy(&newBits[i * width], &rfbScreen[y * rfbWindowX + x], width);
-            y++;
-          }
-          WriteExact(sGlobal, (char *)newBits, width * height);
-          delete [] newBits;
-        }
+  }
+  rfbUpdatePending = 1;
+  BX_UNLOCK(rfbUpdateMutex);
+}
+
+// Output buffer helpers (all values are sent in network byte order)
+
+static Bit8u *rfbBufReserve(rfbBuffer *buf, unsigned len)
+{
+  Bit8u *ptr;
+
+  if ((buf->len + len) > buf->size) {
+    unsigned newsize = buf->size * 2;
+    if (newsize < (buf->len + len + 65536)) {
+      newsize = buf->len + len + 65536;
     }
+    ptr = new Bit8u[newsize];
+    if (buf->data != NULL) {
+      memcpy(ptr, buf->data, buf->len);
+      delete [] buf->data;
+    }
+    buf->data = ptr;
+    buf->size = newsize;
+  }
+  ptr = buf->data + buf->len;
+  buf->len += len;
+  return ptr;
 }
 
-void rfbSetUpdateRegion(unsigned x0, unsigned y0, unsigned w, unsigned h)
+static void rfbBufPut8(rfbBuffer *buf, Bit8u value)
 {
-  rfbUpdateRegion.x = x0;
-  rfbUpdateRegion.y = y0;
-  rfbUpdateRegion.width  = w;
-  rfbUpdateRegion.height = h;
-  rfbUpdateRegion.updated = ((w > 0) && (h > 0));
+  *rfbBufReserve(buf, 1) = value;
 }
 
-void rfbAddUpdateRegion(unsigned x0, unsigned y0, unsigned w, unsigned h)
+static void rfbBufPut16(rfbBuffer *buf, Bit16u value)
 {
-  unsigned x1, y1;
+  Bit8u *ptr = rfbBufReserve(buf, 2);
+  ptr[0] = (Bit8u)(value >> 8);
+  ptr[1] = (Bit8u)value;
+}
+
+static void rfbBufPut32(rfbBuffer *buf, Bit32u value)
+{
+  Bit8u *ptr = rfbBufReserve(buf, 4);
+  ptr[0] = (Bit8u)(value >> 24);
+  ptr[1] = (Bit8u)(value >> 16);
+  ptr[2] = (Bit8u)(value >> 8);
+  ptr[3] = (Bit8u)value;
+}
+
+static void rfbBufPutRectHeader(rfbBuffer *buf, unsigned x, unsigned y,
+                                unsigned w, unsigned h, Bit32u encoding)
+{
+  rfbBufPut16(buf, x);
+  rfbBufPut16(buf, y);
+  rfbBufPut16(buf, w);
+  rfbBufPut16(buf, h);
+  rfbBufPut32(buf, encoding);
+}
 
-  if (!rfbUpdateRegion.updated) {
-    rfbSetUpdateRegion(x0, y0, w, h);
+// run lengths of the RLE encodings are stored as length - 1 in a sequence
+// of bytes terminated by a value < 255
+static void rfbBufPutRunLength(rfbBuffer *buf, unsigned len)
+{
+  len--;
+  while (len >= 255) {
+    rfbBufPut8(buf, 255);
+    len -= 255;
+  }
+  rfbBufPut8(buf, (Bit8u)len);
+}
+
+static void rfbGetTile(Bit8u *tile, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+  for (unsigned i = 0; i < h; i++) {
+    memcpy(&tile[i * w], &rfbFrame[(y + i) * rfbClientX + x], w);
+  }
+}
+
+// Raw encoding
+
+static void rfbEncodeRaw(unsigned x, unsigned y, unsigned w, unsigned h)
+{
+  rfbGetTile(rfbBufReserve(&rfbOutBuf, w * h), x, y, w, h);
+}
+
+// Hextile encoding
+
+static void rfbEncodeHextileTile(const Bit8u *tile, unsigned w, unsigned h,
+                                 Bit8u *bg, bool *bg_valid, Bit8u *fg, bool *fg_valid)
+{
+  Bit16u count[256];
+  bool done[RFB_BLOCK_SIZE * RFB_BLOCK_SIZE];
+  Bit8u subrects[RFB_BLOCK_SIZE * RFB_BLOCK_SIZE * 3];
+  unsigned i, j, k, sw, sh, ncolors = 0, nsubrects = 0, len = 0;
+  unsigned n = w * h, size, maxsize = n + 1;
+  Bit8u mask, c, newbg = tile[0], newfg = 0;
+  bool coloured;
+
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < n; i++) {
+    if (count[tile[i]]++ == 0) ncolors++;
+    if (count[tile[i]] > count[newbg]) newbg = tile[i];
+  }
+  coloured = (ncolors > 2);
+  if (ncolors == 2) {
+    for (i = 0; (i < n) && (tile[i] == newbg); i++);
+    newfg = tile[i];
+  }
+
+  // split the foreground pixels into subrectangles
+  memset(done, 0, sizeof(done));
+  for (j = 0; (j < h) && (len < maxsize); j++) {
+    for (i = 0; (i < w) && (len < maxsize); i++) {
+      c = tile[j * w + i];
+      if ((c == newbg) || done[j * w + i]) continue;
+      for (sw = 1; ((i + sw) < w) && (tile[j * w + i + sw] == c) && !done[j * w + i + sw]; sw++);
+      for (sh = 1; (j + sh) < h; sh++) {
+        for (k = 0; (k < sw) && (tile[(j + sh) * w + i + k] == c) &&
+             !done[(j + sh) * w + i + k]; k++);
+        if (k < sw) break;
+      }
+      for (k = 0; k < sh; k++) {
+        memset(&done[(j + k) * w + i], 1, sw);
+      }
+      if (coloured) {
+        subrects[len++] = c;
+      }
+      subrects[len++] = rfbHextilePackXY(i, j);
+      subrects[len++] = rfbHextilePackWH(sw, sh);
+      nsubrects++;
+    }
+  }
+
+  mask = 0;
+  size = 1;
+  if (!*bg_valid || (newbg != *bg)) {
+    mask |= rfbHextileBackgroundSpecified;
+    size++;
+  }
+  if (nsubrects > 0) {
+    mask |= rfbHextileAnySubrects;
+    size += 1 + len;
+    if (coloured) {
+      mask |= rfbHextileSubrectsColoured;
+    } else if (!*fg_valid || (newfg != *fg)) {
+      mask |= rfbHextileForegroundSpecified;
+      size++;
+    }
+  }
+  if ((size >= maxsize) || (nsubrects > 255)) {
+    // the background and foreground values are undefined after a raw tile
+    rfbBufPut8(&rfbOutBuf, rfbHextileRaw);
+    memcpy(rfbBufReserve(&rfbOutBuf, n), tile, n);
+    *bg_valid = 0;
+    *fg_valid = 0;
+    return;
+  }
+  rfbBufPut8(&rfbOutBuf, mask);
+  if (mask & rfbHextileBackgroundSpecified) {
+    rfbBufPut8(&rfbOutBuf, newbg);
+    *bg = newbg;
+    *bg_valid = 1;
+  }
+  if (mask & rfbHextileForegroundSpecified) {
+    rfbBufPut8(&rfbOutBuf, newfg);
+    *fg = newfg;
+    *fg_valid = 1;
+  }
+  if (mask & rfbHextileAnySubrects) {
+    rfbBufPut8(&rfbOutBuf, (Bit8u)nsubrects);
+    memcpy(rfbBufReserve(&rfbOutBuf, len), subrects, len);
+    if (coloured) {
+      *fg_valid = 0;
+    }
+  }
+}
+
+static void rfbEncodeHextile(unsigned x, unsigned y, unsigned w, unsigned h)
+{
+  Bit8u tile[RFB_BLOCK_SIZE * RFB_BLOCK_SIZE];
+  Bit8u bg = 0, fg = 0;
+  bool bg_valid = 0, fg_valid = 0;
+  unsigned tx, ty, tw, th;
+
+  for (ty = y; ty < (y + h); ty += RFB_BLOCK_SIZE) {
+    th = BX_MIN(RFB_BLOCK_SIZE, y + h - ty);
+    for (tx = x; tx < (x + w); tx += RFB_BLOCK_SIZE) {
+      tw = BX_MIN(RFB_BLOCK_SIZE, x + w - tx);
+      rfbGetTile(tile, tx, ty, tw, th);
+      rfbEncodeHextileTile(tile, tw, th, &bg, &bg_valid, &fg, &fg_valid);
+    }
+  }
+}
+
+// ZRLE encoding
+
+#define RFB_ZRLE_TILE_SIZE 64
+
+static void rfbEncodeZrleTile(unsigned x, unsigned y, unsigned w, unsigned h)
+{
+  Bit8u tile[RFB_ZRLE_TILE_SIZE * RFB_ZRLE_TILE_SIZE];
+  Bit8u palette[127], index[256];
+  unsigned i, j, len, bits, rowbytes, best, n = w * h;
+  unsigned npal = 0, plain_rle = 0, palette_rle = 0;
+  bool too_many = 0;
+  Bit8u c, value, subencoding = 0;
+
+  rfbGetTile(tile, x, y, w, h);
+  memset(index, 0xff, sizeof(index));
+  for (i = 0; i < n; i += len) {
+    c = tile[i];
+    for (len = 1; ((i + len) < n) && (tile[i + len] == c); len++);
+    if (index[c] == 0xff) {
+      if (npal < 127) {
+        index[c] = (Bit8u)npal;
+        palette[npal++] = c;
+      } else {
+        too_many = 1;
+      }
+    }
+    plain_rle += 1 + (len - 1) / 255 + 1;
+    palette_rle += (len == 1) ? 1 : (1 + (len - 1) / 255 + 1);
+  }
+
+  if (npal == 1) {
+    rfbBufPut8(&rfbZrleBuf, 1);
+    rfbBufPut8(&rfbZrleBuf, palette[0]);
+    return;
+  }
+  // pick the smallest of raw, packed palette, palette RLE and plain RLE
+  best = n;
+  bits = (npal == 2) ? 1 : ((npal <= 4) ? 2 : 4);
+  rowbytes = (w * bits + 7) >> 3;
+  if (!too_many && (npal <= 16) && ((npal + rowbytes * h) < best)) {
+    best = npal + rowbytes * h;
+    subencoding = (Bit8u)npal;
+  }
+  if (!too_many && ((npal + palette_rle) < best)) {
+    best = npal + palette_rle;
+    subencoding = (Bit8u)(128 + npal);
+  }
+  if (plain_rle < best) {
+    subencoding = 128;
+  }
+
+  rfbBufPut8(&rfbZrleBuf, subencoding);
+  if (subencoding == 0) {
+    memcpy(rfbBufReserve(&rfbZrleBuf, n), tile, n);
+  } else if (subencoding <= 16) {
+    memcpy(rfbBufReserve(&rfbZrleBuf, npal), palette, npal);
+    for (j = 0; j < h; j++) {
+      value = 0;
+      len = 0;
+      for (i = 0; i < w; i++) {
+        value = (value << bits) | index[tile[j * w + i]];
+        len += bits;
+        if (len == 8) {
+          rfbBufPut8(&rfbZrleBuf, value);
+          value = 0;
+          len = 0;
+        }
+      }
+      if (len > 0) {
+        rfbBufPut8(&rfbZrleBuf, (Bit8u)(value << (8 - len)));
+      }
+    }
   } else {
-    x1 = rfbUpdateRegion.x + rfbUpdateRegion.width;
-    y1 = rfbUpdateRegion.y + rfbUpdateRegion.height;
-    if (x0 < rfbUpdateRegion.x) {
-      rfbUpdateRegion.x = x0;
+    if (subencoding > 128) {
+      memcpy(rfbBufReserve(&rfbZrleBuf, npal), palette, npal);
     }
-    if (y0 < rfbUpdateRegion.y) {
-      rfbUpdateRegion.y = y0;
+    for (i = 0; i < n; i += len) {
+      c = tile[i];
+      for (len = 1; ((i + len) < n) && (tile[i + len] == c); len++);
+      if (subencoding == 128) {
+        rfbBufPut8(&rfbZrleBuf, c);
+        rfbBufPutRunLength(&rfbZrleBuf, len);
+      } else if (len == 1) {
+        rfbBufPut8(&rfbZrleBuf, index[c]);
+      } else {
+        rfbBufPut8(&rfbZrleBuf, index[c] | 0x80);
+        rfbBufPutRunLength(&rfbZrleBuf, len);
+      }
     }
-    if ((x0 + w) > x1) {
-      rfbUpdateRegion.width = x0 + w - rfbUpdateRegion.x;
-    } else {
-      rfbUpdateRegion.width= x1 - rfbUpdateRegion.x;
+  }
+}
+
+static void rfbEncodeZRLE(unsigned x, unsigned y, unsigned w, unsigned h)
+{
+  unsigned tx, ty, pos, len, remaining;
+  const Bit8u *data;
+  Bit8u *ptr;
+
+  rfbZrleBuf.len = 0;
+  for (ty = y; ty < (y + h); ty += RFB_ZRLE_TILE_SIZE) {
+    for (tx = x; tx < (x + w); tx += RFB_ZRLE_TILE_SIZE) {
+      rfbEncodeZrleTile(tx, ty, BX_MIN(RFB_ZRLE_TILE_SIZE, x + w - tx),
+                        BX_MIN(RFB_ZRLE_TILE_SIZE, y + h - ty));
     }
-    if ((y0 + h) > y1) {
-      rfbUpdateRegion.height = y0 + h - rfbUpdateRegion.y;
-    } else {
-      rfbUpdateRegion.height = y1 - rfbUpdateRegion.y;
+  }
+
+  // The tile data is sent as part of one zlib stream per connection. Without
+  // a deflate implementation it is wrapped into stored (uncompressed) blocks,
+  // the stream is never finished so no checksum is required.
+  pos = rfbOutBuf.len;
+  rfbBufReserve(&rfbOutBuf, 4);
+  if (!rfbZrleStreamStarted) {
+    rfbBufPut8(&rfbOutBuf, 0x78);
+    rfbBufPut8(&rfbOutBuf, 0x01);
+    rfbZrleStreamStarted = 1;
+  }
+  data = rfbZrleBuf.data;
+  remaining = rfbZrleBuf.len;
+  while (remaining > 0) {
+    len = BX_MIN(remaining, 0xffff);
+    ptr = rfbBufReserve(&rfbOutBuf, 5);
+    ptr[0] = 0x00;
+    ptr[1] = (Bit8u)len;
+    ptr[2] = (Bit8u)(len >> 8);
+    ptr[3] = (Bit8u)~len;
+    ptr[4] = (Bit8u)(~len >> 8);
+    memcpy(rfbBufReserve(&rfbOutBuf, len), data, len);
+    data += len;
+    remaining -= len;
+  }
+  len = rfbOutBuf.len - pos - 4;
+  ptr = rfbOutBuf.data + pos;
+  ptr[0] = (Bit8u)(len >> 24);
+  ptr[1] = (Bit8u)(len >> 16);
+  ptr[2] = (Bit8u)(len >> 8);
+  ptr[3] = (Bit8u)len;
+}
+
+// Scroll detection for CopyRect
+
+static bool rfbBlockChanged(unsigned bx, unsigned by)
+{
+  unsigned x = bx << RFB_BLOCK_SHIFT, y = by << RFB_BLOCK_SHIFT;
+  unsigned w = BX_MIN(RFB_BLOCK_SIZE, rfbClientX - x);
+  unsigned h = BX_MIN(RFB_BLOCK_SIZE, rfbClientY - y);
+
+  for (unsigned i = 0; i < h; i++) {
+    if (memcmp(&rfbFrame[(y + i) * rfbClientX + x],
+               &rfbClientScreen[(y + i) * rfbClientX + x], w) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static bool rfbRowsMatch(unsigned x, unsigned newy, unsigned oldy, unsigned w, unsigned count)
+{
+  for (unsigned i = 0; i < count; i++) {
+    if (memcmp(&rfbFrame[(newy + i) * rfbClientX + x],
+               &rfbClientScreen[(oldy + i) * rfbClientX + x], w) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static bool rfbRowUniform(unsigned x, unsigned y, unsigned w)
+{
+  const char *row = &rfbFrame[y * rfbClientX + x];
+  return (memcmp(row, row + 1, w - 1) == 0);
+}
+
+#define RFB_SCROLL_MIN_LINES 32
+
+// Searches the region for a band of lines that has been scrolled up (positive
+// result) or down (negative result) compared to the client's copy. The band
+// found is returned in top / lines, 0 means that nothing has been scrolled.
+static int rfbFindScroll(unsigned x, unsigned y, unsigned w, unsigned h,
+                         unsigned *top, unsigned *lines)
+{
+  unsigned ref, dy, r0, r1;
+
+  // use the first changed line as reference, skipping uniform lines (e.g.
+  // blank text lines) since they would match at any distance
+  for (ref = 0; ref < h; ref++) {
+    if (!rfbRowUniform(x, y + ref, w) && !rfbRowsMatch(x, y + ref, y + ref, w, 1))
+      break;
+  }
+  if (ref >= h) return 0;
+
+  for (dy = 1; (dy + RFB_SCROLL_MIN_LINES) <= h; dy++) {
+    if (((ref + dy) < h) && rfbRowsMatch(x, y + ref, y + ref + dy, w, 1)) {
+      for (r0 = ref; (r0 > 0) && rfbRowsMatch(x, y + r0 - 1, y + r0 - 1 + dy, w, 1); r0--);
+      for (r1 = ref + 1; ((r1 + dy) < h) && rfbRowsMatch(x, y + r1, y + r1 + dy, w, 1); r1++);
+      if ((r1 - r0) >= RFB_SCROLL_MIN_LINES) {
+        *top = y + r0;
+        *lines = r1 - r0;
+        return (int)dy;
+      }
     }
-    if ((rfbUpdateRegion.x + rfbUpdateRegion.width) > rfbWindowX) {
-      rfbUpdateRegion.width = rfbWindowX - rfbUpdateRegion.x;
+    if ((ref >= dy) && rfbRowsMatch(x, y + ref, y + ref - dy, w, 1)) {
+      for (r0 = ref; (r0 > dy) && rfbRowsMatch(x, y + r0 - 1, y + r0 - 1 - dy, w, 1); r0--);
+      for (r1 = ref + 1; (r1 < h) && rfbRowsMatch(x, y + r1, y + r1 - dy, w, 1); r1++);
+      if ((r1 - r0) >= RFB_SCROLL_MIN_LINES) {
+        *top = y + r0;
+        *lines = r1 - r0;
+        return -(int)dy;
+      }
     }
-    if ((rfbUpdateRegion.y + rfbUpdateRegion.height) > rfbWindowY) {
-      rfbUpdateRegion.height = rfbWindowY - rfbUpdateRegion.y;
+  }
+  return 0;
+}
+
+// Sender thread: coalesces the dirty blocks into rectangles, encodes them
+// and sends a single framebuffer update message to the client
+
+static bool *rfbChangedBlocks = NULL;
+static struct _rfbUpdateRect {
+  unsigned x, y, w, h;
+} *rfbUpdateRects = NULL;
+
+void rfbSendFramebufferUpdate(void)
+{
+  unsigned bw, bh, bx, by, i, j, start, nrects = 0;
+  unsigned bx0, by0, bx1, by1, x, y, w, h, stop = 0, slines = 0;
+  bool full, resize = 0;
+  int scroll = 0;
+  Bit32u encoding;
+  bool copyrect;
+
+  BX_LOCK(rfbUpdateMutex);
+  if (!keep_alive || (rfbScreen == NULL) || !rfbUpdateRequested || !rfbUpdatePending) {
+    BX_UNLOCK(rfbUpdateMutex);
+    return;
+  }
+  if (rfbChangedBlocks == NULL) {
+    rfbChangedBlocks = new bool[rfbBlocksX * rfbBlocksY];
+    rfbUpdateRects = new struct _rfbUpdateRect[rfbBlocksX * rfbBlocksY];
+  }
+  if ((rfbClientX != rfbWindowX) || (rfbClientY != rfbWindowY)) {
+    rfbClientX = rfbWindowX;
+    rfbClientY = rfbWindowY;
+    resize = desktop_resizable;
+    rfbFullUpdate = 1;
+  }
+  full = rfbFullUpdate;
+  encoding = rfbClientEncoding;
+  copyrect = rfbClientCopyRect;
+  bw = (rfbClientX + RFB_BLOCK_SIZE - 1) >> RFB_BLOCK_SHIFT;
+  bh = (rfbClientY + RFB_BLOCK_SIZE - 1) >> RFB_BLOCK_SHIFT;
+  // take a snapshot of the dirty blocks
+  for (by = 0; by < bh; by++) {
+    for (bx = 0; bx < bw; bx++) {
+      i = by * rfbBlocksX + bx;
+      rfbChangedBlocks[i] = full || rfbDirtyBlocks[i];
+      if (rfbChangedBlocks[i]) {
+        x = bx << RFB_BLOCK_SHIFT;
+        y = by << RFB_BLOCK_SHIFT;
+        w = BX_MIN(RFB_BLOCK_SIZE, rfbClientX - x);
+        h = BX_MIN(RFB_BLOCK_SIZE, rfbClientY - y);
+        for (j = 0; j < h; j++) {
+          memcpy(&rfbFrame[(y + j) * rfbClientX + x], &rfbScreen[(y + j) * rfbWindowX + x], w);
+        }
+      }
+    }
+  }
+  memset(rfbDirtyBlocks, 0, rfbBlocksX * rfbBlocksY * sizeof(bool));
+  rfbUpdatePending = 0;
+  rfbFullUpdate = 0;
+  BX_UNLOCK(rfbUpdateMutex);
+
+  // drop blocks that have been redrawn with the same contents
+  bx0 = bw;
+  by0 = bh;
+  bx1 = by1 = 0;
+  for (by = 0; by < bh; by++) {
+    for (bx = 0; bx < bw; bx++) {
+      i = by * rfbBlocksX + bx;
+      if (!full && rfbChangedBlocks[i]) {
+        rfbChangedBlocks[i] = rfbBlockChanged(bx, by);
+      }
+      if (rfbChangedBlocks[i]) {
+        if (bx < bx0) bx0 = bx;
+        if (bx > bx1) bx1 = bx;
+        if (by < by0) by0 = by;
+        if (by > by1) by1 = by;
+      }
     }
-    rfbUpdateRegion.updated = 1;
   }
+
+  // replace scrolled contents by a CopyRect and resend only what's left
+  x = bx0 << RFB_BLOCK_SHIFT;
+  y = by0 << RFB_BLOCK_SHIFT;
+  w = BX_MIN((bx1 + 1) << RFB_BLOCK_SHIFT, rfbClientX) - x;
+  h = BX_MIN((by1 + 1) << RFB_BLOCK_SHIFT, rfbClientY) - y;
+  if (!full && copyrect && (bx0 <= bx1) && (h >= RFB_SCROLL_MIN_LINES)) {
+    scroll = rfbFindScroll(x, y, w, h, &stop, &slines);
+    if (scroll > 0) {
+      for (j = 0; j < slines; j++) {
+        memcpy(&rfbClientScreen[(stop + j) * rfbClientX + x],
+               &rfbClientScreen[(stop + j + scroll) * rfbClientX + x], w);
+      }
+    } else if (scroll < 0) {
+      for (j = slines; j-- > 0; ) {
+        memcpy(&rfbClientScreen[(stop + j) * rfbClientX + x],
+               &rfbClientScreen[(stop + j + scroll) * rfbClientX + x], w);
+      }
+    }
+    if (scroll != 0) {
+      for (by = by0; by <= by1; by++) {
+        for (bx = bx0; bx <= bx1; bx++) {
+          rfbChangedBlocks[by * rfbBlocksX + bx] = rfbBlockChanged(bx, by);
+        }
+      }
+    }
+  }
+
+  // coalesce the changed blocks into rectangles
+  for (by = 0; by < bh; by++) {
+    bx = 0;
+    while (bx < bw) {
+      if (!rfbChangedBlocks[by * rfbBlocksX + bx]) {
+        bx++;
+        continue;
+      }
+      start = bx;
+      while ((bx < bw) && rfbChangedBlocks[by * rfbBlocksX + bx]) bx++;
+      for (i = 0; i < nrects; i++) {
+        if ((rfbUpdateRects[i].x == start) && (rfbUpdateRects[i].w == (bx - start)) &&
+            ((rfbUpdateRects[i].y + rfbUpdateRects[i].h) == by)) {
+          rfbUpdateRects[i].h++;
+          break;
+        }
+      }
+      if (i == nrects) {
+        rfbUpdateRects[nrects].x = start;
+        rfbUpdateRects[nrects].y = by;
+        rfbUpdateRects[nrects].w = bx - start;
+        rfbUpdateRects[nrects].h = 1;
+        nrects++;
+      }
+    }
+  }
+
+  if ((nrects == 0) && !resize && (scroll == 0)) {
+    // nothing to send, keep the client's request pending
+    return;
+  }
+
+  rfbOutBuf.len = 0;
+  rfbBufPut8(&rfbOutBuf, rfbFramebufferUpdate);
+  rfbBufPut8(&rfbOutBuf, 0);
+  rfbBufPut16(&rfbOutBuf, nrects + (resize ? 1 : 0) + ((scroll != 0) ? 1 : 0));
+  if (resize) {
+    rfbBufPutRectHeader(&rfbOutBuf, 0, 0, rfbClientX, rfbClientY, rfbEncodingDesktopSize);
+  }
+  if (scroll != 0) {
+    rfbBufPutRectHeader(&rfbOutBuf, x, stop, w, slines, rfbEncodingCopyRect);
+    rfbBufPut16(&rfbOutBuf, x);
+    rfbBufPut16(&rfbOutBuf, stop + scroll);
+  }
+  for (i = 0; i < nrects; i++) {
+    x = rfbUpdateRects[i].x << RFB_BLOCK_SHIFT;
+    y = rfbUpdateRects[i].y << RFB_BLOCK_SHIFT;
+    w = BX_MIN((rfbUpdateRects[i].x + rfbUpdateRects[i].w) << RFB_BLOCK_SHIFT, rfbClientX) - x;
+    h = BX_MIN((rfbUpdateRects[i].y + rfbUpdateRects[i].h) << RFB_BLOCK_SHIFT, rfbClientY) - y;
+    rfbBufPutRectHeader(&rfbOutBuf, x, y, w, h, encoding);
+    if (encoding == rfbEncodingZRLE) {
+      rfbEncodeZRLE(x, y, w, h);
+    } else if (encoding == rfbEncodingHextile) {
+      rfbEncodeHextile(x, y, w, h);
+    } else {
+      rfbEncodeRaw(x, y, w, h);
+    }
+    for (j = 0; j < h; j++) {
+      memcpy(&rfbClientScreen[(y + j) * rfbClientX + x], &rfbFrame[(y + j) * rfbClientX + x], w);
+    }
+  }
+
+  BX_LOCK(rfbUpdateMutex);
+  rfbUpdateRequested = 0;
+  BX_UNLOCK(rfbUpdateMutex);
+  WriteExact(sGlobal, (char *)rfbOutBuf.data, rfbOutBuf.len);
 }
 
 void rfbSetStatusText(int element, const char *text, bool active, Bit8u color)
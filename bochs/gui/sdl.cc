@@ -534,10 +534,7 @@ void bx_sdl_gui_c::draw_char(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
                              Bit8u fw, Bit8u fh, Bit8u fx, Bit8u fy,
                              bool gfxcharw9, Bit8u cs, Bit8u ce, bool curs, bool font2)
 {
-  Uint32 *buf, pitch, fgcolor, bgcolor;
-  Bit16u font_row, mask;
-  Bit8u *font_ptr, fontpixels;
-  bool dwidth;
+  Uint32 *buf, pitch;
 
   if (sdl_screen) {
     pitch = sdl_screen->pitch/4;
@@ -546,40 +543,8 @@ void bx_sdl_gui_c::draw_char(Bit8u ch, Bit8u fc, Bit8u bc, Bit16u xc, Bit16u yc,
     pitch = sdl_fullscreen->pitch/4;
     buf = (Uint32 *)sdl_fullscreen->pixels + yc * pitch + xc + sdl_fullscreen->offset/4;
   }
-  fgcolor = sdl_palette[fc];
-  bgcolor = sdl_palette[bc];
-  dwidth = (guest_fwidth > 9);
-  if (font2) {
-    font_ptr = &vga_charmap[1][(ch << 5) + fy];
-  } else {
-    font_ptr = &vga_charmap[0][(ch << 5) + fy];
-  }
-  do {
-    font_row = *font_ptr++;
-    if (gfxcharw9) {
-      font_row = (font_row << 1) | (font_row & 0x01);
-    } else {
-      font_row <<= 1;
-    }
-    if (fx > 0) {
-      font_row <<= fx;
-    }
-    fontpixels = fw;
-    if (curs && (fy >= cs) && (fy <= ce))
-      mask = 0x100;
-    else
-      mask = 0x00;
-    do {
-      if ((font_row & 0x100) == mask)
-        *buf = bgcolor;
-      else
-        *buf = fgcolor;
-      buf++;
-      if (!dwidth || (fontpixels & 1)) font_row <<= 1;
-    } while (--fontpixels);
-    buf += (pitch - fw);
-    fy++;
-  } while (--fh);
+  draw_char_32bpp(buf, pitch, ch, sdl_palette[fc], sdl_palette[bc], fw, fh, fx, fy,
+                  gfxcharw9, cs, ce, curs, font2);
 }
 
 void bx_sdl_gui_c::text_update(Bit8u *old_text, Bit8u *new_text,
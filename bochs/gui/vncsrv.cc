@@ -180,6 +180,16 @@ static unsigned rfbStatusitemPos[12] = {
 };
 static bool rfbStatusitemActive[12];
 
+// Damage tracking: the drawing functions only mark the touched blocks and the
+// coalesced rectangles are passed to libvncserver once per flush()
+#define VNC_BLOCK_SHIFT 4
+static bool *vncDirtyBlocks = NULL;
+static unsigned vncBlocksX, vncBlocksY;
+static bool vncUpdatePending = 0;
+static struct _vncUpdateRect {
+  unsigned x, y, w, h;
+} *vncUpdateRects = NULL;
+
 inline rfbPixel rfbMapRGB(U32 red, U32 green, U32 blue) {
     U16 redMax = theGui->screen->serverFormat.redMax;
     U16 greenMax = theGui->screen->serverFormat.greenMax;
@@ -285,6 +295,13 @@ void bx_vncsrv_gui_c::specific_init(int argc, char **argv, unsigned headerbar_y)
 
   memset(screen->frameBuffer, 0, rfbWindowX * rfbWindowY * sizeof(rfbPixel));
 
+  vncBlocksX = (BX_RFB_MAX_XDIM + (1 << VNC_BLOCK_SHIFT) - 1) >> VNC_BLOCK_SHIFT;
+  vncBlocksY = (BX_RFB_MAX_YDIM + rfbHeaderbarY + rfbStatusbarY +
+                (1 << VNC_BLOCK_SHIFT) - 1) >> VNC_BLOCK_SHIFT;
+  vncDirtyBlocks = new bool[vncBlocksX * vncBlocksY];
+  memset(vncDirtyBlocks, 0, vncBlocksX * vncBlocksY * sizeof(bool));
+  vncUpdateRects = new struct _vncUpdateRect[vncBlocksX * vncBlocksY];
+
   /* initialize the server */
   rfbInitServer(screen);
 
@@ -358,6 +375,51 @@ void bx_vncsrv_gui_c::handle_events(void)
 
 void bx_vncsrv_gui_c::flush(void)
 {
+  unsigned bx, by, bw, bh, start, i, nrects = 0;
+  unsigned x, y;
+
+  if (!vncUpdatePending)
+    return;
+
+  bw = (rfbWindowX + (1 << VNC_BLOCK_SHIFT) - 1) >> VNC_BLOCK_SHIFT;
+  bh = (rfbWindowY + (1 << VNC_BLOCK_SHIFT) - 1) >> VNC_BLOCK_SHIFT;
+  // merge runs of dirty blocks with the run of the same extent above them
+  for (by = 0; by < bh; by++) {
+    bx = 0;
+    while (bx < bw) {
+      if (!vncDirtyBlocks[by * vncBlocksX + bx]) {
+        bx++;
+        continue;
+      }
+      start = bx;
+      while ((bx < bw) && vncDirtyBlocks[by * vncBlocksX + bx]) {
+        vncDirtyBlocks[by * vncBlocksX + bx] = 0;
+        bx++;
+      }
+      for (i = 0; i < nrects; i++) {
+        if ((vncUpdateRects[i].x == start) && (vncUpdateRects[i].w == (bx - start)) &&
+            ((vncUpdateRects[i].y + vncUpdateRects[i].h) == by)) {
+          vncUpdateRects[i].h++;
+          break;
+        }
+      }
+      if (i == nrects) {
+        vncUpdateRects[nrects].x = start;
+        vncUpdateRects[nrects].y = by;
+        vncUpdateRects[nrects].w = bx - start;
+        vncUpdateRects[nrects].h = 1;
+        nrects++;
+      }
+    }
+  }
+  for (i = 0; i < nrects; i++) {
+    x = vncUpdateRects[i].x << VNC_BLOCK_SHIFT;
+    y = vncUpdateRects[i].y << VNC_BLOCK_SHIFT;
+    rfbMarkRectAsModified(screen, x, y,
+      BX_MIN((vncUpdateRects[i].x + vncUpdateRects[i].w) << VNC_BLOCK_SHIFT, rfbWindowX),
+      BX_MIN((vncUpdateRects[i].y + vncUpdateRects[i].h) << VNC_BLOCK_SHIFT, rfbWindowY));
+  }
+  vncUpdatePending = 0;
 }
 
 void bx_vncsrv_gui_c::clear_screen(void)
@@ -600,6 +662,8 @@ void bx_vncsrv_gui_c::exit(void)
   for (i = 0; i < rfbBitmapCount; i++) {
     delete [] rfbBitmaps[i].bmap;
   }
+  delete [] vncDirtyBlocks;
+  delete [] vncUpdateRects;
 
   BX_DEBUG(("bx_vncsrv_gui_c::exit()"));
 }
@@ -1157,7 +1221,26 @@ void UpdateScreen(rfbPixel *newBits, int x, int y, int width, int height)
 
 void SendUpdate(int x, int y, int width, int height)
 {
-  rfbMarkRectAsModified(theGui->screen, x, y, x + width, y + height);
+  unsigned bx, by, bx1, by1;
+
+  if ((x < 0) || (y < 0) || ((unsigned)x >= rfbWindowX) ||
+      ((unsigned)y >= rfbWindowY) || (width <= 0) || (height <= 0)) {
+    return;
+  }
+  if ((unsigned)(x + width) > rfbWindowX) {
+    width = rfbWindowX - x;
+  }
+  if ((unsigned)(y + height) > rfbWindowY) {
+    height = rfbWindowY - y;
+  }
+  bx1 = (x + width - 1) >> VNC_BLOCK_SHIFT;
+  by1 = (y + height - 1) >> VNC_BLOCK_SHIFT;
+  for (by = (y >> VNC_BLOCK_SHIFT); by <= by1; by++) {
+    for (bx = (x >> VNC_BLOCK_SHIFT); bx <= bx1; bx++) {
+      vncDirtyBlocks[by * vncBlocksX + bx] = 1;
+    }
+  }
+  vncUpdatePending = 1;
 }
 
 void vncSetStatusText(int element, const char *text, bool active, Bit8u color)
@@ -1191,8 +1274,7 @@ void vncSetStatusText(int element, const char *text, bool active, Bit8u color)
              (char *) &sdl_font8x8[(unsigned) text[i]][0], fgcolor, bgcolor, 0);
   }
 
-  rfbMarkRectAsModified(theGui->screen, xleft, rfbWindowY - rfbStatusbarY + 1,
-                        xleft + xsize, rfbWindowY - 2);
+  SendUpdate(xleft, rfbWindowY - rfbStatusbarY + 1, xsize, rfbStatusbarY - 3);
 }
 
 void newframebuffer(rfbScreenInfoPtr screen, int width, int height)
@@ -63,6 +63,10 @@ void bx_instr_lin_access(unsigned cpu, bx_address lin, bx_phy_address phy, unsig
 #define BX_INSTR_DEBUG_PROMPT()
 #define BX_INSTR_DEBUG_CMD(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip) bx_instr_cnear_branch_taken(cpu_id, branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip) bx_instr_cnear_branch_not_taken(cpu_id, branch_eip)
@@ -128,6 +132,10 @@ void bx_instr_lin_access(unsigned cpu, bx_address lin, bx_phy_address phy, unsig
 #define BX_INSTR_DEBUG_PROMPT()
 #define BX_INSTR_DEBUG_CMD(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip)
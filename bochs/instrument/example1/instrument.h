@@ -115,6 +115,10 @@ extern bxInstrumentation *icpu;
 #define BX_INSTR_DEBUG_PROMPT()
 #define BX_INSTR_DEBUG_CMD(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip) icpu[cpu_id].bx_instr_cnear_branch_taken(branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip) icpu[cpu_id].bx_instr_cnear_branch_not_taken(branch_eip)
@@ -179,6 +183,10 @@ extern bxInstrumentation *icpu;
 #define BX_INSTR_DEBUG_PROMPT()
 #define BX_INSTR_DEBUG_CMD(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip)
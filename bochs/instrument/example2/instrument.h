@@ -53,6 +53,10 @@ void bx_instr_before_execution(unsigned cpu, bxInstruction_c *i);
 #define BX_INSTR_DEBUG_PROMPT()
 #define BX_INSTR_DEBUG_CMD(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip)
@@ -119,6 +123,10 @@ void bx_instr_before_execution(unsigned cpu, bxInstruction_c *i);
 #define BX_INSTR_DEBUG_PROMPT()
 #define BX_INSTR_DEBUG_CMD(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip)
@@ -0,0 +1,215 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+// bxtrace: convert a binary trace written by the built-in tracer to text
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "tracefile.h"
+
+// instruction bytes of the last decode at each RIP
+
+typedef struct {
+  Bit64u rip;
+  Bit8u len;     // 0 for a free slot
+  Bit8u bytes[16];
+} code_entry_t;
+
+static code_entry_t *code_table = NULL;
+static Bit32u code_size = 0, code_used = 0;
+
+static inline Bit32u code_hash(Bit64u rip)
+{
+  rip *= BX_CONST64(0x9e3779b97f4a7c15);
+  return (Bit32u)(rip >> 32);
+}
+
+static code_entry_t *code_lookup(Bit64u rip)
+{
+  Bit32u n = code_hash(rip) & (code_size - 1);
+  while (code_table[n].len != 0 && code_table[n].rip != rip)
+    n = (n + 1) & (code_size - 1);
+  return &code_table[n];
+}
+
+static void code_insert(const bx_trace_rec_t *rec)
+{
+  if (code_used * 2 >= code_size) {
+    code_entry_t *old = code_table;
+    Bit32u old_size = code_size;
+    code_size = code_size ? code_size * 2 : 4096;
+    code_table = (code_entry_t*) calloc(code_size, sizeof(code_entry_t));
+    if (code_table == NULL) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+    for (Bit32u n = 0; n < old_size; n++) {
+      if (old[n].len != 0) *code_lookup(old[n].rip) = old[n];
+    }
+    free(old);
+  }
+  code_entry_t *e = code_lookup(rec->addr);
+  if (e->len == 0) code_used++;
+  e->rip = rec->addr;
+  e->len = (rec->size < 16) ? rec->size : 16;
+  memcpy(e->bytes, rec->u.bytes, e->len);
+}
+
+static const char *branch_name(unsigned kind)
+{
+  static const char *names[] = {
+    "jmp", "jmp indirect", "call", "call indirect", "ret", "iret",
+    "int", "syscall", "sysret", "sysenter", "sysexit"
+  };
+  if (kind == BX_TREC_BR_TAKEN) return "jcc taken";
+  if (kind == BX_TREC_BR_NOT_TAKEN) return "jcc not taken";
+  if (kind >= 10 && kind <= 20) return names[kind - 10];
+  return "branch";
+}
+
+static const char *rw_name(unsigned rw)
+{
+  static const char *names[] = { "R", "W", "X", "RW", "SR", "SW" };
+  return (rw < 6) ? names[rw] : "?";
+}
+
+static void print_record(unsigned cpu, const bx_trace_rec_t *rec)
+{
+  char bytes[64];
+  unsigned n, len;
+
+  switch (rec->type) {
+    case BX_TREC_INSN:
+      if (code_size > 0) {
+        code_entry_t *e = code_lookup(rec->addr);
+        len = 0;
+        if (e->len != 0) {
+          for (n = 0; n < e->len; n++)
+            len += sprintf(bytes + len, "%02x", e->bytes[n]);
+        }
+        bytes[len] = 0;
+      } else {
+        bytes[0] = 0;
+      }
+      printf("%u: %016llx %-30s op=%u\n", cpu, (unsigned long long) rec->addr,
+             bytes, rec->info);
+      break;
+    case BX_TREC_MEM:
+      if (rec->info & BX_TREC_MEM_PHY) {
+        printf("%u:   phy %-2s %016llx len=%u memtype=%u\n", cpu,
+               rw_name(rec->info & 0xf), (unsigned long long) rec->u.addr2,
+               rec->size, (rec->info >> 4) & 0xf);
+      } else {
+        printf("%u:   mem %-2s %016llx phy=%016llx len=%u memtype=%u\n", cpu,
+               rw_name(rec->info & 0xf), (unsigned long long) rec->addr,
+               (unsigned long long) rec->u.addr2, rec->size, (rec->info >> 4) & 0xf);
+      }
+      break;
+    case BX_TREC_BRANCH:
+      if (rec->data != 0) {
+        printf("%u:   %s %04x:%016llx -> %04x:%016llx\n", cpu, branch_name(rec->info),
+               rec->data >> 16, (unsigned long long) rec->addr,
+               rec->data & 0xffff, (unsigned long long) rec->u.addr2);
+      } else {
+        printf("%u:   %s %016llx -> %016llx\n", cpu, branch_name(rec->info),
+               (unsigned long long) rec->addr, (unsigned long long) rec->u.addr2);
+      }
+      break;
+    case BX_TREC_INTERRUPT:
+      if (rec->size == BX_TREC_INT_EXCEPTION)
+        printf("%u:   exception 0x%02x error=0x%x\n", cpu, rec->info, rec->data);
+      else if (rec->size == BX_TREC_INT_HW)
+        printf("%u:   hwint 0x%02x at %04x:%016llx\n", cpu, rec->info, rec->data,
+               (unsigned long long) rec->addr);
+      else
+        printf("%u:   interrupt 0x%02x\n", cpu, rec->info);
+      break;
+    case BX_TREC_IO:
+      printf("%u:   %s port=0x%04x len=%u value=0x%x\n", cpu, rec->info ? "out" : "in",
+             (unsigned) rec->addr, rec->size, rec->data);
+      break;
+  }
+}
+
+static void print_usage(void)
+{
+  fprintf(stderr,
+    "Usage: bxtrace [options] tracefile\n\n"
+    "Converts a binary trace of the Bochs built-in tracer to text.\n\n"
+    "Options:\n"
+    "  -c cpu   show the records of this CPU only\n"
+    "  -s       show record counts only\n");
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *type_names[BX_TREC_NUM_TYPES] = {
+    "", "instructions", "decodes", "memory accesses", "branches",
+    "interrupts", "I/O accesses"
+  };
+  bx_trace_reader_c reader;
+  bx_trace_rec_t rec;
+  Bit64u count[BX_TREC_NUM_TYPES];
+  unsigned cpu;
+  int only_cpu = -1, summary = 0, arg;
+
+  for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++) {
+    if (!strcmp(argv[arg], "-c") && (arg + 1) < argc) {
+      only_cpu = atoi(argv[++arg]);
+    } else if (!strcmp(argv[arg], "-s")) {
+      summary = 1;
+    } else {
+      print_usage();
+      return 1;
+    }
+  }
+  if (arg != argc - 1) {
+    print_usage();
+    return 1;
+  }
+  if (!reader.open(argv[arg])) {
+    fprintf(stderr, "%s: %s\n", argv[arg], reader.get_error());
+    return 1;
+  }
+
+  memset(count, 0, sizeof(count));
+  while (reader.next(&cpu, &rec)) {
+    if (only_cpu >= 0 && (int) cpu != only_cpu) continue;
+    count[rec.type]++;
+    if (summary) continue;
+    if (rec.type == BX_TREC_DECODE)
+      code_insert(&rec);
+    else
+      print_record(cpu, &rec);
+  }
+  if (reader.get_error() != NULL) {
+    fprintf(stderr, "%s: %s\n", argv[arg], reader.get_error());
+  }
+  if (summary) {
+    printf("%u CPU(s)\n", reader.get_ncpus());
+    for (unsigned n = 1; n < BX_TREC_NUM_TYPES; n++)
+      printf("%12llu %s\n", (unsigned long long) count[n], type_names[n]);
+  }
+  free(code_table);
+  return (reader.get_error() != NULL);
+}
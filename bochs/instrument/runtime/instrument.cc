@@ -0,0 +1,379 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+
+#include "bochs.h"
+#include "cpu/cpu.h"
+#include "plugin.h"
+
+#if BX_INSTRUMENTATION
+
+#define BX_INSTR_MAX_CLIENTS 32
+#define BX_INSTR_MAX_LIBS    8
+
+static logfunctions *instrument_log = new logfunctions();
+#define LOG_THIS instrument_log->
+
+Bit32u bx_instr_event_mask = 0;
+
+typedef struct {
+  const bx_instr_callbacks_t *cb;
+  Bit32u events;
+  bx_address lo, hi;
+  void *param;
+} bx_instr_client_t;
+
+static bx_instr_client_t clients[BX_INSTR_MAX_CLIENTS];
+
+// subscribers of each event, rebuilt on every (un)subscription
+static struct {
+  unsigned num;
+  bx_instr_client_t *client[BX_INSTR_MAX_CLIENTS];
+} subscribers[BX_INSTR_NUM_EVENTS];
+
+static void rebuild_subscribers(void)
+{
+  bx_instr_event_mask = 0;
+  for (unsigned ev = 0; ev < BX_INSTR_NUM_EVENTS; ev++) {
+    subscribers[ev].num = 0;
+    for (unsigned n = 0; n < BX_INSTR_MAX_CLIENTS; n++) {
+      if (clients[n].events & BX_INSTR_EVENT(ev))
+        subscribers[ev].client[subscribers[ev].num++] = &clients[n];
+    }
+    if (subscribers[ev].num > 0)
+      bx_instr_event_mask |= BX_INSTR_EVENT(ev);
+  }
+}
+
+int bx_instr_subscribe(const bx_instr_callbacks_t *cb, Bit32u events,
+                       bx_address lo, bx_address hi, void *param)
+{
+  events &= BX_INSTR_ALL_EVENTS;
+  for (int n = 0; n < BX_INSTR_MAX_CLIENTS; n++) {
+    if (clients[n].events == 0) {
+      clients[n].cb = cb;
+      clients[n].lo = lo;
+      clients[n].hi = hi;
+      clients[n].param = param;
+      clients[n].events = events;
+      rebuild_subscribers();
+      return n;
+    }
+  }
+  BX_ERROR(("no free instrumentation client slot"));
+  return -1;
+}
+
+void bx_instr_unsubscribe(int handle)
+{
+  if (handle >= 0 && handle < BX_INSTR_MAX_CLIENTS) {
+    clients[handle].events = 0;
+    rebuild_subscribers();
+  }
+}
+
+// call fn of every subscriber of ev whose range contains addr
+#define BX_INSTR_DISPATCH(ev, addr, fn, ...) {                    \
+  for (unsigned n = 0; n < subscribers[ev].num; n++) {            \
+    bx_instr_client_t *c = subscribers[ev].client[n];             \
+    if (c->cb->fn && (addr) >= c->lo && (addr) <= c->hi)          \
+      c->cb->fn(c->param, __VA_ARGS__);                           \
+  }                                                               \
+}
+
+#define BX_INSTR_DISPATCH_ALL(ev, fn, ...) {                      \
+  for (unsigned n = 0; n < subscribers[ev].num; n++) {            \
+    bx_instr_client_t *c = subscribers[ev].client[n];             \
+    if (c->cb->fn)                                                \
+      c->cb->fn(c->param, __VA_ARGS__);                           \
+  }                                                               \
+}
+
+// clients loaded from shared objects
+
+static const bx_instr_api_t instr_api = {
+  BX_INSTR_API_VERSION,
+  bx_instr_subscribe,
+  bx_instr_unsubscribe
+};
+
+static unsigned num_libs = 0;
+static bx_instr_client_exit_t lib_exit[BX_INSTR_MAX_LIBS];
+
+bool bx_instr_load_client(const char *path)
+{
+#if BX_PLUGINS
+  bx_instr_client_init_t client_init;
+
+  if (num_libs == BX_INSTR_MAX_LIBS) {
+    BX_ERROR(("too many instrumentation libraries"));
+    return 0;
+  }
+#if defined(WIN32)
+  HMODULE handle = LoadLibrary(path);
+  if (!handle) {
+    BX_ERROR(("LoadLibrary failed for '%s': error=%d", path, GetLastError()));
+    return 0;
+  }
+  client_init = (bx_instr_client_init_t) GetProcAddress(handle, BX_INSTR_CLIENT_INIT);
+  lib_exit[num_libs] = (bx_instr_client_exit_t) GetProcAddress(handle, BX_INSTR_CLIENT_EXIT);
+#else
+  lt_dlhandle handle = lt_dlopen(path);
+  if (!handle) {
+    BX_ERROR(("dlopen failed for '%s': %s", path, lt_dlerror()));
+    return 0;
+  }
+  client_init = (bx_instr_client_init_t) lt_dlsym(handle, BX_INSTR_CLIENT_INIT);
+  lib_exit[num_libs] = (bx_instr_client_exit_t) lt_dlsym(handle, BX_INSTR_CLIENT_EXIT);
+#endif
+  if (client_init == NULL) {
+    BX_ERROR(("'%s' has no %s() function", path, BX_INSTR_CLIENT_INIT));
+    return 0;
+  }
+  if (client_init(&instr_api) != 0) {
+    BX_ERROR(("initialization of '%s' failed", path));
+    return 0;
+  }
+  num_libs++;
+  BX_INFO(("loaded instrumentation library '%s'", path));
+  return 1;
+#else
+  BX_ERROR(("loading '%s' requires plugin support", path));
+  return 0;
+#endif
+}
+
+// BXINSTRUMENT holds a list of libraries to load at startup
+void bx_instr_init_env(void)
+{
+  instrument_log->put("INSTR");
+  bx_trace_init_env();
+
+  const char *env = getenv("BXINSTRUMENT");
+  if (env == NULL) return;
+
+#if BX_PLUGINS && !defined(WIN32)
+  // the plugin system has not been started yet
+  lt_dlinit();
+#endif
+
+  char *list = strdup(env);
+#if defined(WIN32)
+  const char *sep = ";";
+#else
+  const char *sep = ":";
+#endif
+  for (char *path = strtok(list, sep); path != NULL; path = strtok(NULL, sep)) {
+    bx_instr_load_client(path);
+  }
+  free(list);
+}
+
+void bx_instr_exit_env(void)
+{
+  bx_trace_stop();
+  while (num_libs > 0) {
+    num_libs--;
+    if (lib_exit[num_libs]) lib_exit[num_libs]();
+  }
+  for (unsigned n = 0; n < BX_INSTR_MAX_CLIENTS; n++)
+    clients[n].events = 0;
+  rebuild_subscribers();
+}
+
+// BXTRACE names a file for the built-in tracer, it is started as soon
+// as the number of CPUs is known
+void bx_instr_initialize(unsigned cpu)
+{
+  const char *path = getenv("BXTRACE");
+  if (cpu == 0 && path != NULL)
+    bx_trace_start(path);
+}
+
+void bx_instr_exit(unsigned cpu) {}
+
+void bx_instr_reset(unsigned cpu, unsigned type)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_RESET, reset, cpu, type);
+}
+
+void bx_instr_hlt(unsigned cpu)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_HLT, hlt, cpu);
+}
+
+void bx_instr_mwait(unsigned cpu, bx_phy_address addr, unsigned len, Bit32u flags)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_HLT, mwait, cpu, addr, len, flags);
+}
+
+void bx_instr_debug_promt() {}
+
+// 'instrument "load <library>"' loads a client, 'instrument list' shows
+// the active subscriptions, 'instrument "trace <file>"' and
+// 'instrument "trace off"' control the built-in tracer
+void bx_instr_debug_cmd(const char *cmd)
+{
+  if (!strncmp(cmd, "load ", 5)) {
+    bx_instr_load_client(cmd + 5);
+  }
+  else if (!strcmp(cmd, "trace off")) {
+    bx_trace_stop();
+  }
+  else if (!strncmp(cmd, "trace ", 6)) {
+    bx_trace_start(cmd + 6);
+  }
+  else if (!strcmp(cmd, "list")) {
+    for (unsigned n = 0; n < BX_INSTR_MAX_CLIENTS; n++) {
+      if (clients[n].events) {
+        fprintf(stderr, "client %u: events=0x%05x range=" FMT_ADDRX "-" FMT_ADDRX "\n",
+                n, clients[n].events, clients[n].lo, clients[n].hi);
+      }
+    }
+  }
+  else {
+    fprintf(stderr, "Unknown instrumentation command '%s', use 'load <library>', 'list' or 'trace <file>|off'\n", cmd);
+  }
+}
+
+void bx_instr_trace(unsigned cpu, bx_address rip, bx_phy_address paddr, unsigned ninstr)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_TRACE, rip, trace, cpu, rip, paddr, ninstr);
+}
+
+void bx_instr_cnear_branch_taken(unsigned cpu, bx_address branch_eip, bx_address new_eip)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_BRANCH, branch_eip, cnear_branch_taken, cpu, branch_eip, new_eip);
+}
+
+void bx_instr_cnear_branch_not_taken(unsigned cpu, bx_address branch_eip)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_BRANCH, branch_eip, cnear_branch_not_taken, cpu, branch_eip);
+}
+
+void bx_instr_ucnear_branch(unsigned cpu, unsigned what, bx_address branch_eip, bx_address new_eip)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_BRANCH, branch_eip, ucnear_branch, cpu, what, branch_eip, new_eip);
+}
+
+void bx_instr_far_branch(unsigned cpu, unsigned what, Bit16u prev_cs, bx_address prev_eip, Bit16u new_cs, bx_address new_eip)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_BRANCH, prev_eip, far_branch, cpu, what, prev_cs, prev_eip, new_cs, new_eip);
+}
+
+void bx_instr_opcode(unsigned cpu, bxInstruction_c *i, const Bit8u *opcode, unsigned len, bool is32, bool is64)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_OPCODE, opcode, cpu, i, opcode, len, is32, is64);
+}
+
+void bx_instr_interrupt(unsigned cpu, unsigned vector)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_INTERRUPT, vector, interrupt, cpu, vector);
+}
+
+void bx_instr_exception(unsigned cpu, unsigned vector, unsigned error_code)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_INTERRUPT, vector, exception, cpu, vector, error_code);
+}
+
+void bx_instr_hwinterrupt(unsigned cpu, unsigned vector, Bit16u cs, bx_address eip)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_INTERRUPT, vector, hwinterrupt, cpu, vector, cs, eip);
+}
+
+void bx_instr_tlb_cntrl(unsigned cpu, unsigned what, bx_phy_address new_cr3)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_CACHE_CNTRL, tlb_cntrl, cpu, what, new_cr3);
+}
+
+void bx_instr_cache_cntrl(unsigned cpu, unsigned what)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_CACHE_CNTRL, cache_cntrl, cpu, what);
+}
+
+void bx_instr_prefetch_hint(unsigned cpu, unsigned what, unsigned seg, bx_address offset)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_CACHE_CNTRL, prefetch_hint, cpu, what, seg, offset);
+}
+
+void bx_instr_clflush(unsigned cpu, bx_address laddr, bx_phy_address paddr)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_CACHE_CNTRL, clflush, cpu, laddr, paddr);
+}
+
+void bx_instr_cpuid(unsigned cpu)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_CPUID, cpuid, cpu);
+}
+
+void bx_instr_before_execution(unsigned cpu, bxInstruction_c *i)
+{
+  bx_address rip = BX_CPU(cpu)->get_instruction_pointer();
+  BX_INSTR_DISPATCH(BX_INSTR_EV_BEFORE_EXECUTION, rip, before_execution, cpu, i);
+}
+
+void bx_instr_after_execution(unsigned cpu, bxInstruction_c *i)
+{
+  bx_address rip = BX_CPU(cpu)->get_instruction_pointer();
+  BX_INSTR_DISPATCH(BX_INSTR_EV_AFTER_EXECUTION, rip, after_execution, cpu, i);
+}
+
+void bx_instr_repeat_iteration(unsigned cpu, bxInstruction_c *i)
+{
+  bx_address rip = BX_CPU(cpu)->get_instruction_pointer();
+  BX_INSTR_DISPATCH(BX_INSTR_EV_REPEAT_ITERATION, rip, repeat_iteration, cpu, i);
+}
+
+void bx_instr_inp(Bit16u addr, unsigned len)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_IO, addr, inp, addr, len);
+}
+
+void bx_instr_inp2(Bit16u addr, unsigned len, unsigned val)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_IO, addr, inp2, addr, len, val);
+}
+
+void bx_instr_outp(Bit16u addr, unsigned len, unsigned val)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_IO, addr, outp, addr, len, val);
+}
+
+void bx_instr_lin_access(unsigned cpu, bx_address lin, bx_address phy, unsigned len, unsigned memtype, unsigned rw)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_LIN_ACCESS, lin, lin_access, cpu, lin, phy, len, memtype, rw);
+}
+
+void bx_instr_phy_access(unsigned cpu, bx_address phy, unsigned len, unsigned memtype, unsigned rw)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_PHY_ACCESS, phy, phy_access, cpu, phy, len, memtype, rw);
+}
+
+void bx_instr_wrmsr(unsigned cpu, unsigned addr, Bit64u value)
+{
+  BX_INSTR_DISPATCH(BX_INSTR_EV_WRMSR, addr, wrmsr, cpu, addr, value);
+}
+
+void bx_instr_vmexit(unsigned cpu, Bit32u reason, Bit64u qualification)
+{
+  BX_INSTR_DISPATCH_ALL(BX_INSTR_EV_VMEXIT, vmexit, cpu, reason, qualification);
+}
+
+#endif
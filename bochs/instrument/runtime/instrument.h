@@ -0,0 +1,331 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+// Runtime instrumentation: clients subscribe to single events at runtime,
+// optionally limited to an address range. A hook nobody subscribed to
+// costs a test of bx_instr_event_mask. Clients are either linked into
+// Bochs or loaded from shared objects (see instrumentation.txt).
+
+#ifndef BX_INSTRUMENT_RUNTIME_H
+#define BX_INSTRUMENT_RUNTIME_H
+
+#if BX_INSTRUMENTATION
+
+class bxInstruction_c;
+
+// events, the address used for the range check is given in brackets
+enum {
+  BX_INSTR_EV_TRACE,            // start of a trace (RIP)
+  BX_INSTR_EV_BEFORE_EXECUTION, // (RIP)
+  BX_INSTR_EV_AFTER_EXECUTION,  // (RIP of the next instruction)
+  BX_INSTR_EV_REPEAT_ITERATION, // (RIP)
+  BX_INSTR_EV_BRANCH,           // all branch callbacks (RIP of the branch)
+  BX_INSTR_EV_OPCODE,           // decoding completed
+  BX_INSTR_EV_INTERRUPT,        // interrupts and exceptions (vector)
+  BX_INSTR_EV_LIN_ACCESS,       // (linear address)
+  BX_INSTR_EV_PHY_ACCESS,       // (physical address)
+  BX_INSTR_EV_IO,               // (I/O port)
+  BX_INSTR_EV_CACHE_CNTRL,      // TLB/cache control, prefetch hints, CLFLUSH
+  BX_INSTR_EV_HLT,              // HLT and MWAIT
+  BX_INSTR_EV_RESET,
+  BX_INSTR_EV_CPUID,
+  BX_INSTR_EV_WRMSR,            // (MSR index)
+  BX_INSTR_EV_VMEXIT,
+  BX_INSTR_NUM_EVENTS
+};
+
+#define BX_INSTR_EVENT(ev) (1u << (ev))
+#define BX_INSTR_ALL_EVENTS ((1u << BX_INSTR_NUM_EVENTS) - 1)
+
+// Callbacks of one client, unused entries are NULL. The param pointer
+// passed to bx_instr_subscribe() is handed back to every callback.
+typedef struct {
+  void (*trace)(void *param, unsigned cpu, bx_address rip, bx_phy_address paddr, unsigned ninstr);
+  void (*before_execution)(void *param, unsigned cpu, bxInstruction_c *i);
+  void (*after_execution)(void *param, unsigned cpu, bxInstruction_c *i);
+  void (*repeat_iteration)(void *param, unsigned cpu, bxInstruction_c *i);
+  void (*cnear_branch_taken)(void *param, unsigned cpu, bx_address branch_eip, bx_address new_eip);
+  void (*cnear_branch_not_taken)(void *param, unsigned cpu, bx_address branch_eip);
+  void (*ucnear_branch)(void *param, unsigned cpu, unsigned what, bx_address branch_eip, bx_address new_eip);
+  void (*far_branch)(void *param, unsigned cpu, unsigned what, Bit16u prev_cs, bx_address prev_eip, Bit16u new_cs, bx_address new_eip);
+  void (*opcode)(void *param, unsigned cpu, bxInstruction_c *i, const Bit8u *opcode, unsigned len, bool is32, bool is64);
+  void (*interrupt)(void *param, unsigned cpu, unsigned vector);
+  void (*exception)(void *param, unsigned cpu, unsigned vector, unsigned error_code);
+  void (*hwinterrupt)(void *param, unsigned cpu, unsigned vector, Bit16u cs, bx_address eip);
+  void (*lin_access)(void *param, unsigned cpu, bx_address lin, bx_address phy, unsigned len, unsigned memtype, unsigned rw);
+  void (*phy_access)(void *param, unsigned cpu, bx_address phy, unsigned len, unsigned memtype, unsigned rw);
+  void (*inp)(void *param, Bit16u addr, unsigned len);
+  void (*inp2)(void *param, Bit16u addr, unsigned len, unsigned val);
+  void (*outp)(void *param, Bit16u addr, unsigned len, unsigned val);
+  void (*tlb_cntrl)(void *param, unsigned cpu, unsigned what, bx_phy_address new_cr3);
+  void (*cache_cntrl)(void *param, unsigned cpu, unsigned what);
+  void (*prefetch_hint)(void *param, unsigned cpu, unsigned what, unsigned seg, bx_address offset);
+  void (*clflush)(void *param, unsigned cpu, bx_address laddr, bx_phy_address paddr);
+  void (*hlt)(void *param, unsigned cpu);
+  void (*mwait)(void *param, unsigned cpu, bx_phy_address addr, unsigned len, Bit32u flags);
+  void (*reset)(void *param, unsigned cpu, unsigned type);
+  void (*cpuid)(void *param, unsigned cpu);
+  void (*wrmsr)(void *param, unsigned cpu, unsigned addr, Bit64u value);
+  void (*vmexit)(void *param, unsigned cpu, Bit32u reason, Bit64u qualification);
+} bx_instr_callbacks_t;
+
+// Subscribe to the events in the mask for addresses lo..hi (inclusive).
+// Returns a handle for bx_instr_unsubscribe() or -1 if there is no slot.
+int  bx_instr_subscribe(const bx_instr_callbacks_t *cb, Bit32u events,
+                        bx_address lo, bx_address hi, void *param);
+void bx_instr_unsubscribe(int handle);
+
+// interface handed to clients loaded from shared objects
+#define BX_INSTR_API_VERSION 1
+
+typedef struct {
+  unsigned version;
+  int  (*subscribe)(const bx_instr_callbacks_t *cb, Bit32u events,
+                    bx_address lo, bx_address hi, void *param);
+  void (*unsubscribe)(int handle);
+} bx_instr_api_t;
+
+// shared objects export these functions with C linkage
+#define BX_INSTR_CLIENT_INIT "bx_instr_client_init"
+#define BX_INSTR_CLIENT_EXIT "bx_instr_client_exit"
+typedef int  (*bx_instr_client_init_t)(const bx_instr_api_t *api);
+typedef void (*bx_instr_client_exit_t)(void);
+
+bool bx_instr_load_client(const char *path);
+
+// built-in binary tracer (tracer.cc)
+void bx_trace_init_env(void);
+bool bx_trace_start(const char *path);
+void bx_trace_stop(void);
+
+// union of the events of all subscriptions
+extern Bit32u bx_instr_event_mask;
+
+#define BX_INSTR_ENABLED(ev) (bx_instr_event_mask & BX_INSTR_EVENT(ev))
+
+// dispatch an event only if somebody subscribed to it
+#define BX_INSTR_HOOK(ev, call) do { \
+  if (BX_INSTR_ENABLED(ev)) call;    \
+} while(0)
+
+void bx_instr_init_env(void);
+void bx_instr_exit_env(void);
+
+// called from the CPU core
+
+void bx_instr_initialize(unsigned cpu);
+void bx_instr_exit(unsigned cpu);
+void bx_instr_reset(unsigned cpu, unsigned type);
+void bx_instr_hlt(unsigned cpu);
+void bx_instr_mwait(unsigned cpu, bx_phy_address addr, unsigned len, Bit32u flags);
+
+void bx_instr_debug_promt();
+void bx_instr_debug_cmd(const char *cmd);
+
+void bx_instr_trace(unsigned cpu, bx_address rip, bx_phy_address paddr, unsigned ninstr);
+
+void bx_instr_cnear_branch_taken(unsigned cpu, bx_address branch_eip, bx_address new_eip);
+void bx_instr_cnear_branch_not_taken(unsigned cpu, bx_address branch_eip);
+void bx_instr_ucnear_branch(unsigned cpu, unsigned what, bx_address branch_eip, bx_address new_eip);
+void bx_instr_far_branch(unsigned cpu, unsigned what, Bit16u prev_cs, bx_address prev_eip, Bit16u new_cs, bx_address new_eip);
+
+void bx_instr_opcode(unsigned cpu, bxInstruction_c *i, const Bit8u *opcode, unsigned len, bool is32, bool is64);
+
+void bx_instr_interrupt(unsigned cpu, unsigned vector);
+void bx_instr_exception(unsigned cpu, unsigned vector, unsigned error_code);
+void bx_instr_hwinterrupt(unsigned cpu, unsigned vector, Bit16u cs, bx_address eip);
+
+void bx_instr_tlb_cntrl(unsigned cpu, unsigned what, bx_phy_address new_cr3);
+void bx_instr_cache_cntrl(unsigned cpu, unsigned what);
+void bx_instr_prefetch_hint(unsigned cpu, unsigned what, unsigned seg, bx_address offset);
+void bx_instr_clflush(unsigned cpu, bx_address laddr, bx_phy_address paddr);
+void bx_instr_cpuid(unsigned cpu);
+
+void bx_instr_before_execution(unsigned cpu, bxInstruction_c *i);
+void bx_instr_after_execution(unsigned cpu, bxInstruction_c *i);
+void bx_instr_repeat_iteration(unsigned cpu, bxInstruction_c *i);
+
+void bx_instr_inp(Bit16u addr, unsigned len);
+void bx_instr_inp2(Bit16u addr, unsigned len, unsigned val);
+void bx_instr_outp(Bit16u addr, unsigned len, unsigned val);
+
+void bx_instr_lin_access(unsigned cpu, bx_address lin, bx_address phy, unsigned len, unsigned memtype, unsigned rw);
+void bx_instr_phy_access(unsigned cpu, bx_address phy, unsigned len, unsigned memtype, unsigned rw);
+
+void bx_instr_wrmsr(unsigned cpu, unsigned addr, Bit64u value);
+
+void bx_instr_vmexit(unsigned cpu, Bit32u reason, Bit64u qualification);
+
+/* initialization/deinitialization of instrumentalization*/
+#define BX_INSTR_INIT_ENV() bx_instr_init_env()
+#define BX_INSTR_EXIT_ENV() bx_instr_exit_env()
+
+/* simulation init, shutdown, reset */
+#define BX_INSTR_INITIALIZE(cpu_id)      bx_instr_initialize(cpu_id)
+#define BX_INSTR_EXIT(cpu_id)            bx_instr_exit(cpu_id)
+#define BX_INSTR_RESET(cpu_id, type)     BX_INSTR_HOOK(BX_INSTR_EV_RESET, bx_instr_reset(cpu_id, type))
+#define BX_INSTR_HLT(cpu_id)             BX_INSTR_HOOK(BX_INSTR_EV_HLT, bx_instr_hlt(cpu_id))
+
+#define BX_INSTR_MWAIT(cpu_id, addr, len, flags) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_HLT, bx_instr_mwait(cpu_id, addr, len, flags))
+
+/* called from command line debugger */
+#define BX_INSTR_DEBUG_PROMPT()          bx_instr_debug_promt()
+#define BX_INSTR_DEBUG_CMD(cmd)          bx_instr_debug_cmd(cmd)
+
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_TRACE, bx_instr_trace(cpu_id, rip, paddr, ninstr))
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    BX_INSTR_ENABLED(BX_INSTR_EV_TRACE)
+
+/* branch resolution */
+#define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_BRANCH, bx_instr_cnear_branch_taken(cpu_id, branch_eip, new_eip))
+#define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_BRANCH, bx_instr_cnear_branch_not_taken(cpu_id, branch_eip))
+#define BX_INSTR_UCNEAR_BRANCH(cpu_id, what, branch_eip, new_eip) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_BRANCH, bx_instr_ucnear_branch(cpu_id, what, branch_eip, new_eip))
+#define BX_INSTR_FAR_BRANCH(cpu_id, what, prev_cs, prev_eip, new_cs, new_eip) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_BRANCH, bx_instr_far_branch(cpu_id, what, prev_cs, prev_eip, new_cs, new_eip))
+
+/* decoding completed */
+#define BX_INSTR_OPCODE(cpu_id, i, opcode, len, is32, is64) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_OPCODE, bx_instr_opcode(cpu_id, i, opcode, len, is32, is64))
+
+/* exceptional case and interrupt */
+#define BX_INSTR_EXCEPTION(cpu_id, vector, error_code) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_INTERRUPT, bx_instr_exception(cpu_id, vector, error_code))
+
+#define BX_INSTR_INTERRUPT(cpu_id, vector) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_INTERRUPT, bx_instr_interrupt(cpu_id, vector))
+#define BX_INSTR_HWINTERRUPT(cpu_id, vector, cs, eip) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_INTERRUPT, bx_instr_hwinterrupt(cpu_id, vector, cs, eip))
+
+/* TLB/CACHE control instruction executed */
+#define BX_INSTR_CLFLUSH(cpu_id, laddr, paddr) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_CACHE_CNTRL, bx_instr_clflush(cpu_id, laddr, paddr))
+#define BX_INSTR_CACHE_CNTRL(cpu_id, what) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_CACHE_CNTRL, bx_instr_cache_cntrl(cpu_id, what))
+#define BX_INSTR_TLB_CNTRL(cpu_id, what, new_cr3) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_CACHE_CNTRL, bx_instr_tlb_cntrl(cpu_id, what, new_cr3))
+#define BX_INSTR_PREFETCH_HINT(cpu_id, what, seg, offset) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_CACHE_CNTRL, bx_instr_prefetch_hint(cpu_id, what, seg, offset))
+
+/* execution */
+#define BX_INSTR_BEFORE_EXECUTION(cpu_id, i) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_BEFORE_EXECUTION, bx_instr_before_execution(cpu_id, i))
+#define BX_INSTR_AFTER_EXECUTION(cpu_id, i) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_AFTER_EXECUTION, bx_instr_after_execution(cpu_id, i))
+#define BX_INSTR_REPEAT_ITERATION(cpu_id, i) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_REPEAT_ITERATION, bx_instr_repeat_iteration(cpu_id, i))
+
+/* linear memory access */
+#define BX_INSTR_LIN_ACCESS(cpu_id, lin, phy, len, memtype, rw) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_LIN_ACCESS, bx_instr_lin_access(cpu_id, lin, phy, len, memtype, rw))
+
+/* physical memory access */
+#define BX_INSTR_PHY_ACCESS(cpu_id, phy, len, memtype, rw) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_PHY_ACCESS, bx_instr_phy_access(cpu_id, phy, len, memtype, rw))
+
+/* feedback from device units */
+#define BX_INSTR_INP(addr, len)          BX_INSTR_HOOK(BX_INSTR_EV_IO, bx_instr_inp(addr, len))
+#define BX_INSTR_INP2(addr, len, val)    BX_INSTR_HOOK(BX_INSTR_EV_IO, bx_instr_inp2(addr, len, val))
+#define BX_INSTR_OUTP(addr, len, val)    BX_INSTR_HOOK(BX_INSTR_EV_IO, bx_instr_outp(addr, len, val))
+
+/* cpuid callback */
+#define BX_INSTR_CPUID(cpu_id)           BX_INSTR_HOOK(BX_INSTR_EV_CPUID, bx_instr_cpuid(cpu_id))
+
+/* wrmsr callback */
+#define BX_INSTR_WRMSR(cpu_id, addr, value) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_WRMSR, bx_instr_wrmsr(cpu_id, addr, value))
+
+/* vmexit callback */
+#define BX_INSTR_VMEXIT(cpu_id, reason, qualification) \
+                       BX_INSTR_HOOK(BX_INSTR_EV_VMEXIT, bx_instr_vmexit(cpu_id, reason, qualification))
+
+#else
+
+/* initialization/deinitialization of instrumentalization */
+#define BX_INSTR_INIT_ENV()
+#define BX_INSTR_EXIT_ENV()
+
+/* simulation init, shutdown, reset */
+#define BX_INSTR_INITIALIZE(cpu_id)
+#define BX_INSTR_EXIT(cpu_id)
+#define BX_INSTR_RESET(cpu_id, type)
+#define BX_INSTR_HLT(cpu_id)
+#define BX_INSTR_MWAIT(cpu_id, addr, len, flags)
+
+/* called from command line debugger */
+#define BX_INSTR_DEBUG_PROMPT()
+#define BX_INSTR_DEBUG_CMD(cmd)
+
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
+/* branch resolution */
+#define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip)
+#define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip)
+#define BX_INSTR_UCNEAR_BRANCH(cpu_id, what, branch_eip, new_eip)
+#define BX_INSTR_FAR_BRANCH(cpu_id, what, prev_cs, prev_eip, new_cs, new_eip)
+
+/* decoding completed */
+#define BX_INSTR_OPCODE(cpu_id, i, opcode, len, is32, is64)
+
+/* exceptional case and interrupt */
+#define BX_INSTR_EXCEPTION(cpu_id, vector, error_code)
+#define BX_INSTR_INTERRUPT(cpu_id, vector)
+#define BX_INSTR_HWINTERRUPT(cpu_id, vector, cs, eip)
+
+/* TLB/CACHE control instruction executed */
+#define BX_INSTR_CLFLUSH(cpu_id, laddr, paddr)
+#define BX_INSTR_CACHE_CNTRL(cpu_id, what)
+#define BX_INSTR_TLB_CNTRL(cpu_id, what, new_cr3)
+#define BX_INSTR_PREFETCH_HINT(cpu_id, what, seg, offset)
+
+/* execution */
+#define BX_INSTR_BEFORE_EXECUTION(cpu_id, i)
+#define BX_INSTR_AFTER_EXECUTION(cpu_id, i)
+#define BX_INSTR_REPEAT_ITERATION(cpu_id, i)
+
+/* linear memory access */
+#define BX_INSTR_LIN_ACCESS(cpu_id, lin, phy, len, memtype, rw)
+
+/* physical memory access */
+#define BX_INSTR_PHY_ACCESS(cpu_id, phy, len, memtype, rw)
+
+/* feedback from device units */
+#define BX_INSTR_INP(addr, len)
+#define BX_INSTR_INP2(addr, len, val)
+#define BX_INSTR_OUTP(addr, len, val)
+
+/* cpuid callback */
+#define BX_INSTR_CPUID(cpu_id)
+
+/* wrmsr callback */
+#define BX_INSTR_WRMSR(cpu_id, addr, value)
+
+/* vmexit callback */
+#define BX_INSTR_VMEXIT(cpu_id, reason, qualification)
+
+#endif
+
+#endif
@@ -0,0 +1,330 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+// Binary trace encoder and reader, see tracefile.h for the format.
+// This file does not depend on the rest of Bochs, so that it can be
+// linked into the bxtrace converter.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "tracefile.h"
+
+// fields stored for each record type, in this order
+#define F_ADDR  0x01
+#define F_ADDR2 0x02
+#define F_SIZE  0x04
+#define F_INFO  0x08
+#define F_DATA  0x10
+#define F_BYTES 0x20
+
+static const Bit8u trec_fields[BX_TREC_NUM_TYPES] = {
+  0,                                      // BX_TREC_NONE
+  F_ADDR | F_SIZE | F_INFO,               // BX_TREC_INSN
+  F_ADDR | F_SIZE | F_INFO | F_BYTES,     // BX_TREC_DECODE
+  F_ADDR | F_ADDR2 | F_SIZE | F_INFO,     // BX_TREC_MEM
+  F_ADDR | F_ADDR2 | F_INFO | F_DATA,     // BX_TREC_BRANCH
+  F_ADDR | F_SIZE | F_INFO | F_DATA,      // BX_TREC_INTERRUPT
+  F_ADDR | F_SIZE | F_INFO | F_DATA       // BX_TREC_IO
+};
+
+static inline void put_le(Bit8u *buf, Bit32u val, unsigned len)
+{
+  for (unsigned n = 0; n < len; n++) buf[n] = (Bit8u)(val >> (n * 8));
+}
+
+static inline Bit32u get_le(const Bit8u *buf, unsigned len)
+{
+  Bit32u val = 0;
+  for (unsigned n = 0; n < len; n++) val |= (Bit32u) buf[n] << (n * 8);
+  return val;
+}
+
+void bx_trace_file_header(Bit8u *buf, unsigned ncpus)
+{
+  memcpy(buf, BX_TRACE_FILE_MAGIC, 8);
+  put_le(buf + 8, ncpus, 4);
+  put_le(buf + 12, 0, 4);
+}
+
+void bx_trace_chunk_header(Bit8u *buf, unsigned cpu, Bit32u nrecs, Bit32u size)
+{
+  memcpy(buf, BX_TRACE_CHUNK_MAGIC, 4);
+  put_le(buf + 4, cpu, 2);
+  put_le(buf + 6, 0, 2);
+  put_le(buf + 8, nrecs, 4);
+  put_le(buf + 12, size, 4);
+}
+
+static inline unsigned put_varint(Bit8u *buf, Bit64u val)
+{
+  unsigned len = 0;
+  while (val >= 0x80) {
+    buf[len++] = (Bit8u) val | 0x80;
+    val >>= 7;
+  }
+  buf[len++] = (Bit8u) val;
+  return len;
+}
+
+static inline unsigned put_delta(Bit8u *buf, Bit64u val, Bit64u *last)
+{
+  Bit64s delta = (Bit64s)(val - *last);
+  *last = val;
+  return put_varint(buf, ((Bit64u) delta << 1) ^ (Bit64u)(delta >> 63));
+}
+
+void bx_trace_encoder_c::reset(void)
+{
+  memset(&st, 0, sizeof(st));
+}
+
+unsigned bx_trace_encoder_c::encode(const bx_trace_rec_t *rec, Bit8u *buf)
+{
+  unsigned type = rec->type & BX_TREC_TYPE_MASK;
+  unsigned fields = trec_fields[type];
+  unsigned len = 1;
+  Bit16u *last_info = &st.last_info[type];
+  Bit8u *last_size = &st.last_size[type];
+
+  buf[0] = type;
+  if (type == BX_TREC_INSN) {
+    if (rec->addr == st.next_rip) {
+      buf[0] |= BX_TREC_SEQ;
+      fields &= ~F_ADDR;
+      st.last_addr[type] = rec->addr;
+    }
+    st.next_rip = rec->addr + rec->size;
+    unsigned n = (unsigned) rec->addr & (BX_TREC_INSN_CACHE - 1);
+    if (st.insn[n].rip != rec->addr) {
+      st.insn[n].rip = rec->addr;
+      st.insn[n].size = 0;
+    }
+    last_info = &st.insn[n].info;
+    last_size = &st.insn[n].size;
+  }
+  if ((fields & F_SIZE) && (fields & F_INFO)) {
+    if (rec->size == *last_size && rec->info == *last_info) {
+      buf[0] |= BX_TREC_SAME;
+      fields &= ~(F_SIZE | F_INFO);
+    }
+    *last_size = rec->size;
+    *last_info = rec->info;
+  }
+  if (fields & F_ADDR)
+    len += put_delta(buf + len, rec->addr, &st.last_addr[type]);
+  if (fields & F_ADDR2)
+    len += put_delta(buf + len, rec->u.addr2, &st.last_addr2[type]);
+  if (fields & F_SIZE)
+    buf[len++] = rec->size;
+  if (fields & F_INFO)
+    len += put_varint(buf + len, rec->info);
+  if (fields & F_DATA)
+    len += put_varint(buf + len, rec->data);
+  if (fields & F_BYTES) {
+    unsigned n = (rec->size < 16) ? rec->size : 16;
+    memcpy(buf + len, rec->u.bytes, n);
+    len += n;
+  }
+  return len;
+}
+
+bx_trace_reader_c::bx_trace_reader_c()
+{
+  fp = NULL;
+  buf = NULL;
+  buf_size = 0;
+  ncpus = 0;
+  chunk_left = 0;
+  error = NULL;
+}
+
+bx_trace_reader_c::~bx_trace_reader_c()
+{
+  close();
+}
+
+bool bx_trace_reader_c::open(const char *path)
+{
+  Bit8u hdr[BX_TRACE_FILE_HDR_SIZE];
+
+  close();
+  fp = fopen(path, "rb");
+  if (fp == NULL) {
+    error = "cannot open file";
+    return 0;
+  }
+  if ((fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) ||
+      memcmp(hdr, BX_TRACE_FILE_MAGIC, 8)) {
+    error = "not a Bochs trace file";
+    close();
+    return 0;
+  }
+  ncpus = get_le(hdr + 8, 4);
+  chunk_left = 0;
+  error = NULL;
+  return 1;
+}
+
+void bx_trace_reader_c::close(void)
+{
+  if (fp != NULL) {
+    fclose(fp);
+    fp = NULL;
+  }
+  if (buf != NULL) {
+    free(buf);
+    buf = NULL;
+    buf_size = 0;
+  }
+}
+
+bool bx_trace_reader_c::read_chunk(void)
+{
+  Bit8u hdr[BX_TRACE_CHUNK_HDR_SIZE];
+
+  size_t n = fread(hdr, 1, sizeof(hdr), fp);
+  if (n == 0) return 0; // end of file
+  if ((n != sizeof(hdr)) || memcmp(hdr, BX_TRACE_CHUNK_MAGIC, 4)) {
+    error = "corrupt chunk header";
+    return 0;
+  }
+  chunk_cpu = get_le(hdr + 4, 2);
+  chunk_left = get_le(hdr + 8, 4);
+  buf_len = get_le(hdr + 12, 4);
+  if (buf_len > buf_size) {
+    Bit8u *newbuf = (Bit8u*) realloc(buf, buf_len);
+    if (newbuf == NULL) {
+      error = "out of memory";
+      return 0;
+    }
+    buf = newbuf;
+    buf_size = buf_len;
+  }
+  if (fread(buf, 1, buf_len, fp) != buf_len) {
+    error = "truncated chunk";
+    return 0;
+  }
+  buf_pos = 0;
+  memset(&st, 0, sizeof(st));
+  return 1;
+}
+
+#define GET_VARINT(var) {                            \
+  Bit64u v = 0;                                      \
+  unsigned shift = 0;                                \
+  do {                                               \
+    if (buf_pos >= buf_len || shift > 63) return 0;  \
+    v |= (Bit64u)(buf[buf_pos] & 0x7f) << shift;     \
+    shift += 7;                                      \
+  } while (buf[buf_pos++] & 0x80);                   \
+  (var) = v;                                         \
+}
+
+#define GET_DELTA(var, last) {                       \
+  Bit64u zz;                                         \
+  GET_VARINT(zz);                                    \
+  (last) += (zz >> 1) ^ (0 - (zz & 1));              \
+  (var) = (last);                                    \
+}
+
+bool bx_trace_reader_c::decode(bx_trace_rec_t *rec)
+{
+  Bit64u val;
+
+  if (buf_pos >= buf_len) return 0;
+  Bit8u tag = buf[buf_pos++];
+  unsigned type = tag & BX_TREC_TYPE_MASK;
+  if (type == BX_TREC_NONE || type >= BX_TREC_NUM_TYPES) return 0;
+  unsigned fields = trec_fields[type];
+
+  memset(rec, 0, sizeof(*rec));
+  rec->type = type;
+  if (tag & BX_TREC_SEQ) {
+    if (type != BX_TREC_INSN) return 0;
+    fields &= ~F_ADDR;
+    rec->addr = st.last_addr[type] = st.next_rip;
+  }
+  if (fields & F_ADDR)
+    GET_DELTA(rec->addr, st.last_addr[type]);
+  if (fields & F_ADDR2)
+    GET_DELTA(rec->u.addr2, st.last_addr2[type]);
+
+  Bit16u *last_info = &st.last_info[type];
+  Bit8u *last_size = &st.last_size[type];
+  if (type == BX_TREC_INSN) {
+    unsigned n = (unsigned) rec->addr & (BX_TREC_INSN_CACHE - 1);
+    if (st.insn[n].rip != rec->addr) {
+      st.insn[n].rip = rec->addr;
+      st.insn[n].size = 0;
+    }
+    last_info = &st.insn[n].info;
+    last_size = &st.insn[n].size;
+  }
+  if (tag & BX_TREC_SAME) {
+    if (!(fields & F_SIZE)) return 0;
+    fields &= ~(F_SIZE | F_INFO);
+    rec->size = *last_size;
+    rec->info = *last_info;
+  }
+  if (fields & F_SIZE) {
+    if (buf_pos >= buf_len) return 0;
+    rec->size = buf[buf_pos++];
+  }
+  if (fields & F_INFO) {
+    GET_VARINT(val);
+    rec->info = (Bit16u) val;
+  }
+  if ((trec_fields[type] & F_SIZE) && (trec_fields[type] & F_INFO)) {
+    *last_size = rec->size;
+    *last_info = rec->info;
+  }
+  if (fields & F_DATA) {
+    GET_VARINT(val);
+    rec->data = (Bit32u) val;
+  }
+  if (fields & F_BYTES) {
+    unsigned n = (rec->size < 16) ? rec->size : 16;
+    if (buf_pos + n > buf_len) return 0;
+    memcpy(rec->u.bytes, buf + buf_pos, n);
+    buf_pos += n;
+  }
+  if (type == BX_TREC_INSN)
+    st.next_rip = rec->addr + rec->size;
+  return 1;
+}
+
+bool bx_trace_reader_c::next(unsigned *cpu, bx_trace_rec_t *rec)
+{
+  if (fp == NULL) return 0;
+  while (chunk_left == 0) {
+    if (!read_chunk()) return 0;
+  }
+  if (!decode(rec)) {
+    error = "corrupt record";
+    chunk_left = 0;
+    return 0;
+  }
+  chunk_left--;
+  *cpu = chunk_cpu;
+  return 1;
+}
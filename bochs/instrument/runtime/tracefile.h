@@ -0,0 +1,153 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+// Binary trace file format, shared by the tracer (tracer.cc) and the
+// reader library used by the bxtrace converter.
+//
+// The file starts with a header:
+//
+//   Bit8u  magic[8]    "BXTRACE1"
+//   Bit32u ncpus
+//   Bit32u reserved
+//
+// followed by chunks, each holding consecutive records of one CPU:
+//
+//   Bit8u  magic[4]    "BXTC"
+//   Bit16u cpu
+//   Bit16u reserved
+//   Bit32u nrecs       number of records in the chunk
+//   Bit32u size        size of the encoded records in bytes
+//
+// All header fields are little endian. The records are delta encoded:
+// a tag byte (record type in bits 0..3, flags in bits 4..5) is followed
+// by the fields the type uses. Numbers are stored as LEB128 varints and
+// addresses as zigzag varints of the difference to the previous address
+// of the same record type in the chunk. An instruction that starts right
+// after the previous one (BX_TREC_SEQ) has no address at all. BX_TREC_SAME
+// omits size and info if they match the previous record of the type, for
+// instructions the previous one at the same RIP (kept in a table indexed
+// by the low RIP bits). Every chunk starts with cleared state and can be
+// decoded on its own.
+
+#ifndef BX_INSTRUMENT_TRACEFILE_H
+#define BX_INSTRUMENT_TRACEFILE_H
+
+#define BX_TRACE_FILE_MAGIC  "BXTRACE1"
+#define BX_TRACE_CHUNK_MAGIC "BXTC"
+#define BX_TRACE_FILE_HDR_SIZE  16
+#define BX_TRACE_CHUNK_HDR_SIZE 16
+
+// record types
+enum {
+  BX_TREC_NONE = 0,
+  BX_TREC_INSN,      // addr=rip size=ilen info=Bochs opcode
+  BX_TREC_DECODE,    // addr=rip size=len info=mode (16/32/64) bytes=opcode
+  BX_TREC_MEM,       // addr=lin addr2=phy size=len info=rw|memtype<<4 (|BX_TREC_MEM_PHY)
+  BX_TREC_BRANCH,    // addr=branch rip addr2=target info=kind data=prev_cs<<16|new_cs
+  BX_TREC_INTERRUPT, // info=vector size=kind data=error code or cs addr=rip (hw only)
+  BX_TREC_IO,        // addr=port size=len info=0 (in) or 1 (out) data=value
+  BX_TREC_NUM_TYPES
+};
+
+#define BX_TREC_TYPE_MASK 0x0f
+#define BX_TREC_SEQ       0x10
+#define BX_TREC_SAME      0x20
+
+#define BX_TREC_INSN_CACHE 1024
+
+// BX_TREC_MEM: physical access without a linear address (page walks etc.)
+#define BX_TREC_MEM_PHY   0x100
+
+// BX_TREC_BRANCH kinds besides the BX_INSTR_IS_* branch types
+#define BX_TREC_BR_TAKEN     1
+#define BX_TREC_BR_NOT_TAKEN 2
+
+// BX_TREC_INTERRUPT kinds
+#define BX_TREC_INT_DELIVERY  0 // every interrupt, exception included
+#define BX_TREC_INT_EXCEPTION 1
+#define BX_TREC_INT_HW        2
+
+// in-memory record, also the element of the per-CPU ring buffers
+typedef struct {
+  Bit8u  type;
+  Bit8u  size;
+  Bit16u info;
+  Bit32u data;
+  Bit64u addr;
+  union {
+    Bit64u addr2;
+    Bit8u  bytes[16];
+  } u;
+} bx_trace_rec_t;
+
+// worst case size of one encoded record
+#define BX_TREC_MAX_ENCODED 64
+
+// delta state shared by the encoder and the reader
+typedef struct {
+  Bit64u last_addr[BX_TREC_NUM_TYPES];
+  Bit64u last_addr2[BX_TREC_NUM_TYPES];
+  Bit16u last_info[BX_TREC_NUM_TYPES];
+  Bit8u  last_size[BX_TREC_NUM_TYPES];
+  Bit64u next_rip;
+  struct {
+    Bit64u rip;
+    Bit16u info;
+    Bit8u  size;
+  } insn[BX_TREC_INSN_CACHE];
+} bx_trace_state_t;
+
+class bx_trace_encoder_c {
+public:
+  void reset(void);
+  // returns the number of bytes written to buf
+  unsigned encode(const bx_trace_rec_t *rec, Bit8u *buf);
+private:
+  bx_trace_state_t st;
+};
+
+class bx_trace_reader_c {
+public:
+  bx_trace_reader_c();
+  ~bx_trace_reader_c();
+  bool open(const char *path);
+  void close(void);
+  unsigned get_ncpus(void) const { return ncpus; }
+  // returns false at the end of the file or on a corrupt chunk
+  bool next(unsigned *cpu, bx_trace_rec_t *rec);
+  const char *get_error(void) const { return error; }
+private:
+  bool read_chunk(void);
+  bool decode(bx_trace_rec_t *rec);
+
+  FILE *fp;
+  unsigned ncpus;
+  unsigned chunk_cpu;
+  Bit32u chunk_left;
+  Bit8u *buf;
+  Bit32u buf_size, buf_pos, buf_len;
+  bx_trace_state_t st;
+  const char *error;
+};
+
+void bx_trace_file_header(Bit8u *buf, unsigned ncpus);
+void bx_trace_chunk_header(Bit8u *buf, unsigned cpu, Bit32u nrecs, Bit32u size);
+
+#endif
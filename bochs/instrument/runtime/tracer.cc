@@ -0,0 +1,361 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+// Built-in binary tracer. The callbacks store fixed size records into a
+// ring buffer per CPU. A writer thread drains the rings, encodes the
+// records in chunks and writes them to the trace file. The simulation
+// thread only waits if a ring is completely full.
+
+#include "bochs.h"
+#include "cpu/cpu.h"
+#include "bxthread.h"
+#include "tracefile.h"
+
+#if BX_INSTRUMENTATION
+
+#define BX_TRACE_RING_SIZE  (1 << 16)  // records per CPU
+#define BX_TRACE_RING_MASK  (BX_TRACE_RING_SIZE - 1)
+#define BX_TRACE_CHUNK_RECS 4096
+// wake up the writer each time this many records were added to a ring
+#define BX_TRACE_WAKE_MASK  (BX_TRACE_RING_SIZE / 4 - 1)
+
+static logfunctions *trace_log = new logfunctions();
+#define LOG_THIS trace_log->
+
+typedef struct {
+  bx_trace_rec_t *rec;
+  Bit32u head;       // written by the simulation thread only
+  Bit32u tail_seen;  // last tail value read by the simulation thread
+  Bit8u pad[64];     // keep head and tail in different cache lines
+  Bit32u tail;       // written by the writer thread only
+  // decoder position for BX_TREC_DECODE records
+  bxInstruction_c *decode_i;
+  bx_address decode_rip;
+} bx_trace_ring_t;
+
+static bx_trace_ring_t *rings = NULL;
+static unsigned trace_ncpus = 0;
+static unsigned cur_cpu = 0;
+static int trace_handle = -1;
+static FILE *trace_fp = NULL;
+static char *trace_path = NULL;
+
+static BX_THREAD_VAR(trace_thread);
+static bx_thread_sem_t trace_sem;
+static bool trace_stop;
+
+static bx_trace_encoder_c encoder;
+static Bit8u *chunk_buf = NULL;
+static Bit64u trace_records, trace_bytes;
+static Bit32u trace_stalls;
+
+// simulation thread side
+
+static BX_CPP_INLINE bx_trace_rec_t *trace_alloc(unsigned cpu)
+{
+  bx_trace_ring_t *r = &rings[cpu];
+  // only look at the writer's tail when the ring seems to be full
+  if ((r->head - r->tail_seen) == BX_TRACE_RING_SIZE) {
+    r->tail_seen = BX_ATOMIC_LOAD(r->tail);
+    if ((r->head - r->tail_seen) == BX_TRACE_RING_SIZE) {
+      trace_stalls++;
+      do {
+        bx_set_sem(&trace_sem);
+        BX_MSLEEP(1);
+        r->tail_seen = BX_ATOMIC_LOAD(r->tail);
+      } while ((r->head - r->tail_seen) == BX_TRACE_RING_SIZE);
+    }
+  }
+  return &r->rec[r->head & BX_TRACE_RING_MASK];
+}
+
+static BX_CPP_INLINE void trace_commit(unsigned cpu)
+{
+  Bit32u head = rings[cpu].head + 1;
+  BX_ATOMIC_STORE(rings[cpu].head, head);
+  if ((head & BX_TRACE_WAKE_MASK) == 0)
+    bx_set_sem(&trace_sem);
+}
+
+static void trace_before_execution(void *param, unsigned cpu, bxInstruction_c *i)
+{
+  bx_trace_rec_t *rec = trace_alloc(cpu);
+  rec->type = BX_TREC_INSN;
+  rec->size = i->ilen();
+  rec->info = i->getIaOpcode();
+  rec->addr = BX_CPU(cpu)->get_instruction_pointer();
+  trace_commit(cpu);
+  cur_cpu = cpu;
+}
+
+// The decoder reports the instructions of a new trace in order, RIP still
+// points to the first one.
+static void trace_opcode(void *param, unsigned cpu, bxInstruction_c *i, const Bit8u *opcode, unsigned len, bool is32, bool is64)
+{
+  bx_trace_ring_t *r = &rings[cpu];
+  if (i != r->decode_i + 1)
+    r->decode_rip = BX_CPU(cpu)->get_instruction_pointer();
+  bx_trace_rec_t *rec = trace_alloc(cpu);
+  rec->type = BX_TREC_DECODE;
+  rec->size = len;
+  rec->info = is64 ? 64 : (is32 ? 32 : 16);
+  rec->addr = r->decode_rip;
+  memcpy(rec->u.bytes, opcode, (len < 16) ? len : 16);
+  trace_commit(cpu);
+  r->decode_i = i;
+  r->decode_rip += len;
+}
+
+static void trace_lin_access(void *param, unsigned cpu, bx_address lin, bx_address phy, unsigned len, unsigned memtype, unsigned rw)
+{
+  bx_trace_rec_t *rec = trace_alloc(cpu);
+  rec->type = BX_TREC_MEM;
+  rec->size = len;
+  rec->info = rw | (memtype << 4);
+  rec->addr = lin;
+  rec->u.addr2 = phy;
+  trace_commit(cpu);
+}
+
+static void trace_phy_access(void *param, unsigned cpu, bx_address phy, unsigned len, unsigned memtype, unsigned rw)
+{
+  bx_trace_rec_t *rec = trace_alloc(cpu);
+  rec->type = BX_TREC_MEM;
+  rec->size = len;
+  rec->info = rw | (memtype << 4) | BX_TREC_MEM_PHY;
+  rec->addr = phy;
+  rec->u.addr2 = phy;
+  trace_commit(cpu);
+}
+
+static void trace_branch(unsigned cpu, unsigned kind, bx_address from, bx_address to, Bit32u data)
+{
+  bx_trace_rec_t *rec = trace_alloc(cpu);
+  rec->type = BX_TREC_BRANCH;
+  rec->size = 0;
+  rec->info = kind;
+  rec->data = data;
+  rec->addr = from;
+  rec->u.addr2 = to;
+  trace_commit(cpu);
+}
+
+static void trace_cnear_branch_taken(void *param, unsigned cpu, bx_address branch_eip, bx_address new_eip)
+{
+  trace_branch(cpu, BX_TREC_BR_TAKEN, branch_eip, new_eip, 0);
+}
+
+static void trace_cnear_branch_not_taken(void *param, unsigned cpu, bx_address branch_eip)
+{
+  trace_branch(cpu, BX_TREC_BR_NOT_TAKEN, branch_eip, branch_eip, 0);
+}
+
+static void trace_ucnear_branch(void *param, unsigned cpu, unsigned what, bx_address branch_eip, bx_address new_eip)
+{
+  trace_branch(cpu, what, branch_eip, new_eip, 0);
+}
+
+static void trace_far_branch(void *param, unsigned cpu, unsigned what, Bit16u prev_cs, bx_address prev_eip, Bit16u new_cs, bx_address new_eip)
+{
+  trace_branch(cpu, what, prev_eip, new_eip, ((Bit32u) prev_cs << 16) | new_cs);
+}
+
+static void trace_interrupt_rec(unsigned cpu, unsigned kind, unsigned vector, Bit32u data, bx_address rip)
+{
+  bx_trace_rec_t *rec = trace_alloc(cpu);
+  rec->type = BX_TREC_INTERRUPT;
+  rec->size = kind;
+  rec->info = vector;
+  rec->data = data;
+  rec->addr = rip;
+  trace_commit(cpu);
+}
+
+static void trace_interrupt(void *param, unsigned cpu, unsigned vector)
+{
+  trace_interrupt_rec(cpu, BX_TREC_INT_DELIVERY, vector, 0, 0);
+}
+
+static void trace_exception(void *param, unsigned cpu, unsigned vector, unsigned error_code)
+{
+  trace_interrupt_rec(cpu, BX_TREC_INT_EXCEPTION, vector, error_code, 0);
+}
+
+static void trace_hwinterrupt(void *param, unsigned cpu, unsigned vector, Bit16u cs, bx_address eip)
+{
+  trace_interrupt_rec(cpu, BX_TREC_INT_HW, vector, cs, eip);
+}
+
+// I/O is reported without a CPU, use the one that executed last
+static void trace_io(unsigned dir, Bit16u addr, unsigned len, unsigned val)
+{
+  bx_trace_rec_t *rec = trace_alloc(cur_cpu);
+  rec->type = BX_TREC_IO;
+  rec->size = len;
+  rec->info = dir;
+  rec->data = val;
+  rec->addr = addr;
+  trace_commit(cur_cpu);
+}
+
+static void trace_inp2(void *param, Bit16u addr, unsigned len, unsigned val)
+{
+  trace_io(0, addr, len, val);
+}
+
+static void trace_outp(void *param, Bit16u addr, unsigned len, unsigned val)
+{
+  trace_io(1, addr, len, val);
+}
+
+static bx_instr_callbacks_t trace_callbacks;
+
+// writer thread side
+
+// encode and write the complete chunks of every ring, or everything if
+// all is set
+static void trace_drain(bool all)
+{
+  Bit8u hdr[BX_TRACE_CHUNK_HDR_SIZE];
+
+  for (unsigned cpu = 0; cpu < trace_ncpus; cpu++) {
+    bx_trace_ring_t *r = &rings[cpu];
+    for (;;) {
+      Bit32u tail = r->tail;
+      Bit32u avail = BX_ATOMIC_LOAD(r->head) - tail;
+      if (avail == 0 || (avail < BX_TRACE_CHUNK_RECS && !all)) break;
+      if (avail > BX_TRACE_CHUNK_RECS) avail = BX_TRACE_CHUNK_RECS;
+      unsigned len = 0;
+      encoder.reset();
+      for (Bit32u n = 0; n < avail; n++) {
+        len += encoder.encode(&r->rec[(tail + n) & BX_TRACE_RING_MASK], chunk_buf + len);
+      }
+      // the records are encoded, give the slots back
+      BX_ATOMIC_STORE(r->tail, tail + avail);
+      bx_trace_chunk_header(hdr, cpu, avail, len);
+      fwrite(hdr, 1, sizeof(hdr), trace_fp);
+      fwrite(chunk_buf, 1, len, trace_fp);
+      trace_records += avail;
+      trace_bytes += sizeof(hdr) + len;
+    }
+  }
+}
+
+static BX_THREAD_FUNC(trace_writer, indata)
+{
+  for (;;) {
+    bx_wait_sem(&trace_sem);
+    bool stop = BX_ATOMIC_LOAD(trace_stop);
+    trace_drain(stop);
+    if (stop) break;
+  }
+  BX_THREAD_EXIT;
+}
+
+bool bx_trace_start(const char *path)
+{
+  Bit8u hdr[BX_TRACE_FILE_HDR_SIZE];
+
+  if (trace_fp != NULL) {
+    BX_ERROR(("tracing to '%s' already active", trace_path));
+    return 0;
+  }
+  trace_fp = fopen(path, "wb");
+  if (trace_fp == NULL) {
+    BX_ERROR(("cannot create trace file '%s'", path));
+    return 0;
+  }
+  setvbuf(trace_fp, NULL, _IOFBF, 1 << 20);
+  trace_path = strdup(path);
+  trace_ncpus = BX_SMP_PROCESSORS;
+  bx_trace_file_header(hdr, trace_ncpus);
+  fwrite(hdr, 1, sizeof(hdr), trace_fp);
+
+  rings = new bx_trace_ring_t[trace_ncpus];
+  for (unsigned n = 0; n < trace_ncpus; n++) {
+    rings[n].rec = new bx_trace_rec_t[BX_TRACE_RING_SIZE];
+    rings[n].head = rings[n].tail = rings[n].tail_seen = 0;
+    rings[n].decode_i = NULL;
+    rings[n].decode_rip = 0;
+  }
+  chunk_buf = new Bit8u[BX_TRACE_CHUNK_RECS * BX_TREC_MAX_ENCODED];
+  trace_records = trace_bytes = 0;
+  trace_stalls = 0;
+  cur_cpu = 0;
+
+  trace_stop = 0;
+  bx_create_sem(&trace_sem);
+  BX_THREAD_CREATE(trace_writer, NULL, trace_thread);
+
+  memset(&trace_callbacks, 0, sizeof(trace_callbacks));
+  trace_callbacks.before_execution = trace_before_execution;
+  trace_callbacks.opcode = trace_opcode;
+  trace_callbacks.lin_access = trace_lin_access;
+  trace_callbacks.phy_access = trace_phy_access;
+  trace_callbacks.cnear_branch_taken = trace_cnear_branch_taken;
+  trace_callbacks.cnear_branch_not_taken = trace_cnear_branch_not_taken;
+  trace_callbacks.ucnear_branch = trace_ucnear_branch;
+  trace_callbacks.far_branch = trace_far_branch;
+  trace_callbacks.interrupt = trace_interrupt;
+  trace_callbacks.exception = trace_exception;
+  trace_callbacks.hwinterrupt = trace_hwinterrupt;
+  trace_callbacks.inp2 = trace_inp2;
+  trace_callbacks.outp = trace_outp;
+  trace_handle = bx_instr_subscribe(&trace_callbacks,
+    BX_INSTR_EVENT(BX_INSTR_EV_BEFORE_EXECUTION) | BX_INSTR_EVENT(BX_INSTR_EV_OPCODE) |
+    BX_INSTR_EVENT(BX_INSTR_EV_LIN_ACCESS) | BX_INSTR_EVENT(BX_INSTR_EV_PHY_ACCESS) |
+    BX_INSTR_EVENT(BX_INSTR_EV_BRANCH) | BX_INSTR_EVENT(BX_INSTR_EV_INTERRUPT) |
+    BX_INSTR_EVENT(BX_INSTR_EV_IO), 0, (bx_address) -1, NULL);
+
+  BX_INFO(("tracing to '%s'", path));
+  return 1;
+}
+
+void bx_trace_stop(void)
+{
+  if (trace_fp == NULL) return;
+
+  bx_instr_unsubscribe(trace_handle);
+  trace_handle = -1;
+  BX_ATOMIC_STORE(trace_stop, 1);
+  bx_set_sem(&trace_sem);
+  BX_THREAD_JOIN(trace_thread);
+  bx_destroy_sem(&trace_sem);
+  fclose(trace_fp);
+  trace_fp = NULL;
+
+  BX_INFO(("trace '%s': " FMT_LL "u records, " FMT_LL "u bytes, %u stalls",
+           trace_path, trace_records, trace_bytes, trace_stalls));
+  for (unsigned n = 0; n < trace_ncpus; n++)
+    delete [] rings[n].rec;
+  delete [] rings;
+  rings = NULL;
+  delete [] chunk_buf;
+  chunk_buf = NULL;
+  free(trace_path);
+  trace_path = NULL;
+}
+
+void bx_trace_init_env(void)
+{
+  trace_log->put("TRACE");
+}
+
+#endif
@@ -89,6 +89,10 @@ void bx_instr_vmexit(unsigned cpu, Bit32u reason, Bit64u qualification);
 #define BX_INSTR_DEBUG_PROMPT()          bx_instr_debug_promt()
 #define BX_INSTR_DEBUG_CMD(cmd)          bx_instr_debug_cmd(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip) bx_instr_cnear_branch_taken(cpu_id, branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip) bx_instr_cnear_branch_not_taken(cpu_id, branch_eip)
@@ -156,6 +160,10 @@ void bx_instr_vmexit(unsigned cpu, Bit32u reason, Bit64u qualification);
 #define BX_INSTR_DEBUG_PROMPT()
 #define BX_INSTR_DEBUG_CMD(cmd)
 
+/* start of a trace */
+#define BX_INSTR_TRACE(cpu_id, rip, paddr, ninstr)
+#define BX_INSTR_TRACE_ACTIVE(cpu_id)    (0)
+
 /* branch resolution */
 #define BX_INSTR_CNEAR_BRANCH_TAKEN(cpu_id, branch_eip, new_eip)
 #define BX_INSTR_CNEAR_BRANCH_NOT_TAKEN(cpu_id, branch_eip)
@@ -33,6 +33,7 @@
 #include "iodev/network/netmod.h"
 #include "iodev/usb/usb_common.h"
 #include "iodev/hdimage/hdimage.h"
+#include "iodev/ioapic.h"
 
 #include "bx_debug/debug.h"
 
@@ -772,6 +773,9 @@ bool bx_devices_c::register_io_read_handler(void *this_ptr, bx_read_handler_t f,
     strcpy(io_read_handler->handler_name, name);
     io_read_handler->mask = mask;
     io_read_handler->usage_count = 0;
+#if BX_ENABLE_STATISTICS
+    io_read_handler->count = bx_stats_counter("io", name, "reads");
+#endif
     // add the handler to the double linked list of handlers
     io_read_handlers.prev->next = io_read_handler;
     io_read_handler->next = &io_read_handlers;
@@ -831,6 +835,9 @@ bool bx_devices_c::register_io_write_handler(void *this_ptr, bx_write_handler_t
     strcpy(io_write_handler->handler_name, name);
     io_write_handler->mask = mask;
     io_write_handler->usage_count = 0;
+#if BX_ENABLE_STATISTICS
+    io_write_handler->count = bx_stats_counter("io", name, "writes");
+#endif
     // add the handler to the double linked list of handlers
     io_write_handlers.prev->next = io_write_handler;
     io_write_handler->next = &io_write_handlers;
@@ -895,6 +902,9 @@ bool bx_devices_c::register_io_read_handler_range(void *this_ptr, bx_read_handle
     strcpy(io_read_handler->handler_name, name);
     io_read_handler->mask = mask;
     io_read_handler->usage_count = 0;
+#if BX_ENABLE_STATISTICS
+    io_read_handler->count = bx_stats_counter("io", name, "reads");
+#endif
     // add the handler to the double linked list of handlers
     io_read_handlers.prev->next = io_read_handler;
     io_read_handler->next = &io_read_handlers;
@@ -960,6 +970,9 @@ bool bx_devices_c::register_io_write_handler_range(void *this_ptr, bx_write_hand
     strcpy(io_write_handler->handler_name, name);
     io_write_handler->mask = mask;
     io_write_handler->usage_count = 0;
+#if BX_ENABLE_STATISTICS
+    io_write_handler->count = bx_stats_counter("io", name, "writes");
+#endif
     // add the handler to the double linked list of handlers
     io_write_handlers.prev->next = io_write_handler;
     io_write_handler->next = &io_write_handlers;
@@ -985,6 +998,9 @@ bool bx_devices_c::register_default_io_read_handler(void *this_ptr, bx_read_hand
   io_read_handlers.handler_name = new char[strlen(name)+1];
   strcpy(io_read_handlers.handler_name, name);
   io_read_handlers.mask = mask;
+#if BX_ENABLE_STATISTICS
+  io_read_handlers.count = bx_stats_counter("io", name, "reads");
+#endif
 
   return true;
 }
@@ -1000,6 +1016,9 @@ bool bx_devices_c::register_default_io_write_handler(void *this_ptr, bx_write_ha
   io_write_handlers.handler_name = new char[strlen(name)+1];
   strcpy(io_write_handlers.handler_name, name);
   io_write_handlers.mask = mask;
+#if BX_ENABLE_STATISTICS
+  io_write_handlers.count = bx_stats_counter("io", name, "writes");
+#endif
 
   return true;
 }
@@ -1131,8 +1150,16 @@ bx_devices_c::inp(Bit16u addr, unsigned io_len)
   BX_INSTR_INP(addr, io_len);
 
   io_read_handler = read_port_to_handler[addr];
+  INC_STAT(*io_read_handler->count);
   if (io_read_handler->mask & io_len) {
+#if BX_ENABLE_STATISTICS
+    Bit64u heat_start = bx_heatmap.enabled ? bx_heatmap.start() : 0;
+#endif
     ret = ((bx_read_handler_t)io_read_handler->funct)(io_read_handler->this_ptr, (Bit32u)addr, io_len);
+#if BX_ENABLE_STATISTICS
+    if (bx_heatmap.enabled)
+      bx_heatmap.io_access(addr, 0, io_read_handler, io_read_handler->handler_name, heat_start);
+#endif
   } else {
     switch (io_len) {
       case 1: ret = 0xff; break;
@@ -1164,13 +1191,36 @@ bx_devices_c::outp(Bit16u addr, Bit32u value, unsigned io_len)
   BX_DBG_IO_REPORT(addr, io_len, BX_WRITE, value);
 
   io_write_handler = write_port_to_handler[addr];
+  INC_STAT(*io_write_handler->count);
   if (io_write_handler->mask & io_len) {
+#if BX_ENABLE_STATISTICS
+    Bit64u heat_start = bx_heatmap.enabled ? bx_heatmap.start() : 0;
+#endif
     ((bx_write_handler_t)io_write_handler->funct)(io_write_handler->this_ptr, (Bit32u)addr, value, io_len);
+#if BX_ENABLE_STATISTICS
+    if (bx_heatmap.enabled)
+      bx_heatmap.io_access(addr, 1, io_write_handler, io_write_handler->handler_name, heat_start);
+#endif
   } else if (addr != 0x0cf8) { // don't flood the logfile when probing PCI
     BX_ERROR(("write to port 0x%04x with len %d ignored", addr, io_len));
   }
 }
 
+#if BX_ENABLE_STATISTICS
+const char *bx_devices_c::get_device_name(void *this_ptr)
+{
+  struct io_handler_struct *curr;
+
+  for (curr = io_read_handlers.next; curr != &io_read_handlers; curr = curr->next) {
+    if (curr->this_ptr == this_ptr) return curr->handler_name;
+  }
+  for (curr = io_write_handlers.next; curr != &io_write_handlers; curr = curr->next) {
+    if (curr->this_ptr == this_ptr) return curr->handler_name;
+  }
+  return NULL;
+}
+#endif
+
 bool bx_devices_c::is_harddrv_enabled(void)
 {
   char pname[24];
@@ -1646,6 +1696,10 @@ void bx_pci_device_c::register_pci_state(bx_list_c *list)
     sprintf(name, "addr%u", i);
     new bx_shadow_num_c(pci_bars, name, &pci_bar[i].addr, BASE_HEX);
   }
+  if (msix_cap != 0) {
+    new bx_shadow_data_c(list, "msix_table", msix_table, msix_nvec * 16, 1);
+    new bx_shadow_data_c(list, "msix_pba", msix_pba, ((msix_nvec + 63) >> 6) * 8, 1);
+  }
 }
 
 void bx_pci_device_c::after_restore_pci_state()
@@ -1747,6 +1801,266 @@ void bx_pci_device_c::load_pci_rom(const char *path, memory_handler_t mem_read_h
   BX_INFO(("loaded PCI ROM '%s' (size=%u / PCI=%uk)", path, (unsigned) stat_buf.st_size, pci_rom_size >> 10));
 }
 
+// MSI / MSI-X support
+//
+// The capabilities are inserted at the head of the capability list. The
+// MSI-X table and PBA either live in a memory BAR of their own or the device
+// forwards accesses to its BAR with msix_mmio_access(). Messages addressed to
+// the local APIC range are delivered on the APIC bus, all others are written
+// to memory like on real hardware.
+
+#define BX_MSI_CAP_ID      0x05
+#define BX_MSIX_CAP_ID     0x11
+#define BX_MSI_ADDR_BASE   0xfee00000
+
+static Bit32u msi_get_dword(const Bit8u *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((Bit32u)p[3] << 24);
+}
+
+void bx_pci_device_c::init_msi(Bit8u cap, unsigned nvec, bool pvm)
+{
+#if BX_SUPPORT_APIC
+  Bit8u mmc = 0;
+
+  while ((mmc < 5) && ((1U << mmc) < nvec)) mmc++;
+  msi_cap = cap;
+  msi_len = pvm ? 0x18 : 0x10;
+  memset(&pci_conf[cap], 0, msi_len);
+  pci_conf[cap] = BX_MSI_CAP_ID;
+  pci_conf[cap + 1] = pci_conf[0x34];
+  pci_conf[cap + 2] = 0x80 | (mmc << 1); // 64-bit address capable
+  pci_conf[cap + 3] = pvm ? 0x01 : 0x00;
+  pci_conf[0x34] = cap;
+  pci_conf[0x06] |= 0x10;
+#endif
+}
+
+void bx_pci_device_c::init_msix(Bit8u cap, unsigned nvec, Bit8u bar, Bit32u table_offset, Bit32u pba_offset)
+{
+#if BX_SUPPORT_APIC
+  Bit32u size;
+
+  if ((nvec == 0) || (nvec > 2048) || (bar > 5)) {
+    BX_PANIC(("%s: invalid MSI-X configuration", pci_name));
+    return;
+  }
+  msix_cap = cap;
+  msix_nvec = nvec;
+  msix_bar = bar;
+  msix_table_offset = table_offset;
+  msix_pba_offset = pba_offset;
+  msix_table = new Bit8u[nvec * 16];
+  msix_pba = new Bit8u[((nvec + 63) >> 6) * 8];
+  memset(&pci_conf[cap], 0, 12);
+  pci_conf[cap] = BX_MSIX_CAP_ID;
+  pci_conf[cap + 1] = pci_conf[0x34];
+  pci_conf[cap + 2] = (Bit8u)((nvec - 1) & 0xff);
+  pci_conf[cap + 3] = (Bit8u)((nvec - 1) >> 8);
+  for (int i = 0; i < 4; i++) {
+    pci_conf[cap + 4 + i] = (Bit8u)(((table_offset & ~7) | bar) >> (i * 8));
+    pci_conf[cap + 8 + i] = (Bit8u)(((pba_offset & ~7) | bar) >> (i * 8));
+  }
+  pci_conf[0x34] = cap;
+  pci_conf[0x06] |= 0x10;
+  if (pci_bar[bar].type == BX_PCI_BAR_TYPE_NONE) {
+    // the table gets a memory BAR of its own
+    size = 0x1000;
+    while ((size < (table_offset + nvec * 16)) ||
+           (size < (pba_offset + ((nvec + 63) >> 6) * 8))) {
+      size <<= 1;
+    }
+    init_bar_mem(bar, size, msix_read_handler, msix_write_handler);
+  }
+  pci_msi_reset();
+#endif
+}
+
+void bx_pci_device_c::pci_msi_reset(void)
+{
+  if (msi_cap != 0) {
+    pci_conf[msi_cap + 2] &= 0x8e;
+    memset(&pci_conf[msi_cap + 4], 0, msi_len - 4);
+  }
+  if (msix_cap != 0) {
+    pci_conf[msix_cap + 3] &= 0x07;
+    memset(msix_table, 0, msix_nvec * 16);
+    for (unsigned i = 0; i < msix_nvec; i++) {
+      msix_table[i * 16 + 12] = 0x01; // vector masked
+    }
+    memset(msix_pba, 0, ((msix_nvec + 63) >> 6) * 8);
+  }
+}
+
+bool bx_pci_device_c::pci_msi_enabled(void) const
+{
+  if ((msix_cap != 0) && ((pci_conf[msix_cap + 3] & 0x80) != 0))
+    return true;
+  return ((msi_cap != 0) && ((pci_conf[msi_cap + 2] & 0x01) != 0));
+}
+
+void bx_pci_device_c::pci_msi_notify(unsigned vector)
+{
+  Bit8u *entry;
+  Bit32u data, mask;
+
+  if ((msix_cap != 0) && ((pci_conf[msix_cap + 3] & 0x80) != 0)) {
+    if (vector >= msix_nvec) {
+      BX_ERROR(("%s: MSI-X vector %u out of range", pci_name, vector));
+      return;
+    }
+    entry = &msix_table[vector * 16];
+    if (((pci_conf[msix_cap + 3] & 0x40) != 0) || ((entry[12] & 0x01) != 0)) {
+      msix_pba[vector >> 3] |= (1 << (vector & 7));
+    } else {
+      msi_send(msi_get_dword(entry) | ((Bit64u)msi_get_dword(entry + 4) << 32),
+               msi_get_dword(entry + 8));
+    }
+  } else if ((msi_cap != 0) && ((pci_conf[msi_cap + 2] & 0x01) != 0)) {
+    // vectors beyond the allocated count share the last ones
+    mask = (1 << ((pci_conf[msi_cap + 2] >> 4) & 0x07)) - 1;
+    vector &= mask;
+    if ((msi_len > 0x10) && ((pci_conf[msi_cap + 0x10 + (vector >> 3)] >> (vector & 7)) & 1)) {
+      pci_conf[msi_cap + 0x14 + (vector >> 3)] |= (1 << (vector & 7));
+      return;
+    }
+    data = pci_conf[msi_cap + 0x0c] | (pci_conf[msi_cap + 0x0d] << 8);
+    msi_send(msi_get_dword(&pci_conf[msi_cap + 4]) |
+             ((Bit64u)msi_get_dword(&pci_conf[msi_cap + 8]) << 32),
+             (data & ~mask) | vector);
+  }
+}
+
+void bx_pci_device_c::msi_send(Bit64u addr, Bit32u data)
+{
+  // a message is a memory write, which requires bus mastering
+  if ((pci_conf[0x04] & 0x04) == 0) {
+    BX_DEBUG(("%s: MSI dropped, bus master disabled", pci_name));
+    return;
+  }
+#if BX_SUPPORT_APIC
+  if ((addr & 0xfff00000) == BX_MSI_ADDR_BASE) {
+    BX_DEBUG(("%s: MSI address=0x%08x data=0x%04x", pci_name, (Bit32u)addr, data));
+    apic_bus_deliver_interrupt((Bit8u)(data & 0xff), (apic_dest_t)((addr >> 12) & 0xff),
+                               (Bit8u)((data >> 8) & 0x07), (addr & 0x04) != 0,
+                               (data & 0x4000) != 0, (data & 0x8000) != 0);
+    return;
+  }
+#endif
+  Bit8u buf[4];
+  for (int i = 0; i < 4; i++) buf[i] = (Bit8u)(data >> (i * 8));
+  DEV_MEM_WRITE_PHYSICAL_DMA((bx_phy_address)addr, 4, buf);
+}
+
+void bx_pci_device_c::msix_deliver_pending(void)
+{
+  if ((pci_conf[msix_cap + 3] & 0xc0) != 0x80)
+    return;
+  for (unsigned i = 0; i < msix_nvec; i++) {
+    if ((msix_pba[i >> 3] & (1 << (i & 7))) && !(msix_table[i * 16 + 12] & 0x01)) {
+      msix_pba[i >> 3] &= ~(1 << (i & 7));
+      pci_msi_notify(i);
+    }
+  }
+}
+
+// pci configuration space write to the MSI / MSI-X capabilities
+void bx_pci_device_c::msi_write(Bit8u address, Bit8u value)
+{
+  Bit8u offset, oldval, pending;
+
+  if ((msi_cap != 0) && (address >= msi_cap) && (address < (msi_cap + msi_len))) {
+    offset = address - msi_cap;
+    switch (offset) {
+      case 0x02: // enable, multiple message enable
+        pci_conf[address] = (pci_conf[address] & 0x8e) | (value & 0x71);
+        if (((pci_conf[address] >> 4) & 0x07) > ((pci_conf[address] >> 1) & 0x07)) {
+          pci_conf[address] = (pci_conf[address] & 0x8f) | (pci_conf[address] & 0x0e) << 3;
+        }
+        break;
+      case 0x04:
+        pci_conf[address] = value & 0xfc;
+        break;
+      case 0x05: case 0x06: case 0x07: // address
+      case 0x08: case 0x09: case 0x0a: case 0x0b:
+      case 0x0c: case 0x0d: // data
+        pci_conf[address] = value;
+        break;
+      case 0x10: case 0x11: case 0x12: case 0x13: // mask bits
+        oldval = pci_conf[address];
+        pci_conf[address] = value;
+        pending = oldval & ~value & pci_conf[address + 4];
+        pci_conf[address + 4] &= ~pending;
+        for (unsigned i = 0; i < 8; i++) {
+          if (pending & (1 << i)) pci_msi_notify((offset - 0x10) * 8 + i);
+        }
+        break;
+      default: // read-only
+        break;
+    }
+  } else if ((msix_cap != 0) && (address >= msix_cap) && (address < (msix_cap + 12))) {
+    if (address == (msix_cap + 3)) {
+      // enable, function mask
+      pci_conf[address] = (pci_conf[address] & 0x07) | (value & 0xc0);
+      msix_deliver_pending();
+    }
+  }
+}
+
+bool bx_pci_device_c::msix_mmio_access(Bit32u offset, unsigned len, void *data, bool write)
+{
+  Bit8u *data_ptr = (Bit8u*)data;
+  Bit32u tsize = msix_nvec * 16, psize = ((msix_nvec + 63) >> 6) * 8;
+  Bit8u oldval;
+
+  if (msix_cap == 0)
+    return false;
+  if ((offset >= msix_table_offset) && (offset < (msix_table_offset + tsize))) {
+    offset -= msix_table_offset;
+    for (unsigned i = 0; (i < len) && (offset < tsize); i++, offset++) {
+      if (!write) {
+        data_ptr[i] = msix_table[offset];
+      } else if ((offset & 0x0f) < 12) {
+        msix_table[offset] = data_ptr[i];
+      } else if ((offset & 0x0f) == 12) {
+        oldval = msix_table[offset];
+        msix_table[offset] = data_ptr[i] & 0x01;
+        if ((oldval & 0x01) && !(data_ptr[i] & 0x01)) {
+          msix_deliver_pending();
+        }
+      }
+    }
+    return true;
+  }
+  if ((offset >= msix_pba_offset) && (offset < (msix_pba_offset + psize))) {
+    offset -= msix_pba_offset;
+    for (unsigned i = 0; (i < len) && (offset < psize); i++, offset++) {
+      if (!write) {
+        data_ptr[i] = msix_pba[offset];
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+bool bx_pci_device_c::msix_read_handler(bx_phy_address addr, unsigned len, void *data, void *param)
+{
+  bx_pci_device_c *dev = (bx_pci_device_c*)param;
+
+  memset(data, 0, len);
+  dev->msix_mmio_access((Bit32u)(addr - dev->pci_bar[dev->msix_bar].addr), len, data, 0);
+  return 1;
+}
+
+bool bx_pci_device_c::msix_write_handler(bx_phy_address addr, unsigned len, void *data, void *param)
+{
+  bx_pci_device_c *dev = (bx_pci_device_c*)param;
+
+  dev->msix_mmio_access((Bit32u)(addr - dev->pci_bar[dev->msix_bar].addr), len, data, 1);
+  return 1;
+}
+
 // pci configuration space write callback handler (common registers)
 void bx_pci_device_c::pci_write_handler_common(Bit8u address, Bit32u value, unsigned io_len)
 {
@@ -1761,6 +2075,16 @@ void bx_pci_device_c::pci_write_handler_common(Bit8u address, Bit32u value, unsi
     return;
   }
 
+  // handle MSI / MSI-X capability registers
+  if (((msi_cap != 0) && (address >= msi_cap) && (address < (msi_cap + msi_len))) ||
+      ((msix_cap != 0) && (address >= msix_cap) && (address < (msix_cap + 12)))) {
+    BX_DEBUG_PCI_WRITE(address, value, io_len);
+    for (i = 0; i < io_len; i++) {
+      msi_write(address + i, (value >> (i*8)) & 0xff);
+    }
+    return;
+  }
+
   // handle base address registers if header type bit #0 and #1 are clear
   if (((pci_conf[0x0e] & 0x03) == 0) && (address >= 0x10) && (address < 0x28)) {
     bnum = ((address - 0x10) >> 2);
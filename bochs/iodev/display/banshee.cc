@@ -754,6 +754,13 @@ bool bx_banshee_c::update(void)
       BX_UNLOCK(render_mutex);
       return false;
     }
+    // convert the pages written since the last update into dirty tiles
+    if (fb_dirty.is_dirty()) {
+      fb_dirty.mark_tiles(start, pitch, bpp >> 3, iWidth, iHeight,
+                          v->banshee.double_width, v->banshee.half_mode,
+                          s.vga_tile_updated, s.num_x_tiles, s.num_y_tiles);
+      fb_dirty.clear();
+    }
     if (bx_gui->graphics_tile_info_common(&info)) {
       if (info.snapshot_mode) {
         vid_ptr = disp_ptr;
@@ -1731,8 +1738,9 @@ void bx_banshee_c::mem_write_linear(Bit32u offset, Bit64u value, unsigned len)
     start = v->banshee.io[io_vidDesktopStartAddr] & v->fbi.mask;
     pitch = v->banshee.io[io_vidDesktopOverlayStride] & 0x7fff;
   }
-  unsigned i, w, x, y;
+  unsigned i, x, y;
 #ifdef BANSHEE_TILED_FB
+  unsigned w;
   bool tiled_xy = false;
 #endif
 
@@ -1762,23 +1770,14 @@ void bx_banshee_c::mem_write_linear(Bit32u offset, Bit64u value, unsigned len)
       if (tiled_xy) {
         x /= (v->banshee.disp_bpp >> 3);
         w = len / (v->banshee.disp_bpp >> 3);
+        if (w == 0) w = 1;
+        theVoodooVga->redraw_area(x, y, w, 1);
       } else
 #endif
       {
-        offset -= start;
-        x = (offset % pitch) / (v->banshee.disp_bpp >> 3);
-        y = offset / pitch;
-        w = len / (v->banshee.disp_bpp >> 3);
-        if (v->banshee.half_mode) {
-          y <<= 1;
-        }
-        if (v->banshee.double_width) {
-          x <<= 1;
-          w <<= 1;
-        }
+        // the display update finds out if the page is 'onscreen'
+        fb_dirty.set_dirty(offset, len);
       }
-      if (w == 0) w = 1;
-      theVoodooVga->redraw_area(x, y, w, 1);
     }
   }
   BX_UNLOCK(render_mutex);
@@ -1949,6 +1948,9 @@ void bx_banshee_c::yuv_planar_write(Bit32u offset, Bit32u value)
 
 #define BLT v->banshee.blt
 
+// multiple of all destination pixel sizes (1 - 4 bytes)
+#define BLT_FILL_ROW_SIZE 3072
+
 Bit32u bx_banshee_c::blt_reg_read(Bit8u reg)
 {
   Bit32u result = 0;
@@ -2699,6 +2701,26 @@ void bx_banshee_c::blt_rectangle_fill()
   }
   BX_LOCK(render_mutex);
   dst_ptr = &v->fbi.ram[dbase + dy * dpitch + dx * dpxsize];
+#ifdef BANSHEE_TILED_FB
+  if (((colorkey_en & 2) == 0) && !BLT.dst_tiled) {
+#else
+  if ((colorkey_en & 2) == 0) {
+#endif
+    // no per-pixel decision: apply the ROP to the whole rectangle in
+    // column chunks, using a row of the fill color as source
+    Bit8u fill_row[BLT_FILL_ROW_SIZE];
+    int rowbytes = w * dpxsize, len;
+    for (x = 0; x < BLT_FILL_ROW_SIZE; x += dpxsize) {
+      memcpy(&fill_row[x], BLT.fgcolor, dpxsize);
+    }
+    for (x = 0; x < rowbytes; x += len) {
+      len = BX_MIN(rowbytes - x, BLT_FILL_ROW_SIZE);
+      BLT.rop_fn[0](dst_ptr + x, fill_row, dpitch, 0, len, h);
+    }
+    blt_complete();
+    BX_UNLOCK(render_mutex);
+    return;
+  }
   for (y = 0; y < h; y++) {
     dst_ptr1 = dst_ptr;
     for (x = 0; x < w; x++) {
@@ -4286,4 +4308,12 @@ void bx_voodoo_vga_c::mem_write(bx_phy_address addr, Bit8u value)
   }
 }
 
+bool bx_voodoo_vga_c::mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data)
+{
+  if ((v->banshee.io[io_vgaInit1] >> 20) & 1) {
+    return 0;
+  }
+  return bx_vgacore_c::mem_write_block(addr, len, data);
+}
+
 #endif // BX_SUPPORT_PCI && BX_SUPPORT_VOODOO
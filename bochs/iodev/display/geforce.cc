@@ -761,18 +761,7 @@ void bx_geforce_c::mem_write(bx_phy_address addr, Bit8u value)
       (addr < (BX_GEFORCE_THIS pci_bar[1].addr + BX_GEFORCE_THIS s.memsize))) {
     Bit32u offset = addr & BX_GEFORCE_THIS memsize_mask;
     BX_GEFORCE_THIS s.memory[offset] = value;
-    if (offset < BX_GEFORCE_THIS disp_end_offset &&
-        offset >= BX_GEFORCE_THIS disp_offset) {
-      BX_GEFORCE_THIS svga_needs_update_tile = 1;
-      offset -= BX_GEFORCE_THIS disp_offset;
-      Bit32u x = (offset % BX_GEFORCE_THIS svga_pitch) / (BX_GEFORCE_THIS svga_bpp / 8);
-      Bit32u y = offset / BX_GEFORCE_THIS svga_pitch;
-      if (BX_GEFORCE_THIS s.y_doublescan)
-        y <<= 1;
-      if (BX_GEFORCE_THIS svga_double_width)
-        x <<= 1;
-      SET_TILE_UPDATED(BX_GEFORCE_THIS, x / X_TILESIZE, y / Y_TILESIZE, 1);
-    }
+    BX_GEFORCE_THIS fb_dirty.set_dirty(offset, 1);
     return;
   }
 
@@ -790,15 +779,16 @@ void bx_geforce_c::mem_write(bx_phy_address addr, Bit8u value)
     offset += BX_GEFORCE_THIS bank_base[0];
     offset &= BX_GEFORCE_THIS memsize_mask;
     BX_GEFORCE_THIS s.memory[offset] = value;
-    BX_GEFORCE_THIS svga_needs_update_tile = 1;
-    unsigned x = (offset % BX_GEFORCE_THIS svga_pitch) / (BX_GEFORCE_THIS svga_bpp / 8);
-    unsigned y = offset / BX_GEFORCE_THIS svga_pitch;
-    if (BX_GEFORCE_THIS s.y_doublescan)
-      y <<= 1;
-    if (BX_GEFORCE_THIS svga_double_width)
-      x <<= 1;
-    SET_TILE_UPDATED(BX_GEFORCE_THIS, x / X_TILESIZE, y / Y_TILESIZE, 1);
+    BX_GEFORCE_THIS fb_dirty.set_dirty(offset, 1);
+  }
+}
+
+bool bx_geforce_c::mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data)
+{
+  if ((addr < 0xA0000) || (addr > 0xBFFFF) || BX_GEFORCE_THIS crtc.reg[0x28]) {
+    return false;
   }
+  return BX_GEFORCE_THIS bx_vgacore_c::mem_write_block(addr, len, data);
 }
 
 void bx_geforce_c::get_text_snapshot(Bit8u **text_snapshot,
@@ -1362,6 +1352,19 @@ void bx_geforce_c::update(void)
     BX_GEFORCE_THIS svga_needs_update_dispentire = 0;
   }
 
+  // convert the pages written since the last update into dirty tiles
+  if (BX_GEFORCE_THIS fb_dirty.is_dirty()) {
+    if ((BX_GEFORCE_THIS svga_dispbpp != 4) &&
+        BX_GEFORCE_THIS fb_dirty.mark_tiles(BX_GEFORCE_THIS disp_offset, pitch,
+          BX_GEFORCE_THIS svga_bpp >> 3, width, height,
+          BX_GEFORCE_THIS svga_double_width, BX_GEFORCE_THIS s.y_doublescan,
+          BX_GEFORCE_THIS s.vga_tile_updated, BX_GEFORCE_THIS s.num_x_tiles,
+          BX_GEFORCE_THIS s.num_y_tiles)) {
+      BX_GEFORCE_THIS svga_needs_update_tile = 1;
+    }
+    BX_GEFORCE_THIS fb_dirty.clear();
+  }
+
   if (!BX_GEFORCE_THIS svga_needs_update_tile)
     return;
 
@@ -1475,6 +1478,61 @@ void bx_geforce_c::update(void)
           }
           break;
       }
+    } else if (bx_vga_tile_is_xrgb32(&info) && (BX_GEFORCE_THIS svga_dispbpp != 4) &&
+               !BX_GEFORCE_THIS svga_double_width) {
+      Bit32u palette[256];
+      unsigned bytespp = BX_GEFORCE_THIS svga_bpp >> 3;
+      if (BX_GEFORCE_THIS svga_dispbpp == 8) {
+        hp = BX_GEFORCE_THIS s.attribute_ctrl.horiz_pel_panning & 0x07;
+        for (i = 0; i < 256; i++) {
+          palette[i] = MAKE_COLOUR(
+            BX_GEFORCE_THIS s.pel.data[i].red, dac_size, 24, 0xff0000,
+            BX_GEFORCE_THIS s.pel.data[i].green, dac_size, 16, 0x00ff00,
+            BX_GEFORCE_THIS s.pel.data[i].blue, dac_size, 8, 0x0000ff);
+        }
+      } else if (BX_GEFORCE_THIS svga_dispbpp <= 16) {
+        hp = BX_GEFORCE_THIS s.attribute_ctrl.horiz_pel_panning & 0x01;
+      } else {
+        hp = 0;
+      }
+      for (yc=0, yti = 0; yc<height; yc+=Y_TILESIZE, yti++) {
+        for (xc=0, xti = 0; xc<width; xc+=X_TILESIZE, xti++) {
+          if (GET_TILE_UPDATED (xti, yti)) {
+            if (!BX_GEFORCE_THIS s.y_doublescan) {
+              vid_ptr = BX_GEFORCE_THIS disp_ptr + (yc * pitch + (xc + hp) * bytespp);
+            } else {
+              vid_ptr = BX_GEFORCE_THIS disp_ptr + ((yc >> 1) * pitch + (xc + hp) * bytespp);
+            }
+            tile_ptr = bx_gui->graphics_tile_get(xc, yc, &w, &h);
+            for (r=0; r<h; r++) {
+              switch (BX_GEFORCE_THIS svga_dispbpp) {
+                case 8:
+                  bx_vga_convert_8bpp((Bit32u*)tile_ptr, vid_ptr, w, palette);
+                  break;
+                case 15:
+                  bx_vga_convert_15bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+                case 16:
+                  bx_vga_convert_16bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+                case 24:
+                  bx_vga_convert_24bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+                case 32:
+                  bx_vga_convert_32bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+              }
+              if (!BX_GEFORCE_THIS s.y_doublescan || (r & 1)) {
+                vid_ptr += pitch;
+              }
+              tile_ptr += info.pitch;
+            }
+            draw_hardware_cursor(xc, yc, &info);
+            bx_gui->graphics_tile_update_in_place(xc, yc, w, h);
+            SET_TILE_UPDATED(BX_GEFORCE_THIS, xti, yti, 0);
+          }
+        }
+      }
     }
     else {
       switch (BX_GEFORCE_THIS svga_dispbpp) {
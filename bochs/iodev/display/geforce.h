@@ -394,6 +394,7 @@ public:
   void redraw_area_nd(Bit32u offset, Bit32u width, Bit32u height);
   virtual Bit8u mem_read(bx_phy_address addr);
   virtual void mem_write(bx_phy_address addr, Bit8u value);
+  virtual bool mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data);
   virtual void get_text_snapshot(Bit8u **text_snapshot,
                                  unsigned *txHeight, unsigned *txWidth);
   virtual void register_state(void);
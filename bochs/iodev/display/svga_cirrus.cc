@@ -214,6 +214,54 @@
 
 static bx_svga_cirrus_c *theSvga = NULL;
 
+// color expansion byte masks for 1, 2 and 4 bytes per pixel
+// (the most significant source bit selects the first byte)
+static Bit64u colorexp_mask[3][256];
+
+static void cirrus_init_colorexp_masks()
+{
+  Bit8u bytes[8];
+  int i, b;
+
+  for (i = 0; i < 256; i++) {
+    for (b = 0; b < 8; b++)
+      bytes[b] = (i & (0x80 >> b)) ? 0xff : 0x00;
+    memcpy(&colorexp_mask[0][i], bytes, 8);
+  }
+  for (i = 0; i < 16; i++) {
+    for (b = 0; b < 8; b++)
+      bytes[b] = (i & (0x08 >> (b >> 1))) ? 0xff : 0x00;
+    memcpy(&colorexp_mask[1][i], bytes, 8);
+  }
+  for (i = 0; i < 4; i++) {
+    for (b = 0; b < 8; b++)
+      bytes[b] = (i & (0x02 >> (b >> 2))) ? 0xff : 0x00;
+    memcpy(&colorexp_mask[2][i], bytes, 8);
+  }
+}
+
+static Bit64u cirrus_color_word(const Bit8u *color, int pixelwidth)
+{
+  Bit8u bytes[8];
+  Bit64u word;
+
+  for (int b = 0; b < 8; b++)
+    bytes[b] = color[b % pixelwidth];
+  memcpy(&word, bytes, 8);
+  return word;
+}
+
+// fill 'count' bytes (rounded up to whole pixels) with a solid color
+static int cirrus_fill_color_row(Bit8u *row, const Bit8u *color, int pixelwidth, int count)
+{
+  int x;
+
+  for (x = 0; x < count; x += pixelwidth) {
+    memcpy(row + x, color, pixelwidth);
+  }
+  return x;
+}
+
 PLUGIN_ENTRY_FOR_MODULE(svga_cirrus)
 {
   if (mode == PLUGIN_INIT) {
@@ -247,6 +295,7 @@ bool bx_svga_cirrus_c::init_vga_extension(void)
   // initialize SVGA stuffs.
   BX_CIRRUS_THIS bx_vgacore_c::init_iohandlers(svga_read_handler, svga_write_handler, "cirrus");
   BX_CIRRUS_THIS pci_enabled = SIM->is_pci_device("cirrus");
+  cirrus_init_colorexp_masks();
   BX_CIRRUS_THIS svga_init_members();
 #if BX_SUPPORT_PCI
   if (BX_CIRRUS_THIS pci_enabled)
@@ -765,6 +814,11 @@ bool bx_svga_cirrus_c::cirrus_mem_write_handler(bx_phy_address addr, unsigned le
 #endif
     }
   } else {
+#ifdef BX_LITTLE_ENDIAN
+    if ((len > 1) && BX_CIRRUS_THIS mem_write_block(addr, len, data_ptr)) {
+      return 1;
+    }
+#endif
     for (unsigned i = 0; i < len; i++) {
       BX_CIRRUS_THIS mem_write(addr, *data_ptr);
       addr++;
@@ -783,8 +837,6 @@ void bx_svga_cirrus_c::mem_write(bx_phy_address addr, Bit8u value)
 {
 #if BX_SUPPORT_PCI
   if (BX_CIRRUS_THIS pci_enabled) {
-    unsigned x, y;
-
     if ((addr >= BX_CIRRUS_THIS pci_bar[0].addr) &&
         (addr < (BX_CIRRUS_THIS pci_bar[0].addr + CIRRUS_PNPMEM_SIZE))) {
 
@@ -811,27 +863,16 @@ void bx_svga_cirrus_c::mem_write(bx_phy_address addr, Bit8u value)
       Bit8u mode = BX_CIRRUS_THIS control.reg[0x05] & 0x07;
       if ((mode < 4) || (mode > 5) || ((BX_CIRRUS_THIS control.reg[0x0b] & 0x4) == 0)) {
         *(BX_CIRRUS_THIS s.memory + offset) = value;
+        BX_CIRRUS_THIS fb_dirty.set_dirty(offset, 1);
       } else {
         if ((BX_CIRRUS_THIS control.reg[0x0b] & 0x14) != 0x14) {
           mem_write_mode4and5_8bpp(mode, offset, value);
+          BX_CIRRUS_THIS fb_dirty.set_dirty(offset, 8);
         } else {
           mem_write_mode4and5_16bpp(mode, offset, value);
+          BX_CIRRUS_THIS fb_dirty.set_dirty(offset, 16);
         }
       }
-      Bit32u dstart = (Bit32u)(BX_CIRRUS_THIS disp_ptr - BX_CIRRUS_THIS s.memory);
-      if (offset >= dstart) {
-        BX_CIRRUS_THIS svga_needs_update_tile = 1;
-        offset -= dstart;
-        x = (offset % BX_CIRRUS_THIS svga_pitch) / (BX_CIRRUS_THIS svga_bpp / 8);
-        y = offset / BX_CIRRUS_THIS svga_pitch;
-        if (BX_CIRRUS_THIS s.y_doublescan) {
-          y <<= 1;
-        }
-        if (BX_CIRRUS_THIS svga_double_width) {
-          x <<= 1;
-        }
-        SET_TILE_UPDATED(BX_CIRRUS_THIS, x / X_TILESIZE, y / Y_TILESIZE, 1);
-      }
       return;
     } else if ((addr >= BX_CIRRUS_THIS pci_bar[1].addr) &&
                (addr < (BX_CIRRUS_THIS pci_bar[1].addr + CIRRUS_PNPMMIO_SIZE))) {
@@ -860,7 +901,6 @@ void bx_svga_cirrus_c::mem_write(bx_phy_address addr, Bit8u value)
   if (addr >= 0xA0000 && addr <= 0xAFFFF) {
     Bit32u bank, offset;
     Bit8u mode;
-    unsigned x, y;
 
     // cpu-to-video BLT
     if (BX_CIRRUS_THIS bitblt.memsrc_needed > 0) {
@@ -885,27 +925,16 @@ void bx_svga_cirrus_c::mem_write(bx_phy_address addr, Bit8u value)
       mode = BX_CIRRUS_THIS control.reg[0x05] & 0x07;
       if ((mode < 4) || (mode > 5) || ((BX_CIRRUS_THIS control.reg[0x0b] & 0x4) == 0)) {
         *(BX_CIRRUS_THIS s.memory + offset) = value;
+        BX_CIRRUS_THIS fb_dirty.set_dirty(offset, 1);
       } else {
         if ((BX_CIRRUS_THIS control.reg[0x0b] & 0x14) != 0x14) {
           mem_write_mode4and5_8bpp(mode, offset, value);
+          BX_CIRRUS_THIS fb_dirty.set_dirty(offset, 8);
         } else {
           mem_write_mode4and5_16bpp(mode, offset, value);
+          BX_CIRRUS_THIS fb_dirty.set_dirty(offset, 16);
         }
       }
-      Bit32u dstart = (Bit32u)(BX_CIRRUS_THIS disp_ptr - BX_CIRRUS_THIS s.memory);
-      if (offset >= dstart) {
-        BX_CIRRUS_THIS svga_needs_update_tile = 1;
-        offset -= dstart;
-        x = (offset % BX_CIRRUS_THIS svga_pitch) / (BX_CIRRUS_THIS svga_bpp / 8);
-        y = offset / BX_CIRRUS_THIS svga_pitch;
-        if (BX_CIRRUS_THIS s.y_doublescan) {
-          y <<= 1;
-        }
-        if (BX_CIRRUS_THIS svga_double_width) {
-          x <<= 1;
-        }
-        SET_TILE_UPDATED(BX_CIRRUS_THIS, x / X_TILESIZE, y / Y_TILESIZE, 1);
-      }
     }
   } else if (addr >= 0xB8000 && addr < 0xB8100) {
     // memory-mapped I/O.
@@ -918,6 +947,17 @@ void bx_svga_cirrus_c::mem_write(bx_phy_address addr, Bit8u value)
   }
 }
 
+bool bx_svga_cirrus_c::mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data)
+{
+  // only the standard VGA modes without Cirrus extensions
+  if ((addr < 0xA0000) || (addr > 0xBFFFF) ||
+      ((BX_CIRRUS_THIS sequencer.reg[0x07] & 0x01) != CIRRUS_SR7_BPP_VGA) ||
+      ((BX_CIRRUS_THIS control.reg[0x0b] & 0x1f) != 0)) {
+    return 0;
+  }
+  return BX_CIRRUS_THIS bx_vgacore_c::mem_write_block(addr, len, data);
+}
+
 void bx_svga_cirrus_c::vga_mem_write(bx_phy_address addr, Bit8u value)
 {
   Bit32u offset;
@@ -1744,6 +1784,19 @@ void bx_svga_cirrus_c::update(void)
     BX_CIRRUS_THIS svga_needs_update_dispentire = 0;
   }
 
+  // convert the pages written since the last update into dirty tiles
+  if (BX_CIRRUS_THIS fb_dirty.is_dirty()) {
+    if ((BX_CIRRUS_THIS svga_dispbpp != 4) &&
+        BX_CIRRUS_THIS fb_dirty.mark_tiles((Bit32u)(BX_CIRRUS_THIS disp_ptr - BX_CIRRUS_THIS s.memory),
+          pitch, BX_CIRRUS_THIS svga_bpp >> 3, width, height,
+          BX_CIRRUS_THIS svga_double_width, BX_CIRRUS_THIS s.y_doublescan,
+          BX_CIRRUS_THIS s.vga_tile_updated, BX_CIRRUS_THIS s.num_x_tiles,
+          BX_CIRRUS_THIS s.num_y_tiles)) {
+      BX_CIRRUS_THIS svga_needs_update_tile = 1;
+    }
+    BX_CIRRUS_THIS fb_dirty.clear();
+  }
+
   if (!BX_CIRRUS_THIS svga_needs_update_tile) {
     return;
   }
@@ -1857,6 +1910,61 @@ void bx_svga_cirrus_c::update(void)
           }
           break;
       }
+    } else if (bx_vga_tile_is_xrgb32(&info) && (BX_CIRRUS_THIS svga_dispbpp != 4) &&
+               !BX_CIRRUS_THIS svga_double_width) {
+      Bit32u palette[256];
+      unsigned bytespp = BX_CIRRUS_THIS svga_bpp >> 3;
+      if (BX_CIRRUS_THIS svga_dispbpp == 8) {
+        hp = BX_CIRRUS_THIS s.attribute_ctrl.horiz_pel_panning & 0x07;
+        for (i = 0; i < 256; i++) {
+          palette[i] = MAKE_COLOUR(
+            BX_CIRRUS_THIS s.pel.data[i].red, 6, 24, 0xff0000,
+            BX_CIRRUS_THIS s.pel.data[i].green, 6, 16, 0x00ff00,
+            BX_CIRRUS_THIS s.pel.data[i].blue, 6, 8, 0x0000ff);
+        }
+      } else if (BX_CIRRUS_THIS svga_dispbpp <= 16) {
+        hp = BX_CIRRUS_THIS s.attribute_ctrl.horiz_pel_panning & 0x01;
+      } else {
+        hp = 0;
+      }
+      for (yc=0, yti = 0; yc<height; yc+=Y_TILESIZE, yti++) {
+        for (xc=0, xti = 0; xc<width; xc+=X_TILESIZE, xti++) {
+          if (GET_TILE_UPDATED (xti, yti)) {
+            if (!BX_CIRRUS_THIS s.y_doublescan) {
+              vid_ptr = BX_CIRRUS_THIS disp_ptr + (yc * pitch + (xc + hp) * bytespp);
+            } else {
+              vid_ptr = BX_CIRRUS_THIS disp_ptr + ((yc >> 1) * pitch + (xc + hp) * bytespp);
+            }
+            tile_ptr = bx_gui->graphics_tile_get(xc, yc, &w, &h);
+            for (r=0; r<h; r++) {
+              switch (BX_CIRRUS_THIS svga_dispbpp) {
+                case 8:
+                  bx_vga_convert_8bpp((Bit32u*)tile_ptr, vid_ptr, w, palette);
+                  break;
+                case 15:
+                  bx_vga_convert_15bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+                case 16:
+                  bx_vga_convert_16bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+                case 24:
+                  bx_vga_convert_24bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+                case 32:
+                  bx_vga_convert_32bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                  break;
+              }
+              if (!BX_CIRRUS_THIS s.y_doublescan || (r & 1)) {
+                vid_ptr += pitch;
+              }
+              tile_ptr += info.pitch;
+            }
+            draw_hardware_cursor(xc, yc, &info);
+            bx_gui->graphics_tile_update_in_place(xc, yc, w, h);
+            SET_TILE_UPDATED(BX_CIRRUS_THIS, xti, yti, 0);
+          }
+        }
+      }
     }
     else {
       switch (BX_CIRRUS_THIS svga_dispbpp) {
@@ -3129,6 +3237,7 @@ void bx_svga_cirrus_c::svga_reset_bitblt(void)
 {
   BX_CIRRUS_THIS control.reg[0x31] &= ~(CIRRUS_BLT_START|CIRRUS_BLT_BUSY|CIRRUS_BLT_FIFOUSED);
   BX_CIRRUS_THIS bitblt.rop_handler = NULL;
+  BX_CIRRUS_THIS bitblt.span_rop_handler = NULL;
   BX_CIRRUS_THIS bitblt.src = NULL;
   BX_CIRRUS_THIS bitblt.dst = NULL;
   BX_CIRRUS_THIS bitblt.memsrc_ptr = NULL;
@@ -3222,6 +3331,10 @@ void bx_svga_cirrus_c::svga_bitblt()
     goto ignoreblt;
   }
 
+  // The runs of pixels built by the fill and transparent modes are stored
+  // in ascending order, the backward ROP handlers would walk down from the
+  // start of a run outside of it.
+  BX_CIRRUS_THIS bitblt.span_rop_handler = svga_get_fwd_rop_handler(BX_CIRRUS_THIS bitblt.bltrop);
   if ((BX_CIRRUS_THIS bitblt.bltmodeext & CIRRUS_BLTMODEEXT_SOLIDFILL) &&
       (BX_CIRRUS_THIS bitblt.bltmode & (CIRRUS_BLTMODE_MEMSYSDEST |
                              CIRRUS_BLTMODE_TRANSPARENTCOMP |
@@ -3419,19 +3532,27 @@ void bx_svga_cirrus_c::svga_colorexpand_8(Bit8u *dst,const Bit8u *src,int count)
   Bit8u colors[2];
   unsigned bits;
   unsigned bitmask;
+  Bit64u bg, fg, mask, pixels;
+  int x;
 
   colors[0] = BX_CIRRUS_THIS control.shadow_reg0;
   colors[1] = BX_CIRRUS_THIS control.shadow_reg1;
 
-  bitmask = 0x80;
-  bits = *src++;
-  for (int x = 0; x < count; x++) {
-    if ((bitmask & 0xff) == 0) {
-      bitmask = 0x80;
-      bits = *src++;
+  bg = cirrus_color_word(&colors[0], 1);
+  fg = cirrus_color_word(&colors[1], 1);
+  for (x = 0; x <= (count - 8); x += 8) {
+    mask = colorexp_mask[0][*src++];
+    pixels = (fg & mask) | (bg & ~mask);
+    memcpy(dst, &pixels, 8);
+    dst += 8;
+  }
+  if (x < count) {
+    bitmask = 0x80;
+    bits = *src;
+    for (; x < count; x++) {
+      *dst++ = colors[!!(bits & bitmask)];
+      bitmask >>= 1;
     }
-    *dst++ = colors[!!(bits & bitmask)];
-    bitmask >>= 1;
   }
 }
 
@@ -3441,23 +3562,35 @@ void bx_svga_cirrus_c::svga_colorexpand_16(Bit8u *dst,const Bit8u *src,int count
   unsigned bits;
   unsigned bitmask;
   unsigned index;
+  Bit64u bg, fg, mask, pixels;
+  int x;
 
   colors[0][0] = BX_CIRRUS_THIS control.shadow_reg0;
   colors[0][1] = BX_CIRRUS_THIS control.reg[0x10];
   colors[1][0] = BX_CIRRUS_THIS control.shadow_reg1;
   colors[1][1] = BX_CIRRUS_THIS control.reg[0x11];
 
-  bitmask = 0x80;
-  bits = *src++;
-  for (int x = 0; x < count; x++) {
-    if ((bitmask & 0xff) == 0) {
-      bitmask = 0x80;
-      bits = *src++;
+  bg = cirrus_color_word(colors[0], 2);
+  fg = cirrus_color_word(colors[1], 2);
+  for (x = 0; x <= (count - 8); x += 8) {
+    bits = *src++;
+    mask = colorexp_mask[1][bits >> 4];
+    pixels = (fg & mask) | (bg & ~mask);
+    memcpy(dst, &pixels, 8);
+    mask = colorexp_mask[1][bits & 0x0f];
+    pixels = (fg & mask) | (bg & ~mask);
+    memcpy(dst + 8, &pixels, 8);
+    dst += 16;
+  }
+  if (x < count) {
+    bitmask = 0x80;
+    bits = *src;
+    for (; x < count; x++) {
+      index = !!(bits & bitmask);
+      *dst++ = colors[index][0];
+      *dst++ = colors[index][1];
+      bitmask >>= 1;
     }
-    index = !!(bits & bitmask);
-    *dst++ = colors[index][0];
-    *dst++ = colors[index][1];
-    bitmask >>= 1;
   }
 }
 
@@ -3496,6 +3629,8 @@ void bx_svga_cirrus_c::svga_colorexpand_32(Bit8u *dst,const Bit8u *src,int count
   unsigned bits;
   unsigned bitmask;
   unsigned index;
+  Bit64u bg, fg, mask, pixels;
+  int x, i;
 
   colors[0][0] = BX_CIRRUS_THIS control.shadow_reg0;
   colors[0][1] = BX_CIRRUS_THIS control.reg[0x10];
@@ -3506,19 +3641,28 @@ void bx_svga_cirrus_c::svga_colorexpand_32(Bit8u *dst,const Bit8u *src,int count
   colors[1][2] = BX_CIRRUS_THIS control.reg[0x13];
   colors[1][3] = BX_CIRRUS_THIS control.reg[0x15];
 
-  bitmask = 0x80;
-  bits = *src++;
-  for (int x = 0; x < count; x++) {
-    if ((bitmask & 0xff) == 0) {
-      bitmask = 0x80;
-      bits = *src++;
+  bg = cirrus_color_word(colors[0], 4);
+  fg = cirrus_color_word(colors[1], 4);
+  for (x = 0; x <= (count - 8); x += 8) {
+    bits = *src++;
+    for (i = 6; i >= 0; i -= 2) {
+      mask = colorexp_mask[2][(bits >> i) & 0x03];
+      pixels = (fg & mask) | (bg & ~mask);
+      memcpy(dst, &pixels, 8);
+      dst += 8;
+    }
+  }
+  if (x < count) {
+    bitmask = 0x80;
+    bits = *src;
+    for (; x < count; x++) {
+      index = !!(bits & bitmask);
+      *dst++ = colors[index][0];
+      *dst++ = colors[index][1];
+      *dst++ = colors[index][2];
+      *dst++ = colors[index][3];
+      bitmask >>= 1;
     }
-    index = !!(bits & bitmask);
-    *dst++ = colors[index][0];
-    *dst++ = colors[index][1];
-    *dst++ = colors[index][2];
-    *dst++ = colors[index][3];
-    bitmask >>= 1;
   }
 }
 
@@ -3559,10 +3703,11 @@ void bx_svga_cirrus_c::svga_patterncopy()
 {
   Bit8u color[4];
   Bit8u work_colorexp[256];
-  Bit8u *src, *dst;
-  Bit8u *srcc, *src2;
-  Bit32u dstaddr;
-  int x, y, pattern_x, pattern_y, srcskipleft;
+  Bit8u work_row[CIRRUS_BLT_CACHESIZE + 4];
+  Bit8u *src;
+  Bit8u *srcc;
+  Bit32u dstaddr, runaddr;
+  int x, y, pattern_x, pattern_y, srcskipleft, runbytes;
   int patternbytes = 8 * BX_CIRRUS_THIS bitblt.pixelwidth;
   int pattern_pitch = patternbytes;
   int bltbytes = BX_CIRRUS_THIS bitblt.bltwidth;
@@ -3587,24 +3732,32 @@ void bx_svga_cirrus_c::svga_patterncopy()
         bits_xor = 0x00;
       }
 
+      cirrus_fill_color_row(work_row, color, BX_CIRRUS_THIS bitblt.pixelwidth, bltbytes);
       pattern_y = BX_CIRRUS_THIS bitblt.srcaddr & 0x07;
       for (y = 0; y < BX_CIRRUS_THIS bitblt.bltheight; y++) {
         dstaddr = (BX_CIRRUS_THIS bitblt.dstaddr + pattern_x) & BX_CIRRUS_THIS memsize_mask;
         bitmask = 0x80 >> srcskipleft;
         bits = BX_CIRRUS_THIS bitblt.src[pattern_y] ^ bits_xor;
+        runaddr = dstaddr;
+        runbytes = 0;
         for (x = pattern_x; x < BX_CIRRUS_THIS bitblt.bltwidth; x+=BX_CIRRUS_THIS bitblt.pixelwidth) {
           if ((bitmask & 0xff) == 0) {
             bitmask = 0x80;
             bits = BX_CIRRUS_THIS bitblt.src[pattern_y] ^ bits_xor;
           }
-          dst = BX_CIRRUS_THIS s.memory + dstaddr;
           if (bits & bitmask) {
-            (*BX_CIRRUS_THIS bitblt.rop_handler)(
-              dst, &color[0], 0, 0, BX_CIRRUS_THIS bitblt.pixelwidth, 1);
+            if (runbytes == 0) runaddr = dstaddr;
+            runbytes += BX_CIRRUS_THIS bitblt.pixelwidth;
+          } else if (runbytes > 0) {
+            svga_rop_span(runaddr, work_row, runbytes);
+            runbytes = 0;
           }
           dstaddr = (dstaddr + BX_CIRRUS_THIS bitblt.pixelwidth) & BX_CIRRUS_THIS memsize_mask;
           bitmask >>= 1;
         }
+        if (runbytes > 0) {
+          svga_rop_span(runaddr, work_row, runbytes);
+        }
         pattern_y = (pattern_y + 1) & 7;
         BX_CIRRUS_THIS bitblt.dstaddr += BX_CIRRUS_THIS bitblt.dstpitch;
       }
@@ -3628,14 +3781,16 @@ void bx_svga_cirrus_c::svga_patterncopy()
   pattern_y = BX_CIRRUS_THIS bitblt.srcaddr & 0x07;
   src = (Bit8u *)BX_CIRRUS_THIS bitblt.src;
   for (y = 0; y < BX_CIRRUS_THIS bitblt.bltheight; y++) {
+    // unroll the pattern line and apply the ROP to the whole row at once
     srcc = src + pattern_y * pattern_pitch;
     dstaddr = (BX_CIRRUS_THIS bitblt.dstaddr + pattern_x) & BX_CIRRUS_THIS memsize_mask;
+    runbytes = 0;
     for (x = pattern_x; x < bltbytes; x += BX_CIRRUS_THIS bitblt.pixelwidth) {
-      src2 = srcc + (x % patternbytes);
-      dst = BX_CIRRUS_THIS s.memory + dstaddr;
-      (*BX_CIRRUS_THIS bitblt.rop_handler)(
-        dst, src2, 0, 0, BX_CIRRUS_THIS bitblt.pixelwidth, 1);
-      dstaddr = (dstaddr + BX_CIRRUS_THIS bitblt.pixelwidth) & BX_CIRRUS_THIS memsize_mask;
+      memcpy(work_row + runbytes, srcc + (x % patternbytes), BX_CIRRUS_THIS bitblt.pixelwidth);
+      runbytes += BX_CIRRUS_THIS bitblt.pixelwidth;
+    }
+    if (runbytes > 0) {
+      svga_rop_span(dstaddr, work_row, runbytes);
     }
     pattern_y = (pattern_y + 1) & 7;
     BX_CIRRUS_THIS bitblt.dstaddr += BX_CIRRUS_THIS bitblt.dstpitch;
@@ -3646,10 +3801,11 @@ void bx_svga_cirrus_c::svga_simplebitblt()
 {
   Bit8u color[4];
   Bit8u work_colorexp[2048];
+  Bit8u work_row[CIRRUS_BLT_CACHESIZE + 4];
   Bit16u w, x, y, pxcolor, trcolor;
-  Bit8u *src, *dst;
+  Bit8u *src, *dst, *run;
   unsigned bits, bits_xor, bitmask;
-  int pattern_x, srcskipleft;
+  int pattern_x, srcskipleft, runbytes;
 
   if (BX_CIRRUS_THIS bitblt.pixelwidth == 3) {
     pattern_x = BX_CIRRUS_THIS control.reg[0x2f] & 0x1f;
@@ -3670,22 +3826,32 @@ void bx_svga_cirrus_c::svga_simplebitblt()
         bits_xor = 0x00;
       }
 
+      cirrus_fill_color_row(work_row, color, BX_CIRRUS_THIS bitblt.pixelwidth,
+                            BX_CIRRUS_THIS bitblt.bltwidth);
       for (y = 0; y < BX_CIRRUS_THIS bitblt.bltheight; y++) {
         dst = BX_CIRRUS_THIS bitblt.dst + pattern_x;
         bitmask = 0x80 >> srcskipleft;
         bits = *BX_CIRRUS_THIS bitblt.src++ ^ bits_xor;
+        run = dst;
+        runbytes = 0;
         for (x = pattern_x; x < BX_CIRRUS_THIS bitblt.bltwidth; x+=BX_CIRRUS_THIS bitblt.pixelwidth) {
           if ((bitmask & 0xff) == 0) {
             bitmask = 0x80;
             bits = *BX_CIRRUS_THIS bitblt.src++ ^ bits_xor;
           }
           if (bits & bitmask) {
-            (*BX_CIRRUS_THIS bitblt.rop_handler)(
-              dst, &color[0], 0, 0, BX_CIRRUS_THIS bitblt.pixelwidth, 1);
+            if (runbytes == 0) run = dst;
+            runbytes += BX_CIRRUS_THIS bitblt.pixelwidth;
+          } else if (runbytes > 0) {
+            (*BX_CIRRUS_THIS bitblt.span_rop_handler)(run, work_row, 0, 0, runbytes, 1);
+            runbytes = 0;
           }
           dst += BX_CIRRUS_THIS bitblt.pixelwidth;
           bitmask >>= 1;
         }
+        if (runbytes > 0) {
+          (*BX_CIRRUS_THIS bitblt.span_rop_handler)(run, work_row, 0, 0, runbytes, 1);
+        }
         BX_CIRRUS_THIS bitblt.dst += BX_CIRRUS_THIS bitblt.dstpitch;
       }
       return;
@@ -3709,13 +3875,20 @@ void bx_svga_cirrus_c::svga_simplebitblt()
       for (y = 0; y < BX_CIRRUS_THIS bitblt.bltheight; y++) {
         src = (Bit8u*)BX_CIRRUS_THIS bitblt.src;
         dst = BX_CIRRUS_THIS bitblt.dst;
+        runbytes = 0;
         for (x = 0; x < BX_CIRRUS_THIS bitblt.bltwidth; x++) {
           if (*src != trcolor) {
-            (*BX_CIRRUS_THIS bitblt.rop_handler)(dst, src, 0, 0, 1, 1);
+            runbytes++;
+          } else if (runbytes > 0) {
+            (*BX_CIRRUS_THIS bitblt.span_rop_handler)(dst - runbytes, src - runbytes, 0, 0, runbytes, 1);
+            runbytes = 0;
           }
           src++;
           dst++;
         }
+        if (runbytes > 0) {
+          (*BX_CIRRUS_THIS bitblt.span_rop_handler)(dst - runbytes, src - runbytes, 0, 0, runbytes, 1);
+        }
         BX_CIRRUS_THIS bitblt.src += BX_CIRRUS_THIS bitblt.srcpitch;
         BX_CIRRUS_THIS bitblt.dst += BX_CIRRUS_THIS bitblt.dstpitch;
       }
@@ -3725,14 +3898,21 @@ void bx_svga_cirrus_c::svga_simplebitblt()
       for (y = 0; y < BX_CIRRUS_THIS bitblt.bltheight; y++) {
         src = (Bit8u*)BX_CIRRUS_THIS bitblt.src;
         dst = BX_CIRRUS_THIS bitblt.dst;
+        runbytes = 0;
         for (x = 0; x < BX_CIRRUS_THIS bitblt.bltwidth; x+=2) {
           pxcolor = src[0] | (src[1] << 8);
           if (pxcolor != trcolor) {
-            (*BX_CIRRUS_THIS bitblt.rop_handler)(dst, src, 0, 0, 2, 1);
+            runbytes += 2;
+          } else if (runbytes > 0) {
+            (*BX_CIRRUS_THIS bitblt.span_rop_handler)(dst - runbytes, src - runbytes, 0, 0, runbytes, 1);
+            runbytes = 0;
           }
           src += 2;
           dst += 2;
         }
+        if (runbytes > 0) {
+          (*BX_CIRRUS_THIS bitblt.span_rop_handler)(dst - runbytes, src - runbytes, 0, 0, runbytes, 1);
+        }
         BX_CIRRUS_THIS bitblt.src += BX_CIRRUS_THIS bitblt.srcpitch;
         BX_CIRRUS_THIS bitblt.dst += BX_CIRRUS_THIS bitblt.dstpitch;
       }
@@ -3756,8 +3936,8 @@ void bx_svga_cirrus_c::svga_simplebitblt()
 void bx_svga_cirrus_c::svga_solidfill()
 {
   Bit8u color[4];
-  int x, y;
-  Bit8u *dst;
+  Bit8u work_row[CIRRUS_BLT_CACHESIZE + 4];
+  int rowbytes;
 
   BX_DEBUG(("BLT: SOLIDFILL"));
 
@@ -3766,15 +3946,13 @@ void bx_svga_cirrus_c::svga_solidfill()
   color[2] = BX_CIRRUS_THIS control.reg[0x13];
   color[3] = BX_CIRRUS_THIS control.reg[0x15];
 
-  for (y = 0; y < BX_CIRRUS_THIS bitblt.bltheight; y++) {
-    dst = BX_CIRRUS_THIS bitblt.dst;
-    for (x = 0; x < BX_CIRRUS_THIS bitblt.bltwidth; x+=BX_CIRRUS_THIS bitblt.pixelwidth) {
-      (*BX_CIRRUS_THIS bitblt.rop_handler)(
-        dst, &color[0], 0, 0, BX_CIRRUS_THIS bitblt.pixelwidth, 1);
-        dst += BX_CIRRUS_THIS bitblt.pixelwidth;
-    }
-    BX_CIRRUS_THIS bitblt.dst += BX_CIRRUS_THIS bitblt.dstpitch;
-  }
+  // one color row is the source for all destination lines
+  rowbytes = cirrus_fill_color_row(work_row, color, BX_CIRRUS_THIS bitblt.pixelwidth,
+                                   BX_CIRRUS_THIS bitblt.bltwidth);
+  (*BX_CIRRUS_THIS bitblt.rop_handler)(
+    BX_CIRRUS_THIS bitblt.dst, work_row, BX_CIRRUS_THIS bitblt.dstpitch, 0,
+    rowbytes, BX_CIRRUS_THIS bitblt.bltheight);
+  BX_CIRRUS_THIS bitblt.dst += BX_CIRRUS_THIS bitblt.dstpitch * BX_CIRRUS_THIS bitblt.bltheight;
   BX_CIRRUS_THIS redraw_area(BX_CIRRUS_THIS redraw.x, BX_CIRRUS_THIS redraw.y,
                              BX_CIRRUS_THIS redraw.w, BX_CIRRUS_THIS redraw.h);
 }
@@ -3833,9 +4011,9 @@ void bx_svga_cirrus_c::svga_colorexpand_transp_memsrc()
 {
   Bit8u *src = &BX_CIRRUS_THIS bitblt.memsrc[0];
   Bit8u color[4];
-  int x, pattern_x, srcskipleft;
-  Bit32u dstaddr;
-  Bit8u *dst;
+  Bit8u work_row[CIRRUS_BLT_CACHESIZE + 4];
+  int x, pattern_x, srcskipleft, runbytes;
+  Bit32u dstaddr, runaddr;
   unsigned bits, bits_xor, bitmask;
   int byteofs;
 
@@ -3862,7 +4040,11 @@ void bx_svga_cirrus_c::svga_colorexpand_transp_memsrc()
     bits_xor = 0x00;
   }
 
+  cirrus_fill_color_row(work_row, color, BX_CIRRUS_THIS bitblt.pixelwidth,
+                        BX_CIRRUS_THIS bitblt.bltwidth);
   dstaddr = (BX_CIRRUS_THIS bitblt.dstaddr + pattern_x) & BX_CIRRUS_THIS memsize_mask;
+  runaddr = dstaddr;
+  runbytes = 0;
   bitmask = 0x80 >> srcskipleft;
   bits = *src++ ^ bits_xor;
   for (x = pattern_x; x < BX_CIRRUS_THIS bitblt.bltwidth; x+=BX_CIRRUS_THIS bitblt.pixelwidth) {
@@ -3871,13 +4053,34 @@ void bx_svga_cirrus_c::svga_colorexpand_transp_memsrc()
       bits = *src++ ^ bits_xor;
     }
     if (bits & bitmask) {
-      dst = BX_CIRRUS_THIS s.memory + dstaddr;
-      (*BX_CIRRUS_THIS bitblt.rop_handler)(
-          dst, &color[0], 0, 0, BX_CIRRUS_THIS bitblt.pixelwidth, 1);
+      if (runbytes == 0) runaddr = dstaddr;
+      runbytes += BX_CIRRUS_THIS bitblt.pixelwidth;
+    } else if (runbytes > 0) {
+      svga_rop_span(runaddr, work_row, runbytes);
+      runbytes = 0;
     }
-    dstaddr += BX_CIRRUS_THIS bitblt.pixelwidth;
+    dstaddr = (dstaddr + BX_CIRRUS_THIS bitblt.pixelwidth) & BX_CIRRUS_THIS memsize_mask;
     bitmask >>= 1;
   }
+  if (runbytes > 0) {
+    svga_rop_span(runaddr, work_row, runbytes);
+  }
+}
+
+void bx_svga_cirrus_c::svga_rop_span(Bit32u dstaddr, const Bit8u *src, int count)
+{
+  Bit32u len = BX_CIRRUS_THIS memsize_mask + 1 - dstaddr;
+
+  // split the span where it wraps around the end of video memory
+  if ((Bit32u)count > len) {
+    (*BX_CIRRUS_THIS bitblt.span_rop_handler)(
+        BX_CIRRUS_THIS s.memory + dstaddr, src, 0, 0, len, 1);
+    src += len;
+    count -= len;
+    dstaddr = 0;
+  }
+  (*BX_CIRRUS_THIS bitblt.span_rop_handler)(
+      BX_CIRRUS_THIS s.memory + dstaddr, src, 0, 0, count, 1);
 }
 
   bool // 1 if finished, 0 otherwise
@@ -69,6 +69,7 @@ public:
                            unsigned width, unsigned height);
   virtual Bit8u mem_read(bx_phy_address addr);
   virtual void mem_write(bx_phy_address addr, Bit8u value);
+  virtual bool mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data);
   virtual void get_text_snapshot(Bit8u **text_snapshot,
                                  unsigned *txHeight, unsigned *txWidth);
   virtual void register_state(void);
@@ -167,6 +168,7 @@ private:
   BX_CIRRUS_SMF void svga_patterncopy_memsrc();
   BX_CIRRUS_SMF void svga_simplebitblt_memsrc();
   BX_CIRRUS_SMF void svga_colorexpand_transp_memsrc();
+  BX_CIRRUS_SMF void svga_rop_span(Bit32u dstaddr, const Bit8u *src, int count);
 
   BX_CIRRUS_SMF bool svga_asyncbitblt_next();
   BX_CIRRUS_SMF bx_bitblt_rop_t svga_get_fwd_rop_handler(Bit8u rop);
@@ -212,6 +214,7 @@ private:
 
   struct {
     bx_bitblt_rop_t rop_handler;
+    bx_bitblt_rop_t span_rop_handler; // forward ROP for runs of pixels
     int pixelwidth;
     int bltwidth;
     int bltheight;
@@ -307,7 +307,8 @@ void bx_vga_c::update(void)
 
   if (BX_VGA_THIS vbe.enabled) {
     /* no screen update necessary */
-    if ((BX_VGA_THIS s.vga_mem_updated==0) && BX_VGA_THIS s.graphics_ctrl.graphics_alpha)
+    if ((BX_VGA_THIS s.vga_mem_updated==0) && !BX_VGA_THIS fb_dirty.is_dirty() &&
+        BX_VGA_THIS s.graphics_ctrl.graphics_alpha)
       return;
 
     /* skip screen update when vga/video is disabled or the sequencer is in reset mode */
@@ -344,6 +345,19 @@ void bx_vga_c::update(void)
       pitch = BX_VGA_THIS vbe.line_offset;
       Bit8u *disp_ptr = &BX_VGA_THIS s.memory[BX_VGA_THIS vbe.virtual_start];
 
+      // convert the pages written since the last update into dirty tiles
+      if (BX_VGA_THIS fb_dirty.is_dirty()) {
+        if (BX_VGA_THIS fb_dirty.mark_tiles(BX_VGA_THIS vbe.virtual_start, pitch,
+              BX_VGA_THIS vbe.bpp_multiplier, iWidth, iHeight, 0, 0,
+              BX_VGA_THIS s.vga_tile_updated, BX_VGA_THIS s.num_x_tiles,
+              BX_VGA_THIS s.num_y_tiles)) {
+          BX_VGA_THIS s.vga_mem_updated = 1;
+        }
+        BX_VGA_THIS fb_dirty.clear();
+      }
+      if (BX_VGA_THIS s.vga_mem_updated == 0)
+        return;
+
       if (bx_gui->graphics_tile_info_common(&info)) {
         if (info.snapshot_mode) {
           vid_ptr = disp_ptr;
@@ -398,6 +412,47 @@ void bx_vga_c::update(void)
               }
               break;
           }
+        } else if (bx_vga_tile_is_xrgb32(&info)) {
+          Bit32u palette[256];
+          if (BX_VGA_THIS vbe.bpp == 8) {
+            for (i = 0; i < 256; i++) {
+              palette[i] = MAKE_COLOUR(
+                BX_VGA_THIS s.pel.data[i].red, dac_size, 24, 0xff0000,
+                BX_VGA_THIS s.pel.data[i].green, dac_size, 16, 0x00ff00,
+                BX_VGA_THIS s.pel.data[i].blue, dac_size, 8, 0x0000ff);
+            }
+          }
+          for (yc=0, yti = 0; yc<iHeight; yc+=Y_TILESIZE, yti++) {
+            for (xc=0, xti = 0; xc<iWidth; xc+=X_TILESIZE, xti++) {
+              if (GET_TILE_UPDATED (xti, yti)) {
+                vid_ptr = disp_ptr + (yc * pitch + xc * BX_VGA_THIS vbe.bpp_multiplier);
+                tile_ptr = bx_gui->graphics_tile_get(xc, yc, &w, &h);
+                for (r=0; r<h; r++) {
+                  switch (BX_VGA_THIS vbe.bpp) {
+                    case 8:
+                      bx_vga_convert_8bpp((Bit32u*)tile_ptr, vid_ptr, w, palette);
+                      break;
+                    case 15:
+                      bx_vga_convert_15bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                      break;
+                    case 16:
+                      bx_vga_convert_16bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                      break;
+                    case 24:
+                      bx_vga_convert_24bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                      break;
+                    case 32:
+                      bx_vga_convert_32bpp((Bit32u*)tile_ptr, vid_ptr, w);
+                      break;
+                  }
+                  vid_ptr  += pitch;
+                  tile_ptr += info.pitch;
+                }
+                bx_gui->graphics_tile_update_in_place(xc, yc, w, h);
+                SET_TILE_UPDATED(BX_VGA_THIS, xti, yti, 0);
+              }
+            }
+          }
         } else {
           switch (BX_VGA_THIS vbe.bpp) {
             case 4:
@@ -603,6 +658,9 @@ void bx_vga_c::update(void)
       unsigned xc, yc, xti, yti;
       Bit32u row_addr;
 
+      // planar 4bpp memory is tracked by the VGA core
+      BX_VGA_THIS fb_dirty.clear();
+
       if ((BX_VGA_THIS vbe.virtual_start + BX_VGA_THIS vbe.visible_screen_size) > BX_VGA_THIS s.memsize) {
         BX_ERROR(("skip address wrap during update() (start = 0x%08x)",
                   BX_VGA_THIS vbe.virtual_start));
@@ -734,6 +792,17 @@ void bx_vga_c::mem_write(bx_phy_address addr, Bit8u value)
   bx_vgacore_c::mem_write(addr, value);
 }
 
+bool bx_vga_c::mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data)
+{
+  if ((BX_VGA_THIS vbe.enabled) && (BX_VGA_THIS vbe.bpp != VBE_DISPI_BPP_4)) {
+    return 0;
+  } else if ((BX_VGA_THIS vbe.base_address != 0) && (addr >= BX_VGA_THIS vbe.base_address)) {
+    return 0;
+  }
+
+  return bx_vgacore_c::mem_write_block(addr, len, data);
+}
+
 void bx_vga_c::redraw_area(unsigned x0, unsigned y0, unsigned width, unsigned height)
 {
   unsigned xti, yti, xt0, xt1, yt0, yt1, xmax, ymax;
@@ -800,7 +869,6 @@ bx_vga_c::vbe_mem_read(bx_phy_address addr)
 bx_vga_c::vbe_mem_write(bx_phy_address addr, Bit8u value)
 {
   Bit32u offset;
-  unsigned x_tileno, y_tileno;
 
   if (addr >= BX_VGA_THIS vbe.base_address) {
     // LFB write
@@ -817,6 +885,8 @@ bx_vga_c::vbe_mem_write(bx_phy_address addr, Bit8u value)
   // check for out of memory write
   if (offset < BX_VGA_THIS s.memsize) {
     BX_VGA_THIS s.memory[offset] = value;
+    // the display update finds out if the page is 'onscreen'
+    BX_VGA_THIS fb_dirty.set_dirty(offset, 1);
   } else {
     // make sure we don't flood the logfile
     static int count=0;
@@ -825,20 +895,6 @@ bx_vga_c::vbe_mem_write(bx_phy_address addr, Bit8u value)
       BX_DEBUG(("VBE_mem_write out of video memory write at %x",offset));
     }
   }
-
-  offset -= BX_VGA_THIS vbe.virtual_start;
-
-  // only update the UI when writing 'onscreen'
-  if (offset < BX_VGA_THIS vbe.visible_screen_size) {
-    y_tileno = ((offset / BX_VGA_THIS vbe.bpp_multiplier) / BX_VGA_THIS vbe.virtual_xres) / Y_TILESIZE;
-    x_tileno = ((offset / BX_VGA_THIS vbe.bpp_multiplier) % BX_VGA_THIS vbe.virtual_xres) / X_TILESIZE;
-
-    if ((y_tileno < BX_VGA_THIS s.num_y_tiles) && (x_tileno < BX_VGA_THIS s.num_x_tiles))
-    {
-      BX_VGA_THIS s.vga_mem_updated = 1;
-      SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
-    }
-  }
 }
 
 // MMIO handlers for BAR2 (QEMU-compatible VBE MMIO)
@@ -102,6 +102,7 @@ public:
   BX_VGA_SMF bool mem_write_handler(bx_phy_address addr, unsigned len, void *data, void *param);
   virtual Bit8u  mem_read(bx_phy_address addr);
   virtual void   mem_write(bx_phy_address addr, Bit8u value);
+  virtual bool   mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data);
   virtual void   register_state(void);
   virtual void   after_restore_state(void);
 
@@ -65,6 +65,169 @@ const Bit8u ccdat[16][4] = {
   { 0xff, 0xff, 0xff, 0xff },
 };
 
+// ccdat[] as 32-bit words (plane 0 in the lowest memory byte)
+static Bit32u vga_plane_mask[16];
+
+// dirty page log for linear framebuffers
+
+bx_vga_dirty_log_c::bx_vga_dirty_log_c()
+{
+  bitmap = NULL;
+  num_pages = 0;
+  dirty = 0;
+}
+
+bx_vga_dirty_log_c::~bx_vga_dirty_log_c()
+{
+  if (bitmap != NULL) {
+    delete [] bitmap;
+  }
+}
+
+void bx_vga_dirty_log_c::init(Bit32u memsize)
+{
+  if (bitmap != NULL) {
+    delete [] bitmap;
+  }
+  num_pages = (memsize + (1 << VGA_DIRTY_PAGE_SHIFT) - 1) >> VGA_DIRTY_PAGE_SHIFT;
+  if (num_pages == 0) num_pages = 1;
+  bitmap = new Bit32u[(num_pages + 31) >> 5];
+  clear();
+}
+
+void bx_vga_dirty_log_c::set_all_dirty(void)
+{
+  memset(bitmap, 0xff, ((num_pages + 31) >> 5) * sizeof(Bit32u));
+  dirty = 1;
+}
+
+void bx_vga_dirty_log_c::clear(void)
+{
+  memset(bitmap, 0, ((num_pages + 31) >> 5) * sizeof(Bit32u));
+  dirty = 0;
+}
+
+// Convert the dirty pages inside the visible area starting at 'start' into
+// dirty tiles. 'width' and 'height' are the output dimensions, the xdouble /
+// ydouble flags select pixel / scanline doubling. A page covering only a part
+// of one scanline marks the tiles of that span, a page covering more than one
+// scanline marks the affected tile rows completely. Returns 1 if at least one
+// tile has been marked.
+bool bx_vga_dirty_log_c::mark_tiles(Bit32u start, Bit32u pitch, unsigned bytespp,
+                                    unsigned width, unsigned height, bool xdouble, bool ydouble,
+                                    bool *tiles, unsigned num_x_tiles, unsigned num_y_tiles)
+{
+  Bit32u page, lo, hi, end, x0, x1, y0, y1, xt, yt;
+  unsigned src_width, src_height;
+  bool marked = 0;
+
+  if (!dirty || (pitch == 0) || (bytespp == 0) || (width == 0) || (height == 0))
+    return 0;
+  src_width = xdouble ? ((width + 1) >> 1) : width;
+  src_height = ydouble ? ((height + 1) >> 1) : height;
+  end = start + pitch * src_height;
+  for (page = start >> VGA_DIRTY_PAGE_SHIFT;
+       (page < num_pages) && ((page << VGA_DIRTY_PAGE_SHIFT) < end); page++) {
+    if (bitmap[page >> 5] == 0) {
+      page |= 0x1f;
+      continue;
+    }
+    if ((bitmap[page >> 5] & (1 << (page & 0x1f))) == 0)
+      continue;
+    lo = page << VGA_DIRTY_PAGE_SHIFT;
+    hi = lo + (1 << VGA_DIRTY_PAGE_SHIFT);
+    if (lo < start) lo = start;
+    if (hi > end) hi = end;
+    lo -= start;
+    hi -= start;
+    y0 = lo / pitch;
+    y1 = (hi - 1) / pitch;
+    if (y0 == y1) {
+      x0 = (lo % pitch) / bytespp;
+      x1 = ((hi - 1) % pitch) / bytespp;
+      if (x0 >= src_width) continue;
+      if (x1 >= src_width) x1 = src_width - 1;
+    } else {
+      x0 = 0;
+      x1 = src_width - 1;
+    }
+    if (xdouble) {
+      x0 <<= 1;
+      x1 = (x1 << 1) + 1;
+    }
+    if (ydouble) {
+      y0 <<= 1;
+      y1 = (y1 << 1) + 1;
+    }
+    if (x1 >= width) x1 = width - 1;
+    if (y1 >= height) y1 = height - 1;
+    for (yt = y0 / Y_TILESIZE; (yt <= y1 / Y_TILESIZE) && (yt < num_y_tiles); yt++) {
+      for (xt = x0 / X_TILESIZE; (xt <= x1 / X_TILESIZE) && (xt < num_x_tiles); xt++) {
+        tiles[xt + yt * num_x_tiles] = 1;
+      }
+    }
+    marked = 1;
+  }
+  return marked;
+}
+
+// scanline conversion kernels for 32-bit xRGB host displays
+
+bool bx_vga_tile_is_xrgb32(const bx_svga_tileinfo_t *info)
+{
+#ifdef BX_LITTLE_ENDIAN
+  return (!info->is_indexed && info->is_little_endian && (info->bpp == 32) &&
+          (info->red_shift == 24) && (info->green_shift == 16) &&
+          (info->blue_shift == 8) && (info->red_mask == 0xff0000) &&
+          (info->green_mask == 0x00ff00) && (info->blue_mask == 0x0000ff));
+#else
+  return 0;
+#endif
+}
+
+void bx_vga_convert_8bpp(Bit32u *dst, const Bit8u *src, unsigned w, const Bit32u *palette)
+{
+  for (unsigned i = 0; i < w; i++) {
+    dst[i] = palette[src[i]];
+  }
+}
+
+void bx_vga_convert_15bpp(Bit32u *dst, const Bit8u *src, unsigned w)
+{
+  for (unsigned i = 0; i < w; i++) {
+    Bit32u val = src[i * 2] | (src[i * 2 + 1] << 8);
+    Bit32u r = ((val >> 7) & 0xf8) | ((val >> 12) & 0x07);
+    Bit32u g = ((val >> 2) & 0xf8) | ((val >> 7) & 0x07);
+    Bit32u b = ((val << 3) & 0xf8) | ((val >> 2) & 0x07);
+    dst[i] = (r << 16) | (g << 8) | b;
+  }
+}
+
+void bx_vga_convert_16bpp(Bit32u *dst, const Bit8u *src, unsigned w)
+{
+  for (unsigned i = 0; i < w; i++) {
+    Bit32u val = src[i * 2] | (src[i * 2 + 1] << 8);
+    Bit32u r = ((val >> 8) & 0xf8) | ((val >> 13) & 0x07);
+    Bit32u g = ((val >> 3) & 0xfc) | ((val >> 9) & 0x03);
+    Bit32u b = ((val << 3) & 0xf8) | ((val >> 2) & 0x07);
+    dst[i] = (r << 16) | (g << 8) | b;
+  }
+}
+
+void bx_vga_convert_24bpp(Bit32u *dst, const Bit8u *src, unsigned w)
+{
+  for (unsigned i = 0; i < w; i++) {
+    dst[i] = src[i * 3] | (src[i * 3 + 1] << 8) | (src[i * 3 + 2] << 16);
+  }
+}
+
+void bx_vga_convert_32bpp(Bit32u *dst, const Bit8u *src, unsigned w)
+{
+  for (unsigned i = 0; i < w; i++) {
+    dst[i] = src[i * 4] | (src[i * 4 + 1] << 8) | (src[i * 4 + 2] << 16);
+  }
+}
+
 
 bx_vgacore_c::bx_vgacore_c()
 {
@@ -101,6 +264,10 @@ void bx_vgacore_c::init(void)
   BX_VGA_THIS vga_ext = SIM->get_param_enum(BXPN_VGA_EXTENSION);
   BX_VGA_THIS pci_enabled = 0;
 
+  for (x = 0; x < 16; x++) {
+    memcpy(&vga_plane_mask[x], ccdat[x], 4);
+  }
+
   BX_VGA_THIS init_standard_vga();
   if (!BX_VGA_THIS init_vga_extension()) {
     // VGA memory not yet initialized
@@ -111,6 +278,7 @@ void bx_vgacore_c::init(void)
     BX_INFO(("Standard VGA adapter initialized"));
   }
   BX_VGA_THIS s.vgamem_mask = 0x3ffff;
+  BX_VGA_THIS fb_dirty.init(BX_VGA_THIS s.memsize);
   BX_VGA_THIS init_gui();
 
   BX_VGA_THIS s.num_x_tiles = BX_VGA_THIS s.max_xres / X_TILESIZE +
@@ -1803,6 +1971,11 @@ bool bx_vgacore_c::mem_write_handler(bx_phy_address addr, unsigned len, void *da
   data_ptr = (Bit8u *) data;
 #else // BX_BIG_ENDIAN
   data_ptr = (Bit8u *) data + (len - 1);
+#endif
+#ifdef BX_LITTLE_ENDIAN
+  if ((len > 1) && class_ptr->mem_write_block(addr, len, data_ptr)) {
+    return 1;
+  }
 #endif
   for (unsigned i = 0; i < len; i++) {
     class_ptr->mem_write(addr, *data_ptr);
@@ -1816,319 +1989,209 @@ bool bx_vgacore_c::mem_write_handler(bx_phy_address addr, unsigned len, void *da
   return 1;
 }
 
-void bx_vgacore_c::mem_write(bx_phy_address addr, Bit8u value)
+// Decode a CPU address in the legacy VGA window to a video memory offset.
+// Returns false if the address is outside the currently mapped window.
+bool bx_vgacore_c::mem_decode_addr(bx_phy_address addr, Bit32u *offset)
 {
-  Bit32u offset;
-  Bit8u new_val[4] = {0,0,0,0};
-  unsigned start_addr;
-  Bit8u sequ_map_mask = BX_VGA_THIS s.sequencer.map_mask & 0x0f;
-
   if (addr >= 0xA0000) {
     switch (BX_VGA_THIS s.graphics_ctrl.memory_mapping) {
       case 1: // 0xA0000 .. 0xAFFFF
-        if ((addr < 0xA0000) || (addr > 0xAFFFF)) return;
-        offset = addr & 0xFFFF;
+        if ((addr < 0xA0000) || (addr > 0xAFFFF)) return 0;
+        *offset = addr & 0xFFFF;
         break;
       case 2: // 0xB0000 .. 0xB7FFF
-        if ((addr < 0xB0000) || (addr > 0xB7FFF)) return;
-        offset = addr & 0x7FFF;
+        if ((addr < 0xB0000) || (addr > 0xB7FFF)) return 0;
+        *offset = addr & 0x7FFF;
         break;
       case 3: // 0xB8000 .. 0xBFFFF
-        if ((addr < 0xB8000) || (addr > 0xBFFFF)) return;
-        offset = addr & 0x7FFF;
+        if ((addr < 0xB8000) || (addr > 0xBFFFF)) return 0;
+        *offset = addr & 0x7FFF;
         break;
       default: // 0xA0000 .. 0xBFFFF
-        if ((addr < 0xA0000) || (addr > 0xBFFFF)) return;
-        offset = addr & 0x1FFFF;
+        if ((addr < 0xA0000) || (addr > 0xBFFFF)) return 0;
+        *offset = addr & 0x1FFFF;
     }
   } else {
-    offset = (Bit32u)addr;
+    *offset = (Bit32u)addr;
   }
+  return 1;
+}
 
-  start_addr = BX_VGA_THIS s.CRTC.start_addr;
+// Apply write mode, data rotate, set/reset, ALU and bit mask to one CPU byte.
+// The result holds the new data for planes 0-3 in memory byte order.
+Bit32u bx_vgacore_c::planar_write_data(Bit8u value)
+{
+  Bit32u latch, src, mask;
+  const Bit8u data_rotate = BX_VGA_THIS s.graphics_ctrl.data_rotate;
 
-  if (BX_VGA_THIS s.sequencer.chain_four) {
-    // 320 x 200 256 color mode: chained pixel representation
-    BX_VGA_THIS s.memory[offset] = value;
-    BX_VGA_THIS s.vga_mem_updated |= (1 << (offset % 4));
-    if (BX_VGA_THIS s.graphics_ctrl.graphics_alpha) {
-      unsigned x_tileno, y_tileno;
+  memcpy(&latch, BX_VGA_THIS s.graphics_ctrl.latch, 4);
+  switch (BX_VGA_THIS s.graphics_ctrl.write_mode) {
+    case 0: /* write mode 0 */
+      if (data_rotate) {
+        value = (value >> data_rotate) | (value << (8 - data_rotate));
+      }
+      src = (Bit32u)value * 0x01010101;
+      src = (src & ~vga_plane_mask[BX_VGA_THIS s.graphics_ctrl.enable_set_reset]) |
+            (vga_plane_mask[BX_VGA_THIS s.graphics_ctrl.set_reset] &
+             vga_plane_mask[BX_VGA_THIS s.graphics_ctrl.enable_set_reset]);
+      mask = (Bit32u)BX_VGA_THIS s.graphics_ctrl.bitmask * 0x01010101;
+      break;
+    case 1: /* write mode 1 */
+      return latch;
+    case 2: /* write mode 2 */
+      src = vga_plane_mask[value & 0x0f];
+      mask = (Bit32u)BX_VGA_THIS s.graphics_ctrl.bitmask * 0x01010101;
+      break;
+    default: /* write mode 3 */
+      if (data_rotate) {
+        value = (value >> data_rotate) | (value << (8 - data_rotate));
+      }
+      src = vga_plane_mask[BX_VGA_THIS s.graphics_ctrl.set_reset];
+      mask = (Bit32u)(BX_VGA_THIS s.graphics_ctrl.bitmask & value) * 0x01010101;
+      break;
+  }
+  switch (BX_VGA_THIS s.graphics_ctrl.raster_op) {
+    case 1: // AND
+      src &= latch;
+      break;
+    case 2: // OR
+      src |= latch;
+      break;
+    case 3: // XOR
+      src ^= latch;
+      break;
+  }
+  return (latch & ~mask) | (src & mask);
+}
+
+void bx_vgacore_c::mark_tile_chain4(Bit32u offset)
+{
+  unsigned start_addr = BX_VGA_THIS s.CRTC.start_addr;
+  unsigned x_tileno, y_tileno;
 
-      if (BX_VGA_THIS s.CRTC.reg[0x14] & 0x40) {
-        start_addr <<= 2;
+  if (BX_VGA_THIS s.CRTC.reg[0x14] & 0x40) {
+    start_addr <<= 2;
+  }
+  if (BX_VGA_THIS s.line_offset > 0) {
+    if (BX_VGA_THIS s.line_compare < BX_VGA_THIS s.vertical_display_end) {
+      x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 2);
+      if (BX_VGA_THIS s.y_doublescan) {
+        y_tileno = ((offset / BX_VGA_THIS s.line_offset) + BX_VGA_THIS s.line_compare + 1) / Y_TILESIZE;
+      } else {
+        y_tileno = ((offset / BX_VGA_THIS s.line_offset) + BX_VGA_THIS s.line_compare + 1) / (Y_TILESIZE / 2);
       }
-      if (BX_VGA_THIS s.line_offset > 0) {
-        if (BX_VGA_THIS s.line_compare < BX_VGA_THIS s.vertical_display_end) {
-          x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 2);
-          if (BX_VGA_THIS s.y_doublescan) {
-            y_tileno = ((offset / BX_VGA_THIS s.line_offset) + BX_VGA_THIS s.line_compare + 1) / Y_TILESIZE;
-          } else {
-            y_tileno = ((offset / BX_VGA_THIS s.line_offset) + BX_VGA_THIS s.line_compare + 1) / (Y_TILESIZE / 2);
-          }
-          SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
-        }
-        if (offset >= start_addr) {
-          offset -= start_addr;
-          x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 2);
-          if (BX_VGA_THIS s.y_doublescan) {
-            y_tileno = (offset / BX_VGA_THIS s.line_offset) / (Y_TILESIZE / 2);
-          } else {
-            y_tileno = (offset / BX_VGA_THIS s.line_offset) / Y_TILESIZE;
-          }
-          SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
-        }
+      SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
+    }
+    if (offset >= start_addr) {
+      offset -= start_addr;
+      x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 2);
+      if (BX_VGA_THIS s.y_doublescan) {
+        y_tileno = (offset / BX_VGA_THIS s.line_offset) / (Y_TILESIZE / 2);
+      } else {
+        y_tileno = (offset / BX_VGA_THIS s.line_offset) / Y_TILESIZE;
       }
+      SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
     }
-    return;
   }
+}
 
-  offset += BX_VGA_THIS s.ext_offset;
-
-  switch (BX_VGA_THIS s.graphics_ctrl.write_mode) {
-    unsigned i;
+void bx_vgacore_c::mark_tile_planar(Bit32u offset)
+{
+  unsigned start_addr = BX_VGA_THIS s.CRTC.start_addr;
+  unsigned x_tileno, y_tileno;
+  if ((BX_VGA_THIS s.CRTC.reg[0x17] & 1) == 0) { // MAP13 (CGA 320x200x4 / 640x200x2)
+    unsigned xc, yc;
 
-    case 0: /* write mode 0 */
-      {
-        const Bit8u bitmask = BX_VGA_THIS s.graphics_ctrl.bitmask;
-        const Bit8u set_reset = BX_VGA_THIS s.graphics_ctrl.set_reset;
-        const Bit8u enable_set_reset = BX_VGA_THIS s.graphics_ctrl.enable_set_reset;
-        /* perform rotate on CPU data in case its needed */
-        if (BX_VGA_THIS s.graphics_ctrl.data_rotate) {
-          value = (value >> BX_VGA_THIS s.graphics_ctrl.data_rotate) |
-                  (value << (8 - BX_VGA_THIS s.graphics_ctrl.data_rotate));
+    if ((BX_VGA_THIS s.CRTC.reg[0x17] & 0x40) == 0) {
+      start_addr <<= 1;
+    }
+    offset -= start_addr;
+    if (offset >= 0x2000) {
+      yc = (((offset - 0x2000) / (320 / 4)) << 1) + 1;
+      xc = ((offset - 0x2000) % (320 / 4)) << 2;
+    } else {
+      yc = (offset / (320 / 4)) << 1;
+      xc = (offset % (320 / 4)) << 2;
+    }
+    if ((BX_VGA_THIS s.graphics_ctrl.shift_reg == 0) || BX_VGA_THIS s.x_dotclockdiv2) {
+      xc <<= 1;
+    }
+    x_tileno = xc / X_TILESIZE;
+    if (BX_VGA_THIS s.y_doublescan) {
+      y_tileno = yc / (Y_TILESIZE / 2);
+    } else {
+      y_tileno = yc / Y_TILESIZE;
+    }
+    SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
+  } else if (BX_VGA_THIS s.graphics_ctrl.shift_reg == 2) {
+    offset -= start_addr;
+    x_tileno = (offset % BX_VGA_THIS s.line_offset) * 4 / (X_TILESIZE / 2);
+    if (BX_VGA_THIS s.y_doublescan) {
+      y_tileno = (offset / BX_VGA_THIS s.line_offset) / (Y_TILESIZE / 2);
+    } else {
+      y_tileno = (offset / BX_VGA_THIS s.line_offset) / Y_TILESIZE;
+    }
+    SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
+  } else {
+    if (BX_VGA_THIS s.line_offset > 0) {
+      if (BX_VGA_THIS s.line_compare < BX_VGA_THIS s.vertical_display_end) {
+        if (BX_VGA_THIS s.x_dotclockdiv2) {
+          x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 16);
+        } else {
+          x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 8);
         }
-        new_val[0] = BX_VGA_THIS s.graphics_ctrl.latch[0] & ~bitmask;
-        new_val[1] = BX_VGA_THIS s.graphics_ctrl.latch[1] & ~bitmask;
-        new_val[2] = BX_VGA_THIS s.graphics_ctrl.latch[2] & ~bitmask;
-        new_val[3] = BX_VGA_THIS s.graphics_ctrl.latch[3] & ~bitmask;
-        switch (BX_VGA_THIS s.graphics_ctrl.raster_op) {
-          case 0: // replace
-            new_val[0] |= ((enable_set_reset & 1)
-                           ? ((set_reset & 1) ? bitmask : 0)
-                           : (value & bitmask));
-            new_val[1] |= ((enable_set_reset & 2)
-                           ? ((set_reset & 2) ? bitmask : 0)
-                           : (value & bitmask));
-            new_val[2] |= ((enable_set_reset & 4)
-                           ? ((set_reset & 4) ? bitmask : 0)
-                           : (value & bitmask));
-            new_val[3] |= ((enable_set_reset & 8)
-                           ? ((set_reset & 8) ? bitmask : 0)
-                           : (value & bitmask));
-            break;
-          case 1: // AND
-            new_val[0] |= ((enable_set_reset & 1)
-                           ? ((set_reset & 1)
-                              ? (BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask)
-                              : 0)
-                           : (value & BX_VGA_THIS s.graphics_ctrl.latch[0]) & bitmask);
-            new_val[1] |= ((enable_set_reset & 2)
-                           ? ((set_reset & 2)
-                              ? (BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask)
-                              : 0)
-                           : (value & BX_VGA_THIS s.graphics_ctrl.latch[1]) & bitmask);
-            new_val[2] |= ((enable_set_reset & 4)
-                           ? ((set_reset & 4)
-                              ? (BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask)
-                              : 0)
-                           : (value & BX_VGA_THIS s.graphics_ctrl.latch[2]) & bitmask);
-            new_val[3] |= ((enable_set_reset & 8)
-                           ? ((set_reset & 8)
-                              ? (BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask)
-                              : 0)
-                           : (value & BX_VGA_THIS s.graphics_ctrl.latch[3]) & bitmask);
-            break;
-          case 2: // OR
-            new_val[0]
-              |= ((enable_set_reset & 1)
-                  ? ((set_reset & 1)
-                     ? bitmask
-                     : (BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask))
-                  : ((value | BX_VGA_THIS s.graphics_ctrl.latch[0]) & bitmask));
-            new_val[1]
-              |= ((enable_set_reset & 2)
-                  ? ((set_reset & 2)
-                     ? bitmask
-                     : (BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask))
-                  : ((value | BX_VGA_THIS s.graphics_ctrl.latch[1]) & bitmask));
-            new_val[2]
-              |= ((enable_set_reset & 4)
-                  ? ((set_reset & 4)
-                     ? bitmask
-                     : (BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask))
-                  : ((value | BX_VGA_THIS s.graphics_ctrl.latch[2]) & bitmask));
-            new_val[3]
-              |= ((enable_set_reset & 8)
-                  ? ((set_reset & 8)
-                     ? bitmask
-                     : (BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask))
-                  : ((value | BX_VGA_THIS s.graphics_ctrl.latch[3]) & bitmask));
-            break;
-          case 3: // XOR
-            new_val[0]
-              |= ((enable_set_reset & 1)
-                 ? ((set_reset & 1)
-                    ? (~BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask)
-                    : (BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask))
-                 : (value ^ BX_VGA_THIS s.graphics_ctrl.latch[0]) & bitmask);
-            new_val[1]
-              |= ((enable_set_reset & 2)
-                 ? ((set_reset & 2)
-                    ? (~BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask)
-                    : (BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask))
-                 : (value ^ BX_VGA_THIS s.graphics_ctrl.latch[1]) & bitmask);
-            new_val[2]
-              |= ((enable_set_reset & 4)
-                 ? ((set_reset & 4)
-                    ? (~BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask)
-                    : (BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask))
-                 : (value ^ BX_VGA_THIS s.graphics_ctrl.latch[2]) & bitmask);
-            new_val[3]
-              |= ((enable_set_reset & 8)
-                 ? ((set_reset & 8)
-                    ? (~BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask)
-                    : (BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask))
-                 : (value ^ BX_VGA_THIS s.graphics_ctrl.latch[3]) & bitmask);
-            break;
-          default:
-            BX_PANIC(("vga_mem_write: write mode 0: op = %u",
-                      (unsigned) BX_VGA_THIS s.graphics_ctrl.raster_op));
+        if (BX_VGA_THIS s.y_doublescan) {
+          y_tileno = ((offset / BX_VGA_THIS s.line_offset) * 2 + BX_VGA_THIS s.line_compare + 1) / Y_TILESIZE;
+        } else {
+          y_tileno = ((offset / BX_VGA_THIS s.line_offset) + BX_VGA_THIS s.line_compare + 1) / Y_TILESIZE;
         }
+        SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
       }
-      break;
-
-    case 1: /* write mode 1 */
-      for (i=0; i<4; i++) {
-        new_val[i] = BX_VGA_THIS s.graphics_ctrl.latch[i];
-      }
-      break;
-
-    case 2: /* write mode 2 */
-      {
-        const Bit8u bitmask = BX_VGA_THIS s.graphics_ctrl.bitmask;
-
-        new_val[0] = BX_VGA_THIS s.graphics_ctrl.latch[0] & ~bitmask;
-        new_val[1] = BX_VGA_THIS s.graphics_ctrl.latch[1] & ~bitmask;
-        new_val[2] = BX_VGA_THIS s.graphics_ctrl.latch[2] & ~bitmask;
-        new_val[3] = BX_VGA_THIS s.graphics_ctrl.latch[3] & ~bitmask;
-        switch (BX_VGA_THIS s.graphics_ctrl.raster_op) {
-          case 0: // write
-            new_val[0] |= (value & 1) ? bitmask : 0;
-            new_val[1] |= (value & 2) ? bitmask : 0;
-            new_val[2] |= (value & 4) ? bitmask : 0;
-            new_val[3] |= (value & 8) ? bitmask : 0;
-            break;
-          case 1: // AND
-            new_val[0] |= (value & 1)
-              ? (BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask)
-              : 0;
-            new_val[1] |= (value & 2)
-              ? (BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask)
-              : 0;
-            new_val[2] |= (value & 4)
-              ? (BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask)
-              : 0;
-            new_val[3] |= (value & 8)
-              ? (BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask)
-              : 0;
-            break;
-          case 2: // OR
-            new_val[0] |= (value & 1)
-              ? bitmask
-              : (BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask);
-            new_val[1] |= (value & 2)
-              ? bitmask
-              : (BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask);
-            new_val[2] |= (value & 4)
-              ? bitmask
-              : (BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask);
-            new_val[3] |= (value & 8)
-              ? bitmask
-              : (BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask);
-            break;
-          case 3: // XOR
-            new_val[0] |= (value & 1)
-              ? (~BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask)
-              : (BX_VGA_THIS s.graphics_ctrl.latch[0] & bitmask);
-            new_val[1] |= (value & 2)
-              ? (~BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask)
-              : (BX_VGA_THIS s.graphics_ctrl.latch[1] & bitmask);
-            new_val[2] |= (value & 4)
-              ? (~BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask)
-              : (BX_VGA_THIS s.graphics_ctrl.latch[2] & bitmask);
-            new_val[3] |= (value & 8)
-              ? (~BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask)
-              : (BX_VGA_THIS s.graphics_ctrl.latch[3] & bitmask);
-            break;
+      if (offset >= start_addr) {
+        offset -= start_addr;
+        if (BX_VGA_THIS s.x_dotclockdiv2) {
+          x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 16);
+        } else {
+          x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 8);
         }
+        if (BX_VGA_THIS s.y_doublescan) {
+          y_tileno = (offset / BX_VGA_THIS s.line_offset) / (Y_TILESIZE / 2);
+        } else {
+          y_tileno = (offset / BX_VGA_THIS s.line_offset) / Y_TILESIZE;
+        }
+        SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
       }
-      break;
+    }
+  }
+}
 
-    case 3: /* write mode 3 */
-      {
-        /* perform rotate on CPU data */
-        if (BX_VGA_THIS s.graphics_ctrl.data_rotate) {
-          value = (value >> BX_VGA_THIS s.graphics_ctrl.data_rotate) |
-                  (value << (8 - BX_VGA_THIS s.graphics_ctrl.data_rotate));
-        }
+void bx_vgacore_c::mem_write(bx_phy_address addr, Bit8u value)
+{
+  Bit32u offset, new_val32, old_val32, map_mask32;
+  Bit8u new_val[4];
+  unsigned start_addr;
+  Bit8u sequ_map_mask = BX_VGA_THIS s.sequencer.map_mask & 0x0f;
 
-        const Bit8u bitmask = BX_VGA_THIS s.graphics_ctrl.bitmask & value;
-        const Bit8u set_reset = BX_VGA_THIS s.graphics_ctrl.set_reset;
+  if (!mem_decode_addr(addr, &offset)) return;
 
-        new_val[0] = BX_VGA_THIS s.graphics_ctrl.latch[0] & ~bitmask;
-        new_val[1] = BX_VGA_THIS s.graphics_ctrl.latch[1] & ~bitmask;
-        new_val[2] = BX_VGA_THIS s.graphics_ctrl.latch[2] & ~bitmask;
-        new_val[3] = BX_VGA_THIS s.graphics_ctrl.latch[3] & ~bitmask;
+  start_addr = BX_VGA_THIS s.CRTC.start_addr;
 
-        value &= bitmask;
+  if (BX_VGA_THIS s.sequencer.chain_four) {
+    // 320 x 200 256 color mode: chained pixel representation
+    BX_VGA_THIS s.memory[offset] = value;
+    BX_VGA_THIS s.vga_mem_updated |= (1 << (offset % 4));
+    if (BX_VGA_THIS s.graphics_ctrl.graphics_alpha) {
+      mark_tile_chain4(offset);
+    }
+    return;
+  }
 
-        switch (BX_VGA_THIS s.graphics_ctrl.raster_op) {
-          case 0: // write
-            new_val[0] |= (set_reset & 1) ? value : 0;
-            new_val[1] |= (set_reset & 2) ? value : 0;
-            new_val[2] |= (set_reset & 4) ? value : 0;
-            new_val[3] |= (set_reset & 8) ? value : 0;
-            break;
-          case 1: // AND
-            new_val[0] |= ((set_reset & 1) ? value : 0)
-              & BX_VGA_THIS s.graphics_ctrl.latch[0];
-            new_val[1] |= ((set_reset & 2) ? value : 0)
-              & BX_VGA_THIS s.graphics_ctrl.latch[1];
-            new_val[2] |= ((set_reset & 4) ? value : 0)
-              & BX_VGA_THIS s.graphics_ctrl.latch[2];
-            new_val[3] |= ((set_reset & 8) ? value : 0)
-              & BX_VGA_THIS s.graphics_ctrl.latch[3];
-            break;
-          case 2: // OR
-            new_val[0] |= ((set_reset & 1) ? value : 0)
-              | BX_VGA_THIS s.graphics_ctrl.latch[0];
-            new_val[1] |= ((set_reset & 2) ? value : 0)
-              | BX_VGA_THIS s.graphics_ctrl.latch[1];
-            new_val[2] |= ((set_reset & 4) ? value : 0)
-              | BX_VGA_THIS s.graphics_ctrl.latch[2];
-            new_val[3] |= ((set_reset & 8) ? value : 0)
-              | BX_VGA_THIS s.graphics_ctrl.latch[3];
-            break;
-          case 3: // XOR
-            new_val[0] |= ((set_reset & 1) ? value : 0)
-              ^ BX_VGA_THIS s.graphics_ctrl.latch[0];
-            new_val[1] |= ((set_reset & 2) ? value : 0)
-              ^ BX_VGA_THIS s.graphics_ctrl.latch[1];
-            new_val[2] |= ((set_reset & 4) ? value : 0)
-              ^ BX_VGA_THIS s.graphics_ctrl.latch[2];
-            new_val[3] |= ((set_reset & 8) ? value : 0)
-              ^ BX_VGA_THIS s.graphics_ctrl.latch[3];
-            break;
-        }
-      }
-      break;
+  offset += BX_VGA_THIS s.ext_offset;
 
-    default:
-      BX_PANIC(("vga_mem_write: write mode %u ?",
-        (unsigned) BX_VGA_THIS s.graphics_ctrl.write_mode));
-  }
+  new_val32 = planar_write_data(value);
 
   if (!BX_VGA_THIS s.sequencer.odd_even_dis) {
+    memcpy(new_val, &new_val32, 4);
     Bit8u plane = offset & 1;
     Bit8u mask = sequ_map_mask & (0x05 << plane);
     if (mask > 0) {
@@ -2179,83 +2242,64 @@ void bx_vgacore_c::mem_write(bx_phy_address addr, Bit8u value)
 
   if (sequ_map_mask & 0x0f) {
     BX_VGA_THIS s.vga_mem_updated |= (sequ_map_mask & 0x0f);
-    if (sequ_map_mask & 0x01)
-      BX_VGA_THIS s.memory[offset << 2] = new_val[0];
-    if (sequ_map_mask & 0x02)
-      BX_VGA_THIS s.memory[(offset << 2) + 1] = new_val[1];
-    if (sequ_map_mask & 0x04)
-      BX_VGA_THIS s.memory[(offset << 2) + 2] = new_val[2];
-    if (sequ_map_mask & 0x08)
-      BX_VGA_THIS s.memory[(offset << 2) + 3] = new_val[3];
+    map_mask32 = vga_plane_mask[sequ_map_mask];
+    memcpy(&old_val32, &BX_VGA_THIS s.memory[offset << 2], 4);
+    old_val32 = (old_val32 & ~map_mask32) | (new_val32 & map_mask32);
+    memcpy(&BX_VGA_THIS s.memory[offset << 2], &old_val32, 4);
 
     if (BX_VGA_THIS s.graphics_ctrl.graphics_alpha) {
-      unsigned x_tileno, y_tileno;
-      if ((BX_VGA_THIS s.CRTC.reg[0x17] & 1) == 0) { // MAP13 (CGA 320x200x4 / 640x200x2)
-        unsigned xc, yc;
+      mark_tile_planar(offset);
+    }
+  }
+}
 
-        if ((BX_VGA_THIS s.CRTC.reg[0x17] & 0x40) == 0) {
-          start_addr <<= 1;
-        }
-        offset -= start_addr;
-        if (offset >= 0x2000) {
-          yc = (((offset - 0x2000) / (320 / 4)) << 1) + 1;
-          xc = ((offset - 0x2000) % (320 / 4)) << 2;
-        } else {
-          yc = (offset / (320 / 4)) << 1;
-          xc = (offset % (320 / 4)) << 2;
-        }
-        if ((BX_VGA_THIS s.graphics_ctrl.shift_reg == 0) || BX_VGA_THIS s.x_dotclockdiv2) {
-          xc <<= 1;
-        }
-        x_tileno = xc / X_TILESIZE;
-        if (BX_VGA_THIS s.y_doublescan) {
-          y_tileno = yc / (Y_TILESIZE / 2);
-        } else {
-          y_tileno = yc / Y_TILESIZE;
-        }
-        SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
-      } else if (BX_VGA_THIS s.graphics_ctrl.shift_reg == 2) {
-        offset -= start_addr;
-        x_tileno = (offset % BX_VGA_THIS s.line_offset) * 4 / (X_TILESIZE / 2);
-        if (BX_VGA_THIS s.y_doublescan) {
-          y_tileno = (offset / BX_VGA_THIS s.line_offset) / (Y_TILESIZE / 2);
-        } else {
-          y_tileno = (offset / BX_VGA_THIS s.line_offset) / Y_TILESIZE;
-        }
-        SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
-      } else {
-        if (BX_VGA_THIS s.line_offset > 0) {
-          if (BX_VGA_THIS s.line_compare < BX_VGA_THIS s.vertical_display_end) {
-            if (BX_VGA_THIS s.x_dotclockdiv2) {
-              x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 16);
-            } else {
-              x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 8);
-            }
-            if (BX_VGA_THIS s.y_doublescan) {
-              y_tileno = ((offset / BX_VGA_THIS s.line_offset) * 2 + BX_VGA_THIS s.line_compare + 1) / Y_TILESIZE;
-            } else {
-              y_tileno = ((offset / BX_VGA_THIS s.line_offset) + BX_VGA_THIS s.line_compare + 1) / Y_TILESIZE;
-            }
-            SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
-          }
-          if (offset >= start_addr) {
-            offset -= start_addr;
-            if (BX_VGA_THIS s.x_dotclockdiv2) {
-              x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 16);
-            } else {
-              x_tileno = (offset % BX_VGA_THIS s.line_offset) / (X_TILESIZE / 8);
-            }
-            if (BX_VGA_THIS s.y_doublescan) {
-              y_tileno = (offset / BX_VGA_THIS s.line_offset) / (Y_TILESIZE / 2);
-            } else {
-              y_tileno = (offset / BX_VGA_THIS s.line_offset) / Y_TILESIZE;
-            }
-            SET_TILE_UPDATED(BX_VGA_THIS, x_tileno, y_tileno, 1);
-          }
-        }
+// Write a run of bytes in one call. Handles the chained (mode 13h) and the
+// sequential planar memory layouts and returns false for anything else,
+// in which case the caller falls back to mem_write() for each byte.
+bool bx_vgacore_c::mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data)
+{
+  Bit32u offset, last, new_val32, old_val32, map_mask32;
+  Bit8u sequ_map_mask = BX_VGA_THIS s.sequencer.map_mask & 0x0f;
+  Bit8u *plane_ptr;
+  unsigned i;
+
+  if (!BX_VGA_THIS s.sequencer.chain_four && !BX_VGA_THIS s.sequencer.odd_even_dis)
+    return 0;
+  if (!mem_decode_addr(addr, &offset) || !mem_decode_addr(addr + len - 1, &last) ||
+      (last != (offset + len - 1)))
+    return 0;
+
+  if (BX_VGA_THIS s.sequencer.chain_four) {
+    memcpy(&BX_VGA_THIS s.memory[offset], data, len);
+    for (i = 0; i < len; i++) {
+      BX_VGA_THIS s.vga_mem_updated |= (1 << ((offset + i) % 4));
+      if (BX_VGA_THIS s.graphics_ctrl.graphics_alpha) {
+        mark_tile_chain4(offset + i);
       }
     }
+    return 1;
+  }
+
+  offset += BX_VGA_THIS s.ext_offset;
+  if (sequ_map_mask == 0)
+    return 1;
+
+  BX_VGA_THIS s.vga_mem_updated |= sequ_map_mask;
+  map_mask32 = vga_plane_mask[sequ_map_mask];
+  plane_ptr = &BX_VGA_THIS s.memory[offset << 2];
+  for (i = 0; i < len; i++) {
+    new_val32 = planar_write_data(data[i]);
+    memcpy(&old_val32, plane_ptr, 4);
+    old_val32 = (old_val32 & ~map_mask32) | (new_val32 & map_mask32);
+    memcpy(plane_ptr, &old_val32, 4);
+    plane_ptr += 4;
+  }
+  if (BX_VGA_THIS s.graphics_ctrl.graphics_alpha) {
+    for (i = 0; i < len; i++) {
+      mark_tile_planar(offset + i);
+    }
   }
+  return 1;
 }
 
 void bx_vgacore_c::get_text_snapshot(Bit8u **text_snapshot, unsigned *txHeight,
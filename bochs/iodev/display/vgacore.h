@@ -69,6 +69,48 @@ typedef struct {
 
 extern const Bit8u ccdat[16][4];
 
+// Page-granular dirty log for linear framebuffers. The memory write path
+// only sets a bit here, the display update converts the dirty pages into
+// dirty tiles once per frame (and does nothing if no page was written).
+#define VGA_DIRTY_PAGE_SHIFT 12
+
+class bx_vga_dirty_log_c {
+public:
+  bx_vga_dirty_log_c();
+  ~bx_vga_dirty_log_c();
+  void init(Bit32u memsize);
+  BX_CPP_INLINE void set_dirty(Bit32u offset, Bit32u len)
+  {
+    Bit32u page = offset >> VGA_DIRTY_PAGE_SHIFT;
+    Bit32u last = (offset + len - 1) >> VGA_DIRTY_PAGE_SHIFT;
+    if (last >= num_pages) last = num_pages - 1;
+    for (; page <= last; page++) {
+      bitmap[page >> 5] |= (1 << (page & 0x1f));
+    }
+    dirty = 1;
+  }
+  void set_all_dirty(void);
+  bool is_dirty(void) const {return dirty;}
+  bool mark_tiles(Bit32u start, Bit32u pitch, unsigned bytespp,
+                  unsigned width, unsigned height, bool xdouble, bool ydouble,
+                  bool *tiles, unsigned num_x_tiles, unsigned num_y_tiles);
+  void clear(void);
+
+private:
+  Bit32u *bitmap;
+  Bit32u num_pages;
+  bool dirty;
+};
+
+// Scanline conversion kernels for the common 32-bit xRGB host format. The
+// loops are kept branch-free so that the compiler can vectorize them.
+bool bx_vga_tile_is_xrgb32(const bx_svga_tileinfo_t *info);
+void bx_vga_convert_8bpp(Bit32u *dst, const Bit8u *src, unsigned w, const Bit32u *palette);
+void bx_vga_convert_15bpp(Bit32u *dst, const Bit8u *src, unsigned w);
+void bx_vga_convert_16bpp(Bit32u *dst, const Bit8u *src, unsigned w);
+void bx_vga_convert_24bpp(Bit32u *dst, const Bit8u *src, unsigned w);
+void bx_vga_convert_32bpp(Bit32u *dst, const Bit8u *src, unsigned w);
+
 #if BX_SUPPORT_PCI
 class bx_nonvga_device_c : public bx_pci_device_c {
 public:
@@ -90,6 +132,7 @@ public:
   static bool    mem_write_handler(bx_phy_address addr, unsigned len, void *data, void *param);
   virtual Bit8u  mem_read(bx_phy_address addr);
   virtual void   mem_write(bx_phy_address addr, Bit8u value);
+  virtual bool   mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data);
   virtual void   set_override(bool enabled, void *dev);
   void           vgacore_register_state(bx_list_c *parent);
   virtual void   after_restore_state(void);
@@ -133,6 +176,10 @@ protected:
   void calculate_retrace_timing(void);
   bool skip_update(void);
   void update_charmap(void);
+  bool mem_decode_addr(bx_phy_address addr, Bit32u *offset);
+  Bit32u planar_write_data(Bit8u value);
+  void mark_tile_chain4(Bit32u offset);
+  void mark_tile_planar(Bit32u offset);
 
   struct {
     struct {
@@ -283,6 +330,9 @@ protected:
 #endif
   } s;  // state information
 
+  // dirty page log of the linear framebuffer (SVGA modes)
+  bx_vga_dirty_log_c fb_dirty;
+
   // vga update timer stuff
   int update_timer_id;
   Bit32u vga_update_interval;
@@ -113,6 +113,12 @@ void voodoo_init_options(void)
     "Selects the Voodoo model to emulate.",
     voodoo_model_list,
     VOODOO_1, VOODOO_1);
+  new bx_param_num_c(menu,
+    "threads",
+    "Rasterizer threads",
+    "Number of additional host threads used for 3D rasterization (0 = disabled).",
+    0, WORK_MAX_THREADS - 1,
+    0);
   enabled->set_dependent_list(menu->clone());
 }
 
@@ -263,8 +269,10 @@ bx_voodoo_base_c::~bx_voodoo_base_c()
     bx_set_sem(&fifo_not_full);
     bx_set_sem(&vertical_sem);
     BX_THREAD_JOIN(fifo_thread_var);
+    voodoo_stop_raster_threads();
     BX_FINI_MUTEX(fifo_mutex);
     BX_FINI_MUTEX(render_mutex);
+    BX_FINI_MUTEX(raster_mutex);
     if (s.model >= VOODOO_2) {
       BX_FINI_MUTEX(cmdfifo_mutex);
     }
@@ -312,6 +320,7 @@ void bx_voodoo_base_c::init(void)
 
   BX_INIT_MUTEX(fifo_mutex);
   BX_INIT_MUTEX(render_mutex);
+  BX_INIT_MUTEX(raster_mutex);
   if (s.model >= VOODOO_2) {
     v->fbi.cmdfifo[0].depth_needed = BX_MAX_BIT32U;
     v->fbi.cmdfifo[1].depth_needed = BX_MAX_BIT32U;
@@ -321,6 +330,7 @@ void bx_voodoo_base_c::init(void)
   voodoo_init(s.model);
   if (s.model >= VOODOO_BANSHEE) {
     banshee_bitblt_init();
+    fb_dirty.init(v->fbi.mask + 1);
     s.max_xres = 1920;
     s.max_yres = 1440;
     v->banshee.tiled_x_remap = new Bit16u[s.max_xres];
@@ -529,6 +539,7 @@ void bx_voodoo_base_c::start_fifo_thread(void)
   bx_set_sem(&fifo_not_full);
   BX_THREAD_CREATE(fifo_thread, this, fifo_thread_var);
   bx_create_sem(&vertical_sem);
+  voodoo_start_raster_threads(SIM->get_param_num("threads", SIM->get_param(BXPN_VOODOO))->get());
 }
 
 void bx_voodoo_base_c::refresh_display(bool redraw)
@@ -87,6 +87,8 @@ public:
 
 protected:
   bx_voodoo_t s;
+  // dirty page log of the Banshee / Voodoo3 linear framebuffer
+  bx_vga_dirty_log_c fb_dirty;
 
   void voodoo_register_state(bx_list_c *parent);
   void set_irq_level(bool level);
@@ -203,6 +205,7 @@ public:
 
   virtual Bit8u  mem_read(bx_phy_address addr);
   virtual void   mem_write(bx_phy_address addr, Bit8u value);
+  virtual bool   mem_write_block(bx_phy_address addr, unsigned len, const Bit8u *data);
 
   virtual void   refresh_display(bool redraw);
   virtual void   redraw_area(unsigned x0, unsigned y0,
@@ -71,6 +71,14 @@ BX_MUTEX(fifo_mutex);
 bx_thread_sem_t fifo_wakeup;
 bx_thread_sem_t fifo_not_full;
 static bx_thread_sem_t vertical_sem;
+/* rasterizer worker threads */
+static int raster_threads = 0;
+static bool raster_keep_alive = 0;
+static int raster_thread_id[WORK_MAX_THREADS];
+BX_THREAD_VAR(raster_thread_var[WORK_MAX_THREADS]);
+BX_MUTEX(raster_mutex);
+static bx_thread_sem_t raster_wakeup[WORK_MAX_THREADS];
+static bx_thread_sem_t raster_done;
 
 /* fast dither lookup */
 static Bit8u dither4_lookup[256*16*2];
@@ -474,6 +482,119 @@ BX_CPP_INLINE Bit32s round_coordinate(float value)
   return result + (value - (float)result > 0.5f);
 }
 
+/*************************************
+ *
+ *  Rasterizer worker threads
+ *
+ *************************************/
+
+/* scanlines are handed out in interleaved bands of 8 lines */
+#define RASTER_BAND_SHIFT     3
+/* smaller primitives are not worth waking up the workers */
+#define RASTER_MIN_SCANLINES  32
+#define RASTER_MAX_SCANLINES  4096
+
+static void raster_fastfill(void *destbase, Bit32s y, const poly_extent *extent, const void *extradata, int threadid);
+
+typedef struct
+{
+  void *dest;
+  int texcount;                 /* number of TMUs or -1 for fastfill */
+  Bit32s startscan;
+  Bit32s numscans;
+  const poly_extent *extents;
+  const poly_extra_data *extra;
+} raster_work_item;
+
+static raster_work_item raster_work;
+static poly_extent raster_extents[RASTER_MAX_SCANLINES];
+
+static void raster_work_bands(int threadid)
+{
+  const raster_work_item *work = &raster_work;
+  Bit32s stride = (raster_threads + 1) << RASTER_BAND_SHIFT;
+  Bit32s band, i, end;
+
+  for (band = threadid << RASTER_BAND_SHIFT; band < work->numscans; band += stride) {
+    end = MIN(band + (1 << RASTER_BAND_SHIFT), work->numscans);
+    for (i = band; i < end; i++) {
+      if (work->texcount < 0)
+        raster_fastfill(work->dest, work->startscan + i, &work->extents[i], work->extra, threadid);
+      else
+        raster_function(work->texcount, work->dest, work->startscan + i, &work->extents[i], work->extra, threadid);
+    }
+  }
+}
+
+BX_THREAD_FUNC(raster_thread, indata)
+{
+  int threadid = *(int*)indata;
+
+  while (raster_keep_alive) {
+    bx_wait_sem(&raster_wakeup[threadid]);
+    if (!raster_keep_alive) break;
+    raster_work_bands(threadid);
+    bx_set_sem(&raster_done);
+  }
+  BX_THREAD_EXIT;
+}
+
+/* the caller must hold raster_mutex */
+static void raster_dispatch(void *dest, int texcount, Bit32s startscan, Bit32s numscans,
+                            const poly_extent *extents, const poly_extra_data *extra)
+{
+  int i;
+
+  raster_work.dest = dest;
+  raster_work.texcount = texcount;
+  raster_work.startscan = startscan;
+  raster_work.numscans = numscans;
+  raster_work.extents = extents;
+  raster_work.extra = extra;
+  for (i = 1; i <= raster_threads; i++)
+    bx_set_sem(&raster_wakeup[i]);
+  raster_work_bands(0);
+  /* wait for all bands to preserve the primitive order */
+  for (i = 1; i <= raster_threads; i++)
+    bx_wait_sem(&raster_done);
+}
+
+BX_CPP_INLINE bool raster_use_threads(Bit32s numscans)
+{
+  return (raster_threads > 0) && (numscans >= RASTER_MIN_SCANLINES) &&
+         (numscans <= RASTER_MAX_SCANLINES);
+}
+
+void voodoo_start_raster_threads(int count)
+{
+  raster_threads = MIN(count, WORK_MAX_THREADS - 1);
+  if (raster_threads > 0) {
+    raster_keep_alive = 1;
+    bx_create_sem(&raster_done);
+    for (int i = 1; i <= raster_threads; i++) {
+      raster_thread_id[i] = i;
+      bx_create_sem(&raster_wakeup[i]);
+      BX_THREAD_CREATE(raster_thread, &raster_thread_id[i], raster_thread_var[i]);
+    }
+    BX_INFO(("using %d rasterizer worker thread(s)", raster_threads));
+  }
+}
+
+void voodoo_stop_raster_threads(void)
+{
+  if (raster_keep_alive) {
+    raster_keep_alive = 0;
+    for (int i = 1; i <= raster_threads; i++) {
+      bx_set_sem(&raster_wakeup[i]);
+      BX_THREAD_JOIN(raster_thread_var[i]);
+      bx_destroy_sem(&raster_wakeup[i]);
+    }
+    bx_destroy_sem(&raster_done);
+  }
+  raster_threads = 0;
+}
+
+
 Bit32u poly_render_triangle(void *dest, const rectangle *cliprect, int texcount, int paramcount, const poly_vertex *v1, const poly_vertex *v2, const poly_vertex *v3, poly_extra_data *extra)
 {
   float dxdy_v1v2, dxdy_v1v3, dxdy_v2v3;
@@ -483,6 +604,7 @@ Bit32u poly_render_triangle(void *dest, const rectangle *cliprect, int texcount,
   Bit32s v1yclip, v3yclip;
   Bit32s v1y, v3y;
   Bit32s pixels = 0;
+  bool threaded;
 
   /* first sort by Y */
   if (v2->y < v1->y)
@@ -524,6 +646,11 @@ Bit32u poly_render_triangle(void *dest, const rectangle *cliprect, int texcount,
   dxdy_v1v3 = (v3->y == v1->y) ? 0.0f : (v3->x - v1->x) / (v3->y - v1->y);
   dxdy_v2v3 = (v3->y == v2->y) ? 0.0f : (v3->x - v2->x) / (v3->y - v2->y);
 
+  /* large triangles are split into bands for the worker threads */
+  threaded = raster_use_threads(v3yclip - v1yclip);
+  if (threaded)
+    BX_LOCK(raster_mutex);
+
   /* compute the X extents for each scanline */
   poly_extent extent;
   int extnum=0;
@@ -567,12 +694,20 @@ Bit32u poly_render_triangle(void *dest, const rectangle *cliprect, int texcount,
         istartx = istopx = 0;
       extent.startx = istartx;
       extent.stopx = istopx;
-      raster_function(texcount,dest,curscan,&extent,extra,0);
+      if (threaded)
+        raster_extents[curscan - v1yclip] = extent;
+      else
+        raster_function(texcount,dest,curscan,&extent,extra,0);
 
       pixels += istopx - istartx;
     }
   }
 
+  if (threaded) {
+    raster_dispatch(dest, texcount, v1yclip, v3yclip - v1yclip, raster_extents, extra);
+    BX_UNLOCK(raster_mutex);
+  }
+
   return pixels;
 }
 
@@ -969,6 +1104,7 @@ Bit32u poly_render_triangle_custom(void *dest, const rectangle *cliprect, int st
   Bit32s curscan, scaninc;
   Bit32s v1yclip, v3yclip;
   Bit32s pixels = 0;
+  bool threaded;
 
   /* clip coordinates */
   if (cliprect != NULL)
@@ -984,6 +1120,13 @@ Bit32u poly_render_triangle_custom(void *dest, const rectangle *cliprect, int st
   if (v3yclip - v1yclip <= 0)
     return 0;
 
+  threaded = raster_use_threads(v3yclip - v1yclip);
+  if (threaded) {
+    BX_LOCK(raster_mutex);
+    raster_dispatch(dest, -1, v1yclip, v3yclip - v1yclip, &extents[v1yclip - startscanline], extra);
+    BX_UNLOCK(raster_mutex);
+  }
+
   /* compute the X extents for each scanline */
   for (curscan = v1yclip; curscan < v3yclip; curscan += scaninc)
   {
@@ -1015,7 +1158,8 @@ Bit32u poly_render_triangle_custom(void *dest, const rectangle *cliprect, int st
       }
 
       /* set the extent and update the total pixel count */
-      raster_fastfill(dest,curscan,extent,extra,0);
+      if (!threaded)
+        raster_fastfill(dest,curscan,extent,extra,0);
       if (istartx < istopx)
         pixels += istopx - istartx;
     }
@@ -1102,10 +1246,17 @@ Bit32s fastfill(voodoo_state *v)
   return pixels / 2;
 }
 
+static void update_statistics(voodoo_state *v, int accumulate);
+
 void swap_buffers(voodoo_state *v)
 {
   int count;
 
+  /* merge the per-thread pixel statistics */
+  BX_LOCK(raster_mutex);
+  update_statistics(v, TRUE);
+  BX_UNLOCK(raster_mutex);
+
   /* force a partial update */
   v->fbi.video_changed = 1;
 
@@ -1189,6 +1340,12 @@ static void accumulate_statistics(voodoo_state *v, const stats_block *stats)
   v->reg[fbiChromaFail].u += stats->chroma_fail;
   v->reg[fbiZfuncFail].u += stats->zfunc_fail;
   v->reg[fbiAfuncFail].u += stats->afunc_fail;
+  /* the counters are 24 bits wide */
+  v->reg[fbiPixelsIn].u &= 0xffffff;
+  v->reg[fbiPixelsOut].u &= 0xffffff;
+  v->reg[fbiChromaFail].u &= 0xffffff;
+  v->reg[fbiZfuncFail].u &= 0xffffff;
+  v->reg[fbiAfuncFail].u &= 0xffffff;
 }
 
 static void update_statistics(voodoo_state *v, int accumulate)
@@ -4091,7 +4248,7 @@ void voodoo_init(Bit8u _type)
 
   v->tmu_config = 64;
 
-  v->thread_stats = new stats_block[16];
+  v->thread_stats = new stats_block[WORK_MAX_THREADS];
 
   soft_reset(v);
 }
@@ -290,6 +290,13 @@ void bx_hard_drive_c::init(void)
       BX_HD_THIS channels[channel].drives[device].identify_set = 0;
       if (SIM->get_param_enum("type", base)->get() == BX_ATA_DEVICE_NONE) continue;
 
+#if BX_ENABLE_STATISTICS
+      char stats_name[16];
+      sprintf(stats_name, "ata%d-%s", channel, (device==0)?"master":"slave");
+      BX_DRIVE(channel,device).read_bytes = bx_stats_counter("disk", stats_name, "read_bytes");
+      BX_DRIVE(channel,device).write_bytes = bx_stats_counter("disk", stats_name, "write_bytes");
+#endif
+
       // Make model string
       strncpy((char*)BX_HD_THIS channels[channel].drives[device].model_no,
         SIM->get_param_string("model", base)->getptr(), 40);
@@ -443,6 +450,11 @@ void bx_hard_drive_c::init(void)
         BX_HD_THIS channels[channel].drives[device].controller.buffer =
           new Bit8u[BX_HD_THIS channels[channel].drives[device].controller.buffer_total_size + 4];
         // register timer for HD/CD seek emulation
+        BX_DRIVE(channel,device).timing = SIM->get_param_enum("timing", base)->get();
+        if (BX_DRIVE(channel,device).timing != BX_DISK_TIMING_REALISTIC) {
+          BX_INFO(("ata%d-%d: using '%s' timing model", channel, device,
+                   SIM->get_param_enum("timing", base)->get_selected()));
+        }
         if (BX_DRIVE(channel,device).seek_timer_index == BX_NULL_TIMER_HANDLE) {
           BX_DRIVE(channel,device).seek_timer_index =
             DEV_register_timer(this, seek_timer_handler, 1000, 0, 0, "HD/CD seek");
@@ -958,6 +970,7 @@ Bit32u bx_hard_drive_c::read(Bit32u address, unsigned io_len)
                   {
                     BX_PANIC(("CDROM: read block %d failed", BX_SELECTED_DRIVE(channel).cdrom.next_lba));
                   }
+                  ADD_STAT(*BX_SELECTED_DRIVE(channel).read_bytes, controller->buffer_size);
                   BX_SELECTED_DRIVE(channel).cdrom.next_lba++;
                   BX_SELECTED_DRIVE(channel).cdrom.remaining_blocks--;
 
@@ -3688,6 +3701,7 @@ bool bx_hard_drive_c::bmdma_read_sector(Bit8u channel, Bit8u *buffer, Bit32u *se
             BX_PANIC(("CDROM: read block %d failed", BX_SELECTED_DRIVE(channel).cdrom.next_lba));
             return 0;
           }
+          ADD_STAT(*BX_SELECTED_DRIVE(channel).read_bytes, controller->buffer_size);
           BX_SELECTED_DRIVE(channel).cdrom.next_lba++;
           BX_SELECTED_DRIVE(channel).cdrom.remaining_blocks--;
           if (!BX_SELECTED_DRIVE(channel).cdrom.remaining_blocks) {
@@ -3802,6 +3816,7 @@ bool bx_hard_drive_c::ide_read_sector(Bit8u channel, Bit8u *buffer, Bit32u buffe
       command_aborted(channel, controller->current_command);
       return 0;
     }
+    ADD_STAT(*BX_SELECTED_DRIVE(channel).read_bytes, sect_size);
     increment_address(channel, &logical_sector);
     BX_SELECTED_DRIVE(channel).next_lsector = logical_sector;
     bufptr += sect_size;
@@ -3839,6 +3854,7 @@ bool bx_hard_drive_c::ide_write_sector(Bit8u channel, Bit8u *buffer, Bit32u buff
       command_aborted(channel, controller->current_command);
       return 0;
     }
+    ADD_STAT(*BX_SELECTED_DRIVE(channel).write_bytes, sect_size);
     increment_address(channel, &logical_sector);
     BX_SELECTED_DRIVE(channel).next_lsector = logical_sector;
     bufptr += sect_size;
@@ -3868,6 +3884,7 @@ void bx_hard_drive_c::lba48_transform(controller_t *controller, bool lba48)
 void bx_hard_drive_c::start_seek(Bit8u channel)
 {
   Bit64s new_pos, prev_pos, max_pos;
+  Bit64u xfer_bytes;
   Bit32u seek_time;
   double fSeekBase, fSeekTime;
 
@@ -3876,14 +3893,21 @@ void bx_hard_drive_c::start_seek(Bit8u channel)
     prev_pos = BX_SELECTED_DRIVE(channel).cdrom.curr_lba;
     new_pos = BX_SELECTED_DRIVE(channel).cdrom.next_lba;
     fSeekBase = 80000.0;
+    xfer_bytes = (Bit64u)BX_SELECTED_DRIVE(channel).cdrom.remaining_blocks * 2048;
   } else {
     max_pos = (BX_SELECTED_DRIVE(channel).hdimage->hd_size / BX_SELECTED_DRIVE(channel).hdimage->sect_size) - 1;
     prev_pos = BX_SELECTED_DRIVE(channel).curr_lsector;
     new_pos = BX_SELECTED_DRIVE(channel).next_lsector;
     fSeekBase = 5000.0;
+    xfer_bytes = (Bit64u)BX_SELECTED_CONTROLLER(channel).num_sectors *
+                 BX_SELECTED_DRIVE(channel).sect_size;
+  }
+  if (BX_SELECTED_DRIVE(channel).timing != BX_DISK_TIMING_REALISTIC) {
+    seek_time = bx_disk_timing_delay(BX_SELECTED_DRIVE(channel).timing, xfer_bytes);
+  } else {
+    fSeekTime = fSeekBase * (double)abs((int)(new_pos - prev_pos + 1)) / (max_pos + 1);
+    seek_time = (fSeekTime > 10.0) ? (Bit32u)fSeekTime : 10;
   }
-  fSeekTime = fSeekBase * (double)abs((int)(new_pos - prev_pos + 1)) / (max_pos + 1);
-  seek_time = (fSeekTime > 10.0) ? (Bit32u)fSeekTime : 10;
   bx_pc_system.activate_timer(BX_SELECTED_DRIVE(channel).seek_timer_index, seek_time, 0);
 }
 
@@ -254,9 +254,14 @@ private:
 
       Bit8u model_no[41];
       int statusbar_id;
+#if BX_ENABLE_STATISTICS
+      Bit64u *read_bytes;   // statistics.disk.<ataX-device>.read_bytes/write_bytes
+      Bit64u *write_bytes;
+#endif
       Bit8u device_num; // for ATAPI identify & inquiry
       int  status_changed;
       int seek_timer_index;
+      int timing;
     } drives[2];
     unsigned drive_select;
 
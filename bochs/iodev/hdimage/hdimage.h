@@ -614,6 +614,27 @@ class volatile_image_t : public device_image_t
 
 #ifndef BXIMAGE
 
+// disk timing models (ATA, ATAPI and USB mass storage devices)
+enum {
+  BX_DISK_TIMING_REALISTIC,
+  BX_DISK_TIMING_SSD,
+  BX_DISK_TIMING_INSTANT
+};
+
+// Command completion delay of the non-mechanical disk timing models: 'ssd'
+// uses a fixed command latency plus the transfer time at constant bandwidth,
+// 'instant' completes after the shortest timer period.
+#define BX_SSD_LATENCY_USEC    20
+#define BX_SSD_BYTES_PER_USEC  512  // ~500 MB/s
+
+BX_CPP_INLINE Bit32u bx_disk_timing_delay(int timing, Bit64u bytes)
+{
+  if (timing == BX_DISK_TIMING_SSD) {
+    return BX_SSD_LATENCY_USEC + (Bit32u)(bytes / BX_SSD_BYTES_PER_USEC);
+  }
+  return 1;
+}
+
 #define DEV_hdimage_init_image(a,b,c) bx_hdimage_ctl.init_image(a,b,c)
 #define DEV_hdimage_init_cdrom(a)     bx_hdimage_ctl.init_cdrom(a)
 
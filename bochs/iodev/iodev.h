@@ -158,11 +158,14 @@ typedef struct {
 
 class BOCHSAPI bx_pci_device_c : public bx_devmodel_c {
 public:
-  bx_pci_device_c(): pci_rom(NULL) {
+  bx_pci_device_c(): pci_rom(NULL), msi_cap(0), msi_len(0), msix_cap(0), msix_nvec(0),
+                     msix_table(NULL), msix_pba(NULL) {
     for (int i = 0; i < 7; i++) memset(&pci_bar[i], 0, sizeof(bx_pci_bar_t));
   }
   virtual ~bx_pci_device_c() {
     if (pci_rom != NULL) delete [] pci_rom;
+    if (msix_table != NULL) delete [] msix_table;
+    if (msix_pba != NULL) delete [] msix_pba;
   }
 
   virtual Bit32u pci_read_handler(Bit8u address, unsigned io_len);
@@ -179,6 +182,14 @@ public:
   void after_restore_pci_state(void);
   void load_pci_rom(const char *path, memory_handler_t mem_read_handler);
 
+  // MSI / MSI-X capabilities (messages are sent to the local APICs)
+  void init_msi(Bit8u cap, unsigned nvec, bool pvm);
+  void init_msix(Bit8u cap, unsigned nvec, Bit8u bar, Bit32u table_offset, Bit32u pba_offset);
+  void pci_msi_reset(void);
+  bool pci_msi_enabled(void) const;
+  void pci_msi_notify(unsigned vector);
+  bool msix_mmio_access(Bit32u offset, unsigned len, void *data, bool write);
+
   void set_name(const char *name) {pci_name = name;}
   const char* get_name(void) {return pci_name;}
 
@@ -187,6 +198,23 @@ protected:
   Bit8u pci_conf[256];
   bx_pci_bar_t pci_bar[7];
   Bit8u  *pci_rom;
+
+private:
+  void msi_write(Bit8u address, Bit8u value);
+  void msi_send(Bit64u addr, Bit32u data);
+  void msix_deliver_pending(void);
+  static bool msix_read_handler(bx_phy_address addr, unsigned len, void *data, void *param);
+  static bool msix_write_handler(bx_phy_address addr, unsigned len, void *data, void *param);
+
+  Bit8u  msi_cap;           // config space offset of the capability, 0 = none
+  Bit8u  msi_len;
+  Bit8u  msix_cap;
+  Bit16u msix_nvec;
+  Bit8u  msix_bar;
+  Bit32u msix_table_offset;
+  Bit32u msix_pba_offset;
+  Bit8u  *msix_table;       // 16 bytes per vector: address, data, control
+  Bit8u  *msix_pba;         // pending bits
 };
 #endif
 
@@ -398,6 +426,10 @@ public:
   void exit(void);
   void register_state(void);
   void after_restore_state(void);
+#if BX_ENABLE_STATISTICS
+  // name of the device with an I/O handler registered for this_ptr
+  const char *get_device_name(void *this_ptr);
+#endif
   BX_MEM_C *mem;  // address space associated with these devices
   bool register_io_read_handler(void *this_ptr, bx_read_handler_t f,
                                 Bit32u addr, const char *name, Bit8u mask);
@@ -525,6 +557,9 @@ private:
     char *handler_name;  // name of device
     int usage_count;
     Bit8u mask;          // io_len mask
+#if BX_ENABLE_STATISTICS
+    Bit64u *count;       // statistics.io.<name>.reads/writes
+#endif
   };
   struct io_handler_struct io_read_handlers;
   struct io_handler_struct io_write_handlers;
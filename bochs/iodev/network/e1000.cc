@@ -576,6 +576,10 @@ void bx_e1000_c::init_card(Bit8u card)
 
   // Attach to the selected ethernet module
   BX_E1000_THIS ethdev = DEV_net_init_module(base, rx_handler, rx_status_handler, this);
+#if BX_ENABLE_STATISTICS
+  BX_E1000_THIS rx_bytes = bx_stats_counter("net", get_name(), "rx_bytes");
+  BX_E1000_THIS tx_bytes = bx_stats_counter("net", get_name(), "tx_bytes");
+#endif
 
   BX_INFO(("E1000 initialized"));
 }
@@ -1197,6 +1201,7 @@ void bx_e1000_c::send_packet(Bit8u *buf, Bit16u size)
   if ((BX_E1000_THIS s.phy_reg[PHY_CTRL] & 0x4000) != 0) {
     BX_E1000_THIS rx_frame(buf, size);
   } else {
+    ADD_STAT(*BX_E1000_THIS tx_bytes, size);
     BX_E1000_THIS ethdev->sendpkt(buf, size);
   }
 }
@@ -1461,6 +1466,7 @@ Bit32u bx_e1000_c::rx_status()
 void bx_e1000_c::rx_handler(void *arg, const void *buf, unsigned len)
 {
   bx_e1000_c *class_ptr = (bx_e1000_c *) arg;
+  ADD_STAT(*class_ptr->rx_bytes, len);
   class_ptr->rx_frame(buf, len);
 }
 
@@ -127,6 +127,10 @@ private:
   bx_e1000_t s;
 
   eth_pktmover_c *ethdev;
+#if BX_ENABLE_STATISTICS
+  Bit64u *rx_bytes;  // statistics.net.<name>.rx_bytes/tx_bytes
+  Bit64u *tx_bytes;
+#endif
 
   void    set_irq_level(bool level);
   void    set_interrupt_cause(Bit32u val);
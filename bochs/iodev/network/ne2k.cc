@@ -424,6 +424,10 @@ void bx_ne2k_c::init_card(Bit8u card)
 
   // Attach to the selected ethernet module
   BX_NE2K_THIS ethdev = DEV_net_init_module(base, rx_handler, rx_status_handler, this);
+#if BX_ENABLE_STATISTICS
+  BX_NE2K_THIS rx_bytes = bx_stats_counter("net", get_name(), "rx_bytes");
+  BX_NE2K_THIS tx_bytes = bx_stats_counter("net", get_name(), "tx_bytes");
+#endif
 
 #if BX_DEBUGGER
   // register device for the 'info device' command (calls debug_dump())
@@ -669,6 +673,7 @@ void bx_ne2k_c::write_cr(Bit32u value)
     if (tx_start_ofs + BX_NE2K_THIS s.tx_bytes > BX_NE2K_MEMEND)
       BX_PANIC(("tx start with start offset %d and byte count %d would overrun memory",
                 tx_start_ofs, BX_NE2K_THIS s.tx_bytes));
+    ADD_STAT(*BX_NE2K_THIS tx_bytes, BX_NE2K_THIS s.tx_bytes);
     BX_NE2K_THIS ethdev->sendpkt(& BX_NE2K_THIS s.mem[tx_start_ofs - BX_NE2K_MEMSTART], BX_NE2K_THIS s.tx_bytes);
 
     // some more debug
@@ -1674,6 +1679,7 @@ void bx_ne2k_c::rx_handler(void *arg, const void *buf, unsigned len)
     // BX_DEBUG(("rx_handler with length %d", len));
   bx_ne2k_c *class_ptr = (bx_ne2k_c *) arg;
 
+  ADD_STAT(*class_ptr->rx_bytes, len);
   class_ptr->rx_frame(buf, len);
 }
 
@@ -224,6 +224,10 @@ private:
   bx_ne2k_t s;
 
   eth_pktmover_c *ethdev;
+#if BX_ENABLE_STATISTICS
+  Bit64u *rx_bytes;  // statistics.net.<name>.rx_bytes/tx_bytes
+  Bit64u *tx_bytes;
+#endif
 
   Bit32u read_cr(void);
   void   write_cr(Bit32u value);
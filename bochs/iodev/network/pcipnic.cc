@@ -165,6 +165,10 @@ void bx_pcipnic_c::init(void)
 
   // Attach to the selected ethernet module
   BX_PNIC_THIS ethdev = DEV_net_init_module(base, rx_handler, rx_status_handler, this);
+#if BX_ENABLE_STATISTICS
+  BX_PNIC_THIS rx_bytes = bx_stats_counter("net", get_name(), "rx_bytes");
+  BX_PNIC_THIS tx_bytes = bx_stats_counter("net", get_name(), "tx_bytes");
+#endif
 
   BX_PNIC_THIS init_bar_io(4, 16, read_handler, write_handler, &pnic_iomask[0]);
   bootrom = SIM->get_param_string("bootrom", base);
@@ -449,6 +453,7 @@ void bx_pcipnic_c::exec_command(void)
     break;
 
   case PNIC_CMD_XMIT:
+    ADD_STAT(*BX_PNIC_THIS tx_bytes, ilength);
     BX_PNIC_THIS ethdev->sendpkt(data, ilength);
     bx_gui->statusbar_setitem(BX_PNIC_THIS s.statusbar_id, 1, 1);
     if (BX_PNIC_THIS s.irqEnabled) {
@@ -535,6 +540,7 @@ void bx_pcipnic_c::rx_handler(void *arg, const void *buf, unsigned len)
 {
     // BX_DEBUG(("rx_handler with length %d", len));
   bx_pcipnic_c *class_ptr = (bx_pcipnic_c *) arg;
+  ADD_STAT(*class_ptr->rx_bytes, len);
   class_ptr->rx_frame(buf, len);
 }
 
@@ -89,6 +89,10 @@ private:
 #endif
 
   eth_pktmover_c *ethdev;
+#if BX_ENABLE_STATISTICS
+  Bit64u *rx_bytes;  // statistics.net.<name>.rx_bytes/tx_bytes
+  Bit64u *tx_bytes;
+#endif
   static void exec_command(void);
 
   static Bit32u rx_status_handler(void *arg);
@@ -103,8 +103,13 @@ void serial_init_options(void)
     bx_param_filename_c *path = new bx_param_filename_c(menu, "dev", label,
       "The path can be a real serial device or a pty (X/Unix only)",
       "", BX_PATHNAME_LEN);
+    sprintf(label, "Fast UART mode for COM%d", i+1);
+    bx_param_bool_c *fast = new bx_param_bool_c(menu, "fast", label,
+      "Use a 128 byte FIFO and pass data to the host without baud rate pacing",
+      0);
     bx_list_c *deplist = new bx_list_c(NULL);
     deplist->add(mode);
+    deplist->add(fast);
     enabled->set_dependent_list(deplist);
     deplist = new bx_list_c(NULL);
     deplist->add(path);
@@ -204,6 +209,9 @@ bx_serial_c::~bx_serial_c(void)
     sprintf(pname, "ports.serial.%d", i+1);
     base = (bx_list_c*) SIM->get_param(pname);
     if (SIM->get_param_bool("enabled", base)->get()) {
+      if (BX_SER_THIS s[i].tx_buf_len > 0) {
+        tx_flush(i);
+      }
       switch (BX_SER_THIS s[i].io_mode) {
         case BX_SER_MODE_FILE:
           if (BX_SER_THIS s[i].output != NULL)
@@ -583,14 +591,23 @@ bx_serial_c::init(void)
       } else if (mode != BX_SER_MODE_NULL) {
         BX_PANIC(("unknown serial i/o mode %d", mode));
       }
+      BX_SER_THIS s[i].fast_mode = SIM->get_param_bool("fast", base)->get();
+      if (BX_SER_THIS s[i].fast_mode && (BX_SER_THIS s[i].io_mode == BX_SER_MODE_RAW)) {
+        BX_ERROR(("com%d: fast mode not supported with a real serial port", i+1));
+        BX_SER_THIS s[i].fast_mode = 0;
+      }
+      BX_SER_THIS s[i].fifo_size = BX_SER_THIS s[i].fast_mode ?
+                                   BX_SER_FAST_FIFO_SIZE : BX_SER_FIFO_SIZE;
+      BX_SER_THIS s[i].tx_buf_len = 0;
       // simulate device connected
       if (BX_SER_THIS s[i].io_mode != BX_SER_MODE_RAW) {
         BX_SER_THIS s[i].modem_status.cts = 1;
         BX_SER_THIS s[i].modem_status.dsr = 1;
       }
       count++;
-      BX_INFO(("com%d at 0x%04x irq %d (mode: %s)", i+1, ports[i], BX_SER_THIS s[i].IRQ,
-               serial_mode_list[BX_SER_THIS s[i].io_mode]));
+      BX_INFO(("com%d at 0x%04x irq %d (mode: %s%s)", i+1, ports[i], BX_SER_THIS s[i].IRQ,
+               serial_mode_list[BX_SER_THIS s[i].io_mode],
+               BX_SER_THIS s[i].fast_mode ? ", fast" : ""));
     }
   }
   // Check if the device is disabled or not configured
@@ -677,8 +694,8 @@ void bx_serial_c::register_state(void)
     BXRS_PARAM_BOOL(mstatus, dcd, BX_SER_THIS s[i].modem_status.dcd);
     new bx_shadow_num_c(port, "scratch", &BX_SER_THIS s[i].scratch, BASE_HEX);
     new bx_shadow_num_c(port, "tsrbuffer", &BX_SER_THIS s[i].tsrbuffer, BASE_HEX);
-    new bx_shadow_data_c(port, "rx_fifo", BX_SER_THIS s[i].rx_fifo, 16, 1);
-    new bx_shadow_data_c(port, "tx_fifo", BX_SER_THIS s[i].tx_fifo, 16, 1);
+    new bx_shadow_data_c(port, "rx_fifo", BX_SER_THIS s[i].rx_fifo, BX_SER_THIS s[i].fifo_size, 1);
+    new bx_shadow_data_c(port, "tx_fifo", BX_SER_THIS s[i].tx_fifo, BX_SER_THIS s[i].fifo_size, 1);
     new bx_shadow_num_c(port, "divisor_lsb", &BX_SER_THIS s[i].divisor_lsb, BASE_HEX);
     new bx_shadow_num_c(port, "divisor_msb", &BX_SER_THIS s[i].divisor_msb, BASE_HEX);
   }
@@ -832,8 +849,9 @@ Bit32u bx_serial_c::read(Bit32u address, unsigned io_len)
         if (BX_SER_THIS s[port].fifo_cntl.enable) {
           val = BX_SER_THIS s[port].rx_fifo[0];
           if (BX_SER_THIS s[port].rx_fifo_end > 0) {
-            memmove(&BX_SER_THIS s[port].rx_fifo[0], &BX_SER_THIS s[port].rx_fifo[1], 15);
             BX_SER_THIS s[port].rx_fifo_end--;
+            memmove(&BX_SER_THIS s[port].rx_fifo[0], &BX_SER_THIS s[port].rx_fifo[1],
+                    BX_SER_THIS s[port].rx_fifo_end);
           }
           if (BX_SER_THIS s[port].rx_fifo_end == 0) {
             BX_SER_THIS s[port].line_status.rxdata_ready = 0;
@@ -1046,7 +1064,22 @@ void bx_serial_c::write(Bit32u address, Bit32u value, unsigned io_len)
       } else {
         Bit8u bitmask = 0xff >> (3 - BX_SER_THIS s[port].line_cntl.wordlen_sel);
         value &= bitmask;
-        if (BX_SER_THIS s[port].line_status.thr_empty) {
+        if (BX_SER_THIS s[port].fast_mode &&
+            !BX_SER_THIS s[port].modem_cntl.local_loopback) {
+          // no baud rate pacing: the byte leaves the UART at once and
+          // the host backend is written when the burst is over
+          if (BX_SER_THIS s[port].tx_buf_len == BX_SER_TX_BUF_SIZE) {
+            tx_flush(port);
+          }
+          if (BX_SER_THIS s[port].tx_buf_len == 0) {
+            bx_pc_system.activate_timer(BX_SER_THIS s[port].tx_timer_index,
+                                        BX_SER_FAST_TX_USEC,
+                                        0); /* not continuous */
+          }
+          BX_SER_THIS s[port].tx_buf[BX_SER_THIS s[port].tx_buf_len++] = value;
+          BX_SER_THIS s[port].tx_interrupt = false;
+          raise_interrupt(port, BX_SER_INT_TXHOLD);
+        } else if (BX_SER_THIS s[port].line_status.thr_empty) {
           if (BX_SER_THIS s[port].fifo_cntl.enable &&
               !BX_SER_THIS s[port].modem_cntl.local_loopback) {
             BX_SER_THIS s[port].tx_fifo[BX_SER_THIS s[port].tx_fifo_end++] = value;
@@ -1058,8 +1091,9 @@ void bx_serial_c::write(Bit32u address, Bit32u value, unsigned io_len)
             if (BX_SER_THIS s[port].fifo_cntl.enable &&
                 !BX_SER_THIS s[port].modem_cntl.local_loopback) {
               BX_SER_THIS s[port].tsrbuffer = BX_SER_THIS s[port].tx_fifo[0];
-              memmove(&BX_SER_THIS s[port].tx_fifo[0], &BX_SER_THIS s[port].tx_fifo[1], 15);
               BX_SER_THIS s[port].line_status.thr_empty = (--BX_SER_THIS s[port].tx_fifo_end == 0);
+              memmove(&BX_SER_THIS s[port].tx_fifo[0], &BX_SER_THIS s[port].tx_fifo[1],
+                      BX_SER_THIS s[port].tx_fifo_end);
             } else {
               BX_SER_THIS s[port].tsrbuffer = BX_SER_THIS s[port].thrbuffer;
               BX_SER_THIS s[port].line_status.thr_empty = 1;
@@ -1082,7 +1116,7 @@ void bx_serial_c::write(Bit32u address, Bit32u value, unsigned io_len)
           }
         } else {
           if (BX_SER_THIS s[port].fifo_cntl.enable) {
-            if (BX_SER_THIS s[port].tx_fifo_end < 16) {
+            if (BX_SER_THIS s[port].tx_fifo_end < BX_SER_THIS s[port].fifo_size) {
               BX_SER_THIS s[port].tx_fifo[BX_SER_THIS s[port].tx_fifo_end++] = value;
             } else {
               BX_ERROR(("com%d: transmit FIFO overflow", port+1));
@@ -1408,7 +1442,7 @@ void bx_serial_c::rx_fifo_enq(Bit8u port, Bit8u data)
   bool gen_int = false;
 
   if (BX_SER_THIS s[port].fifo_cntl.enable) {
-    if (BX_SER_THIS s[port].rx_fifo_end == 16) {
+    if (BX_SER_THIS s[port].rx_fifo_end == BX_SER_THIS s[port].fifo_size) {
       if (!BX_SER_THIS s[port].modem_cntl.local_loopback) {
         BX_ERROR(("com%d: receive FIFO overflow", port+1));
       }
@@ -1458,11 +1492,8 @@ void bx_serial_c::tx_timer_handler(void *this_ptr)
   class_ptr->tx_timer();
 }
 
-void bx_serial_c::tx_timer(void)
+bool bx_serial_c::tx_send(Bit8u port, Bit8u *data, int len)
 {
-  bool gen_int = false;
-  Bit8u port = (Bit8u)bx_pc_system.triggeredTimerParam();
-
   switch (BX_SER_THIS s[port].io_mode) {
     case BX_SER_MODE_FILE:
       if (BX_SER_THIS s[port].output == NULL) {
@@ -1473,17 +1504,17 @@ void bx_serial_c::tx_timer(void)
           BX_ERROR(("Could not open '%s' to write com%d output",
                     BX_SER_THIS s[port].file->getptr(), port+1));
           BX_SER_THIS s[port].io_mode = BX_SER_MODE_NULL;
-          return;
+          return 0;
         }
       }
-      fputc(BX_SER_THIS s[port].tsrbuffer, BX_SER_THIS s[port].output);
+      fwrite(data, 1, len, BX_SER_THIS s[port].output);
       fflush(BX_SER_THIS s[port].output);
       break;
     case BX_SER_MODE_TERM:
 #if defined(SERIAL_ENABLE)
-      BX_DEBUG(("com%d: write: '%c'", port+1, BX_SER_THIS s[port].tsrbuffer));
+      BX_DEBUG(("com%d: write: '%c' (%d bytes)", port+1, data[0], len));
       if (BX_SER_THIS s[port].tty_id >= 0) {
-        write(BX_SER_THIS s[port].tty_id, (bx_ptr_t) & BX_SER_THIS s[port].tsrbuffer, 1);
+        write(BX_SER_THIS s[port].tty_id, (bx_ptr_t) data, len);
       }
 #endif
       break;
@@ -1491,18 +1522,17 @@ void bx_serial_c::tx_timer(void)
 #if BX_USE_RAW_SERIAL
       if (!BX_SER_THIS s[port].raw->ready_transmit())
         BX_PANIC(("com%d: not ready to transmit", port+1));
-      BX_SER_THIS s[port].raw->transmit(BX_SER_THIS s[port].tsrbuffer);
+      BX_SER_THIS s[port].raw->transmit(data[0]);
 #endif
       break;
     case BX_SER_MODE_MOUSE:
-      BX_INFO(("com%d: write to mouse ignored: 0x%02x", port+1, BX_SER_THIS s[port].tsrbuffer));
+      BX_INFO(("com%d: write to mouse ignored: 0x%02x", port+1, data[0]));
       break;
     case BX_SER_MODE_SOCKET_CLIENT:
     case BX_SER_MODE_SOCKET_SERVER:
       if (BX_SER_THIS s[port].socket_id >= 0) {
-        BX_DEBUG(("com%d: write byte [0x%02x]", port+1, BX_SER_THIS s[port].tsrbuffer));
-        ::send(BX_SER_THIS s[port].socket_id,
-               (const char*) &BX_SER_THIS s[port].tsrbuffer, 1, 0);
+        BX_DEBUG(("com%d: write byte [0x%02x] (%d bytes)", port+1, data[0], len));
+        ::send(BX_SER_THIS s[port].socket_id, (const char*) data, len, 0);
       }
       break;
     case BX_SER_MODE_PIPE_CLIENT:
@@ -1510,18 +1540,42 @@ void bx_serial_c::tx_timer(void)
 #ifdef BX_SER_WIN32
       if (BX_SER_THIS s[port].pipe) {
         DWORD written;
-        WriteFile(BX_SER_THIS s[port].pipe, (bx_ptr_t)& BX_SER_THIS s[port].tsrbuffer, 1, &written, NULL);
+        WriteFile(BX_SER_THIS s[port].pipe, (bx_ptr_t) data, len, &written, NULL);
       }
 #endif
       break;
   }
+  return 1;
+}
+
+void bx_serial_c::tx_flush(Bit8u port)
+{
+  if (BX_SER_THIS s[port].tx_buf_len > 0) {
+    tx_send(port, BX_SER_THIS s[port].tx_buf, BX_SER_THIS s[port].tx_buf_len);
+    BX_SER_THIS s[port].tx_buf_len = 0;
+  }
+}
+
+void bx_serial_c::tx_timer(void)
+{
+  bool gen_int = false;
+  Bit8u port = (Bit8u)bx_pc_system.triggeredTimerParam();
+
+  if (BX_SER_THIS s[port].fast_mode) {
+    tx_flush(port);
+    return;
+  }
+  if (!tx_send(port, &BX_SER_THIS s[port].tsrbuffer, 1)) {
+    return;
+  }
 
   BX_SER_THIS s[port].line_status.tsr_empty = 1;
   if (BX_SER_THIS s[port].fifo_cntl.enable && (BX_SER_THIS s[port].tx_fifo_end > 0)) {
     BX_SER_THIS s[port].tsrbuffer = BX_SER_THIS s[port].tx_fifo[0];
     BX_SER_THIS s[port].line_status.tsr_empty = 0;
-    memmove(&BX_SER_THIS s[port].tx_fifo[0], &BX_SER_THIS s[port].tx_fifo[1], 15);
     gen_int = (--BX_SER_THIS s[port].tx_fifo_end == 0);
+    memmove(&BX_SER_THIS s[port].tx_fifo[0], &BX_SER_THIS s[port].tx_fifo[1],
+            BX_SER_THIS s[port].tx_fifo_end);
   } else if (!BX_SER_THIS s[port].line_status.thr_empty) {
     BX_SER_THIS s[port].tsrbuffer = BX_SER_THIS s[port].thrbuffer;
     BX_SER_THIS s[port].line_status.tsr_empty = 0;
@@ -1554,7 +1608,21 @@ void bx_serial_c::rx_timer(void)
   Bit8u port = (Bit8u)bx_pc_system.triggeredTimerParam();
   bool data_ready = 0;
   int db_usec = BX_SER_THIS s[port].databyte_usec;
-  unsigned char chbuf = 0;
+  Bit8u chbuf[BX_SER_FAST_FIFO_SIZE];
+  int len = 1, maxlen = 1;
+
+  // in fast mode drain as much host input as fits into the receive FIFO
+  if (BX_SER_THIS s[port].fast_mode) {
+    db_usec = BX_SER_FAST_RX_USEC;
+    if (BX_SER_THIS s[port].fifo_cntl.enable) {
+      maxlen = BX_SER_THIS s[port].fifo_size - BX_SER_THIS s[port].rx_fifo_end;
+    }
+  }
+  // without FIFO a pending byte in the receive buffer must be read first
+  if (!BX_SER_THIS s[port].fifo_cntl.enable &&
+      BX_SER_THIS s[port].line_status.rxdata_ready) {
+    maxlen = 0;
+  }
 
   if (BX_SER_THIS s[port].io_mode == BX_SER_MODE_TERM) {
 #if BX_HAVE_SELECT && defined(SERIAL_ENABLE)
@@ -1576,7 +1644,8 @@ void bx_serial_c::rx_timer(void)
       case BX_SER_MODE_SOCKET_CLIENT:
       case BX_SER_MODE_SOCKET_SERVER:
 #if BX_HAVE_SELECT && defined(SERIAL_ENABLE)
-        if (BX_SER_THIS s[port].line_status.rxdata_ready == 0) {
+        if (((BX_SER_THIS s[port].line_status.rxdata_ready == 0) ||
+             BX_SER_THIS s[port].fast_mode) && (maxlen > 0)) {
           tval.tv_sec  = 0;
           tval.tv_usec = 0;
           FD_ZERO(&fds);
@@ -1585,9 +1654,10 @@ void bx_serial_c::rx_timer(void)
             FD_SET(socketid, &fds);
             if (select((int)(socketid+1), &fds, NULL, NULL, &tval) == 1) {
               ssize_t bytes = (ssize_t)
-              ::recv(socketid, (char*) &chbuf, 1, 0);
+              ::recv(socketid, (char*) chbuf, maxlen, 0);
               if (bytes > 0) {
-                BX_DEBUG(("com%d: read byte [0x%02x]", port+1, chbuf));
+                BX_DEBUG(("com%d: read byte [0x%02x] (%d bytes)", port+1, chbuf[0], (int)bytes));
+                len = (int)bytes;
                 data_ready = 1;
               }
             }
@@ -1633,16 +1703,20 @@ void bx_serial_c::rx_timer(void)
           }
         }
         if (data_ready) {
-          chbuf = data;
+          chbuf[0] = data;
         }
 #endif
         break;
       case BX_SER_MODE_TERM:
 #if BX_HAVE_SELECT && defined(SERIAL_ENABLE)
-        if ((BX_SER_THIS s[port].tty_id >= 0) && (select(BX_SER_THIS s[port].tty_id + 1, &fds, NULL, NULL, &tval) == 1)) {
-          (void) read(BX_SER_THIS s[port].tty_id, &chbuf, 1);
-          BX_DEBUG(("com%d: read: '%c'", port+1, chbuf));
-          data_ready = 1;
+        if ((BX_SER_THIS s[port].tty_id >= 0) && (maxlen > 0) &&
+            (select(BX_SER_THIS s[port].tty_id + 1, &fds, NULL, NULL, &tval) == 1)) {
+          ssize_t bytes = read(BX_SER_THIS s[port].tty_id, chbuf, maxlen);
+          if (bytes > 0) {
+            BX_DEBUG(("com%d: read: '%c' (%d bytes)", port+1, chbuf[0], (int)bytes));
+            len = (int)bytes;
+            data_ready = 1;
+          }
         }
 #endif
         break;
@@ -1651,7 +1725,7 @@ void bx_serial_c::rx_timer(void)
           BX_SER_THIS update_mouse_data();
         }
         if (BX_SER_THIS mouse_internal_buffer.num_elements > 0) {
-          chbuf = BX_SER_THIS mouse_internal_buffer.buffer[BX_SER_THIS mouse_internal_buffer.head];
+          chbuf[0] = BX_SER_THIS mouse_internal_buffer.buffer[BX_SER_THIS mouse_internal_buffer.head];
           BX_SER_THIS mouse_internal_buffer.head = (BX_SER_THIS mouse_internal_buffer.head + 1) %
             BX_MOUSE_BUFF_SIZE;
           BX_SER_THIS mouse_internal_buffer.num_elements--;
@@ -1662,18 +1736,22 @@ void bx_serial_c::rx_timer(void)
       case BX_SER_MODE_PIPE_SERVER:
 #ifdef BX_SER_WIN32
         DWORD avail = 0;
-        if (BX_SER_THIS s[port].pipe &&
+        if (BX_SER_THIS s[port].pipe && (maxlen > 0) &&
             PeekNamedPipe(BX_SER_THIS s[port].pipe, NULL, 0, NULL, &avail, NULL) &&
             avail > 0) {
-          ReadFile(BX_SER_THIS s[port].pipe, &chbuf, 1, &avail, NULL);
-          data_ready = 1;
+          if (avail > (DWORD)maxlen) avail = maxlen;
+          ReadFile(BX_SER_THIS s[port].pipe, chbuf, avail, &avail, NULL);
+          len = (int)avail;
+          data_ready = (len > 0);
         }
 #endif
         break;
     }
     if (data_ready) {
       if (!BX_SER_THIS s[port].modem_cntl.local_loopback) {
-        rx_fifo_enq(port, chbuf);
+        for (int i = 0; i < len; i++) {
+          rx_fifo_enq(port, chbuf[i]);
+        }
       }
     } else {
       if (!BX_SER_THIS s[port].fifo_cntl.enable) {
@@ -1806,6 +1884,7 @@ const char* bx_serial_c::serial_file_param_handler(bx_param_string_c *param, boo
 {
   if ((set) && (strcmp(val, oldval))) {
     int port = atoi((param->get_parent())->get_name()) - 1;
+    tx_flush(port);
     if (BX_SER_THIS s[port].output != NULL) {
       fclose(BX_SER_THIS s[port].output);
       BX_SER_THIS s[port].output = NULL;
@@ -48,6 +48,15 @@ extern "C" {
 
 #define  BX_PC_CLOCK_XTL   1843200.0
 
+// FIFO depth of the 16550A and of the "fast UART" mode (16950 style)
+#define BX_SER_FIFO_SIZE       16
+#define BX_SER_FAST_FIFO_SIZE  128
+// In fast mode transmitted bytes are collected and written to the host
+// backend at once, at the latest this many usec after the first one
+#define BX_SER_TX_BUF_SIZE     4096
+#define BX_SER_FAST_TX_USEC    1000
+#define BX_SER_FAST_RX_USEC    100
+
 enum {
   BX_SER_RXIDLE = 0,
   BX_SER_RXPOLL = 1,
@@ -112,6 +121,10 @@ typedef struct {
   int   baudrate;
   Bit32u databyte_usec;
 
+  bool  fast_mode;
+  Bit8u fifo_size;
+  Bit16u tx_buf_len;
+
   int  rx_timer_index;
   int  tx_timer_index;
   int  fifo_timer_index;
@@ -197,10 +210,12 @@ typedef struct {
 
   Bit8u  scratch;       /* Scratch Register (r/w) */
   Bit8u  tsrbuffer;     /* transmit shift register (internal) */
-  Bit8u  rx_fifo[16];   /* receive FIFO (internal) */
-  Bit8u  tx_fifo[16];   /* transmit FIFO (internal) */
+  Bit8u  rx_fifo[BX_SER_FAST_FIFO_SIZE];   /* receive FIFO (internal) */
+  Bit8u  tx_fifo[BX_SER_FAST_FIFO_SIZE];   /* transmit FIFO (internal) */
   Bit8u  divisor_lsb;   /* Divisor latch, least-sig. byte */
   Bit8u  divisor_msb;   /* Divisor latch, most-sig. byte */
+
+  Bit8u  tx_buf[BX_SER_TX_BUF_SIZE];       /* pending host output (fast mode) */
 } bx_serial_t;
 
 
@@ -235,6 +250,9 @@ private:
 
   static void rx_fifo_enq(Bit8u port, Bit8u data);
 
+  static bool tx_send(Bit8u port, Bit8u *data, int len);
+  static void tx_flush(Bit8u port);
+
   static void tx_timer_handler(void *);
   BX_SER_SMF void tx_timer(void);
 
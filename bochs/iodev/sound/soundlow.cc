@@ -28,6 +28,10 @@
 
 #include "soundlow.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define LOG_THIS
 
 // audio buffer support
@@ -35,13 +39,19 @@
 bx_audio_buffer_c::bx_audio_buffer_c(Bit8u _format)
 {
   format = _format;
-  root = NULL;
+  head = new audio_buffer_t;
+  head->size = 0;
+  head->next = NULL;
+  tail = head;
 }
 
 bx_audio_buffer_c::~bx_audio_buffer_c()
 {
-  while (root != NULL) {
-    delete_buffer();
+  while (head != NULL) {
+    audio_buffer_t *tmpbuffer = head;
+    head = tmpbuffer->next;
+    free_data(tmpbuffer);
+    delete tmpbuffer;
   }
 }
 
@@ -56,114 +66,158 @@ audio_buffer_t* bx_audio_buffer_c::new_buffer(Bit32u size)
   newbuffer->size = size;
   newbuffer->pos = 0;
   newbuffer->next = NULL;
-
-  if (root == NULL) {
-    root = newbuffer;
-  } else {
-    audio_buffer_t *temp = root;
-
-    while (temp->next)
-      temp = temp->next;
-
-    temp->next = newbuffer;
-  }
   return newbuffer;
 }
 
+void bx_audio_buffer_c::queue_buffer(audio_buffer_t *buffer)
+{
+  BX_ATOMIC_STORE(tail->next, buffer);
+  tail = buffer;
+}
+
 audio_buffer_t* bx_audio_buffer_c::get_buffer()
 {
-  return root;
+  return BX_ATOMIC_LOAD(head->next);
 }
 
 void bx_audio_buffer_c::delete_buffer()
 {
-  audio_buffer_t *tmpbuffer = root;
-  root = tmpbuffer->next;
-  if (tmpbuffer->size > 0) {
+  audio_buffer_t *tmpbuffer = head;
+  audio_buffer_t *curbuffer = tmpbuffer->next;
+  // the consumed entry stays in the queue as the new head, without data
+  free_data(curbuffer);
+  BX_ATOMIC_STORE(head, curbuffer);
+  delete tmpbuffer;
+}
+
+void bx_audio_buffer_c::free_data(audio_buffer_t *buffer)
+{
+  if (buffer->size > 0) {
     if (format == BUFTYPE_FLOAT) {
-      delete [] tmpbuffer->fdata;
+      delete [] buffer->fdata;
     } else {
-      delete [] tmpbuffer->data;
+      delete [] buffer->data;
     }
+    buffer->size = 0;
   }
-  delete tmpbuffer;
 }
 
+// called by the producer: wait until the consumer has taken everything
 void bx_audio_buffer_c::flush()
 {
-  while (root != NULL) {
+  while (BX_ATOMIC_LOAD(head) != tail) {
     BX_MSLEEP(1);
   }
 }
 
+// sample conversion and mixing (SSE2 versions process 8 samples at a time)
+
 // convert to float format for resampler
 
 static void convert_to_float(Bit8u *src, unsigned srcsize, audio_buffer_t *audiobuf)
 {
-  unsigned i, j;
+  unsigned i = 0, count;
   bx_pcm_param_t *param = &audiobuf->param;
   bool issigned = (param->format & 1);
-  bool setvol = (param->volume != BX_MAX_BIT16U);
-  Bit16s val16s;
   Bit16u val16u;
   float volume[2];
 
   float *dst = audiobuf->fdata;
-  if (setvol) {
-    volume[0] = ((float)(param->volume & 0xff)) / 255.0F;
-    volume[1] = ((float)(param->volume >> 8)) / 255.0F;
-  }
   if (param->bits == 8) {
+    count = srcsize;
     if (issigned) {
-      for (i = 0; i < srcsize; i++) {
-        dst[i] = ((float)src[i]) / 128.0F;
-        if (setvol) {
-          dst[i] *= volume[i & 1];
-        }
+      for (i = 0; i < count; i++) {
+        dst[i] = ((float)(Bit8s)src[i]) / 128.0F;
       }
     } else {
-      for (i = 0; i < srcsize; i++) {
+      for (i = 0; i < count; i++) {
         dst[i] = (((float)src[i]) - 128.0F) / 128.0F;
-        if (setvol) {
-          dst[i] *= volume[i & 1];
-        }
       }
     }
   } else {
-    j = 0;
-    if (issigned) {
-      for (i = 0; i < srcsize; i += 2) {
-        val16s = (Bit16s)(src[i] | (src[i+1] << 8));
-        dst[j] = ((float)val16s) / 32768.0F;
-        if (setvol) {
-          dst[j] *= volume[i & 1];
-        }
-        j++;
-      }
-    } else {
-      for (i = 0; i < srcsize; i += 2) {
-        val16u = (Bit16u)(src[i] | (src[i+1] << 8));
-        dst[j] = (((float)val16u) - 32768.0F) / 32768.0F;
-        if (setvol) {
-          dst[j] *= volume[i & 1];
-        }
-        j++;
-      }
+    count = srcsize >> 1;
+    // unsigned samples become signed ones by flipping the sign bit
+    Bit16u flip = issigned ? 0 : 0x8000;
+#if defined(__SSE2__)
+    const __m128i vflip = _mm_set1_epi16((short)flip);
+    const __m128 vscale = _mm_set1_ps(1.0F / 32768.0F);
+    for (; (i + 8) <= count; i += 8) {
+      __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + (i << 1))), vflip);
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+      _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+#endif
+    for (; i < count; i++) {
+      val16u = (Bit16u)(src[i << 1] | (src[(i << 1) + 1] << 8)) ^ flip;
+      dst[i] = ((float)(Bit16s)val16u) / 32768.0F;
+    }
+  }
+  if (param->volume != BX_MAX_BIT16U) {
+    volume[0] = ((float)(param->volume & 0xff)) / 255.0F;
+    volume[1] = ((float)(param->volume >> 8)) / 255.0F;
+    for (i = 0; i < count; i++) {
+      dst[i] *= volume[i & 1];
     }
   }
 }
 
-// convert from float format for output
+// convert from float format for output (with saturation)
 
 void convert_float_to_s16le(float *src, unsigned srcsize, Bit8u *dst)
 {
   Bit16s val16s;
-  unsigned i, j = 0;
+  float fval;
+  unsigned i = 0;
 
-  for (i = 0; i < srcsize; i++) {
-    val16s = (Bit16s)(src[i] * 32768.0F);
-    dst[j++] =(Bit8u)(val16s & 0xff);
-    dst[j++] = (Bit8u)(val16s >> 8);
+#if defined(__SSE2__)
+  const __m128 vscale = _mm_set1_ps(32768.0F);
+  for (; (i + 8) <= srcsize; i += 8) {
+    __m128i lo = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), vscale));
+    __m128i hi = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), vscale));
+    _mm_storeu_si128((__m128i*)(dst + (i << 1)), _mm_packs_epi32(lo, hi));
+  }
+#endif
+  for (; i < srcsize; i++) {
+    fval = src[i] * 32768.0F;
+    if (fval > 32767.0F) {
+      fval = 32767.0F;
+    } else if (fval < -32768.0F) {
+      fval = -32768.0F;
+    }
+    val16s = (Bit16s)fval;
+    dst[i << 1] = (Bit8u)(val16s & 0xff);
+    dst[(i << 1) + 1] = (Bit8u)(val16s >> 8);
+  }
+}
+
+// add 'len' bytes of s16le samples from 'src' to 'dst' (with saturation)
+
+static void mix_s16le(Bit8u *dst, const Bit8u *src, unsigned len)
+{
+  Bit16s src1, src2;
+  Bit32s tmp_val;
+  unsigned i = 0, count = len >> 1;
+
+#if defined(__SSE2__)
+  for (; (i + 8) <= count; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + (i << 1)));
+    __m128i b = _mm_loadu_si128((const __m128i*)(dst + (i << 1)));
+    _mm_storeu_si128((__m128i*)(dst + (i << 1)), _mm_adds_epi16(a, b));
+  }
+#endif
+  for (; i < count; i++) {
+    src1 = (Bit16s)(src[i << 1] | (src[(i << 1) + 1] << 8));
+    src2 = (Bit16s)(dst[i << 1] | (dst[(i << 1) + 1] << 8));
+    tmp_val = (Bit32s)src1 + (Bit32s)src2;
+    if (tmp_val > BX_MAX_BIT16S) {
+      tmp_val = BX_MAX_BIT16S;
+    } else if (tmp_val < BX_MIN_BIT16S) {
+      tmp_val = BX_MIN_BIT16S;
+    }
+    dst[i << 1] = (Bit8u)(tmp_val & 0xff);
+    dst[(i << 1) + 1] = (Bit8u)(tmp_val >> 8);
   }
 }
 
@@ -197,8 +251,9 @@ Bit32u pcm_callback(void *dev, Bit16u rate, Bit8u *buffer, Bit32u len)
 }
 
 // resampler & mixer thread support
+// The device models feed the resampler and the resampler feeds the mixer
+// through lock-free queues. The mixer mutex only guards the callback table.
 
-BX_MUTEX(resampler_mutex);
 BX_MUTEX(mixer_mutex);
 int mixer_mutex_usage = 0;
 
@@ -206,14 +261,10 @@ BX_THREAD_FUNC(resampler_thread, indata)
 {
   bx_soundlow_waveout_c *waveout = (bx_soundlow_waveout_c*)indata;
   while (waveout->resampler_running()) {
-    BX_LOCK(resampler_mutex);
     audio_buffer_t *curbuffer = waveout->get_audio_buffer(0)->get_buffer();
-    BX_UNLOCK(resampler_mutex);
     if (curbuffer != NULL) {
       waveout->resampler(curbuffer, NULL);
-      BX_LOCK(resampler_mutex);
       waveout->get_audio_buffer(0)->delete_buffer();
-      BX_UNLOCK(resampler_mutex);
     } else {
       BX_MSLEEP(20);
     }
@@ -252,6 +303,8 @@ bx_soundlow_waveout_c::bx_soundlow_waveout_c()
   real_pcm_param = default_pcm_param;
   cb_count = 0;
   pcm_callback_id = -1;
+  mix_tmpbuf = NULL;
+  mix_tmpbuf_size = 0;
   res_thread_start = 0;
   mix_thread_start = 0;
 #if BX_HAVE_LIBSAMPLERATE || BX_HAVE_SOXR_LSR
@@ -270,7 +323,6 @@ bx_soundlow_waveout_c::~bx_soundlow_waveout_c()
     if (res_thread_start) {
       res_thread_start = 0;
       BX_MSLEEP(20);
-      BX_FINI_MUTEX(resampler_mutex);
     }
     if (mix_thread_start) {
       mix_thread_start = 0;
@@ -287,6 +339,7 @@ bx_soundlow_waveout_c::~bx_soundlow_waveout_c()
       audio_buffers[0] = NULL;
     }
   }
+  delete [] mix_tmpbuf;
 }
 
 int bx_soundlow_waveout_c::openwaveoutput(const char *wavedev)
@@ -307,11 +360,10 @@ int bx_soundlow_waveout_c::sendwavepacket(int length, Bit8u data[], bx_pcm_param
 
   if (src_param->bits == 16) len1 >>= 1;
   if (pcm_callback_id >= 0) {
-    BX_LOCK(resampler_mutex);
     audio_buffer_t *inbuffer = audio_buffers[0]->new_buffer(len1);
     memcpy(&inbuffer->param, src_param, sizeof(bx_pcm_param_t));
     convert_to_float(data, length, inbuffer);
-    BX_UNLOCK(resampler_mutex);
+    audio_buffers[0]->queue_buffer(inbuffer);
   } else {
     audio_buffer_t *inbuffer = new audio_buffer_t;
     inbuffer->fdata = new float[len1];
@@ -365,44 +417,31 @@ void bx_soundlow_waveout_c::unregister_wave_callback(int callback_id)
   BX_UNLOCK(mixer_mutex);
 }
 
+// 'buffer' must be cleared by the caller
 bool bx_soundlow_waveout_c::mixer_common(Bit8u *buffer, int len)
 {
-  Bit32u count, len2 = 0, len3 = 0;
-  Bit16s src1, src2, dst_val;
-  Bit32s tmp_val;
-  Bit8u *src, *dst;
+  Bit32u len2 = 0, len3 = 0;
 
-  Bit8u *tmpbuffer = new Bit8u[len];
+  if (mix_tmpbuf_size < len) {
+    delete [] mix_tmpbuf;
+    mix_tmpbuf = new Bit8u[len];
+    mix_tmpbuf_size = len;
+  }
   BX_LOCK(mixer_mutex);
   for (int i = 0; i < cb_count; i++) {
     if (get_wave[i].cb != NULL) {
-      memset(tmpbuffer, 0, len);
-      len2 = get_wave[i].cb(get_wave[i].device, real_pcm_param.samplerate, tmpbuffer, len);
-      if (len2 > 0) {
-        src = tmpbuffer;
-        dst = buffer;
-        count = len / 2;
-        while (count--) {
-          src1 = (src[0] | (src[1] << 8));
-          src2 = (dst[0] | (dst[1] << 8));
-          tmp_val = (Bit32s)src1 + (Bit32s)src2;
-          if (tmp_val > BX_MAX_BIT16S) {
-            tmp_val = BX_MAX_BIT16S;
-          } else if (tmp_val < BX_MIN_BIT16S) {
-            tmp_val = BX_MIN_BIT16S;
-          }
-          dst_val = (Bit16s)tmp_val;
-          dst[0] = dst_val & 0xff;
-          dst[1] = (Bit8u)(dst_val >> 8);
-          src += 2;
-          dst += 2;
-        }
-        if (len3 < len2) len3 = len2;
+      if (len3 == 0) {
+        // the first source with data can be written to the output directly
+        len2 = get_wave[i].cb(get_wave[i].device, real_pcm_param.samplerate, buffer, len);
+      } else {
+        memset(mix_tmpbuf, 0, len);
+        len2 = get_wave[i].cb(get_wave[i].device, real_pcm_param.samplerate, mix_tmpbuf, len);
+        mix_s16le(buffer, mix_tmpbuf, len2);
       }
+      if (len3 < len2) len3 = len2;
     }
   }
   BX_UNLOCK(mixer_mutex);
-  delete [] tmpbuffer;
   return (len3 > 0);
 }
 
@@ -413,10 +452,9 @@ void bx_soundlow_waveout_c::resampler(audio_buffer_t *inbuffer, audio_buffer_t *
 
   fcount = resampler_common(inbuffer, &fbuffer);
   if (outbuffer == NULL) {
-    BX_LOCK(mixer_mutex);
     audio_buffer_t *newbuffer = audio_buffers[1]->new_buffer(fcount << 1);
     convert_float_to_s16le(fbuffer, fcount, newbuffer->data);
-    BX_UNLOCK(mixer_mutex);
+    audio_buffers[1]->queue_buffer(newbuffer);
   } else {
     outbuffer->data = new Bit8u[fcount << 1];
     outbuffer->size = (fcount << 1);
@@ -488,7 +526,6 @@ Bit32u bx_soundlow_waveout_c::resampler_common(audio_buffer_t *inbuffer, float *
 
 void bx_soundlow_waveout_c::start_resampler_thread()
 {
-  BX_INIT_MUTEX(resampler_mutex);
   res_thread_start = 1;
   BX_THREAD_CREATE(resampler_thread, this, res_thread_var);
 }
@@ -67,24 +67,31 @@ typedef struct _audio_buffer_t
   struct _audio_buffer_t *next;
 } audio_buffer_t;
 
+// Lock-free queue between exactly one producer thread (new_buffer(), then
+// queue_buffer() after filling it) and one consumer thread (get_buffer() and
+// delete_buffer()). 'head' is an already consumed entry, 'tail' the newest one.
+
 class bx_audio_buffer_c {
 public:
   bx_audio_buffer_c(Bit8u format);
   ~bx_audio_buffer_c();
 
   audio_buffer_t *new_buffer(Bit32u size);
+  void queue_buffer(audio_buffer_t *buffer);
   audio_buffer_t *get_buffer();
   void delete_buffer();
   void flush();
 private:
+  void free_data(audio_buffer_t *buffer);
+
   Bit8u format;
-  audio_buffer_t *root;
+  audio_buffer_t *head;
+  audio_buffer_t *tail;
 };
 
 void convert_float_to_s16le(float *src, unsigned srcsize, Bit8u *dst);
 BOCHSAPI Bit32u pcm_callback(void *dev, Bit16u rate, Bit8u *buffer, Bit32u len);
 
-extern BX_MUTEX(resampler_mutex);
 #ifndef __ANDROID__
 extern BX_MUTEX(mixer_mutex);
 #endif
@@ -136,6 +143,8 @@ protected:
     get_wave_cb_t cb;
   } get_wave[BX_MAX_WAVE_CALLBACKS];
   int pcm_callback_id;
+  Bit8u *mix_tmpbuf;
+  int mix_tmpbuf_size;
 };
 
 // the wavein class
@@ -145,6 +145,7 @@ void bx_soundlow_waveout_sdl_c::resampler(audio_buffer_t *inbuffer, audio_buffer
   if (WaveOutOpen) {
     audio_buffer_t *newbuffer = audio_buffers[1]->new_buffer(fcount << 1);
     convert_float_to_s16le(fbuffer, fcount, newbuffer->data);
+    audio_buffers[1]->queue_buffer(newbuffer);
   }
   SDL_UnlockAudio();
   if (fbuffer != NULL) {
@@ -101,6 +101,7 @@ scsi_device_t::scsi_device_t(device_image_t *_hdimage, int _tcq,
   seek_timer_index =
     DEV_register_timer(this, seek_timer_handler, 1000, 0, 0, "USB HD seek");
   statusbar_id = bx_gui->register_statusitem("USB-HD", 1);
+  timing = BX_DISK_TIMING_REALISTIC;
 
   put("SCSIHD");
 }
@@ -128,6 +129,7 @@ scsi_device_t::scsi_device_t(cdrom_base_c *_cdrom, int _tcq,
   seek_timer_index =
     DEV_register_timer(this, seek_timer_handler, 1000, 0, 0, "USB CD seek");
   statusbar_id = bx_gui->register_statusitem("USB-CD", 1);
+  timing = BX_DISK_TIMING_REALISTIC;
 
   put("SCSICD");
 }
@@ -192,6 +194,9 @@ SCSIRequest* scsi_device_t::scsi_new_request(Bit32u tag)
   r->async_mode = 0;
   r->seek_pending = 0;
   r->buf_len = 0;
+  r->xfer_buf = r->dma_buf;
+  r->xfer_size = SCSI_DMA_BUF_SIZE;
+  r->xfer_done = 0;
   r->status = 0;
 
   r->next = requests;
@@ -255,12 +260,13 @@ bool scsi_device_t::save_requests(const char *path)
         fprintf(fp, "  write_cmd = %u\n", r->write_cmd);
         fprintf(fp, "  async_mode = %u\n", r->async_mode);
         fprintf(fp, "  seek_pending = %u\n", r->seek_pending);
+        fprintf(fp, "  xfer_done = %u\n", r->xfer_done);
         fprintf(fp, "}\n");
         if (r->buf_len > 0) {
           sprintf(tmppath, "%s.%u", path, i);
           fp2 = fopen(tmppath, "wb");
           if (fp2 != NULL) {
-            fwrite(r->dma_buf, 1, (size_t)r->buf_len, fp2);
+            fwrite(r->xfer_buf, 1, (size_t)r->buf_len, fp2);
           }
           fclose(fp2);
         }
@@ -352,6 +358,8 @@ void scsi_device_t::restore_requests(const char *path)
                   r->async_mode = (bool) value;
                 } else if (!strcmp(pname, "seek_pending")) {
                   r->seek_pending = (Bit8u) value;
+                } else if (!strcmp(pname, "xfer_done")) {
+                  r->xfer_done = (bool) value;
                 } else {
                   BX_ERROR(("restore_requests(): data format error"));
                   rrq_error = 1;
@@ -413,13 +421,22 @@ void scsi_device_t::scsi_read_complete(void *req, int ret)
   completion(dev, SCSI_REASON_DATA, r->tag, r->buf_len);
 }
 
-void scsi_device_t::scsi_read_data(Bit32u tag)
+// If 'buf' can hold at least one block, the next sectors are read straight
+// into it (e.g. the data buffer of a pending USB packet) instead of dma_buf.
+void scsi_device_t::scsi_read_data(Bit32u tag, Bit8u *buf, Bit32u size)
 {
   SCSIRequest *r = scsi_find_request(tag);
   if (!r) {
     BX_ERROR(("bad read tag 0x%x", tag));
     return;
   }
+  if ((buf != NULL) && (size >= (Bit32u) block_size)) {
+    r->xfer_buf = buf;
+    r->xfer_size = size;
+  } else {
+    r->xfer_buf = r->dma_buf;
+    r->xfer_size = SCSI_DMA_BUF_SIZE;
+  }
   if (r->sector_count == (Bit32u)-1) {
     BX_DEBUG(("read buf_len=%d", r->buf_len));
     r->sector_count = 0;
@@ -463,7 +480,10 @@ void scsi_device_t::scsi_write_complete(void *req, int ret)
   }
 }
 
-void scsi_device_t::scsi_write_data(Bit32u tag)
+// If 'buf' is given, the 'len' bytes (whole blocks) of the current chunk are
+// written from there instead of dma_buf. They go to the image right away, so
+// the caller may reuse the buffer on return; only the completion is delayed.
+void scsi_device_t::scsi_write_data(Bit32u tag, Bit8u *buf, Bit32u len)
 {
   SCSIRequest *r = scsi_find_request(tag);
 
@@ -473,6 +493,12 @@ void scsi_device_t::scsi_write_data(Bit32u tag)
     return;
   }
   if (type == SCSIDEV_TYPE_DISK) {
+    if ((buf != NULL) && (len >= (Bit32u) block_size)) {
+      r->buf_len = len;
+      if (!write_blocks(r, buf, len / block_size))
+        return;
+      r->xfer_done = 1;
+    }
     if ((r->buf_len / block_size) > 0) {
       if ((r->async_mode) && (r->seek_pending == 2)) {
         start_seek(r);
@@ -495,7 +521,7 @@ Bit8u* scsi_device_t::scsi_get_buf(Bit32u tag)
     BX_ERROR(("bad buffer tag 0x%x", tag));
     return NULL;
   }
-  return r->dma_buf;
+  return r->xfer_buf;
 }
 
 Bit32s scsi_device_t::scsi_send_command(Bit32u tag, Bit8u *buf, Bit8u cmd_len, int lun, bool async)
@@ -1751,16 +1777,23 @@ void scsi_device_t::start_seek(SCSIRequest *r)
   Bit32u seek_time;
   double fSeekBase, fSeekTime;
 
-  max_pos = max_lba;
-  prev_pos = curr_lba;
-  new_pos = r->sector;
-  if (type == SCSIDEV_TYPE_CDROM) {
-    fSeekBase = 80000.0;
+  if (timing == BX_DISK_TIMING_INSTANT) {
+    seek_complete(r);
+    return;
+  } else if (timing == BX_DISK_TIMING_SSD) {
+    seek_time = bx_disk_timing_delay(timing, (Bit64u)r->sector_count * block_size);
   } else {
-    fSeekBase = 5000.0;
+    max_pos = max_lba;
+    prev_pos = curr_lba;
+    new_pos = r->sector;
+    if (type == SCSIDEV_TYPE_CDROM) {
+      fSeekBase = 80000.0;
+    } else {
+      fSeekBase = 5000.0;
+    }
+    fSeekTime = fSeekBase * (double)abs((int)(new_pos - prev_pos + 1)) / (max_pos + 1);
+    seek_time = 4000 + (Bit32u)fSeekTime;
   }
-  fSeekTime = fSeekBase * (double)abs((int)(new_pos - prev_pos + 1)) / (max_pos + 1);
-  seek_time = 4000 + (Bit32u)fSeekTime;
   bx_pc_system.activate_timer(seek_timer_index, seek_time, 0);
   bx_pc_system.setTimerParam(seek_timer_index, r->tag);
   r->seek_pending = 1;
@@ -1789,13 +1822,13 @@ void scsi_device_t::seek_complete(SCSIRequest *r)
   if (!r->write_cmd) {
     bx_gui->statusbar_setitem(statusbar_id, 1);
     n = r->sector_count;
-    if (n > (Bit32u) (SCSI_DMA_BUF_SIZE / block_size))
-      n = SCSI_DMA_BUF_SIZE / block_size;
+    if (n > (r->xfer_size / block_size))
+      n = r->xfer_size / block_size;
     r->buf_len = n * block_size;
     if (type == SCSIDEV_TYPE_CDROM) {
       i = 0;
       do {
-        ret = (int) cdrom->read_block(r->dma_buf + (i * 2048), (Bit32u) (r->sector + i), 2048);
+        ret = (int) cdrom->read_block(r->xfer_buf + (i * 2048), (Bit32u) (r->sector + i), 2048);
       } while ((++i < n) && (ret == 1));
       if (ret == 0) {
         scsi_command_complete(r, STATUS_CHECK_CONDITION, SENSE_MEDIUM_ERROR, 0, 0);
@@ -1810,7 +1843,7 @@ void scsi_device_t::seek_complete(SCSIRequest *r)
       }
       i = 0;
       do {
-        ret = (int) hdimage->read((bx_ptr_t) (r->dma_buf + (i * block_size)), block_size);
+        ret = (int) hdimage->read((bx_ptr_t) (r->xfer_buf + (i * block_size)), block_size);
       } while ((++i < n) && (ret == block_size));
       if (ret != block_size) {
         BX_ERROR(("could not read() hard drive image file"));
@@ -1825,21 +1858,9 @@ void scsi_device_t::seek_complete(SCSIRequest *r)
     bx_gui->statusbar_setitem(statusbar_id, 1, 1);
     n = r->buf_len / block_size;
     if (n) {
-      ret = (int)hdimage->lseek(r->sector * block_size, SEEK_SET);
-      if (ret < 0) {
-        BX_ERROR(("could not lseek() hard drive image file"));
-        scsi_command_complete(r, STATUS_CHECK_CONDITION, SENSE_HARDWARE_ERROR, 0, 0);
-      }
-      i = 0;
-      do {
-        ret = (int) hdimage->write((bx_ptr_t) (r->dma_buf + (i * block_size)),
-                                  block_size);
-      } while ((++i < n) && (ret == block_size));
-      if (ret != block_size) {
-        BX_ERROR(("could not write() hard drive image file"));
-        scsi_command_complete(r, STATUS_CHECK_CONDITION, SENSE_HARDWARE_ERROR, 0, 0);
+      if (!r->xfer_done && !write_blocks(r, r->dma_buf, n))
         return;
-      }
+      r->xfer_done = 0;
       r->sector += n;
       r->sector_count -= n;
       scsi_write_complete((void *) r, 0);
@@ -1847,6 +1868,29 @@ void scsi_device_t::seek_complete(SCSIRequest *r)
   }
 }
 
+bool scsi_device_t::write_blocks(SCSIRequest *r, Bit8u *buf, Bit32u n)
+{
+  Bit32u i;
+  int ret;
+
+  ret = (int)hdimage->lseek(r->sector * block_size, SEEK_SET);
+  if (ret < 0) {
+    BX_ERROR(("could not lseek() hard drive image file"));
+    scsi_command_complete(r, STATUS_CHECK_CONDITION, SENSE_HARDWARE_ERROR, 0, 0);
+    return 0;
+  }
+  i = 0;
+  do {
+    ret = (int) hdimage->write((bx_ptr_t) (buf + (i * block_size)), block_size);
+  } while ((++i < n) && (ret == block_size));
+  if (ret != block_size) {
+    BX_ERROR(("could not write() hard drive image file"));
+    scsi_command_complete(r, STATUS_CHECK_CONDITION, SENSE_HARDWARE_ERROR, 0, 0);
+    return 0;
+  }
+  return 1;
+}
+
 // Turn on BX_DEBUG messages at connection time
 void scsi_device_t::set_debug_mode()
 {
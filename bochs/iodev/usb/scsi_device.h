@@ -204,6 +204,9 @@ typedef struct SCSIRequest {
   Bit32u sector_count;
   int buf_len;
   Bit8u *dma_buf;
+  Bit8u *xfer_buf;     // data of the current chunk: dma_buf or a caller supplied buffer
+  Bit32u xfer_size;    // size of xfer_buf for the next read
+  bool xfer_done;      // data of the current write chunk is already on the image
   Bit32u status;
   bool write_cmd;
   bool async_mode;
@@ -225,9 +228,9 @@ public:
   void scsi_command_complete(SCSIRequest *r, int status, Bit8u _sense, Bit8u _asc, Bit8u _ascq);
   void scsi_cancel_io(Bit32u tag);
   void scsi_read_complete(void *req, int ret);
-  void scsi_read_data(Bit32u tag);
+  void scsi_read_data(Bit32u tag, Bit8u *buf = NULL, Bit32u size = 0);
   void scsi_write_complete(void *req, int ret);
-  void scsi_write_data(Bit32u tag);
+  void scsi_write_data(Bit32u tag, Bit8u *buf = NULL, Bit32u len = 0);
   Bit8u* scsi_get_buf(Bit32u tag);
   const char *get_serial_number() const { return drive_serial_str; }
   int scsi_do_modepage_hdr(Bit8u *p, Bit8u sub_page, Bit8u page_code, int len);
@@ -239,6 +242,7 @@ public:
   bool save_requests(const char *path);
   void restore_requests(const char *path);
   void set_debug_mode();
+  void set_timing(int _timing) { timing = _timing; }
 
 protected:
   SCSIRequest* scsi_new_request(Bit32u tag);
@@ -249,6 +253,7 @@ private:
   void start_seek(SCSIRequest *r);
   void seek_timer(void);
   void seek_complete(SCSIRequest *r);
+  bool write_blocks(SCSIRequest *r, Bit8u *buf, Bit32u n);
 
   // members set in constructor
   enum scsidev_type type;
@@ -261,6 +266,7 @@ private:
   char drive_serial_str[21];
   int seek_timer_index;
   int statusbar_id;
+  int timing;
   // members set in constructor / runtime config
   Bit64u max_lba;
   bool inserted;
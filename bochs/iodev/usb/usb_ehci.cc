@@ -71,6 +71,8 @@ static const int USB_RET_PROCERR = -99;
 
 #define FRAME_TIMER_FREQ 1000
 #define FRAME_TIMER_USEC (1000000 / FRAME_TIMER_FREQ)
+#define UFRAME_TIMER_USEC (FRAME_TIMER_USEC / 8)  // while the async schedule is busy
+#define IDLE_TIMER_USEC  (FRAME_TIMER_USEC * 16)  // while both schedules are off
 
 #define BUFF_SIZE        5*4096   // Max bytes to transfer per transaction
 #define MAX_QH           100      // Max allowable queue heads in a chain
@@ -258,7 +260,9 @@ void bx_usb_ehci_c::init(void)
   }
 
   // Call our frame timer routine every 1mS (1,024uS)
-  // Continuous and active
+  // Continuous and active. The period is adjusted to the schedule activity
+  // (see ehci_frame_timer()).
+  BX_EHCI_THIS hub.frame_timer_usec = FRAME_TIMER_USEC;
   BX_EHCI_THIS hub.frame_timer_index = DEV_register_timer(this, ehci_frame_handler,
                                                  FRAME_TIMER_USEC, 1, 1, "ehci.frame_timer");
 
@@ -443,6 +447,8 @@ void bx_usb_ehci_c::register_state(void)
   BXRS_DEC_PARAM_FIELD(hub, astate, BX_EHCI_THIS hub.astate);
   BXRS_DEC_PARAM_FIELD(hub, last_run_usec, BX_EHCI_THIS hub.last_run_usec);
   BXRS_DEC_PARAM_FIELD(hub, async_stepdown, BX_EHCI_THIS hub.async_stepdown);
+  BXRS_DEC_PARAM_FIELD(hub, async_active_usec, BX_EHCI_THIS hub.async_active_usec);
+  BXRS_DEC_PARAM_FIELD(hub, frame_timer_usec, BX_EHCI_THIS hub.frame_timer_usec);
   op_regs = new bx_list_c(hub, "op_regs");
   reg = new bx_list_c(op_regs, "UsbCmd");
   BXRS_HEX_PARAM_FIELD(reg, itc, BX_EHCI_THIS hub.op_regs.UsbCmd.itc);
@@ -556,6 +562,7 @@ void bx_usb_ehci_c::reset_hc()
 
   BX_EHCI_THIS hub.usbsts_pending = 0;
   BX_EHCI_THIS hub.usbsts_frindex = 0;
+  BX_EHCI_THIS hub.async_active_usec = 0;
   BX_EHCI_THIS hub.astate = EST_INACTIVE;
   BX_EHCI_THIS hub.pstate = EST_INACTIVE;
   BX_EHCI_THIS queues_rip_all(0);
@@ -857,6 +864,12 @@ bool bx_usb_ehci_c::read_handler(bx_phy_address addr, unsigned len, void *data,
           val = BX_EHCI_THIS hub.op_regs.UsbIntr;
           break;
         case 0x0c:
+          if (BX_EHCI_THIS hub.frame_timer_usec == IDLE_TIMER_USEC) {
+            // the frame timer is slowed down, catch up with the elapsed frames
+            int frames = (int)((bx_pc_system.time_usec() - BX_EHCI_THIS hub.last_run_usec) / FRAME_TIMER_USEC);
+            BX_EHCI_THIS update_frindex(frames);
+            BX_EHCI_THIS hub.last_run_usec += FRAME_TIMER_USEC * frames;
+          }
           val = BX_EHCI_THIS hub.op_regs.FrIndex;
           break;
         case 0x10:
@@ -933,7 +946,7 @@ bool bx_usb_ehci_c::write_handler(bx_phy_address addr, unsigned len, void *data,
 {
   Bit32u value = *((Bit32u *) data);
   Bit32u value_hi = *((Bit32u *) ((Bit8u *) data + 4));     // Q: should value and value_hi to be swapped on BIG_ENDIAN platform ?
-  bool oldcfg, oldpo, oldpr, oldfpr;
+  bool oldcfg, oldpo, oldpr, oldfpr, oldase;
   int i, port;
   const Bit32u offset = (Bit32u) (addr - BX_EHCI_THIS pci_bar[0].addr);
 
@@ -959,6 +972,7 @@ bool bx_usb_ehci_c::write_handler(bx_phy_address addr, unsigned len, void *data,
     if (len == 4) {
       switch (offset - OPS_REGS_OFFSET) {
         case 0x00:
+          oldase = BX_EHCI_THIS hub.op_regs.UsbCmd.ase;
           BX_EHCI_THIS hub.op_regs.UsbCmd.itc   = (value >> 16) & 0x7f;
           BX_EHCI_THIS hub.op_regs.UsbCmd.iaad  = (value >> 6) & 1;
           BX_EHCI_THIS hub.op_regs.UsbCmd.ase   = (value >> 5) & 1;
@@ -978,6 +992,15 @@ bool bx_usb_ehci_c::write_handler(bx_phy_address addr, unsigned len, void *data,
           } else {
             BX_EHCI_THIS hub.op_regs.UsbSts.hchalted = 1;
           }
+          // enabling the async schedule or ringing the doorbell starts an
+          // async pass right away instead of waiting for the next frame
+          if (BX_EHCI_THIS hub.op_regs.UsbCmd.iaad ||
+              (BX_EHCI_THIS hub.op_regs.UsbCmd.ase && !oldase)) {
+            BX_EHCI_THIS kick_async_schedule();
+          }
+          if (BX_EHCI_THIS hub.frame_timer_usec == IDLE_TIMER_USEC) {
+            BX_EHCI_THIS set_frame_timer(FRAME_TIMER_USEC);
+          }
           break;
         case 0x04:
           BX_EHCI_THIS hub.op_regs.UsbSts.inti &= ~(value & USBINTR_MASK);
@@ -1099,17 +1122,32 @@ void bx_usb_ehci_c::commit_irq(void)
   if (!BX_EHCI_THIS hub.usbsts_pending) {
     return;
   }
-  if (BX_EHCI_THIS hub.usbsts_frindex > BX_EHCI_THIS hub.op_regs.FrIndex) {
+  Bit32u uframe = BX_EHCI_THIS current_uframe();
+  if (BX_EHCI_THIS hub.usbsts_frindex > uframe) {
     return;
   }
 
   Bit32u itc = BX_EHCI_THIS hub.op_regs.UsbCmd.itc;
   BX_EHCI_THIS hub.op_regs.UsbSts.inti |= BX_EHCI_THIS hub.usbsts_pending;
   BX_EHCI_THIS hub.usbsts_pending = 0;
-  BX_EHCI_THIS hub.usbsts_frindex = BX_EHCI_THIS hub.op_regs.FrIndex + itc;
+  BX_EHCI_THIS hub.usbsts_frindex = uframe + itc;
   BX_EHCI_THIS update_irq();
 }
 
+// FrIndex only advances in whole frames. For the interrupt threshold the
+// micro-frame within the current frame is derived from the emulated time,
+// so that interrupts can be delivered between frame timer ticks.
+Bit32u bx_usb_ehci_c::current_uframe(void)
+{
+  Bit32u uframe = BX_EHCI_THIS hub.op_regs.FrIndex;
+
+  if (BX_EHCI_THIS hub.op_regs.UsbCmd.rs) {
+    Bit64u elapsed = bx_pc_system.time_usec() - BX_EHCI_THIS hub.last_run_usec;
+    uframe += (elapsed >= FRAME_TIMER_USEC) ? 7 : (Bit32u)(elapsed / UFRAME_TIMER_USEC);
+  }
+  return uframe;
+}
+
 void bx_usb_ehci_c::update_halt(void)
 {
   if (BX_EHCI_THIS hub.op_regs.UsbCmd.rs) {
@@ -1475,7 +1513,9 @@ int bx_usb_ehci_c::event_handler(int event, void *ptr, int port)
       p->usb_status = packet->len;
 
       if (p->queue->async) {
+        BX_EHCI_THIS hub.async_active_usec = bx_pc_system.time_usec();
         BX_EHCI_THIS advance_async_state();
+        BX_EHCI_THIS commit_irq();
       }
       break;
     case USB_EVENT_WAKEUP:
@@ -2204,6 +2244,7 @@ void bx_usb_ehci_c::advance_state(int async)
         again = BX_EHCI_THIS state_execute(q);
         if (async) {
           BX_EHCI_THIS hub.async_stepdown = 0;
+          BX_EHCI_THIS hub.async_active_usec = bx_pc_system.time_usec();
         }
         break;
 
@@ -2370,7 +2411,8 @@ void bx_usb_ehci_c::ehci_frame_handler(void *this_ptr)
   class_ptr->ehci_frame_timer();
 }
 
-// Frame timer called once every 1.000 msec
+// Frame timer called once every 1.000 msec (every 125 usec while the async
+// schedule is busy, every 16 msec while both schedules are off)
 void bx_usb_ehci_c::ehci_frame_timer(void)
 {
   int need_timer = 0;
@@ -2437,11 +2479,39 @@ void bx_usb_ehci_c::ehci_frame_timer(void)
     need_timer++;
     BX_EHCI_THIS hub.async_stepdown = 0;
   }
-  if (need_timer) {
-    // TODO: modify timer not implemented
+  // Poll the async schedule every micro-frame while it has recently done
+  // some work, since the guest appends qTDs without notifying us. With
+  // both schedules off, only FrIndex has to advance, so the timer is
+  // slowed down.
+  if (BX_EHCI_THIS async_enabled() &&
+      ((t_now - BX_EHCI_THIS hub.async_active_usec) < (FRAME_TIMER_USEC * 4))) {
+    BX_EHCI_THIS set_frame_timer(UFRAME_TIMER_USEC);
+  } else if (need_timer) {
+    BX_EHCI_THIS set_frame_timer(FRAME_TIMER_USEC);
+  } else {
+    BX_EHCI_THIS set_frame_timer(IDLE_TIMER_USEC);
   }
 }
 
+void bx_usb_ehci_c::set_frame_timer(Bit32u usec)
+{
+  if (BX_EHCI_THIS hub.frame_timer_usec != usec) {
+    BX_EHCI_THIS hub.frame_timer_usec = usec;
+    bx_pc_system.activate_timer(BX_EHCI_THIS hub.frame_timer_index, usec, 1);
+  }
+}
+
+void bx_usb_ehci_c::kick_async_schedule(void)
+{
+  if (!BX_EHCI_THIS async_enabled())
+    return;
+
+  BX_EHCI_THIS hub.async_active_usec = bx_pc_system.time_usec();
+  BX_EHCI_THIS advance_async_state();
+  BX_EHCI_THIS commit_irq();
+  BX_EHCI_THIS set_frame_timer(UFRAME_TIMER_USEC);
+}
+
 // runtime configuration handler (called when continuing simulation)
 void bx_usb_ehci_c::runtime_config_handler(void *this_ptr)
 {
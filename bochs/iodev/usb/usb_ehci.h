@@ -230,6 +230,7 @@ typedef QTAILQ_HEAD(EHCIQueueHead, EHCIQueue) EHCIQueueHead;
 
 typedef struct {
   int frame_timer_index;
+  Bit32u frame_timer_usec;
 
   Bit8u  usbsts_pending;
   Bit32u usbsts_frindex;
@@ -242,6 +243,7 @@ typedef struct {
 
   Bit64u last_run_usec;
   Bit32u async_stepdown;
+  Bit64u async_active_usec;
 
   struct {
     Bit8u  CapLength;
@@ -377,6 +379,7 @@ private:
   void update_irq(void);
   void raise_irq(Bit8u intr);
   void commit_irq(void);
+  Bit32u current_uframe(void);
   void update_halt(void);
 
   void set_state(int async, int state);
@@ -429,6 +432,8 @@ private:
   // EHCI frame timer
   static void ehci_frame_handler(void *);
   void ehci_frame_timer(void);
+  void set_frame_timer(Bit32u usec);
+  void kick_async_schedule(void);
 
 #if BX_USE_USB_EHCI_SMF
   static bool read_handler(bx_phy_address addr, unsigned len, void *data, void *param);
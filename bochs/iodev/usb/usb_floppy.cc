@@ -445,6 +445,17 @@ bool usb_floppy_device_c::set_option(const char *option)
       s.model = 0;
     }
     return 1;
+  } else if (!strncmp(option, "timing:", 7)) {
+    if (!strcmp(option+7, "realistic")) {
+      s.timing = BX_DISK_TIMING_REALISTIC;
+    } else if (!strcmp(option+7, "ssd")) {
+      s.timing = BX_DISK_TIMING_SSD;
+    } else if (!strcmp(option+7, "instant")) {
+      s.timing = BX_DISK_TIMING_INSTANT;
+    } else {
+      BX_ERROR(("Unknown option '%s' for timing:", option+7));
+    }
+    return 1;
   }
   return 0;
 }
@@ -1153,7 +1164,11 @@ void usb_floppy_device_c::start_timer(Bit8u mode)
     delay *= 18;
   }
   bx_gui->statusbar_setitem(s.statusbar_id, 1, (mode > 0));
-  if (s.seek_pending) {
+  if (s.timing != BX_DISK_TIMING_REALISTIC) {
+    delay = bx_disk_timing_delay(s.timing, (mode == 2) ? (18 * 512) : 512);
+    s.cur_track = (s.sector / 36);
+    s.seek_pending = 0;
+  } else if (s.seek_pending) {
     new_track = (s.sector / 36);
     steps = abs(new_track - s.cur_track);
     if (steps == 0) steps = 1;
@@ -76,6 +76,7 @@ private:
     bx_list_c *config;
     char info_txt[BX_PATHNAME_LEN];
     bool model;  // 0 = bochs, 1 = teac
+    int timing;  // BX_DISK_TIMING_REALISTIC (default), _SSD or _INSTANT
     int statusbar_id;
     int floppy_timer_index;
     // members handled by runtime config
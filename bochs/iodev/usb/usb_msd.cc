@@ -669,6 +669,17 @@ bool usb_msd_device_c::set_option(const char *option)
       BX_ERROR(("Unknown option '%s' for proto:", option+6));
     }
     return 1;
+  } else if (!strncmp(option, "timing:", 7)) {
+    if (!strcmp(option+7, "realistic")) {
+      s.timing = BX_DISK_TIMING_REALISTIC;
+    } else if (!strcmp(option+7, "ssd")) {
+      s.timing = BX_DISK_TIMING_SSD;
+    } else if (!strcmp(option+7, "instant")) {
+      s.timing = BX_DISK_TIMING_INSTANT;
+    } else {
+      BX_ERROR(("Unknown option '%s' for timing:", option+7));
+    }
+    return 1;
   }
   return 0;
 }
@@ -725,6 +736,7 @@ bool usb_msd_device_c::init()
       sprintf(s.info_txt, "USB CD: media not present");
     }
   }
+  s.scsi_dev->set_timing(s.timing);
   s.scsi_dev->register_state(s.sr_list, "scsidev");
   if (getonoff(LOGLEV_DEBUG) == ACT_REPORT) {
     s.scsi_dev->set_debug_mode();
@@ -1160,6 +1172,10 @@ int usb_msd_device_c::handle_data(USBPacket *p)
             s.usb_buf = data;
             s.usb_len = len;
             len = 0;
+            if ((s.scsi_len == 0) && (s.residue == 0)) {
+              // no data yet: let the pending (or next) read go straight into this packet
+              s.scsi_dev->scsi_read_data(s.tag, s.usb_buf, s.usb_len);
+            }
             while (s.usb_len && s.scsi_len) {
               len += copy_data();
             }
@@ -1209,11 +1225,18 @@ int usb_msd_device_c::handle_data(USBPacket *p)
 
 int usb_msd_device_c::copy_data()
 {
+  Bit8u *direct = NULL;
   int len = s.usb_len;
   if (len > s.scsi_len)
     len = s.scsi_len;
   if (s.mode == USB_MSDM_DATAIN) {
-    memcpy(s.usb_buf, s.scsi_buf, len);
+    // the sectors may have been read straight into the packet buffer
+    if (s.usb_buf != s.scsi_buf)
+      memcpy(s.usb_buf, s.scsi_buf, len);
+  } else if ((len >= (int) s.sect_size) && (s.scsi_buf == s.scsi_dev->scsi_get_buf(s.tag))) {
+    // nothing buffered yet: hand whole sectors of the packet to the SCSI layer
+    len -= len % s.sect_size;
+    direct = s.usb_buf;
   } else {
     memcpy(s.scsi_buf, s.usb_buf, len);
   }
@@ -1222,9 +1245,15 @@ int usb_msd_device_c::copy_data()
   s.usb_buf += len;
   s.scsi_buf += len;
   s.data_len -= len;
-  if (s.scsi_len == 0) {
+  if (direct != NULL) {
+    // the next chunk is reported by the completion callback
+    s.scsi_len = 0;
+    s.scsi_dev->scsi_write_data(s.tag, direct, len);
+  } else if (s.scsi_len == 0) {
     if (s.mode == USB_MSDM_DATAIN) {
-      s.scsi_dev->scsi_read_data(s.tag);
+      // if this packet is full, the next one starts the read into its own buffer
+      if ((s.usb_len > 0) || (s.data_len == 0))
+        s.scsi_dev->scsi_read_data(s.tag, s.usb_buf, s.usb_len);
     } else if (s.mode == USB_MSDM_DATAOUT) {
       s.scsi_dev->scsi_write_data(s.tag);
     }
@@ -93,6 +93,7 @@ private:
     // members set in constructor / init
     char *image_mode;
     int  proto;  // MSD_PROTO_BBB (default), MSD_PROTO_UASP (uses streams)
+    int  timing; // BX_DISK_TIMING_REALISTIC (default), _SSD or _INSTANT
     device_image_t *hdimage;
     cdrom_base_c *cdrom;
     scsi_device_t *scsi_dev;
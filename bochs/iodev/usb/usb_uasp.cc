@@ -381,7 +381,12 @@ int usb_msd_device_c::uasp_do_command(USBPacket *p)
       s.scsi_dev->scsi_send_command(req->tag, iu->com_block, cmd_len, lun, d.async_mode);
       if (!UASP_GET_COMPLETE(req->mode)) { // zero transfer command?
         if (UASP_GET_DIR(req->mode) == USB_TOKEN_IN) {
-          s.scsi_dev->scsi_read_data(req->tag);
+          // if the data packet is already waiting, read straight into its buffer
+          if (req->p != NULL) {
+            s.scsi_dev->scsi_read_data(req->tag, req->p->data, req->p->len);
+          } else {
+            s.scsi_dev->scsi_read_data(req->tag);
+          }
         } else if (UASP_GET_DIR(req->mode) == USB_TOKEN_OUT) {
           s.scsi_dev->scsi_write_data(req->tag);
         }
@@ -623,11 +628,18 @@ int usb_msd_device_c::uasp_do_response(UASPRequest *req, USBPacket *p)
 
 void usb_msd_device_c::uasp_copy_data(UASPRequest *req)
 {
+  Bit8u *direct = NULL;
   Bit32u len = req->usb_len;
   if (len > req->scsi_len)
     len = req->scsi_len;
   if (UASP_GET_DIR(req->mode) == USB_TOKEN_IN) {
-    memcpy(req->usb_buf, req->scsi_buf, len);
+    // the sectors may have been read straight into the packet buffer
+    if (req->usb_buf != req->scsi_buf)
+      memcpy(req->usb_buf, req->scsi_buf, len);
+  } else if ((len >= s.sect_size) && (req->scsi_buf == s.scsi_dev->scsi_get_buf(req->tag))) {
+    // nothing buffered yet: hand whole sectors of the packet to the SCSI layer
+    len -= len % s.sect_size;
+    direct = req->usb_buf;
   } else {
     memcpy(req->scsi_buf, req->usb_buf, len);
   }
@@ -636,9 +648,13 @@ void usb_msd_device_c::uasp_copy_data(UASPRequest *req)
   req->usb_buf += len;
   req->scsi_buf += len;
   req->data_len -= len;
-  if (req->scsi_len == 0) {
+  if (direct != NULL) {
+    // the next chunk is reported by the completion callback
+    req->scsi_len = 0;
+    s.scsi_dev->scsi_write_data(req->tag, direct, len);
+  } else if (req->scsi_len == 0) {
     if (UASP_GET_DIR(req->mode) == USB_TOKEN_IN) {
-      s.scsi_dev->scsi_read_data(req->tag);
+      s.scsi_dev->scsi_read_data(req->tag, req->usb_buf, req->usb_len);
     } else {
       s.scsi_dev->scsi_write_data(req->tag);
     }
@@ -685,10 +701,11 @@ void usb_msd_device_c::uasp_command_complete(int reason, Bit32u tag, Bit32u arg)
   req->scsi_buf = s.scsi_dev->scsi_get_buf(tag);
   p = req->p;
   if (p) {
+    // reading the next chunk may complete synchronously and re-enter here
+    req->p = NULL;
     p->len = uasp_do_data(req, p);
     BX_DEBUG(("uasp: transferred %d bytes", p->len));
     BX_DEBUG(("packet complete 0x%p", p));
-    req->p = NULL;
     usb_packet_complete(p);
   }
 }
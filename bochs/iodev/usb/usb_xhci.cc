@@ -220,6 +220,7 @@ bx_usb_xhci_c::bx_usb_xhci_c()
   memset((void*)&hub, 0, sizeof(bx_usb_xhci_t));
   rt_conf_id = -1;
   xhci_timer_index = BX_NULL_TIMER_HANDLE;
+  imod_timer_index = BX_NULL_TIMER_HANDLE;
 }
 
 bx_usb_xhci_c::~bx_usb_xhci_c()
@@ -266,6 +267,8 @@ void bx_usb_xhci_c::init(void)
 
   BX_XHCI_THIS xhci_timer_index =
       DEV_register_timer(this, xhci_timer_handler, 1024, 1, 1, "xhci_timer");
+  BX_XHCI_THIS imod_timer_index =
+      DEV_register_timer(this, imod_timer_handler, 1000, 0, 0, "xhci_imod");
 
   BX_XHCI_THIS devfunc = 0x00;
   DEV_register_pci_handlers(this, &BX_XHCI_THIS devfunc, BX_PLUGIN_USB_XHCI,
@@ -307,6 +310,9 @@ void bx_usb_xhci_c::init(void)
   }
 
   BX_XHCI_THIS init_bar_mem(0, IO_SPACE_SIZE, read_handler, write_handler);
+  // MSI-X table and PBA live in BAR 0 like on the uPD720202
+  BX_XHCI_THIS init_msix(0x90, INTERRUPTERS, 0, MSIX_TABLE_OFFSET, MSIX_PBA_OFFSET);
+  BX_XHCI_THIS init_msi(0x70, INTERRUPTERS, 0);
 
   // initialize capability registers
   BX_XHCI_THIS hub.cap_regs.HcCapLength  = (VERSION_MAJOR << 24) | (VERSION_MINOR << 16) | OPS_REGS_OFFSET;
@@ -461,8 +467,7 @@ void bx_usb_xhci_c::reset(unsigned type)
       // capabilities list:
       { 0x50, 0x01 },                 // PCI Power Management
 
-//      { 0x51, 0x70 },                 //  Pointer to next item (0x70 -> MSI stuff)
-      { 0x51, 0x00 },                 //  Pointer to next item (0x00 = no more)
+      { 0x51, 0x70 },                 //  Pointer to next item (0x70 -> MSI stuff)
 
       { 0x52, 0xC3 }, { 0x53, 0xC9 }, //  Capabilities:  version = 1.2, Aux Current = 375mA,
       { 0x54, 0x08 }, { 0x55, 0x00 }, //        Status:  Power State = D0, Bit 3 = no soft reset
@@ -480,8 +485,7 @@ void bx_usb_xhci_c::reset(unsigned type)
        * this emulation.  However, the controller contains them within its PCI(e)
        * configuration space.  Therefore, I leave them here (though commented out)
        * for that sake.  This is for the benefit of the reader, along as myself.
-       * If you uncomment this section, remember to swap the commented lines above.
-       *  { 0x51, 0x70 },  and  { 0x51, 0x00 },
+       * The MSI and MSI-X capabilities are set up by init_msi() / init_msix().
 
       // MSI
       { 0x70, 0x05 },                 // MSI
@@ -565,6 +569,7 @@ void bx_usb_xhci_c::reset(unsigned type)
     for (unsigned i = 0; i < sizeof(reset_vals) / sizeof(*reset_vals); i++) {
         BX_XHCI_THIS pci_conf[reset_vals[i].addr] = reset_vals[i].val;
     }
+    BX_XHCI_THIS pci_msi_reset();
   }
 
   BX_XHCI_THIS reset_hc();
@@ -679,7 +684,12 @@ void bx_usb_xhci_c::reset_hc()
     BX_XHCI_THIS hub.runtime_regs.interrupter[i].erdp.eventadd = 0;
     BX_XHCI_THIS hub.runtime_regs.interrupter[i].erdp.ehb = 0;
     BX_XHCI_THIS hub.runtime_regs.interrupter[i].erdp.desi = 0;
+    BX_XHCI_THIS hub.ring_members.event_rings[i].imod_last = 0;
+    BX_XHCI_THIS hub.ring_members.event_rings[i].imod_pending = 0;
   }
+  bx_pc_system.deactivate_timer(BX_XHCI_THIS imod_timer_index);
+  BX_XHCI_THIS imod_timer_due = 0;
+  BX_XHCI_THIS trb_cache.count = 0;
 
   // reset our slot contexts
   for (i=0; i<MAX_SLOTS; i++)
@@ -1090,6 +1100,8 @@ void bx_usb_xhci_c::register_state(void)
     BXRS_HEX_PARAM_FIELD(item, trb_count, BX_XHCI_THIS hub.ring_members.event_rings[i].trb_count);
     BXRS_HEX_PARAM_FIELD(item, count, BX_XHCI_THIS hub.ring_members.event_rings[i].count);
     BXRS_HEX_PARAM_FIELD(item, cur_trb, BX_XHCI_THIS hub.ring_members.event_rings[i].cur_trb);
+    BXRS_DEC_PARAM_FIELD(item, imod_last, BX_XHCI_THIS hub.ring_members.event_rings[i].imod_last);
+    BXRS_PARAM_BOOL(item, imod_pending, BX_XHCI_THIS hub.ring_members.event_rings[i].imod_pending);
     entries = new bx_list_c(item, "entries");
     for (j = 0; j < (1<<MAX_SEG_TBL_SZ_EXP); j++) {
       sprintf(tmpname, "entry%d", j);
@@ -1110,6 +1122,9 @@ void bx_usb_xhci_c::after_restore_state(void)
       BX_XHCI_THIS hub.usb_port[j].device->after_restore_state();
     }
   }
+  BX_XHCI_THIS trb_cache.count = 0;
+  BX_XHCI_THIS imod_timer_due = 0;
+  imod_start_timer();
 }
 
 int xhci_event_handler(int event, void *ptr, void *dev, int port);
@@ -1150,6 +1165,14 @@ void bx_usb_xhci_c::update_irq(unsigned interrupter)
     level = 1;
     BX_DEBUG(("Interrupt Fired."));
   }
+  if (BX_XHCI_THIS pci_msi_enabled()) {
+    // with MSI(-X) the IP bit is cleared when the message has been sent
+    if (level) {
+      BX_XHCI_THIS hub.runtime_regs.interrupter[interrupter].iman.ip = 0;
+      BX_XHCI_THIS pci_msi_notify(interrupter);
+    }
+    return;
+  }
   DEV_pci_set_irq(BX_XHCI_THIS devfunc, BX_XHCI_THIS pci_conf[0x3d], level);
 }
 
@@ -1160,6 +1183,9 @@ bool bx_usb_xhci_c::read_handler(bx_phy_address addr, unsigned len, void *data,
 
   const Bit32u offset = (Bit32u) (addr - BX_XHCI_THIS pci_bar[0].addr);
 
+  if (BX_XHCI_THIS msix_mmio_access(offset, len, data, 0))
+    return 1;
+
   // Even though the controller allows reads other than 32-bits & on odd boundaries,
   //  we are going to ASSUME dword reads and writes unless specified below
 
@@ -1526,6 +1552,9 @@ bool bx_usb_xhci_c::write_handler(bx_phy_address addr, unsigned len, void *data,
   Bit32u temp;
   int i;
 
+  if (BX_XHCI_THIS msix_mmio_access(offset, len, data, 1))
+    return 1;
+
   // modify val and val_hi per len of data to write
   switch (len) {
     case 1:
@@ -1655,7 +1684,7 @@ bool bx_usb_xhci_c::write_handler(bx_phy_address addr, unsigned len, void *data,
         BX_XHCI_THIS hub.op_regs.HcStatus.pcd     = (value & (1 <<  4)) ? 0 : BX_XHCI_THIS hub.op_regs.HcStatus.pcd;
         BX_XHCI_THIS hub.op_regs.HcStatus.eint    = (value & (1 <<  3)) ? 0 : BX_XHCI_THIS hub.op_regs.HcStatus.eint;
         BX_XHCI_THIS hub.op_regs.HcStatus.hse     = (value & (1 <<  2)) ? 0 : BX_XHCI_THIS hub.op_regs.HcStatus.hse;
-        if (value & (1 << 3))  // acknowledging the interrupt
+        if ((value & (1 << 3)) && !BX_XHCI_THIS pci_msi_enabled())  // acknowledging the interrupt
           DEV_pci_set_irq(BX_XHCI_THIS devfunc, BX_XHCI_THIS pci_conf[0x3d], 0);
         break;
 
@@ -2282,6 +2311,7 @@ Bit64u bx_usb_xhci_c::process_transfer_ring(int slot, int ep, Bit64u ring_addr,
   }
 
   // read in the TRB
+  BX_XHCI_THIS trb_cache.count = 0;
   read_TRB((bx_phy_address) ring_addr, &trb);
   while ((trb.command & 1) == *rcs) {
 #if BX_USB_DEBUGGER
@@ -2559,6 +2589,7 @@ void bx_usb_xhci_c::process_command_ring(void)
     return;
 
   // read in the TRB
+  BX_XHCI_THIS trb_cache.count = 0;
   read_TRB((bx_phy_address) BX_XHCI_THIS hub.ring_members.command_ring.dq_pointer, &trb);
   BX_DEBUG(("Dump command trb: %d  (0x" FMT_ADDRX64 " 0x%08X 0x%08X) (%d)", TRB_GET_TYPE(trb.command),
     trb.parameter, trb.status, trb.command, BX_XHCI_THIS hub.ring_members.command_ring.rcs));
@@ -3099,25 +3130,106 @@ void bx_usb_xhci_c::write_event_TRB(unsigned interrupter, Bit64u parameter, Bit3
 
   // if caller wants us to fire an interrupt, do so
   if (fire_int) {
-    BX_XHCI_THIS hub.runtime_regs.interrupter[interrupter].iman.ip = 1;
-    BX_XHCI_THIS hub.runtime_regs.interrupter[interrupter].erdp.ehb = 1; // set event handler busy
-    BX_XHCI_THIS hub.op_regs.HcStatus.eint = 1;
-    update_irq(interrupter);
+    // Interrupter Moderation (section 4.17.2): while the interval (in 250ns
+    //  units) since the last interrupt has not elapsed, the interrupt is held
+    //  back and all events written until then are signaled by a single one.
+    const Bit64u interval = (Bit64u) BX_XHCI_THIS hub.runtime_regs.interrupter[interrupter].imod.imodi * 250;
+    if ((interval > 0) &&
+        (bx_pc_system.time_nsec() < (BX_XHCI_THIS hub.ring_members.event_rings[interrupter].imod_last + interval))) {
+      if (!BX_XHCI_THIS hub.ring_members.event_rings[interrupter].imod_pending) {
+        BX_XHCI_THIS hub.ring_members.event_rings[interrupter].imod_pending = 1;
+        imod_start_timer();
+      }
+    } else {
+      fire_interrupt(interrupter);
+    }
+  }
+}
+
+void bx_usb_xhci_c::fire_interrupt(unsigned interrupter)
+{
+  BX_XHCI_THIS hub.ring_members.event_rings[interrupter].imod_pending = 0;
+  BX_XHCI_THIS hub.ring_members.event_rings[interrupter].imod_last = bx_pc_system.time_nsec();
+  BX_XHCI_THIS hub.runtime_regs.interrupter[interrupter].iman.ip = 1;
+  BX_XHCI_THIS hub.runtime_regs.interrupter[interrupter].erdp.ehb = 1; // set event handler busy
+  BX_XHCI_THIS hub.op_regs.HcStatus.eint = 1;
+  update_irq(interrupter);
+}
+
+// (re)start the moderation timer for the earliest held back interrupt
+void bx_usb_xhci_c::imod_start_timer(void)
+{
+  Bit64u due, next = 0;
+
+  for (unsigned i=0; i<INTERRUPTERS; i++) {
+    if (BX_XHCI_THIS hub.ring_members.event_rings[i].imod_pending) {
+      due = BX_XHCI_THIS hub.ring_members.event_rings[i].imod_last +
+            (Bit64u) BX_XHCI_THIS hub.runtime_regs.interrupter[i].imod.imodi * 250;
+      if ((next == 0) || (due < next))
+        next = due;
+    }
+  }
+  if ((next > 0) && ((BX_XHCI_THIS imod_timer_due == 0) || (next < BX_XHCI_THIS imod_timer_due))) {
+    const Bit64u now = bx_pc_system.time_nsec();
+    BX_XHCI_THIS imod_timer_due = next;
+    bx_pc_system.activate_timer_nsec(BX_XHCI_THIS imod_timer_index, (next > now) ? (next - now) : 1, 0);
+  }
+}
+
+void bx_usb_xhci_c::imod_timer_handler(void *this_ptr)
+{
+  bx_usb_xhci_c *class_ptr = (bx_usb_xhci_c *) this_ptr;
+  class_ptr->imod_timer();
+}
+
+void bx_usb_xhci_c::imod_timer(void)
+{
+  const Bit64u now = bx_pc_system.time_nsec();
+
+  BX_XHCI_THIS imod_timer_due = 0;
+  for (unsigned i=0; i<INTERRUPTERS; i++) {
+    if (BX_XHCI_THIS hub.ring_members.event_rings[i].imod_pending &&
+        (now >= (BX_XHCI_THIS hub.ring_members.event_rings[i].imod_last +
+                 (Bit64u) BX_XHCI_THIS hub.runtime_regs.interrupter[i].imod.imodi * 250))) {
+      fire_interrupt(i);
+    }
   }
+  imod_start_timer();
 }
 
+// Rings are consumed sequentially, so up to TRB_PREFETCH_COUNT TRBs (not
+//  crossing a page) are fetched at once. The cache is dropped whenever the
+//  processing of a ring starts, since the guest may have updated it since.
 void bx_usb_xhci_c::read_TRB(bx_phy_address addr, struct TRB *trb)
 {
-  DEV_MEM_READ_PHYSICAL(addr,      8, (Bit8u*)&trb->parameter);
-  DEV_MEM_READ_PHYSICAL(addr +  8, 4, (Bit8u*)&trb->status);
-  DEV_MEM_READ_PHYSICAL(addr + 12, 4, (Bit8u*)&trb->command);
+  if ((addr < BX_XHCI_THIS trb_cache.addr) ||
+      (addr >= (BX_XHCI_THIS trb_cache.addr + BX_XHCI_THIS trb_cache.count * 16))) {
+    unsigned count = (unsigned) (0x1000 - (addr & 0xfff)) >> 4;
+    if (count > TRB_PREFETCH_COUNT)
+      count = TRB_PREFETCH_COUNT;
+    else if (count == 0)
+      count = 1;
+    DEV_MEM_READ_PHYSICAL_DMA(addr, count * 16, BX_XHCI_THIS trb_cache.buffer);
+    BX_XHCI_THIS trb_cache.addr = addr;
+    BX_XHCI_THIS trb_cache.count = count;
+  }
+  const Bit8u *ptr = BX_XHCI_THIS trb_cache.buffer + (unsigned) (addr - BX_XHCI_THIS trb_cache.addr);
+  memcpy(&trb->parameter, ptr, 8);
+  memcpy(&trb->status, ptr + 8, 4);
+  memcpy(&trb->command, ptr + 12, 4);
 }
 
 void bx_usb_xhci_c::write_TRB(bx_phy_address addr, Bit64u parameter, Bit32u status, Bit32u command)
 {
-  DEV_MEM_WRITE_PHYSICAL(addr     , 8, (Bit8u*)&parameter);
-  DEV_MEM_WRITE_PHYSICAL(addr +  8, 4, (Bit8u*)&status);
-  DEV_MEM_WRITE_PHYSICAL(addr + 12, 4, (Bit8u*)&command);
+  Bit8u buffer[16];
+
+  memcpy(buffer, &parameter, 8);
+  memcpy(buffer + 8, &status, 4);
+  memcpy(buffer + 12, &command, 4);
+  DEV_MEM_WRITE_PHYSICAL_DMA(addr, 16, buffer);
+  if ((addr + 16 > BX_XHCI_THIS trb_cache.addr) &&
+      (addr < (BX_XHCI_THIS trb_cache.addr + BX_XHCI_THIS trb_cache.count * 16)))
+    BX_XHCI_THIS trb_cache.count = 0;
 }
 
 void bx_usb_xhci_c::update_slot_context(int slot)
@@ -55,6 +55,9 @@
 #define MAX_SLOTS           32   // (1 based)
 #define INTERRUPTERS         8   //
 
+// number of TRBs fetched from a transfer or command ring at once
+#define TRB_PREFETCH_COUNT  16
+
 // Each controller supports its own number of ports.
 // Note: USB_XHCI_PORTS should be defined as twice the amount of sockets wanted.
 //  ie.: Typically each physical port (socket) has two defined port register sets.  One for USB3, one for USB2.
@@ -120,6 +123,9 @@
 
 #define RUNTIME_OFFSET    0x600
 
+#define MSIX_TABLE_OFFSET 0x1000  // MSI-X table and PBA in BAR 0
+#define MSIX_PBA_OFFSET   0x1080
+
 #define XHCI_PORT_SET_OFFSET  (0x400 + OPS_REGS_OFFSET)
 
 /************************************************************************************************/
@@ -203,6 +209,9 @@ struct RING_MEMBERS {
       Bit32u size;
       Bit32u resv;
     } entrys[(1<<MAX_SEG_TBL_SZ_EXP)];
+    // interrupt moderation of the interrupter serving this ring
+    Bit64u   imod_last;     // time (nsec) of the last interrupt assertion
+    bool     imod_pending;  // interrupt held back by the moderation interval
   } event_rings[INTERRUPTERS];
 };
 
@@ -614,8 +623,17 @@ private:
   Bit8u         device_change;
   int           rt_conf_id;
   int           xhci_timer_index;
+  int           imod_timer_index;
+  Bit64u        imod_timer_due;
   USBAsync      *packets;
 
+  // TRBs prefetched from the ring currently processed
+  struct {
+    bx_phy_address addr;
+    unsigned       count;
+    Bit8u          buffer[TRB_PREFETCH_COUNT * 16];
+  } trb_cache;
+
   static void reset_hc();
   static void reset_port(int);
   static void reset_port_usb3(int, int);
@@ -633,6 +651,10 @@ private:
   static Bit8u get_psceg(int port);
   static void xhci_timer_handler(void *);
   void xhci_timer(void);
+  static void imod_timer_handler(void *);
+  void imod_timer(void);
+  static void fire_interrupt(unsigned interrupter);
+  static void imod_start_timer(void);
 
   static Bit64u process_transfer_ring(int slot, int ep, Bit64u ring_addr, bool *rcs, int primary_sid);
   static void process_command_ring(void);
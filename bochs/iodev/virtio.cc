@@ -0,0 +1,524 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+/////////////////////////////////////////////////////////////////////////
+
+// Legacy virtio PCI transport (virtio 0.9.5 / virtio 1.x "legacy interface")
+// shared by the virtio device plugins. The guest places split virtqueues in
+// its memory and kicks the device through the notify register; the device
+// walks the descriptor chains directly in guest memory, so each request is
+// transferred with one DMA access per buffer segment.
+
+// Define BX_PLUGGABLE in files that can be compiled into plugins.  For
+// platforms that require a special tag on exported symbols, BX_PLUGGABLE
+// is used to know when we are exporting symbols and when we are importing.
+#define BX_PLUGGABLE
+
+#include "iodev.h"
+
+#if BX_SUPPORT_PCI && BX_SUPPORT_VIRTIO
+
+#include "pci.h"
+#include "virtio.h"
+
+#define LOG_THIS
+
+bx_virtio_pci_c::bx_virtio_pci_c()
+{
+  put("virtio", "VIRTIO");
+  virtio_config = NULL;
+  config_size = 0;
+  devfunc_ptr = NULL;
+  host_features = 0;
+  guest_features = 0;
+  queue_sel = 0;
+  status = 0;
+  isr = 0;
+  config_vector = VIRTIO_MSI_NO_VECTOR;
+  memset(queue_vector, 0xff, sizeof(queue_vector));
+  nqueues = 0;
+  memset(queue, 0, sizeof(queue));
+  memset(iomask, 7, sizeof(iomask));
+}
+
+bx_virtio_pci_c::~bx_virtio_pci_c()
+{
+  if (virtio_config != NULL) {
+    delete [] virtio_config;
+  }
+}
+
+void bx_virtio_pci_c::virtio_init(Bit8u *devfunc, const char *plugin, const char *descr,
+                                  Bit16u devid, Bit16u subsys_id, Bit32u classc,
+                                  Bit32u features, unsigned nq, Bit16u qsize,
+                                  unsigned cfg_size)
+{
+  Bit16u bar_size = 32;
+
+  if ((nq > VIRTIO_MAX_QUEUES) || (qsize > VIRTQ_MAX_SIZE) || ((qsize & (qsize - 1)) != 0)) {
+    BX_PANIC(("invalid virtqueue setup: %d queue(s) of size %d", nq, qsize));
+    return;
+  }
+  devfunc_ptr = devfunc;
+  DEV_register_pci_handlers(this, devfunc, plugin, descr);
+
+  // initialize readonly registers
+  init_pci_conf(VIRTIO_PCI_VENDOR_ID, devid, 0x00, classc, 0x00, BX_PCI_INTA);
+  pci_conf[0x2c] = (Bit8u)(VIRTIO_PCI_VENDOR_ID & 0xff);
+  pci_conf[0x2d] = (Bit8u)(VIRTIO_PCI_VENDOR_ID >> 8);
+  pci_conf[0x2e] = (Bit8u)(subsys_id & 0xff);
+  pci_conf[0x2f] = (Bit8u)(subsys_id >> 8);
+  while (bar_size < (VIRTIO_PCI_CONFIG_MSI + cfg_size)) {
+    bar_size <<= 1;
+  }
+  init_bar_io(0, bar_size, read_handler, write_handler, &iomask[0]);
+  // one MSI-X vector per queue plus one for config changes (BAR #1)
+  init_msix(0x40, nq + 1, 1, 0x0000, 0x0800);
+
+  host_features = features | (1 << VIRTIO_RING_F_INDIRECT_DESC);
+  nqueues = nq;
+  for (unsigned i = 0; i < nqueues; i++) {
+    queue[i].num = qsize;
+  }
+  config_size = cfg_size;
+  if (config_size > 0) {
+    virtio_config = new Bit8u[config_size];
+    memset(virtio_config, 0, config_size);
+  }
+}
+
+void bx_virtio_pci_c::virtio_reset_pci(void)
+{
+  static const struct reset_vals_t {
+    unsigned      addr;
+    unsigned char val;
+  } reset_vals[] = {
+    { 0x04, 0x00 }, { 0x05, 0x00 }, // command_io
+    { 0x06, 0x10 }, { 0x07, 0x00 }, // status (has caps list)
+    { 0x3c, 0x00 }                  // IRQ
+  };
+  for (unsigned i = 0; i < sizeof(reset_vals) / sizeof(*reset_vals); ++i) {
+    pci_conf[reset_vals[i].addr] = reset_vals[i].val;
+  }
+  pci_msi_reset();
+}
+
+void bx_virtio_pci_c::virtio_reset(void)
+{
+  guest_features = 0;
+  queue_sel = 0;
+  status = 0;
+  isr = 0;
+  config_vector = VIRTIO_MSI_NO_VECTOR;
+  for (unsigned i = 0; i < nqueues; i++) {
+    vq_set_pfn(i, 0);
+    queue_vector[i] = VIRTIO_MSI_NO_VECTOR;
+  }
+  update_irq();
+}
+
+void bx_virtio_pci_c::virtio_register_state(bx_list_c *list)
+{
+  char name[6];
+
+  bx_list_c *vio = new bx_list_c(list, "virtio");
+  new bx_shadow_num_c(vio, "guest_features", &guest_features, BASE_HEX);
+  new bx_shadow_num_c(vio, "queue_sel", &queue_sel);
+  new bx_shadow_num_c(vio, "status", &status, BASE_HEX);
+  new bx_shadow_num_c(vio, "isr", &isr, BASE_HEX);
+  new bx_shadow_num_c(vio, "config_vector", &config_vector, BASE_HEX);
+  for (unsigned i = 0; i < nqueues; i++) {
+    sprintf(name, "vq%d", i);
+    bx_list_c *vq = new bx_list_c(vio, name);
+    new bx_shadow_num_c(vq, "pfn", &queue[i].pfn, BASE_HEX);
+    new bx_shadow_num_c(vq, "vector", &queue_vector[i], BASE_HEX);
+    new bx_shadow_num_c(vq, "last_avail_idx", &queue[i].last_avail_idx);
+    new bx_shadow_num_c(vq, "used_idx", &queue[i].used_idx);
+  }
+  if (config_size > 0) {
+    new bx_shadow_data_c(vio, "config", virtio_config, config_size);
+  }
+  register_pci_state(list);
+}
+
+void bx_virtio_pci_c::virtio_after_restore_state(void)
+{
+  bx_pci_device_c::after_restore_pci_state();
+  for (unsigned i = 0; i < nqueues; i++) {
+    Bit16u last_avail_idx = queue[i].last_avail_idx;
+    Bit16u used_idx = queue[i].used_idx;
+    vq_set_pfn(i, queue[i].pfn);
+    queue[i].last_avail_idx = last_avail_idx;
+    queue[i].used_idx = used_idx;
+  }
+}
+
+// pci configuration space write callback handler
+void bx_virtio_pci_c::pci_write_handler(Bit8u address, Bit32u value, unsigned io_len)
+{
+  if (((address >= 0x10) && (address < 0x20)) ||
+      ((address > 0x23) && (address < 0x34)))
+    return;
+
+  BX_DEBUG_PCI_WRITE(address, value, io_len);
+  for (unsigned i = 0; i < io_len; i++) {
+    Bit8u value8 = (value >> (i*8)) & 0xff;
+    switch (address+i) {
+      case 0x04:
+        value8 &= 0x07; // I/O space, memory space (MSI-X table) and bus master
+        break;
+      case 0x05:
+        value8 &= 0x04; // INTx disable
+        break;
+      default:
+        value8 = pci_conf[address+i];
+    }
+    pci_conf[address+i] = value8;
+  }
+}
+
+// static IO port read/write callback handlers
+// redirect to the non-static class handlers
+
+Bit32u bx_virtio_pci_c::read_handler(void *this_ptr, Bit32u address, unsigned io_len)
+{
+  bx_virtio_pci_c *class_ptr = (bx_virtio_pci_c *) this_ptr;
+  return class_ptr->virtio_read(address - class_ptr->pci_bar[0].addr, io_len);
+}
+
+void bx_virtio_pci_c::write_handler(void *this_ptr, Bit32u address, Bit32u value, unsigned io_len)
+{
+  bx_virtio_pci_c *class_ptr = (bx_virtio_pci_c *) this_ptr;
+  class_ptr->virtio_write(address - class_ptr->pci_bar[0].addr, value, io_len);
+}
+
+Bit32u bx_virtio_pci_c::virtio_read(Bit32u offset, unsigned io_len)
+{
+  Bit32u value = 0;
+
+  if (offset >= config_offset()) {
+    offset -= config_offset();
+    for (unsigned i = 0; i < io_len; i++) {
+      if ((offset + i) < config_size) {
+        value |= (Bit32u)virtio_config[offset + i] << (i * 8);
+      }
+    }
+    return value;
+  }
+
+  switch (offset) {
+    case VIRTIO_PCI_HOST_FEATURES:
+      value = host_features;
+      break;
+    case VIRTIO_PCI_GUEST_FEATURES:
+      value = guest_features;
+      break;
+    case VIRTIO_PCI_QUEUE_PFN:
+      if (queue_sel < nqueues) value = queue[queue_sel].pfn;
+      break;
+    case VIRTIO_PCI_QUEUE_NUM:
+      if (queue_sel < nqueues) value = queue[queue_sel].num;
+      break;
+    case VIRTIO_PCI_QUEUE_SEL:
+      value = queue_sel;
+      break;
+    case VIRTIO_PCI_QUEUE_NOTIFY:
+      break;
+    case VIRTIO_PCI_STATUS:
+      value = status;
+      break;
+    case VIRTIO_PCI_ISR:
+      value = isr;
+      isr = 0;
+      update_irq();
+      break;
+    case VIRTIO_MSI_CONFIG_VECTOR:
+      value = config_vector;
+      break;
+    case VIRTIO_MSI_QUEUE_VECTOR:
+      value = (queue_sel < nqueues) ? queue_vector[queue_sel] : VIRTIO_MSI_NO_VECTOR;
+      break;
+    default:
+      BX_ERROR(("read from unsupported register offset 0x%02x (len=%d)", offset, io_len));
+  }
+  BX_DEBUG(("read offset 0x%02x = 0x%08x (len=%d)", offset, value, io_len));
+  return value;
+}
+
+void bx_virtio_pci_c::virtio_write(Bit32u offset, Bit32u value, unsigned io_len)
+{
+  BX_DEBUG(("write offset 0x%02x = 0x%08x (len=%d)", offset, value, io_len));
+  if (offset >= config_offset()) {
+    offset -= config_offset();
+    if ((offset + io_len) <= config_size) {
+      virtio_config_write(offset, value, io_len);
+    }
+    return;
+  }
+
+  switch (offset) {
+    case VIRTIO_PCI_GUEST_FEATURES:
+      guest_features = value & host_features;
+      break;
+    case VIRTIO_PCI_QUEUE_PFN:
+      if (queue_sel < nqueues) {
+        vq_set_pfn(queue_sel, value);
+      }
+      break;
+    case VIRTIO_PCI_QUEUE_SEL:
+      queue_sel = (Bit16u)value;
+      break;
+    case VIRTIO_PCI_QUEUE_NOTIFY:
+      value &= 0xffff;
+      if (vq_ready(value)) {
+        virtio_queue_notify(value);
+      }
+      break;
+    case VIRTIO_PCI_STATUS:
+      status = (Bit8u)value;
+      if (status == 0) {
+        virtio_reset();
+        virtio_device_reset();
+      }
+      break;
+    // a vector the table doesn't have reads back as "no vector"
+    case VIRTIO_MSI_CONFIG_VECTOR:
+      value &= 0xffff;
+      config_vector = (value <= nqueues) ? value : VIRTIO_MSI_NO_VECTOR;
+      break;
+    case VIRTIO_MSI_QUEUE_VECTOR:
+      value &= 0xffff;
+      if (queue_sel < nqueues) {
+        queue_vector[queue_sel] = (value <= nqueues) ? value : VIRTIO_MSI_NO_VECTOR;
+      }
+      break;
+    default:
+      BX_ERROR(("write to unsupported register offset 0x%02x (len=%d)", offset, io_len));
+  }
+}
+
+void bx_virtio_pci_c::update_irq(void)
+{
+  bool level = (isr != 0) && ((pci_conf[0x05] & 0x04) == 0) && !pci_msi_enabled();
+  DEV_pci_set_irq(*devfunc_ptr, pci_conf[0x3d], level);
+}
+
+// With MSI-X enabled the guest is signalled with the vector assigned to the
+// event, otherwise through the ISR register and INTx.
+void bx_virtio_pci_c::send_irq(Bit16u vector, Bit8u isr_bit)
+{
+  if (pci_msi_enabled()) {
+    if (vector != VIRTIO_MSI_NO_VECTOR) {
+      pci_msi_notify(vector);
+    }
+  } else {
+    isr |= isr_bit;
+    update_irq();
+  }
+}
+
+void bx_virtio_pci_c::virtio_config_changed(void)
+{
+  if (virtio_driver_ok()) {
+    send_irq(config_vector, VIRTIO_ISR_CONFIG);
+  }
+}
+
+// virtqueue handling
+
+void bx_virtio_pci_c::vq_set_pfn(unsigned q, Bit32u pfn)
+{
+  bx_virtq_t *vq = &queue[q];
+
+  vq->pfn = pfn;
+  vq->desc = (bx_phy_address)pfn << VIRTIO_PCI_QUEUE_ADDR_SHIFT;
+  vq->avail = vq->desc + vq->num * 16;
+  vq->used = (vq->avail + 4 + vq->num * 2 + 2 + VIRTIO_PCI_VRING_ALIGN - 1) &
+             ~(bx_phy_address)(VIRTIO_PCI_VRING_ALIGN - 1);
+  vq->last_avail_idx = 0;
+  vq->used_idx = 0;
+  if (pfn != 0) {
+    BX_DEBUG(("queue #%d: size=%d desc=0x" FMT_PHY_ADDRX " used=0x" FMT_PHY_ADDRX,
+              q, vq->num, vq->desc, vq->used));
+  }
+}
+
+bool bx_virtio_pci_c::vq_empty(unsigned q)
+{
+  Bit16u avail_idx;
+
+  if (!vq_ready(q)) return 1;
+  DEV_MEM_READ_PHYSICAL_DMA(queue[q].avail + 2, 2, (Bit8u*)&avail_idx);
+  return ReadHostWordFromLittleEndian(&avail_idx) == queue[q].last_avail_idx;
+}
+
+bool bx_virtio_pci_c::vq_read_desc(bx_phy_address table, Bit16u i, Bit64u *addr,
+                                   Bit32u *len, Bit16u *flags, Bit16u *next)
+{
+  Bit8u desc[16];
+
+  DEV_MEM_READ_PHYSICAL_DMA(table + i * 16, 16, desc);
+  *addr = ReadHostQWordFromLittleEndian((Bit64u*)&desc[0]);
+  *len = ReadHostDWordFromLittleEndian((Bit32u*)&desc[8]);
+  *flags = ReadHostWordFromLittleEndian((Bit16u*)&desc[12]);
+  *next = ReadHostWordFromLittleEndian((Bit16u*)&desc[14]);
+  return 1;
+}
+
+// Take the next available descriptor chain from queue 'q' and collect its
+// device readable (out) and device writable (in) segments.
+bool bx_virtio_pci_c::vq_pop(unsigned q, bx_virtq_elem_t *elem)
+{
+  bx_virtq_t *vq = &queue[q];
+  bx_phy_address table;
+  Bit64u addr;
+  Bit32u len;
+  Bit16u avail_idx, head, flags, next, i, max;
+  unsigned count = 0;
+
+  if (vq_empty(q)) return 0;
+  DEV_MEM_READ_PHYSICAL_DMA(vq->avail + 2, 2, (Bit8u*)&avail_idx);
+  if ((Bit16u)(ReadHostWordFromLittleEndian(&avail_idx) - vq->last_avail_idx) > vq->num) {
+    BX_ERROR(("queue #%d: avail index out of range", q));
+    return 0;
+  }
+  DEV_MEM_READ_PHYSICAL_DMA(vq->avail + 4 + (vq->last_avail_idx % vq->num) * 2, 2, (Bit8u*)&head);
+  head = ReadHostWordFromLittleEndian(&head);
+  if (head >= vq->num) {
+    BX_ERROR(("queue #%d: descriptor index %d out of range", q, head));
+    return 0;
+  }
+  vq->last_avail_idx++;
+
+  elem->index = head;
+  elem->out_num = elem->in_num = 0;
+  elem->out_len = elem->in_len = 0;
+  table = vq->desc;
+  max = vq->num;
+  i = head;
+  vq_read_desc(table, i, &addr, &len, &flags, &next);
+  if (flags & VRING_DESC_F_INDIRECT) {
+    if ((len < 16) || (len & 15)) {
+      BX_ERROR(("queue #%d: invalid indirect table size %d", q, len));
+      return 0;
+    }
+    table = (bx_phy_address)addr;
+    max = (Bit16u)(len / 16);
+    i = 0;
+    vq_read_desc(table, i, &addr, &len, &flags, &next);
+  }
+  while (1) {
+    if (flags & VRING_DESC_F_WRITE) {
+      if (elem->in_num >= VIRTQ_MAX_SG) break;
+      elem->in_sg[elem->in_num].addr = (bx_phy_address)addr;
+      elem->in_sg[elem->in_num++].len = len;
+      elem->in_len += len;
+    } else {
+      if ((elem->out_num >= VIRTQ_MAX_SG) || (elem->in_num > 0)) break;
+      elem->out_sg[elem->out_num].addr = (bx_phy_address)addr;
+      elem->out_sg[elem->out_num++].len = len;
+      elem->out_len += len;
+    }
+    if (!(flags & VRING_DESC_F_NEXT)) {
+      return 1;
+    }
+    if ((next >= max) || (++count >= max)) break;
+    i = next;
+    vq_read_desc(table, i, &addr, &len, &flags, &next);
+  }
+  BX_ERROR(("queue #%d: malformed descriptor chain at head %d", q, head));
+  // hand the broken chain back to the guest
+  vq_push(q, elem, 0);
+  return 0;
+}
+
+void bx_virtio_pci_c::vq_unpop(unsigned q)
+{
+  queue[q].last_avail_idx--;
+}
+
+// Return a processed chain to the guest. 'len' is the number of bytes the
+// device has written to the device writable segments.
+void bx_virtio_pci_c::vq_push(unsigned q, const bx_virtq_elem_t *elem, Bit32u len)
+{
+  bx_virtq_t *vq = &queue[q];
+  Bit8u entry[8];
+  Bit16u idx;
+
+  WriteHostDWordToLittleEndian((Bit32u*)&entry[0], elem->index);
+  WriteHostDWordToLittleEndian((Bit32u*)&entry[4], len);
+  DEV_MEM_WRITE_PHYSICAL_DMA(vq->used + 4 + (vq->used_idx % vq->num) * 8, 8, entry);
+  vq->used_idx++;
+  WriteHostWordToLittleEndian(&idx, vq->used_idx);
+  DEV_MEM_WRITE_PHYSICAL_DMA(vq->used + 2, 2, (Bit8u*)&idx);
+}
+
+// Signal the guest after one or more chains have been pushed, unless the
+// driver has suppressed interrupts for this queue.
+void bx_virtio_pci_c::vq_notify(unsigned q)
+{
+  Bit16u flags;
+
+  DEV_MEM_READ_PHYSICAL_DMA(queue[q].avail, 2, (Bit8u*)&flags);
+  if (!(ReadHostWordFromLittleEndian(&flags) & VRING_AVAIL_F_NO_INTERRUPT)) {
+    send_irq(queue_vector[q], VIRTIO_ISR_QUEUE);
+  }
+}
+
+Bit32u bx_virtio_pci_c::vq_copy_from(const bx_virtq_elem_t *elem, Bit32u offset,
+                                     Bit8u *buf, Bit32u len)
+{
+  Bit32u done = 0;
+
+  for (unsigned i = 0; (i < elem->out_num) && (done < len); i++) {
+    const bx_virtq_sg_t *sg = &elem->out_sg[i];
+    if (offset >= sg->len) {
+      offset -= sg->len;
+      continue;
+    }
+    Bit32u n = sg->len - offset;
+    if (n > (len - done)) n = len - done;
+    DEV_MEM_READ_PHYSICAL_DMA(sg->addr + offset, n, buf + done);
+    done += n;
+    offset = 0;
+  }
+  return done;
+}
+
+Bit32u bx_virtio_pci_c::vq_copy_to(const bx_virtq_elem_t *elem, Bit32u offset,
+                                   const Bit8u *buf, Bit32u len)
+{
+  Bit32u done = 0;
+
+  for (unsigned i = 0; (i < elem->in_num) && (done < len); i++) {
+    const bx_virtq_sg_t *sg = &elem->in_sg[i];
+    if (offset >= sg->len) {
+      offset -= sg->len;
+      continue;
+    }
+    Bit32u n = sg->len - offset;
+    if (n > (len - done)) n = len - done;
+    DEV_MEM_WRITE_PHYSICAL_DMA(sg->addr + offset, n, (Bit8u*)buf + done);
+    done += n;
+    offset = 0;
+  }
+  return done;
+}
+
+#endif // BX_SUPPORT_PCI && BX_SUPPORT_VIRTIO
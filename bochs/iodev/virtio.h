@@ -0,0 +1,165 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BX_IODEV_VIRTIO_H
+#define BX_IODEV_VIRTIO_H
+
+// PCI IDs of the legacy ("transitional") virtio devices
+#define VIRTIO_PCI_VENDOR_ID      0x1af4
+
+// legacy virtio PCI I/O register layout (BAR #0)
+#define VIRTIO_PCI_HOST_FEATURES  0x00  // 32-bit r/o
+#define VIRTIO_PCI_GUEST_FEATURES 0x04  // 32-bit r/w
+#define VIRTIO_PCI_QUEUE_PFN      0x08  // 32-bit r/w
+#define VIRTIO_PCI_QUEUE_NUM      0x0c  // 16-bit r/o
+#define VIRTIO_PCI_QUEUE_SEL      0x0e  // 16-bit r/w
+#define VIRTIO_PCI_QUEUE_NOTIFY   0x10  // 16-bit r/w
+#define VIRTIO_PCI_STATUS         0x12  // 8-bit r/w
+#define VIRTIO_PCI_ISR            0x13  // 8-bit r/o, cleared on read
+#define VIRTIO_PCI_CONFIG         0x14  // start of device specific config
+// with MSI-X enabled two vector registers precede the device config
+#define VIRTIO_MSI_CONFIG_VECTOR  0x14  // 16-bit r/w
+#define VIRTIO_MSI_QUEUE_VECTOR   0x16  // 16-bit r/w
+#define VIRTIO_PCI_CONFIG_MSI     0x18
+#define VIRTIO_MSI_NO_VECTOR      0xffff
+
+#define VIRTIO_PCI_QUEUE_ADDR_SHIFT 12
+#define VIRTIO_PCI_VRING_ALIGN      4096
+
+// device status bits
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER      0x02
+#define VIRTIO_STATUS_DRIVER_OK   0x04
+#define VIRTIO_STATUS_FAILED      0x80
+
+// ISR status bits
+#define VIRTIO_ISR_QUEUE          0x01
+#define VIRTIO_ISR_CONFIG         0x02
+
+// transport feature bits
+#define VIRTIO_RING_F_INDIRECT_DESC 28
+
+// vring descriptor and avail ring flags
+#define VRING_DESC_F_NEXT         1
+#define VRING_DESC_F_WRITE        2
+#define VRING_DESC_F_INDIRECT     4
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+
+#define VIRTIO_MAX_QUEUES         16
+#define VIRTQ_MAX_SIZE            1024
+#define VIRTQ_MAX_SG              128
+
+// one virtqueue as set up by the guest driver
+typedef struct {
+  Bit16u num;             // queue size (fixed by the device)
+  Bit32u pfn;             // guest page frame of the vring, 0 = not in use
+  bx_phy_address desc;    // descriptor table
+  bx_phy_address avail;   // available ring
+  bx_phy_address used;    // used ring
+  Bit16u last_avail_idx;  // next available entry to be processed
+  Bit16u used_idx;        // next used entry to be filled
+} bx_virtq_t;
+
+typedef struct {
+  bx_phy_address addr;
+  Bit32u len;
+} bx_virtq_sg_t;
+
+// one descriptor chain popped from an available ring
+typedef struct {
+  Bit16u index;           // head descriptor index
+  unsigned out_num;       // device readable segments
+  unsigned in_num;        // device writable segments
+  Bit32u out_len;
+  Bit32u in_len;
+  bx_virtq_sg_t out_sg[VIRTQ_MAX_SG];
+  bx_virtq_sg_t in_sg[VIRTQ_MAX_SG];
+} bx_virtq_elem_t;
+
+// Legacy virtio PCI transport shared by the virtio device plugins. The
+// device specific part derives from this class and implements the queue
+// notify and config space hooks.
+class bx_virtio_pci_c : public bx_pci_device_c {
+public:
+  bx_virtio_pci_c();
+  virtual ~bx_virtio_pci_c();
+  virtual void pci_write_handler(Bit8u address, Bit32u value, unsigned io_len);
+
+protected:
+  void virtio_init(Bit8u *devfunc, const char *plugin, const char *descr,
+                   Bit16u devid, Bit16u subsys_id, Bit32u classc,
+                   Bit32u features, unsigned nqueues, Bit16u qsize,
+                   unsigned config_size);
+  void virtio_reset_pci(void);
+  void virtio_reset(void);
+  void virtio_register_state(bx_list_c *list);
+  void virtio_after_restore_state(void);
+
+  bool virtio_has_feature(unsigned bit) const {return (guest_features & (1 << bit)) != 0;}
+  bool virtio_driver_ok(void) const {return (status & VIRTIO_STATUS_DRIVER_OK) != 0;}
+
+  // virtqueue access
+  bool vq_ready(unsigned q) const {return (q < nqueues) && (queue[q].pfn != 0);}
+  bool vq_empty(unsigned q);
+  bool vq_pop(unsigned q, bx_virtq_elem_t *elem);
+  void vq_unpop(unsigned q);
+  void vq_push(unsigned q, const bx_virtq_elem_t *elem, Bit32u len);
+  void vq_notify(unsigned q);
+  Bit32u vq_copy_from(const bx_virtq_elem_t *elem, Bit32u offset, Bit8u *buf, Bit32u len);
+  Bit32u vq_copy_to(const bx_virtq_elem_t *elem, Bit32u offset, const Bit8u *buf, Bit32u len);
+
+  void virtio_config_changed(void);
+
+  // device specific hooks
+  virtual void virtio_queue_notify(unsigned q) = 0;
+  virtual void virtio_config_write(unsigned offset, Bit32u value, unsigned len) {}
+  virtual void virtio_device_reset(void) {}
+
+  Bit8u  *virtio_config;
+  unsigned config_size;
+
+private:
+  static Bit32u read_handler(void *this_ptr, Bit32u address, unsigned io_len);
+  static void   write_handler(void *this_ptr, Bit32u address, Bit32u value, unsigned io_len);
+  Bit32u virtio_read(Bit32u offset, unsigned io_len);
+  void   virtio_write(Bit32u offset, Bit32u value, unsigned io_len);
+
+  void   vq_set_pfn(unsigned q, Bit32u pfn);
+  bool   vq_read_desc(bx_phy_address table, Bit16u i, Bit64u *addr, Bit32u *len,
+                      Bit16u *flags, Bit16u *next);
+  void   update_irq(void);
+  void   send_irq(Bit16u vector, Bit8u isr_bit);
+  unsigned config_offset(void) const {return pci_msi_enabled() ? VIRTIO_PCI_CONFIG_MSI : VIRTIO_PCI_CONFIG;}
+
+  Bit8u  *devfunc_ptr;
+  Bit32u host_features;
+  Bit32u guest_features;
+  Bit16u queue_sel;
+  Bit8u  status;
+  Bit8u  isr;
+  Bit16u config_vector;
+  Bit16u queue_vector[VIRTIO_MAX_QUEUES];
+  unsigned nqueues;
+  bx_virtq_t queue[VIRTIO_MAX_QUEUES];
+  Bit8u  iomask[256];
+};
+
+#endif
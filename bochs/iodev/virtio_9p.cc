@@ -0,0 +1,1633 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+/////////////////////////////////////////////////////////////////////////
+
+// Virtio 9P device sharing a host directory with the guest using the
+// 9P2000.L protocol of the Linux v9fs client:
+//   mount -t 9p -o trans=virtio,version=9p2000.L <tag> /mnt
+//
+// The payload of Tread and Twrite is transferred between the host file and
+// the guest buffers with preadv() / pwritev() on the host addresses of the
+// guest pages, only the message headers are copied. The requests are either
+// handled when the guest notifies the queue or, if worker threads are
+// configured, passed to the workers and completed by a poll timer, so slow
+// host file system calls don't stall the emulation.
+//
+// Host files are accessed with the permissions of the Bochs process (like
+// the "passthrough" security model of other emulators). The host paths are
+// resolved component by component from the shared directory without
+// following symbolic links, the guest resolves them itself, so neither the
+// guest nor links found in the share can reach files outside of it.
+
+// Define BX_PLUGGABLE in files that can be compiled into plugins.  For
+// platforms that require a special tag on exported symbols, BX_PLUGGABLE
+// is used to know when we are exporting symbols and when we are importing.
+#define BX_PLUGGABLE
+
+#include "iodev.h"
+#include "pc_system.h"
+
+#if BX_SUPPORT_PCI && BX_SUPPORT_VIRTIO
+
+#include "pci.h"
+#include "virtio.h"
+#include "virtio_9p.h"
+
+#include <errno.h>
+#ifdef BX_V9P_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+// directory fd only used as base for the *at() calls
+#ifdef O_PATH
+#define V9P_O_DIR (O_PATH | O_DIRECTORY)
+#else
+#define V9P_O_DIR (O_RDONLY | O_DIRECTORY)
+#endif
+#endif
+
+#define LOG_THIS theVirtio9P->
+
+bx_virtio_9p_c *theVirtio9P = NULL;
+
+// builtin configuration handling functions
+
+void virtio_9p_init_options(void)
+{
+  bx_list_c *misc = (bx_list_c*)SIM->get_param("misc");
+  bx_list_c *menu = new bx_list_c(misc, "virtio_9p", "Virtio 9P Options");
+  menu->set_options(menu->SHOW_PARENT);
+  bx_param_bool_c *enabled = new bx_param_bool_c(menu, "enabled",
+    "Enable virtio 9P",
+    "Enables the virtio 9P PCI device (host directory sharing)",
+    0);
+  bx_param_filename_c *path = new bx_param_filename_c(menu, "path",
+    "Shared host directory",
+    "Host directory exported to the guest",
+    "", BX_PATHNAME_LEN);
+  bx_param_string_c *tag = new bx_param_string_c(menu, "tag",
+    "Mount tag",
+    "Name the guest uses to mount the shared directory",
+    "bochs", BX_V9P_MAX_TAG_LEN + 1);
+  bx_param_num_c *workers = new bx_param_num_c(menu, "workers",
+    "Worker threads",
+    "Number of host threads handling requests (0 = emulation thread)",
+    0, BX_V9P_MAX_WORKERS,
+    0);
+  bx_param_bool_c *readonly = new bx_param_bool_c(menu, "readonly",
+    "Read-only",
+    "Export the directory read-only",
+    0);
+  bx_list_c *deplist = new bx_list_c(NULL);
+  deplist->add(path);
+  deplist->add(tag);
+  deplist->add(workers);
+  deplist->add(readonly);
+  enabled->set_dependent_list(deplist);
+}
+
+Bit32s virtio_9p_options_parser(const char *context, int num_params, char *params[])
+{
+  if (!strcmp(params[0], "virtio_9p")) {
+    bx_list_c *base = (bx_list_c*) SIM->get_param(BXPN_VIRTIO_9P);
+    for (int i = 1; i < num_params; i++) {
+      if (SIM->parse_param_from_list(context, params[i], base) < 0) {
+        BX_ERROR(("%s: unknown parameter for virtio_9p ignored.", context));
+      }
+    }
+  } else {
+    BX_PANIC(("%s: unknown directive '%s'", context, params[0]));
+  }
+  return 0;
+}
+
+Bit32s virtio_9p_options_save(FILE *fp)
+{
+  return SIM->write_param_list(fp, (bx_list_c*) SIM->get_param(BXPN_VIRTIO_9P), NULL, 0);
+}
+
+// device plugin entry point
+
+PLUGIN_ENTRY_FOR_MODULE(virtio_9p)
+{
+  if (mode == PLUGIN_INIT) {
+    theVirtio9P = new bx_virtio_9p_c();
+    BX_REGISTER_DEVICE_DEVMODEL(plugin, type, theVirtio9P, BX_PLUGIN_VIRTIO_9P);
+    // add new configuration parameters for the config interface
+    virtio_9p_init_options();
+    // register add-on option for bochsrc and command line
+    SIM->register_addon_option("virtio_9p", virtio_9p_options_parser,
+                               virtio_9p_options_save);
+  } else if (mode == PLUGIN_FINI) {
+    SIM->unregister_addon_option("virtio_9p");
+    bx_list_c *misc = (bx_list_c*)SIM->get_param("misc");
+    misc->remove("virtio_9p");
+    delete theVirtio9P;
+  } else if (mode == PLUGIN_PROBE) {
+    return (int)PLUGTYPE_OPTIONAL;
+  } else if (mode == PLUGIN_FLAGS) {
+    return PLUGFLAG_PCI;
+  }
+  return 0; // Success
+}
+
+// 9P message encoding
+
+typedef struct {
+  Bit8u  *buf;
+  Bit32u pos;
+  Bit32u size;
+  bool   err;
+} bx_v9p_buf_t;
+
+static Bit8u v9p_get8(bx_v9p_buf_t *b)
+{
+  if ((b->pos + 1) > b->size) {
+    b->err = 1;
+    return 0;
+  }
+  return b->buf[b->pos++];
+}
+
+static Bit16u v9p_get16(bx_v9p_buf_t *b)
+{
+  if ((b->pos + 2) > b->size) {
+    b->err = 1;
+    return 0;
+  }
+  b->pos += 2;
+  return ReadHostWordFromLittleEndian((Bit16u*)&b->buf[b->pos - 2]);
+}
+
+static Bit32u v9p_get32(bx_v9p_buf_t *b)
+{
+  if ((b->pos + 4) > b->size) {
+    b->err = 1;
+    return 0;
+  }
+  b->pos += 4;
+  return ReadHostDWordFromLittleEndian((Bit32u*)&b->buf[b->pos - 4]);
+}
+
+static Bit64u v9p_get64(bx_v9p_buf_t *b)
+{
+  if ((b->pos + 8) > b->size) {
+    b->err = 1;
+    return 0;
+  }
+  b->pos += 8;
+  return ReadHostQWordFromLittleEndian((Bit64u*)&b->buf[b->pos - 8]);
+}
+
+// strings are stored as len[2] followed by the bytes without terminator
+static void v9p_getstr(bx_v9p_buf_t *b, char *str, unsigned maxlen)
+{
+  Bit16u len = v9p_get16(b);
+  if (b->err || (len >= maxlen) || ((b->pos + len) > b->size) ||
+      (memchr(&b->buf[b->pos], 0, len) != NULL)) {
+    b->err = 1;
+    str[0] = 0;
+    return;
+  }
+  memcpy(str, &b->buf[b->pos], len);
+  str[len] = 0;
+  b->pos += len;
+}
+
+static void v9p_put8(bx_v9p_buf_t *b, Bit8u val)
+{
+  if ((b->pos + 1) > b->size) {
+    b->err = 1;
+    return;
+  }
+  b->buf[b->pos++] = val;
+}
+
+static void v9p_put16(bx_v9p_buf_t *b, Bit16u val)
+{
+  if ((b->pos + 2) > b->size) {
+    b->err = 1;
+    return;
+  }
+  WriteHostWordToLittleEndian((Bit16u*)&b->buf[b->pos], val);
+  b->pos += 2;
+}
+
+static void v9p_put32(bx_v9p_buf_t *b, Bit32u val)
+{
+  if ((b->pos + 4) > b->size) {
+    b->err = 1;
+    return;
+  }
+  WriteHostDWordToLittleEndian((Bit32u*)&b->buf[b->pos], val);
+  b->pos += 4;
+}
+
+static void v9p_put64(bx_v9p_buf_t *b, Bit64u val)
+{
+  if ((b->pos + 8) > b->size) {
+    b->err = 1;
+    return;
+  }
+  WriteHostQWordToLittleEndian((Bit64u*)&b->buf[b->pos], val);
+  b->pos += 8;
+}
+
+static void v9p_putstr(bx_v9p_buf_t *b, const char *str)
+{
+  Bit16u len = (Bit16u)strlen(str);
+  v9p_put16(b, len);
+  if ((b->pos + len) > b->size) {
+    b->err = 1;
+    return;
+  }
+  memcpy(&b->buf[b->pos], str, len);
+  b->pos += len;
+}
+
+#ifdef BX_V9P_POSIX
+
+static void v9p_putqid(bx_v9p_buf_t *b, const struct stat *st)
+{
+  Bit8u type = 0x00;
+
+  if (S_ISDIR(st->st_mode)) {
+    type = 0x80;
+  } else if (S_ISLNK(st->st_mode)) {
+    type = 0x02;
+  }
+  v9p_put8(b, type);
+  v9p_put32(b, (Bit32u)(st->st_mtime ^ (st->st_size << 8)));
+  v9p_put64(b, (Bit64u)st->st_ino);
+}
+
+#ifdef __linux__
+#define V9P_ATIME_NSEC(st) ((st).st_atim.tv_nsec)
+#define V9P_MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#define V9P_CTIME_NSEC(st) ((st).st_ctim.tv_nsec)
+#else
+#define V9P_ATIME_NSEC(st) 0
+#define V9P_MTIME_NSEC(st) 0
+#define V9P_CTIME_NSEC(st) 0
+#endif
+
+// Rlerror returns Linux errno values
+static Bit32u v9p_errno(int err)
+{
+#ifdef __linux__
+  return err;
+#else
+  switch (err) {
+    case EAGAIN:       return 11;
+    case ENAMETOOLONG: return 36;
+    case ENOSYS:       return 38;
+    case ENOTEMPTY:    return 39;
+    case ELOOP:        return 40;
+    case EOPNOTSUPP:   return 95;
+#if defined(ENOTSUP) && (ENOTSUP != EOPNOTSUPP)
+    case ENOTSUP:      return 95;
+#endif
+    default:           return err; // the classic values are the same
+  }
+#endif
+}
+
+// 9P2000.L open flags use the Linux values
+static int v9p_open_flags(Bit32u flags)
+{
+  int oflags = flags & 3; // O_RDONLY / O_WRONLY / O_RDWR
+
+  if (flags & 000000100) oflags |= O_CREAT;
+  if (flags & 000000200) oflags |= O_EXCL;
+  if (flags & 000001000) oflags |= O_TRUNC;
+  if (flags & 000002000) oflags |= O_APPEND;
+  if (flags & 000400000) oflags |= O_NOFOLLOW;
+#ifdef O_DSYNC
+  if (flags & 000010000) oflags |= O_DSYNC;
+#endif
+  if (flags & 004000000) oflags |= O_SYNC;
+  return oflags;
+}
+
+static bool v9p_modifies(Bit8u type)
+{
+  switch (type) {
+    case P9_TLCREATE:
+    case P9_TSYMLINK:
+    case P9_TMKNOD:
+    case P9_TRENAME:
+    case P9_TSETATTR:
+    case P9_TWRITE:
+    case P9_TLINK:
+    case P9_TMKDIR:
+    case P9_TRENAMEAT:
+    case P9_TUNLINKAT:
+      return 1;
+  }
+  return 0;
+}
+
+static bool v9p_valid_name(const char *name)
+{
+  return (name[0] != 0) && strcmp(name, ".") && strcmp(name, "..") &&
+         (strchr(name, '/') == NULL);
+}
+
+static char *v9p_join(const char *dir, const char *name)
+{
+  char *path = (char*)malloc(strlen(dir) + strlen(name) + 2);
+  sprintf(path, "%s/%s", dir, name);
+  return path;
+}
+
+// chmod() that doesn't follow a symbolic link at <leaf>
+static int v9p_fchmodat(int dfd, const char *leaf, mode_t mode)
+{
+  struct stat st;
+
+  if (fchmodat(dfd, leaf, mode, AT_SYMLINK_NOFOLLOW) == 0) return 0;
+  // older C libraries reject the flag for all files
+  if (((errno != ENOTSUP) && (errno != EOPNOTSUPP)) ||
+      (fstatat(dfd, leaf, &st, AT_SYMLINK_NOFOLLOW) < 0) || S_ISLNK(st.st_mode)) {
+    return -1;
+  }
+  return fchmodat(dfd, leaf, mode, 0);
+}
+
+// truncate() that doesn't follow a symbolic link at <leaf>
+static int v9p_truncateat(int dfd, const char *leaf, off_t size)
+{
+  int fd = openat(dfd, leaf, O_WRONLY | O_NOFOLLOW | O_NONBLOCK);
+
+  if (fd < 0) return -1;
+  int ret = ftruncate(fd, size), err = errno;
+  close(fd);
+  errno = err;
+  return ret;
+}
+
+#endif
+
+// the device object
+
+bx_virtio_9p_c::bx_virtio_9p_c()
+{
+  put("virtio_9p", "V9P");
+  devfunc = 0x00;
+  timer_index = BX_NULL_TIMER_HANDLE;
+  root = NULL;
+  root_fd = -1;
+  readonly = 0;
+  msize = 8192;
+  memset(fids, 0, sizeof(fids));
+  nworkers = 0;
+  in_flight = 0;
+  stop_workers = 0;
+  work_head = work_tail = NULL;
+  done_head = NULL;
+  busy_head = flush_head = NULL;
+  BX_INIT_MUTEX(fid_mutex);
+  BX_INIT_MUTEX(work_mutex);
+}
+
+bx_virtio_9p_c::~bx_virtio_9p_c()
+{
+  wait_idle();
+  if (nworkers > 0) {
+    BX_LOCK(work_mutex);
+    stop_workers = 1;
+    BX_UNLOCK(work_mutex);
+    for (unsigned i = 0; i < nworkers; i++) {
+      bx_set_sem(&work_sem);
+    }
+    for (unsigned i = 0; i < nworkers; i++) {
+      BX_THREAD_JOIN(threads[i]);
+    }
+    bx_destroy_sem(&work_sem);
+  }
+  BX_LOCK(fid_mutex);
+  fid_destroy_all();
+  BX_UNLOCK(fid_mutex);
+  BX_FINI_MUTEX(fid_mutex);
+  BX_FINI_MUTEX(work_mutex);
+  if (root != NULL) {
+    free(root);
+  }
+#ifdef BX_V9P_POSIX
+  if (root_fd >= 0) {
+    close(root_fd);
+  }
+#endif
+  SIM->get_bochs_root()->remove("virtio_9p");
+  BX_DEBUG(("Exit"));
+}
+
+void bx_virtio_9p_c::init(void)
+{
+  // Read in values from config interface
+  bx_list_c *base = (bx_list_c*) SIM->get_param(BXPN_VIRTIO_9P);
+  // Check if the device is disabled or not configured
+  if (!SIM->get_param_bool("enabled", base)->get()) {
+    BX_INFO(("virtio 9P disabled"));
+    // mark unused plugin for removal
+    ((bx_param_bool_c*)((bx_list_c*)SIM->get_param(BXPN_PLUGIN_CTRL))->get_by_name("virtio_9p"))->set(0);
+    return;
+  }
+#ifdef BX_V9P_POSIX
+  const char *path = SIM->get_param_string("path", base)->getptr();
+  struct stat st;
+  if ((path[0] == 0) || (stat(path, &st) < 0) || !S_ISDIR(st.st_mode)) {
+    BX_PANIC(("virtio 9P: shared path '%s' is not a directory", path));
+    return;
+  }
+  root = realpath(path, NULL);
+  if (root == NULL) {
+    root = strdup(path);
+  }
+  if ((root_fd = open(root, V9P_O_DIR)) < 0) {
+    BX_PANIC(("virtio 9P: cannot open shared path '%s'", root));
+    return;
+  }
+#else
+  BX_PANIC(("virtio 9P: host directory sharing not supported on this platform"));
+  return;
+#endif
+  const char *tag = SIM->get_param_string("tag", base)->getptr();
+  unsigned taglen = strlen(tag);
+  if (taglen == 0) {
+    BX_PANIC(("virtio 9P: mount tag must not be empty"));
+    tag = "bochs";
+    taglen = 5;
+  }
+  readonly = SIM->get_param_bool("readonly", base)->get();
+  nworkers = SIM->get_param_num("workers", base)->get();
+
+  virtio_init(&devfunc, BX_PLUGIN_VIRTIO_9P, "Virtio 9P",
+              VIRTIO_9P_DEVICE_ID, VIRTIO_ID_9P, 0x018000,
+              1 << VIRTIO_9P_F_MOUNT_TAG, 1, BX_V9P_QUEUE_SIZE, 2 + taglen);
+  WriteHostWordToLittleEndian((Bit16u*)&virtio_config[0], taglen);
+  memcpy(&virtio_config[2], tag, taglen);
+
+  if (nworkers > 0) {
+    bx_create_sem(&work_sem);
+    for (unsigned i = 0; i < nworkers; i++) {
+      BX_THREAD_CREATE(worker_thread, this, threads[i]);
+    }
+  }
+  timer_index = DEV_register_timer(this, poll_timer_handler, BX_V9P_POLL_USEC, 1, 0,
+                                   "virtio_9p");
+
+  BX_INFO(("virtio 9P: sharing '%s' as '%s'%s, %d worker thread(s)", root, tag,
+           readonly ? " (read-only)" : "", nworkers));
+}
+
+void bx_virtio_9p_c::reset(unsigned type)
+{
+  virtio_reset_pci();
+  virtio_reset();
+  virtio_device_reset();
+}
+
+// The open host files can't be saved, so the guest has to mount the share
+// again after restoring the state.
+void bx_virtio_9p_c::register_state(void)
+{
+  bx_list_c *list = new bx_list_c(SIM->get_bochs_root(), "virtio_9p", "Virtio 9P State");
+  new bx_shadow_num_c(list, "msize", &msize);
+  virtio_register_state(list);
+}
+
+void bx_virtio_9p_c::after_restore_state(void)
+{
+  virtio_after_restore_state();
+}
+
+void bx_virtio_9p_c::virtio_device_reset(void)
+{
+  wait_idle();
+  BX_LOCK(fid_mutex);
+  fid_destroy_all();
+  BX_UNLOCK(fid_mutex);
+  msize = 8192;
+}
+
+void bx_virtio_9p_c::virtio_queue_notify(unsigned q)
+{
+  bx_virtq_elem_t elem;
+  bool done = 0;
+
+  if (q != 0) return;
+  while (vq_pop(0, &elem)) {
+    dispatch(&elem);
+    done = 1;
+  }
+  if (done && (nworkers == 0)) {
+    vq_notify(0);
+  }
+}
+
+// copy the request message (without Twrite payload) and prepare the payload
+// transfer, then handle the request here or pass it to a worker
+void bx_virtio_9p_c::dispatch(bx_virtq_elem_t *elem)
+{
+  Bit8u hdr[P9_TWRITE_HDR];
+  Bit32u size, count;
+
+  Bit32u len = vq_copy_from(elem, 0, hdr, P9_TWRITE_HDR);
+  size = (len >= P9_HDR_SIZE) ? ReadHostDWordFromLittleEndian((Bit32u*)hdr) : 0;
+  if ((size < P9_HDR_SIZE) || (size > elem->out_len) || (size > BX_V9P_MAX_MSIZE)) {
+    BX_ERROR(("malformed 9P request (size=%d)", size));
+    vq_push(0, elem, 0);
+    return;
+  }
+  bx_v9p_req_t *req = (bx_v9p_req_t*)calloc(1, sizeof(bx_v9p_req_t));
+  memcpy(&req->elem, elem, sizeof(bx_virtq_elem_t));
+  Bit8u type = hdr[4];
+  if ((type == P9_TWRITE) && (size >= P9_TWRITE_HDR)) {
+    req->msg_len = P9_TWRITE_HDR;
+    req->msg = (Bit8u*)malloc(P9_TWRITE_HDR);
+    memcpy(req->msg, hdr, P9_TWRITE_HDR);
+    count = ReadHostDWordFromLittleEndian((Bit32u*)&hdr[19]);
+    if (count > (size - P9_TWRITE_HDR)) {
+      count = size - P9_TWRITE_HDR;
+    }
+    req->data_len = count;
+    if (!map_payload(req, P9_TWRITE_HDR, count, 0)) {
+      req->bounce = (Bit8u*)malloc(count + 1);
+      vq_copy_from(elem, P9_TWRITE_HDR, req->bounce, count);
+    }
+  } else {
+    req->msg_len = size;
+    req->msg = (Bit8u*)malloc(size);
+    vq_copy_from(elem, 0, req->msg, size);
+    if ((type == P9_TREAD) && (size >= P9_TWRITE_HDR)) {
+      count = ReadHostDWordFromLittleEndian((Bit32u*)&req->msg[19]);
+      if (elem->in_len < P9_IOHDR_SIZE) {
+        count = 0;
+      } else if (count > (elem->in_len - P9_IOHDR_SIZE)) {
+        count = elem->in_len - P9_IOHDR_SIZE;
+      }
+      if (count > (msize - P9_IOHDR_SIZE)) {
+        count = msize - P9_IOHDR_SIZE;
+      }
+      req->data_len = count;
+      if (!map_payload(req, P9_IOHDR_SIZE, count, 1)) {
+        req->bounce = (Bit8u*)malloc(count + 1);
+      }
+    }
+  }
+
+  if (nworkers > 0) {
+    req->tag = ReadHostWordFromLittleEndian((Bit16u*)&req->msg[5]);
+    if (type == P9_TFLUSH) {
+      // Rflush must not overtake the reply of the flushed request, it is
+      // returned by poll_timer() when that one is done
+      req->oldtag = (req->msg_len >= (P9_HDR_SIZE + 2)) ?
+        ReadHostWordFromLittleEndian((Bit16u*)&req->msg[P9_HDR_SIZE]) : 0xffff;
+      process(req);
+      req->next = flush_head;
+      flush_head = req;
+    } else {
+      req->busy_next = busy_head;
+      busy_head = req;
+      BX_LOCK(work_mutex);
+      if (work_tail != NULL) {
+        work_tail->next = req;
+      } else {
+        work_head = req;
+      }
+      work_tail = req;
+      BX_UNLOCK(work_mutex);
+      bx_set_sem(&work_sem);
+    }
+    if (in_flight++ == 0) {
+      bx_pc_system.activate_timer(timer_index, BX_V9P_POLL_USEC, 1);
+    }
+  } else {
+    process(req);
+    complete(req);
+  }
+}
+
+// Build the I/O vector for the payload at <offset> of the guest buffers.
+// Fails if a page is not plain RAM (the bounce buffer is used then).
+bool bx_virtio_9p_c::map_payload(bx_v9p_req_t *req, Bit32u offset, Bit32u len, bool to_guest)
+{
+#ifdef BX_V9P_POSIX
+  const bx_virtq_sg_t *sg = to_guest ? req->elem.in_sg : req->elem.out_sg;
+  unsigned num = to_guest ? req->elem.in_num : req->elem.out_num;
+  int cnt = 0;
+
+#if BX_LARGE_RAMFILE
+  // memory blocks may be swapped out while a worker uses them
+  if (nworkers > 0) return 0;
+#endif
+  struct iovec *iov = (struct iovec*)malloc((len / 0x1000 + num * 2 + 1) * sizeof(struct iovec));
+  for (unsigned i = 0; (i < num) && (len > 0); i++) {
+    if (offset >= sg[i].len) {
+      offset -= sg[i].len;
+      continue;
+    }
+    bx_phy_address addr = sg[i].addr + offset;
+    Bit32u seglen = sg[i].len - offset;
+    offset = 0;
+    if (seglen > len) seglen = len;
+    len -= seglen;
+    while (seglen > 0) {
+      Bit32u chunk = 0x1000 - (Bit32u)(addr & 0xfff);
+      if (chunk > seglen) chunk = seglen;
+      Bit8u *ptr = BX_MEM(0)->getHostMemAddr(NULL, addr, to_guest ? BX_WRITE : BX_READ);
+      if (ptr == NULL) {
+        free(iov);
+        return 0;
+      }
+      if ((cnt > 0) && ((Bit8u*)iov[cnt - 1].iov_base + iov[cnt - 1].iov_len == ptr)) {
+        iov[cnt - 1].iov_len += chunk;
+      } else {
+        iov[cnt].iov_base = ptr;
+        iov[cnt].iov_len = chunk;
+        cnt++;
+      }
+      addr += chunk;
+      seglen -= chunk;
+    }
+  }
+  if (cnt > IOV_MAX) {
+    free(iov);
+    return 0;
+  }
+  req->iov = iov;
+  req->iovcnt = cnt;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+// Guest pages written through their host address are rewritten with one
+// byte DMA access to invalidate decoded instructions of these pages.
+void bx_virtio_9p_c::touch_pages(const bx_virtq_elem_t *elem, Bit32u offset, Bit32u len)
+{
+  Bit8u val;
+
+  for (unsigned i = 0; (i < elem->in_num) && (len > 0); i++) {
+    if (offset >= elem->in_sg[i].len) {
+      offset -= elem->in_sg[i].len;
+      continue;
+    }
+    bx_phy_address addr = elem->in_sg[i].addr + offset;
+    Bit32u seglen = elem->in_sg[i].len - offset;
+    offset = 0;
+    if (seglen > len) seglen = len;
+    len -= seglen;
+    while (seglen > 0) {
+      Bit32u chunk = 0x1000 - (Bit32u)(addr & 0xfff);
+      if (chunk > seglen) chunk = seglen;
+      DEV_MEM_READ_PHYSICAL_DMA(addr, 1, &val);
+      DEV_MEM_WRITE_PHYSICAL_DMA(addr, 1, &val);
+      addr += chunk;
+      seglen -= chunk;
+    }
+  }
+}
+
+// return the reply to the guest (emulation thread)
+void bx_virtio_9p_c::complete(bx_v9p_req_t *req)
+{
+  Bit32u len = vq_copy_to(&req->elem, 0, req->reply, req->reply_len);
+
+  if ((req->reply[4] == (P9_TREAD + 1)) && (req->data_len > 0)) {
+    if (req->bounce != NULL) {
+      len += vq_copy_to(&req->elem, P9_IOHDR_SIZE, req->bounce, req->data_len);
+    } else {
+      touch_pages(&req->elem, P9_IOHDR_SIZE, req->data_len);
+      len += req->data_len;
+    }
+  }
+  vq_push(0, &req->elem, len);
+  free_req(req);
+}
+
+void bx_virtio_9p_c::free_req(bx_v9p_req_t *req)
+{
+  free(req->msg);
+  free(req->reply);
+#ifdef BX_V9P_POSIX
+  free(req->iov);
+#endif
+  free(req->bounce);
+  free(req);
+}
+
+// wait for the workers to finish all requests and drop the replies
+void bx_virtio_9p_c::wait_idle(void)
+{
+  bx_v9p_req_t *req, *next;
+
+  while (flush_head != NULL) {
+    req = flush_head;
+    flush_head = req->next;
+    free_req(req);
+    in_flight--;
+  }
+  while (in_flight > 0) {
+    BX_LOCK(work_mutex);
+    req = done_head;
+    done_head = NULL;
+    BX_UNLOCK(work_mutex);
+    if (req == NULL) {
+      BX_MSLEEP(1);
+      continue;
+    }
+    while (req != NULL) {
+      next = req->next;
+      free_req(req);
+      in_flight--;
+      req = next;
+    }
+  }
+  busy_head = NULL;
+  if (timer_index != BX_NULL_TIMER_HANDLE) {
+    bx_pc_system.deactivate_timer(timer_index);
+  }
+}
+
+// fid table
+
+bx_v9p_fid_t *bx_virtio_9p_c::fid_lookup(Bit32u fid)
+{
+  bx_v9p_fid_t *f = fids[fid % BX_V9P_FID_HASH_SIZE];
+
+  while ((f != NULL) && (f->fid != fid)) {
+    f = f->next;
+  }
+  return f;
+}
+
+bx_v9p_fid_t *bx_virtio_9p_c::fid_new(Bit32u fid, char *path)
+{
+  bx_v9p_fid_t *f = (bx_v9p_fid_t*)calloc(1, sizeof(bx_v9p_fid_t));
+
+  f->fid = fid;
+  f->path = path;
+  f->fd = -1;
+  f->next = fids[fid % BX_V9P_FID_HASH_SIZE];
+  fids[fid % BX_V9P_FID_HASH_SIZE] = f;
+  return f;
+}
+
+void bx_virtio_9p_c::fid_close(bx_v9p_fid_t *f)
+{
+#ifdef BX_V9P_POSIX
+  if (f->fd >= 0) {
+    close(f->fd);
+  }
+  if (f->dir != NULL) {
+    closedir(f->dir);
+  }
+#endif
+  free(f->path);
+  free(f);
+}
+
+void bx_virtio_9p_c::fid_put(bx_v9p_fid_t *f)
+{
+  if ((--f->ref == 0) && f->clunked) {
+    fid_close(f);
+  }
+}
+
+bool bx_virtio_9p_c::fid_destroy(Bit32u fid)
+{
+  bx_v9p_fid_t **pf = &fids[fid % BX_V9P_FID_HASH_SIZE];
+
+  while (*pf != NULL) {
+    bx_v9p_fid_t *f = *pf;
+    if (f->fid == fid) {
+      *pf = f->next;
+      if (f->ref > 0) {
+        f->clunked = 1;
+      } else {
+        fid_close(f);
+      }
+      return 1;
+    }
+    pf = &f->next;
+  }
+  return 0;
+}
+
+void bx_virtio_9p_c::fid_destroy_all(void)
+{
+  for (int i = 0; i < BX_V9P_FID_HASH_SIZE; i++) {
+    while (fids[i] != NULL) {
+      fid_destroy(fids[i]->fid);
+    }
+  }
+}
+
+// update the fids below a renamed file or directory
+void bx_virtio_9p_c::fid_rename(const char *oldpath, const char *newpath)
+{
+  size_t len = strlen(oldpath);
+
+  for (int i = 0; i < BX_V9P_FID_HASH_SIZE; i++) {
+    for (bx_v9p_fid_t *f = fids[i]; f != NULL; f = f->next) {
+      if (!strncmp(f->path, oldpath, len) && ((f->path[len] == 0) || (f->path[len] == '/'))) {
+        char *path = (char*)malloc(strlen(newpath) + strlen(f->path + len) + 1);
+        sprintf(path, "%s%s", newpath, f->path + len);
+        free(f->path);
+        f->path = path;
+      }
+    }
+  }
+}
+
+#ifdef BX_V9P_POSIX
+// Open the directory containing <path> (the shared directory or a path below
+// it) without following symbolic links and return the last path component
+// in <leaf> ("." for the shared directory itself). Since no component can be
+// a link, textual ".." handling in Twalk can't leave the shared directory.
+int bx_virtio_9p_c::open_parent(const char *path, const char **leaf)
+{
+  const char *p = path + strlen(root), *next;
+  char comp[256];
+  int fd, nfd;
+
+  *leaf = ".";
+  if ((fd = openat(root_fd, ".", V9P_O_DIR)) < 0) return -1;
+  while (*p == '/') p++;
+  while (*p != 0) {
+    next = strchr(p, '/');
+    if (next == NULL) {
+      *leaf = p;
+      break;
+    }
+    if ((size_t)(next - p) >= sizeof(comp)) {
+      close(fd);
+      errno = ENAMETOOLONG;
+      return -1;
+    }
+    memcpy(comp, p, next - p);
+    comp[next - p] = 0;
+    nfd = openat(fd, comp, V9P_O_DIR | O_NOFOLLOW);
+    close(fd);
+    if (nfd < 0) return -1;
+    fd = nfd;
+    p = next;
+    while (*p == '/') p++;
+  }
+  return fd;
+}
+
+// open the directory <path> itself for the *at() calls
+int bx_virtio_9p_c::open_dir(const char *path)
+{
+  const char *leaf;
+  int dfd = open_parent(path, &leaf);
+
+  if (dfd < 0) return -1;
+  int fd = openat(dfd, leaf, V9P_O_DIR | O_NOFOLLOW), err = errno;
+  close(dfd);
+  errno = err;
+  return fd;
+}
+
+int bx_virtio_9p_c::lstat_path(const char *path, struct stat *st)
+{
+  const char *leaf;
+  int dfd = open_parent(path, &leaf);
+
+  if (dfd < 0) return -1;
+  int ret = fstatat(dfd, leaf, st, AT_SYMLINK_NOFOLLOW), err = errno;
+  close(dfd);
+  errno = err;
+  return ret;
+}
+#endif
+
+// Handle one 9P request (emulation or worker thread). Everything except the
+// file data transfer is done with the fid table locked.
+void bx_virtio_9p_c::process(bx_v9p_req_t *req)
+{
+  bx_v9p_buf_t in, out;
+  Bit8u type = req->msg[4];
+  Bit16u tag = ReadHostWordFromLittleEndian((Bit16u*)&req->msg[5]);
+  Bit32u rsize = 8192;
+  int err = 0;
+
+  in.buf = req->msg;
+  in.pos = P9_HDR_SIZE;
+  in.size = req->msg_len;
+  in.err = 0;
+  if (type == P9_TREADDIR) {
+    rsize = msize;
+    if ((req->elem.in_len >= P9_HDR_SIZE) && (req->elem.in_len < rsize)) {
+      rsize = req->elem.in_len;
+    }
+  }
+  req->reply = (Bit8u*)malloc(rsize);
+  out.buf = req->reply;
+  out.pos = P9_HDR_SIZE;
+  out.size = rsize;
+  out.err = 0;
+
+#ifdef BX_V9P_POSIX
+  char name[256], name2[256];
+  char *target = NULL, *path = NULL, *path2 = NULL;
+  const char *leaf;
+  int dfd = -1, dfd2 = -1;
+  bx_v9p_fid_t *f, *d;
+  struct stat st;
+  Bit32u fid, fid2, mode = 0, flags, count = 0;
+  Bit64u offset;
+  ssize_t n;
+
+  if (readonly && v9p_modifies(type)) {
+    err = EROFS;
+  } else {
+    BX_LOCK(fid_mutex);
+    switch (type) {
+      case P9_TVERSION:
+        count = v9p_get32(&in);
+        v9p_getstr(&in, name, sizeof(name));
+        if (in.err) break;
+        fid_destroy_all();
+        if (count > BX_V9P_MAX_MSIZE) count = BX_V9P_MAX_MSIZE;
+        if (count < 4096) count = 4096;
+        msize = count;
+        v9p_put32(&out, msize);
+        v9p_putstr(&out, strcmp(name, "9P2000.L") ? "unknown" : "9P2000.L");
+        break;
+
+      case P9_TATTACH:
+        fid = v9p_get32(&in);
+        if (in.err) break;
+        if (fid_lookup(fid) != NULL) {
+          err = EBADF;
+        } else if (lstat(root, &st) < 0) {
+          err = errno;
+        } else {
+          fid_new(fid, strdup(root));
+          v9p_putqid(&out, &st);
+        }
+        break;
+
+      case P9_TWALK:
+        {
+          fid = v9p_get32(&in);
+          fid2 = v9p_get32(&in);
+          unsigned nwname = v9p_get16(&in), nwqid = 0;
+          if (in.err) break;
+          if ((f = fid_lookup(fid)) == NULL) {
+            err = ENOENT;
+            break;
+          }
+          if ((fid2 != fid) && (fid_lookup(fid2) != NULL)) {
+            err = EBADF;
+            break;
+          }
+          path = strdup(f->path);
+          v9p_put16(&out, 0);
+          for (unsigned i = 0; i < nwname; i++) {
+            v9p_getstr(&in, name, sizeof(name));
+            if (in.err) break;
+            if (!strcmp(name, "..")) {
+              // never leave the shared directory
+              char *p = strrchr(path, '/');
+              if ((strlen(path) > strlen(root)) && (p != NULL)) {
+                *p = 0;
+                if (strlen(path) < strlen(root)) strcpy(path, root);
+              }
+              path2 = strdup(path);
+            } else if (!strcmp(name, ".")) {
+              path2 = strdup(path);
+            } else if (v9p_valid_name(name)) {
+              path2 = v9p_join(path, name);
+            } else {
+              err = ENOENT;
+              break;
+            }
+            if (lstat_path(path2, &st) < 0) {
+              err = errno;
+              free(path2);
+              break;
+            }
+            free(path);
+            path = path2;
+            v9p_putqid(&out, &st);
+            nwqid++;
+          }
+          path2 = NULL;
+          if (in.err || (err && (nwqid == 0) && (nwname > 0))) {
+            break;
+          }
+          // a partial walk returns the qids found without creating the new fid
+          err = 0;
+          if (nwqid == nwname) {
+            if (fid2 == fid) {
+              free(f->path);
+              f->path = path;
+            } else {
+              fid_new(fid2, path);
+            }
+            path = NULL;
+          }
+          WriteHostWordToLittleEndian((Bit16u*)&req->reply[P9_HDR_SIZE], nwqid);
+        }
+        break;
+
+      case P9_TGETATTR:
+        fid = v9p_get32(&in);
+        v9p_get64(&in);
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+        } else if (lstat_path(f->path, &st) < 0) {
+          err = errno;
+        } else {
+          v9p_put64(&out, 0x7ff); // P9_GETATTR_BASIC
+          v9p_putqid(&out, &st);
+          v9p_put32(&out, st.st_mode);
+          v9p_put32(&out, st.st_uid);
+          v9p_put32(&out, st.st_gid);
+          v9p_put64(&out, st.st_nlink);
+          v9p_put64(&out, st.st_rdev);
+          v9p_put64(&out, st.st_size);
+          v9p_put64(&out, st.st_blksize);
+          v9p_put64(&out, st.st_blocks);
+          v9p_put64(&out, st.st_atime);
+          v9p_put64(&out, V9P_ATIME_NSEC(st));
+          v9p_put64(&out, st.st_mtime);
+          v9p_put64(&out, V9P_MTIME_NSEC(st));
+          v9p_put64(&out, st.st_ctime);
+          v9p_put64(&out, V9P_CTIME_NSEC(st));
+          v9p_put64(&out, 0); // btime
+          v9p_put64(&out, 0);
+          v9p_put64(&out, 0); // gen
+          v9p_put64(&out, 0); // data_version
+        }
+        break;
+
+      case P9_TSETATTR:
+        {
+          fid = v9p_get32(&in);
+          Bit32u valid = v9p_get32(&in);
+          mode = v9p_get32(&in);
+          Bit32u uid = v9p_get32(&in), gid = v9p_get32(&in);
+          Bit64u size = v9p_get64(&in);
+          struct timespec ts[2];
+          ts[0].tv_sec = (time_t)v9p_get64(&in);
+          ts[0].tv_nsec = (long)v9p_get64(&in);
+          ts[1].tv_sec = (time_t)v9p_get64(&in);
+          ts[1].tv_nsec = (long)v9p_get64(&in);
+          if (in.err) break;
+          if ((f = fid_lookup(fid)) == NULL) {
+            err = ENOENT;
+            break;
+          }
+          if ((dfd = open_parent(f->path, &leaf)) < 0) {
+            err = errno;
+          } else if ((valid & 0x001) && (v9p_fchmodat(dfd, leaf, mode & 07777) < 0)) {
+            err = errno;
+          } else if ((valid & 0x006) && (fchownat(dfd, leaf, (valid & 0x002) ? (uid_t)uid : (uid_t)-1,
+                                                  (valid & 0x004) ? (gid_t)gid : (gid_t)-1,
+                                                  AT_SYMLINK_NOFOLLOW) < 0)) {
+            err = errno;
+          } else if ((valid & 0x008) && (v9p_truncateat(dfd, leaf, (off_t)size) < 0)) {
+            err = errno;
+          } else if (valid & 0x030) {
+            if (!(valid & 0x010)) {
+              ts[0].tv_nsec = UTIME_OMIT;
+            } else if (!(valid & 0x080)) {
+              ts[0].tv_nsec = UTIME_NOW;
+            }
+            if (!(valid & 0x020)) {
+              ts[1].tv_nsec = UTIME_OMIT;
+            } else if (!(valid & 0x100)) {
+              ts[1].tv_nsec = UTIME_NOW;
+            }
+            if (utimensat(dfd, leaf, ts, AT_SYMLINK_NOFOLLOW) < 0) {
+              err = errno;
+            }
+          }
+        }
+        break;
+
+      case P9_TLOPEN:
+        fid = v9p_get32(&in);
+        flags = v9p_get32(&in);
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+        } else if ((f->fd >= 0) || (f->dir != NULL)) {
+          err = EBADF;
+        } else if ((dfd = open_parent(f->path, &leaf)) < 0) {
+          err = errno;
+        } else if (fstatat(dfd, leaf, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+          err = errno;
+        } else if (S_ISDIR(st.st_mode)) {
+          int fd = openat(dfd, leaf, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+          if ((fd < 0) || ((f->dir = fdopendir(fd)) == NULL)) {
+            err = errno;
+            if (fd >= 0) close(fd);
+          }
+        } else if (readonly && (((flags & 3) != 0) || (flags & 001000))) {
+          err = EROFS;
+        } else if ((f->fd = openat(dfd, leaf, (v9p_open_flags(flags) & ~(O_CREAT | O_EXCL)) |
+                                   O_NOFOLLOW)) < 0) {
+          err = errno;
+        }
+        if (!err) {
+          v9p_putqid(&out, &st);
+          v9p_put32(&out, 0); // iounit
+        }
+        break;
+
+      case P9_TLCREATE:
+        {
+          fid = v9p_get32(&in);
+          v9p_getstr(&in, name, sizeof(name));
+          flags = v9p_get32(&in);
+          mode = v9p_get32(&in);
+          if (in.err) break;
+          if ((f = fid_lookup(fid)) == NULL) {
+            err = ENOENT;
+            break;
+          } else if ((f->fd >= 0) || (f->dir != NULL)) {
+            err = EBADF;
+            break;
+          } else if (!v9p_valid_name(name)) {
+            err = EINVAL;
+            break;
+          } else if ((dfd = open_dir(f->path)) < 0) {
+            err = errno;
+            break;
+          }
+          path = v9p_join(f->path, name);
+          int fd = openat(dfd, name, v9p_open_flags(flags) | O_CREAT | O_NOFOLLOW, mode & 07777);
+          if (fd < 0) {
+            err = errno;
+          } else if (fstat(fd, &st) < 0) {
+            err = errno;
+            close(fd);
+          } else {
+            free(f->path);
+            f->path = path;
+            f->fd = fd;
+            path = NULL;
+            v9p_putqid(&out, &st);
+            v9p_put32(&out, 0); // iounit
+          }
+        }
+        break;
+
+      case P9_TREAD:
+      case P9_TWRITE:
+        fid = v9p_get32(&in);
+        offset = v9p_get64(&in);
+        v9p_get32(&in); // count (see dispatch)
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+        } else if (f->fd < 0) {
+          err = EBADF;
+        } else {
+          // the file data is transferred without holding the lock
+          f->ref++;
+          BX_UNLOCK(fid_mutex);
+          if (req->data_len == 0) {
+            n = 0;
+          } else if (type == P9_TREAD) {
+            if (req->bounce != NULL) {
+              n = pread(f->fd, req->bounce, req->data_len, (off_t)offset);
+            } else {
+              n = preadv(f->fd, req->iov, req->iovcnt, (off_t)offset);
+            }
+          } else {
+            if (req->bounce != NULL) {
+              n = pwrite(f->fd, req->bounce, req->data_len, (off_t)offset);
+            } else {
+              n = pwritev(f->fd, req->iov, req->iovcnt, (off_t)offset);
+            }
+          }
+          if (n < 0) err = errno;
+          BX_LOCK(fid_mutex);
+          fid_put(f);
+          if (!err) {
+            req->data_len = (Bit32u)n;
+            v9p_put32(&out, (Bit32u)n);
+          }
+        }
+        break;
+
+      case P9_TCLUNK:
+        fid = v9p_get32(&in);
+        if (in.err) break;
+        if (!fid_destroy(fid)) {
+          err = ENOENT;
+        }
+        break;
+
+      case P9_TREMOVE:
+        fid = v9p_get32(&in);
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+          break;
+        }
+        if (readonly) {
+          err = EROFS;
+        } else if (((dfd = open_parent(f->path, &leaf)) < 0) ||
+                   (fstatat(dfd, leaf, &st, AT_SYMLINK_NOFOLLOW) < 0) ||
+                   (unlinkat(dfd, leaf, S_ISDIR(st.st_mode) ? AT_REMOVEDIR : 0) < 0)) {
+          err = errno;
+        }
+        // the fid is clunked even if the remove failed
+        fid_destroy(fid);
+        break;
+
+      case P9_TREADDIR:
+        fid = v9p_get32(&in);
+        offset = v9p_get64(&in);
+        count = v9p_get32(&in);
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+        } else if (f->dir == NULL) {
+          err = EBADF;
+        } else {
+          if (count > (out.size - P9_IOHDR_SIZE)) {
+            count = out.size - P9_IOHDR_SIZE;
+          }
+          v9p_put32(&out, 0);
+          if (offset == 0) {
+            rewinddir(f->dir);
+          } else {
+            seekdir(f->dir, (long)offset);
+          }
+          struct dirent *de;
+          while ((de = readdir(f->dir)) != NULL) {
+            unsigned namelen = strlen(de->d_name);
+            if ((out.pos - P9_IOHDR_SIZE + P9_QID_SIZE + 11 + namelen) > count) {
+              break;
+            }
+            Bit8u qtype = 0x00;
+            if (de->d_type == DT_DIR) {
+              qtype = 0x80;
+            } else if (de->d_type == DT_LNK) {
+              qtype = 0x02;
+            }
+            v9p_put8(&out, qtype);
+            v9p_put32(&out, 0);
+            v9p_put64(&out, (Bit64u)de->d_ino);
+            v9p_put64(&out, (Bit64u)telldir(f->dir));
+            v9p_put8(&out, de->d_type);
+            v9p_putstr(&out, de->d_name);
+          }
+          WriteHostDWordToLittleEndian((Bit32u*)&req->reply[P9_HDR_SIZE], out.pos - P9_IOHDR_SIZE);
+        }
+        break;
+
+      case P9_TSTATFS:
+        {
+          struct statvfs sf;
+          fid = v9p_get32(&in);
+          if (in.err) break;
+          if ((f = fid_lookup(fid)) == NULL) {
+            err = ENOENT;
+          } else if (((dfd = open_parent(f->path, &leaf)) < 0) || (fstatvfs(dfd, &sf) < 0)) {
+            err = errno;
+          } else {
+            v9p_put32(&out, 0x01021997); // V9FS_MAGIC
+            v9p_put32(&out, (sf.f_frsize != 0) ? sf.f_frsize : sf.f_bsize);
+            v9p_put64(&out, sf.f_blocks);
+            v9p_put64(&out, sf.f_bfree);
+            v9p_put64(&out, sf.f_bavail);
+            v9p_put64(&out, sf.f_files);
+            v9p_put64(&out, sf.f_ffree);
+            v9p_put64(&out, sf.f_fsid);
+            v9p_put32(&out, sf.f_namemax);
+          }
+        }
+        break;
+
+      case P9_TFSYNC:
+        fid = v9p_get32(&in);
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+        } else if (f->fd >= 0) {
+          f->ref++;
+          BX_UNLOCK(fid_mutex);
+          if (fsync(f->fd) < 0) err = errno;
+          BX_LOCK(fid_mutex);
+          fid_put(f);
+        }
+        break;
+
+      case P9_TLOCK:
+        // locks are only held inside the guest
+        v9p_put8(&out, 0); // P9_LOCK_SUCCESS
+        break;
+
+      case P9_TGETLOCK:
+        {
+          fid = v9p_get32(&in);
+          v9p_get8(&in);
+          Bit64u start = v9p_get64(&in), length = v9p_get64(&in);
+          Bit32u proc_id = v9p_get32(&in);
+          v9p_getstr(&in, name, sizeof(name));
+          if (in.err) break;
+          v9p_put8(&out, 2); // F_UNLCK
+          v9p_put64(&out, start);
+          v9p_put64(&out, length);
+          v9p_put32(&out, proc_id);
+          v9p_putstr(&out, name);
+        }
+        break;
+
+      case P9_TMKDIR:
+      case P9_TSYMLINK:
+      case P9_TMKNOD:
+        fid = v9p_get32(&in);
+        v9p_getstr(&in, name, sizeof(name));
+        if (type == P9_TSYMLINK) {
+          target = (char*)malloc(PATH_MAX);
+          v9p_getstr(&in, target, PATH_MAX);
+        } else {
+          mode = v9p_get32(&in);
+        }
+        if (type == P9_TMKNOD) {
+          fid2 = v9p_get32(&in); // major
+          count = v9p_get32(&in); // minor
+        }
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+          break;
+        } else if (!v9p_valid_name(name)) {
+          err = EINVAL;
+          break;
+        } else if ((dfd = open_dir(f->path)) < 0) {
+          err = errno;
+          break;
+        }
+        // the link target is stored as is, it is never followed on the host
+        if (type == P9_TMKDIR) {
+          if (mkdirat(dfd, name, mode & 07777) < 0) err = errno;
+        } else if (type == P9_TSYMLINK) {
+          if (symlinkat(target, dfd, name) < 0) err = errno;
+        } else {
+          if (mknodat(dfd, name, mode, makedev(fid2, count)) < 0) err = errno;
+        }
+        if (!err && (fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW) < 0)) {
+          err = errno;
+        }
+        if (!err) {
+          v9p_putqid(&out, &st);
+        }
+        break;
+
+      case P9_TREADLINK:
+        fid = v9p_get32(&in);
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+        } else if ((dfd = open_parent(f->path, &leaf)) < 0) {
+          err = errno;
+        } else {
+          target = (char*)malloc(PATH_MAX);
+          n = readlinkat(dfd, leaf, target, PATH_MAX - 1);
+          if (n < 0) {
+            err = errno;
+          } else {
+            target[n] = 0;
+            v9p_putstr(&out, target);
+          }
+        }
+        break;
+
+      case P9_TLINK:
+        fid2 = v9p_get32(&in); // directory
+        fid = v9p_get32(&in);
+        v9p_getstr(&in, name, sizeof(name));
+        if (in.err) break;
+        if (((d = fid_lookup(fid2)) == NULL) || ((f = fid_lookup(fid)) == NULL)) {
+          err = ENOENT;
+        } else if (!v9p_valid_name(name)) {
+          err = EINVAL;
+        } else if (((dfd = open_parent(f->path, &leaf)) < 0) ||
+                   ((dfd2 = open_dir(d->path)) < 0) ||
+                   (linkat(dfd, leaf, dfd2, name, 0) < 0)) {
+          err = errno;
+        }
+        break;
+
+      case P9_TRENAME:
+        fid = v9p_get32(&in);
+        fid2 = v9p_get32(&in);
+        v9p_getstr(&in, name, sizeof(name));
+        if (in.err) break;
+        if (((f = fid_lookup(fid)) == NULL) || ((d = fid_lookup(fid2)) == NULL)) {
+          err = ENOENT;
+        } else if (!v9p_valid_name(name) || !strcmp(f->path, root)) {
+          err = EINVAL;
+        } else {
+          path = strdup(f->path);
+          path2 = v9p_join(d->path, name);
+          if (((dfd = open_parent(path, &leaf)) < 0) || ((dfd2 = open_dir(d->path)) < 0) ||
+              (renameat(dfd, leaf, dfd2, name) < 0)) {
+            err = errno;
+          } else {
+            fid_rename(path, path2);
+          }
+        }
+        break;
+
+      case P9_TRENAMEAT:
+        fid = v9p_get32(&in);
+        v9p_getstr(&in, name, sizeof(name));
+        fid2 = v9p_get32(&in);
+        v9p_getstr(&in, name2, sizeof(name2));
+        if (in.err) break;
+        if (((f = fid_lookup(fid)) == NULL) || ((d = fid_lookup(fid2)) == NULL)) {
+          err = ENOENT;
+        } else if (!v9p_valid_name(name) || !v9p_valid_name(name2)) {
+          err = EINVAL;
+        } else {
+          path = v9p_join(f->path, name);
+          path2 = v9p_join(d->path, name2);
+          if (((dfd = open_dir(f->path)) < 0) || ((dfd2 = open_dir(d->path)) < 0) ||
+              (renameat(dfd, name, dfd2, name2) < 0)) {
+            err = errno;
+          } else {
+            fid_rename(path, path2);
+          }
+        }
+        break;
+
+      case P9_TUNLINKAT:
+        fid = v9p_get32(&in);
+        v9p_getstr(&in, name, sizeof(name));
+        flags = v9p_get32(&in);
+        if (in.err) break;
+        if ((f = fid_lookup(fid)) == NULL) {
+          err = ENOENT;
+        } else if (!v9p_valid_name(name)) {
+          err = EINVAL;
+        } else if (((dfd = open_dir(f->path)) < 0) ||
+                   (unlinkat(dfd, name, (flags & 0x200) ? AT_REMOVEDIR : 0) < 0)) {
+          err = errno;
+        }
+        break;
+
+      case P9_TFLUSH:
+        // requests are never cancelled, Rflush follows the flushed reply
+        break;
+
+      default:
+        // no authentication and no extended attributes
+        err = EOPNOTSUPP;
+    }
+    if (dfd >= 0) close(dfd);
+    if (dfd2 >= 0) close(dfd2);
+    BX_UNLOCK(fid_mutex);
+  }
+  free(path);
+  free(path2);
+  free(target);
+
+  if (!err && (in.err || out.err)) {
+    err = EINVAL;
+  }
+  if (err) {
+    out.pos = P9_HDR_SIZE;
+    out.err = 0;
+    v9p_put32(&out, v9p_errno(err));
+    type = P9_TLERROR;
+    req->data_len = 0;
+  }
+#else
+  err = EOPNOTSUPP;
+  v9p_put32(&out, err);
+  type = P9_TLERROR;
+#endif
+  req->reply_len = out.pos;
+  Bit32u size = out.pos;
+  if (type == P9_TREAD) {
+    size += req->data_len;
+  }
+  WriteHostDWordToLittleEndian((Bit32u*)&req->reply[0], size);
+  req->reply[4] = type + 1;
+  WriteHostWordToLittleEndian((Bit16u*)&req->reply[5], tag);
+}
+
+// worker threads
+
+BX_THREAD_FUNC(bx_virtio_9p_c::worker_thread, indata)
+{
+  ((bx_virtio_9p_c*)indata)->worker();
+  BX_THREAD_EXIT;
+}
+
+void bx_virtio_9p_c::worker(void)
+{
+  bx_v9p_req_t *req;
+
+  while (1) {
+    bx_wait_sem(&work_sem);
+    BX_LOCK(work_mutex);
+    if (stop_workers) {
+      BX_UNLOCK(work_mutex);
+      break;
+    }
+    req = work_head;
+    if (req != NULL) {
+      work_head = req->next;
+      if (work_head == NULL) {
+        work_tail = NULL;
+      }
+    }
+    BX_UNLOCK(work_mutex);
+    if (req == NULL) continue;
+    process(req);
+    BX_LOCK(work_mutex);
+    req->next = done_head;
+    done_head = req;
+    BX_UNLOCK(work_mutex);
+  }
+}
+
+// return the replies of the workers to the guest
+
+void bx_virtio_9p_c::poll_timer_handler(void *this_ptr)
+{
+  ((bx_virtio_9p_c*)this_ptr)->poll_timer();
+}
+
+void bx_virtio_9p_c::poll_timer(void)
+{
+  bx_v9p_req_t *req, *next, **pr, *b;
+  bool done = 0;
+
+  BX_LOCK(work_mutex);
+  req = done_head;
+  done_head = NULL;
+  BX_UNLOCK(work_mutex);
+  while (req != NULL) {
+    next = req->next;
+    for (pr = &busy_head; *pr != req; pr = &(*pr)->busy_next);
+    *pr = req->busy_next;
+    complete(req);
+    in_flight--;
+    done = 1;
+    req = next;
+  }
+  // return Rflush when the flushed request has been answered
+  for (pr = &flush_head; *pr != NULL; ) {
+    req = *pr;
+    for (b = busy_head; (b != NULL) && (b->tag != req->oldtag); b = b->busy_next);
+    if (b != NULL) {
+      pr = &req->next;
+      continue;
+    }
+    *pr = req->next;
+    complete(req);
+    in_flight--;
+    done = 1;
+  }
+  if (!done) return;
+  vq_notify(0);
+  if (in_flight == 0) {
+    bx_pc_system.deactivate_timer(timer_index);
+  }
+}
+
+#endif // BX_SUPPORT_PCI && BX_SUPPORT_VIRTIO
@@ -0,0 +1,177 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BX_IODEV_VIRTIO_9P_H
+#define BX_IODEV_VIRTIO_9P_H
+
+// the host directory is accessed with POSIX file and directory calls
+#if !defined(WIN32) || defined(__CYGWIN__)
+#define BX_V9P_POSIX
+#include <dirent.h>
+#include <sys/uio.h>
+#endif
+
+#include "bxthread.h"
+
+#define VIRTIO_9P_DEVICE_ID     0x1009
+#define VIRTIO_ID_9P            9
+#define VIRTIO_9P_F_MOUNT_TAG   0
+
+#define BX_V9P_QUEUE_SIZE       128
+#define BX_V9P_MAX_TAG_LEN      31
+#define BX_V9P_MAX_MSIZE        (1024 * 1024)
+#define BX_V9P_MAX_WORKERS      16
+#define BX_V9P_FID_HASH_SIZE    64
+#define BX_V9P_POLL_USEC        50
+
+// 9P2000.L message types
+#define P9_TLERROR      6
+#define P9_RLERROR      7
+#define P9_TSTATFS      8
+#define P9_TLOPEN       12
+#define P9_TLCREATE     14
+#define P9_TSYMLINK     16
+#define P9_TMKNOD       18
+#define P9_TRENAME      20
+#define P9_TREADLINK    22
+#define P9_TGETATTR     24
+#define P9_TSETATTR     26
+#define P9_TXATTRWALK   30
+#define P9_TXATTRCREATE 32
+#define P9_TREADDIR     40
+#define P9_TFSYNC       50
+#define P9_TLOCK        52
+#define P9_TGETLOCK     54
+#define P9_TLINK        70
+#define P9_TMKDIR       72
+#define P9_TRENAMEAT    74
+#define P9_TUNLINKAT    76
+#define P9_TVERSION     100
+#define P9_TAUTH        102
+#define P9_TATTACH      104
+#define P9_TFLUSH       108
+#define P9_TWALK        110
+#define P9_TREAD        116
+#define P9_TWRITE       118
+#define P9_TCLUNK       120
+#define P9_TREMOVE      122
+
+#define P9_HDR_SIZE     7   // size[4] type[1] tag[2]
+#define P9_IOHDR_SIZE   11  // Rread: header + count[4]
+#define P9_TWRITE_HDR   23  // Twrite: header + fid[4] offset[8] count[4]
+#define P9_QID_SIZE     13
+
+// one open (walked) file id
+typedef struct bx_v9p_fid {
+  Bit32u fid;
+  char   *path;           // host path
+  int    fd;              // after Tlopen/Tlcreate of a file
+#ifdef BX_V9P_POSIX
+  DIR    *dir;            // after Tlopen of a directory
+#endif
+  unsigned ref;           // file I/O in progress
+  bool   clunked;         // free when the I/O is done
+  struct bx_v9p_fid *next;
+} bx_v9p_fid_t;
+
+// one request travelling from the virtqueue to a worker and back
+typedef struct bx_v9p_req {
+  bx_virtq_elem_t elem;
+  Bit8u  *msg;            // request message (Twrite: header only)
+  Bit32u msg_len;
+  Bit8u  *reply;          // reply message (Rread: header only)
+  Bit32u reply_len;
+  Bit32u data_len;        // Rread/Twrite payload size
+#ifdef BX_V9P_POSIX
+  struct iovec *iov;      // payload in guest memory (zero-copy)
+  int    iovcnt;
+#endif
+  Bit8u  *bounce;         // payload copy if zero-copy is not possible
+  Bit16u tag;
+  Bit16u oldtag;          // Tflush: the request to wait for
+  struct bx_v9p_req *next;
+  struct bx_v9p_req *busy_next; // requests passed to the workers
+} bx_v9p_req_t;
+
+class bx_virtio_9p_c : public bx_virtio_pci_c {
+public:
+  bx_virtio_9p_c();
+  virtual ~bx_virtio_9p_c();
+  virtual void init(void);
+  virtual void reset(unsigned type);
+  virtual void register_state(void);
+  virtual void after_restore_state(void);
+
+protected:
+  virtual void virtio_queue_notify(unsigned q);
+  virtual void virtio_device_reset(void);
+
+private:
+  void   dispatch(bx_virtq_elem_t *elem);
+  void   complete(bx_v9p_req_t *req);
+  void   free_req(bx_v9p_req_t *req);
+  bool   map_payload(bx_v9p_req_t *req, Bit32u offset, Bit32u len, bool to_guest);
+  void   touch_pages(const bx_virtq_elem_t *elem, Bit32u offset, Bit32u len);
+  void   process(bx_v9p_req_t *req);
+  void   wait_idle(void);
+#ifdef BX_V9P_POSIX
+  int    open_parent(const char *path, const char **leaf);
+  int    open_dir(const char *path);
+  int    lstat_path(const char *path, struct stat *st);
+#endif
+
+  // the fid table is protected by fid_mutex
+  bx_v9p_fid_t *fid_lookup(Bit32u fid);
+  bx_v9p_fid_t *fid_new(Bit32u fid, char *path);
+  void   fid_close(bx_v9p_fid_t *f);
+  void   fid_put(bx_v9p_fid_t *f);
+  bool   fid_destroy(Bit32u fid);
+  void   fid_destroy_all(void);
+  void   fid_rename(const char *oldpath, const char *newpath);
+
+  static void poll_timer_handler(void *this_ptr);
+  void   poll_timer(void);
+  static BX_THREAD_FUNC(worker_thread, indata);
+  void   worker(void);
+
+  Bit8u  devfunc;
+  int    timer_index;
+  char   *root;
+  int    root_fd;
+  bool   readonly;
+  Bit32u msize;
+  bx_v9p_fid_t *fids[BX_V9P_FID_HASH_SIZE];
+  BX_MUTEX(fid_mutex);
+
+  // worker threads
+  unsigned nworkers;
+  unsigned in_flight;
+  bool   stop_workers;
+  bx_v9p_req_t *work_head, *work_tail;
+  bx_v9p_req_t *done_head;
+  bx_v9p_req_t *busy_head;  // not yet returned to the guest
+  bx_v9p_req_t *flush_head; // Rflush waiting for the flushed request
+  BX_MUTEX(work_mutex);
+  bx_thread_sem_t work_sem;
+  BX_THREAD_VAR(threads[BX_V9P_MAX_WORKERS]);
+};
+
+#endif
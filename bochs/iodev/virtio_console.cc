@@ -0,0 +1,790 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+/////////////////////////////////////////////////////////////////////////
+
+// Virtio console (virtio-serial) with up to 4 ports. Unlike the UART there
+// is no per-byte register access: the guest passes whole buffers through
+// the virtqueues and each buffer is written to the host backend at once.
+// Host input is polled every millisecond and copied into as many posted
+// receive buffers as there is data available.
+//
+// Port 0 is reported as console (hvc0 in Linux), the other ports show up
+// as /dev/vportNpM and can be given a name (/dev/virtio-ports/<name>).
+
+// Define BX_PLUGGABLE in files that can be compiled into plugins.  For
+// platforms that require a special tag on exported symbols, BX_PLUGGABLE
+// is used to know when we are exporting symbols and when we are importing.
+#define BX_PLUGGABLE
+
+#include "iodev.h"
+#include "pc_system.h"
+
+#if BX_SUPPORT_PCI && BX_SUPPORT_VIRTIO
+
+#include "pci.h"
+#include "virtio.h"
+#include "virtio_console.h"
+
+#ifdef BX_VCON_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define LOG_THIS theVirtioConsole->
+
+bx_virtio_console_c *theVirtioConsole = NULL;
+
+// builtin configuration handling functions
+
+static const char *vcon_mode_list[] = {
+  "none",
+  "stdio",
+  "file",
+  "pipe",
+  "socket-client",
+  "socket-server",
+  NULL
+};
+
+void virtio_console_init_options(void)
+{
+  char name[8], label[80];
+
+  bx_list_c *ports = (bx_list_c*)SIM->get_param("ports");
+  bx_list_c *menu = new bx_list_c(ports, "virtio_console", "Virtio Console Options");
+  menu->set_options(menu->SHOW_PARENT);
+  bx_param_bool_c *enabled = new bx_param_bool_c(menu, "enabled",
+    "Enable virtio console",
+    "Enables the virtio console PCI device",
+    0);
+  bx_list_c *deplist = new bx_list_c(NULL);
+  for (int i = 0; i < BX_VCON_MAX_PORTS; i++) {
+    sprintf(name, "port%d", i);
+    sprintf(label, "Host side of virtio console port #%d", i);
+    bx_param_enum_c *mode = new bx_param_enum_c(menu, name, label,
+      "The mode can be one these: 'none', 'stdio', 'file', 'pipe', 'socket-client', 'socket-server'",
+      vcon_mode_list, BX_VCON_MODE_NONE, BX_VCON_MODE_NONE);
+    mode->set_ask_format("Choose host side of the port [%s] ");
+    sprintf(name, "dev%d", i);
+    sprintf(label, "Pathname for virtio console port #%d", i);
+    bx_param_filename_c *path = new bx_param_filename_c(menu, name, label,
+      "Output file, pipe or unix socket path",
+      "", BX_PATHNAME_LEN);
+    sprintf(name, "name%d", i);
+    sprintf(label, "Guest visible name of virtio console port #%d", i);
+    bx_param_string_c *pname = new bx_param_string_c(menu, name, label,
+      "Name reported to the guest (e.g. org.bochs.port1)",
+      "", BX_PATHNAME_LEN);
+    deplist->add(mode);
+    bx_list_c *deplist2 = new bx_list_c(NULL);
+    deplist2->add(path);
+    deplist2->add(pname);
+    mode->set_dependent_list(deplist2, 1);
+    mode->set_dependent_bitmap(BX_VCON_MODE_NONE, 0);
+    mode->set_dependent_bitmap(BX_VCON_MODE_STDIO, 0x2);
+  }
+  enabled->set_dependent_list(deplist);
+}
+
+Bit32s virtio_console_options_parser(const char *context, int num_params, char *params[])
+{
+  if (!strcmp(params[0], "virtio_console")) {
+    bx_list_c *base = (bx_list_c*) SIM->get_param(BXPN_VIRTIO_CONSOLE);
+    for (int i = 1; i < num_params; i++) {
+      if (SIM->parse_param_from_list(context, params[i], base) < 0) {
+        BX_ERROR(("%s: unknown parameter for virtio_console ignored.", context));
+      }
+    }
+  } else {
+    BX_PANIC(("%s: unknown directive '%s'", context, params[0]));
+  }
+  return 0;
+}
+
+Bit32s virtio_console_options_save(FILE *fp)
+{
+  return SIM->write_param_list(fp, (bx_list_c*) SIM->get_param(BXPN_VIRTIO_CONSOLE), NULL, 0);
+}
+
+// device plugin entry point
+
+PLUGIN_ENTRY_FOR_MODULE(virtio_console)
+{
+  if (mode == PLUGIN_INIT) {
+    theVirtioConsole = new bx_virtio_console_c();
+    BX_REGISTER_DEVICE_DEVMODEL(plugin, type, theVirtioConsole, BX_PLUGIN_VIRTIO_CONSOLE);
+    // add new configuration parameters for the config interface
+    virtio_console_init_options();
+    // register add-on option for bochsrc and command line
+    SIM->register_addon_option("virtio_console", virtio_console_options_parser,
+                               virtio_console_options_save);
+  } else if (mode == PLUGIN_FINI) {
+    SIM->unregister_addon_option("virtio_console");
+    bx_list_c *ports = (bx_list_c*)SIM->get_param("ports");
+    ports->remove("virtio_console");
+    delete theVirtioConsole;
+  } else if (mode == PLUGIN_PROBE) {
+    return (int)PLUGTYPE_OPTIONAL;
+  } else if (mode == PLUGIN_FLAGS) {
+    return PLUGFLAG_PCI;
+  }
+  return 0; // Success
+}
+
+// the device object
+
+bx_virtio_console_c::bx_virtio_console_c()
+{
+  put("virtio_console", "VCON");
+  devfunc = 0x00;
+  timer_index = BX_NULL_TIMER_HANDLE;
+  nports = 0;
+  memset(port, 0, sizeof(port));
+  for (int i = 0; i < BX_VCON_MAX_PORTS; i++) {
+    port[i].fd_in = -1;
+    port[i].fd_out = -1;
+    port[i].listen_fd = -1;
+  }
+  device_ready = 0;
+  ctrl_count = 0;
+  xfer_buf = NULL;
+}
+
+bx_virtio_console_c::~bx_virtio_console_c()
+{
+  for (unsigned i = 0; i < nports; i++) {
+    backend_close(i);
+#ifdef BX_VCON_POSIX
+    if (port[i].listen_fd >= 0) {
+      close(port[i].listen_fd);
+    }
+    if (port[i].term_saved) {
+      tcsetattr(0, TCSAFLUSH, &port[i].term_orig);
+    }
+#endif
+  }
+  for (unsigned i = 0; i < nports; i++) {
+    if (port[i].out_buf != NULL) {
+      delete [] port[i].out_buf;
+    }
+  }
+  if (xfer_buf != NULL) {
+    delete [] xfer_buf;
+  }
+  SIM->get_bochs_root()->remove("virtio_console");
+  BX_DEBUG(("Exit"));
+}
+
+void bx_virtio_console_c::init(void)
+{
+  char pname[8];
+  Bit32u features;
+
+  // Read in values from config interface
+  bx_list_c *base = (bx_list_c*) SIM->get_param(BXPN_VIRTIO_CONSOLE);
+  // Check if the device is disabled or not configured
+  if (!SIM->get_param_bool("enabled", base)->get()) {
+    BX_INFO(("virtio console disabled"));
+    // mark unused plugin for removal
+    ((bx_param_bool_c*)((bx_list_c*)SIM->get_param(BXPN_PLUGIN_CTRL))->get_by_name("virtio_console"))->set(0);
+    return;
+  }
+
+  for (int i = 0; i < BX_VCON_MAX_PORTS; i++) {
+    sprintf(pname, "port%d", i);
+    port[i].mode = SIM->get_param_enum(pname, base)->get();
+    sprintf(pname, "dev%d", i);
+    port[i].dev = SIM->get_param_string(pname, base)->getptr();
+    sprintf(pname, "name%d", i);
+    port[i].name = SIM->get_param_string(pname, base)->getptr();
+    if (port[i].mode != BX_VCON_MODE_NONE) {
+      nports = i + 1;
+      backend_open(i);
+    }
+  }
+  if (nports == 0) {
+    BX_ERROR(("no virtio console port configured"));
+  }
+
+  features = (1 << VIRTIO_CONSOLE_F_MULTIPORT) | (1 << VIRTIO_CONSOLE_F_EMERG_WRITE);
+  virtio_init(&devfunc, BX_PLUGIN_VIRTIO_CONSOLE, "Virtio console",
+              VIRTIO_CONSOLE_DEVICE_ID, VIRTIO_ID_CONSOLE, 0x078000, features,
+              (BX_VCON_MAX_PORTS + 1) * 2, BX_VCON_QUEUE_SIZE, VIRTIO_CONSOLE_CFG_SIZE);
+  WriteHostDWordToLittleEndian((Bit32u*)&virtio_config[VIRTIO_CONSOLE_CFG_MAXPORTS],
+                               BX_VCON_MAX_PORTS);
+
+  xfer_buf = new Bit8u[BX_VCON_BUF_SIZE];
+  timer_index = DEV_register_timer(this, poll_timer_handler, BX_VCON_POLL_USEC, 1, 1,
+                                   "virtio_console");
+
+  BX_INFO(("virtio console initialized (%d port(s))", nports));
+}
+
+void bx_virtio_console_c::reset(unsigned type)
+{
+  virtio_reset_pci();
+  virtio_reset();
+  virtio_device_reset();
+}
+
+void bx_virtio_console_c::register_state(void)
+{
+  char pname[6];
+
+  bx_list_c *list = new bx_list_c(SIM->get_bochs_root(), "virtio_console", "Virtio Console State");
+  BXRS_PARAM_BOOL(list, device_ready, device_ready);
+  new bx_shadow_num_c(list, "ctrl_count", &ctrl_count);
+  new bx_shadow_data_c(list, "ctrl_queue", (Bit8u*)ctrl_queue, sizeof(ctrl_queue));
+  for (unsigned i = 0; i < BX_VCON_MAX_PORTS; i++) {
+    sprintf(pname, "%d", i);
+    bx_list_c *plist = new bx_list_c(list, pname);
+    BXRS_PARAM_BOOL(plist, guest_ready, port[i].guest_ready);
+    BXRS_PARAM_BOOL(plist, guest_open, port[i].guest_open);
+  }
+  virtio_register_state(list);
+}
+
+void bx_virtio_console_c::after_restore_state(void)
+{
+  virtio_after_restore_state();
+}
+
+void bx_virtio_console_c::virtio_device_reset(void)
+{
+  device_ready = 0;
+  ctrl_count = 0;
+  for (unsigned i = 0; i < BX_VCON_MAX_PORTS; i++) {
+    port[i].guest_ready = 0;
+    port[i].guest_open = 0;
+  }
+}
+
+void bx_virtio_console_c::virtio_queue_notify(unsigned q)
+{
+  if (q == 2) {
+    // control receive buffers added
+    flush_control();
+  } else if (q == 3) {
+    handle_control();
+  } else {
+    unsigned p = (q < 2) ? 0 : (q / 2 - 1);
+    if (q & 1) {
+      handle_tx(p);
+    } else {
+      handle_rx(p);
+    }
+  }
+}
+
+void bx_virtio_console_c::virtio_config_write(unsigned offset, Bit32u value, unsigned len)
+{
+  if ((offset == VIRTIO_CONSOLE_CFG_EMERG_WR) && (nports > 0)) {
+    Bit8u c = (Bit8u)value;
+    backend_write(0, &c, 1);
+  }
+}
+
+// guest to host: write every buffer of the chain with one backend call
+void bx_virtio_console_c::handle_tx(unsigned p)
+{
+  bx_virtq_elem_t elem;
+  unsigned q = tx_queue(p);
+  bool done = 0;
+
+  // stop taking output while the host has not drained the queued data
+  while (((p >= nports) || (port[p].out_len == 0)) && vq_pop(q, &elem)) {
+    Bit32u offset = 0;
+    while (offset < elem.out_len) {
+      Bit32u n = vq_copy_from(&elem, offset, xfer_buf, BX_VCON_BUF_SIZE);
+      if (n == 0) break;
+      if (p < nports) {
+        backend_write(p, xfer_buf, n);
+      }
+      offset += n;
+    }
+    vq_push(q, &elem, 0);
+    done = 1;
+  }
+  if (done) {
+    vq_notify(q);
+  }
+}
+
+// host to guest: fill posted receive buffers while input is available
+void bx_virtio_console_c::handle_rx(unsigned p)
+{
+  bx_virtq_elem_t elem;
+  unsigned q = rx_queue(p);
+  bool done = 0;
+  int n;
+
+  if ((p >= nports) || !port[p].host_connected || !virtio_driver_ok())
+    return;
+  if (multiport()) {
+    if (!port[p].guest_ready || ((p > 0) && !port[p].guest_open))
+      return;
+  } else if (p > 0) {
+    return;
+  }
+  while (backend_can_read(p) && vq_pop(q, &elem)) {
+    if (elem.in_len == 0) {
+      // nothing fits, return the buffer without reading from the host
+      vq_push(q, &elem, 0);
+      done = 1;
+      continue;
+    }
+    n = elem.in_len;
+    if (n > BX_VCON_BUF_SIZE) n = BX_VCON_BUF_SIZE;
+    n = backend_read(p, xfer_buf, n);
+    if (n <= 0) {
+      vq_unpop(q);
+      break;
+    }
+    vq_copy_to(&elem, 0, xfer_buf, n);
+    vq_push(q, &elem, n);
+    done = 1;
+  }
+  if (done) {
+    vq_notify(q);
+  }
+}
+
+void bx_virtio_console_c::handle_control(void)
+{
+  bx_virtq_elem_t elem;
+  Bit8u msg[8];
+  Bit32u id;
+  Bit16u event, value;
+  bool done = 0;
+
+  while (vq_pop(3, &elem)) {
+    if (vq_copy_from(&elem, 0, msg, 8) == 8) {
+      id = ReadHostDWordFromLittleEndian((Bit32u*)&msg[0]);
+      event = ReadHostWordFromLittleEndian((Bit16u*)&msg[4]);
+      value = ReadHostWordFromLittleEndian((Bit16u*)&msg[6]);
+      BX_DEBUG(("control message: id=%d event=%d value=%d", id, event, value));
+      switch (event) {
+        case VIRTIO_CONSOLE_DEVICE_READY:
+          if (value == 1) {
+            device_ready = 1;
+            for (unsigned i = 0; i < nports; i++) {
+              if (port[i].mode != BX_VCON_MODE_NONE) {
+                send_control(i, VIRTIO_CONSOLE_DEVICE_ADD, 1);
+              }
+            }
+          } else {
+            BX_ERROR(("guest driver failed to initialize"));
+          }
+          break;
+        case VIRTIO_CONSOLE_PORT_READY:
+          if (id >= nports) {
+            BX_ERROR(("PORT_READY for unknown port %d", id));
+          } else if (value == 1) {
+            port[id].guest_ready = 1;
+            if (id == 0) {
+              send_control(id, VIRTIO_CONSOLE_CONSOLE_PORT, 1);
+            }
+            if (strlen(port[id].name) > 0) {
+              send_control(id, VIRTIO_CONSOLE_PORT_NAME, 1);
+            }
+            if (port[id].host_connected) {
+              send_control(id, VIRTIO_CONSOLE_PORT_OPEN, 1);
+            }
+          } else {
+            port[id].guest_ready = 0;
+            BX_ERROR(("guest failed to add port %d", id));
+          }
+          break;
+        case VIRTIO_CONSOLE_PORT_OPEN:
+          if (id < nports) {
+            port[id].guest_open = (value != 0);
+            BX_DEBUG(("port %d %s by guest", id, value ? "opened" : "closed"));
+          }
+          break;
+        default:
+          BX_DEBUG(("unhandled control event %d", event));
+      }
+    }
+    vq_push(3, &elem, 0);
+    done = 1;
+  }
+  if (done) {
+    vq_notify(3);
+  }
+}
+
+void bx_virtio_console_c::send_control(Bit32u id, Bit16u event, Bit16u value)
+{
+  if (!multiport()) return;
+  if (ctrl_count >= BX_VCON_CTRL_QUEUE_SIZE) {
+    BX_ERROR(("control queue full, event %d for port %d dropped", event, id));
+    return;
+  }
+  ctrl_queue[ctrl_count].id = id;
+  ctrl_queue[ctrl_count].event = event;
+  ctrl_queue[ctrl_count].value = value;
+  ctrl_count++;
+  flush_control();
+}
+
+// pass pending control messages to the guest as far as buffers are posted
+void bx_virtio_console_c::flush_control(void)
+{
+  bx_virtq_elem_t elem;
+  Bit32u len;
+  bool done = 0;
+
+  while ((ctrl_count > 0) && vq_pop(2, &elem)) {
+    bx_vcon_ctrl_msg_t *msg = &ctrl_queue[0];
+    WriteHostDWordToLittleEndian((Bit32u*)&xfer_buf[0], msg->id);
+    WriteHostWordToLittleEndian((Bit16u*)&xfer_buf[4], msg->event);
+    WriteHostWordToLittleEndian((Bit16u*)&xfer_buf[6], msg->value);
+    len = 8;
+    if ((msg->event == VIRTIO_CONSOLE_PORT_NAME) && (msg->id < nports)) {
+      len += strlen(port[msg->id].name);
+      memcpy(&xfer_buf[8], port[msg->id].name, len - 8);
+    }
+    len = vq_copy_to(&elem, 0, xfer_buf, len);
+    vq_push(2, &elem, len);
+    ctrl_count--;
+    memmove(&ctrl_queue[0], &ctrl_queue[1], ctrl_count * sizeof(bx_vcon_ctrl_msg_t));
+    done = 1;
+  }
+  if (done) {
+    vq_notify(2);
+  }
+}
+
+// the host side of a port has been connected or disconnected
+void bx_virtio_console_c::host_connect(unsigned p, bool connected)
+{
+  port[p].host_connected = connected;
+  BX_INFO(("port %d: host side %s", p, connected ? "connected" : "disconnected"));
+  if (device_ready && port[p].guest_ready) {
+    send_control(p, VIRTIO_CONSOLE_PORT_OPEN, connected);
+  }
+}
+
+void bx_virtio_console_c::poll_timer_handler(void *this_ptr)
+{
+  bx_virtio_console_c *class_ptr = (bx_virtio_console_c *) this_ptr;
+  class_ptr->poll_timer();
+}
+
+void bx_virtio_console_c::poll_timer(void)
+{
+  for (unsigned i = 0; i < nports; i++) {
+    if ((port[i].mode == BX_VCON_MODE_SOCKET_SERVER) && !port[i].host_connected) {
+      backend_accept(i);
+    }
+    if (port[i].out_len > 0) {
+      backend_flush(i);
+      if (port[i].out_len == 0) {
+        handle_tx(i);
+      }
+    }
+    handle_rx(i);
+  }
+}
+
+// host backends
+
+bool bx_virtio_console_c::backend_open(unsigned p)
+{
+  bx_vcon_port_t *vp = &port[p];
+
+  if ((vp->mode != BX_VCON_MODE_STDIO) && (strlen(vp->dev) == 0)) {
+    BX_PANIC(("port %d: no device path specified", p));
+    return 0;
+  }
+  if (vp->mode == BX_VCON_MODE_FILE) {
+    vp->output = fopen(vp->dev, "wb");
+    if (vp->output == NULL) {
+      BX_PANIC(("port %d: could not open '%s' for output", p, vp->dev));
+      return 0;
+    }
+    vp->host_connected = 1;
+    return 1;
+  }
+#ifdef BX_VCON_POSIX
+  switch (vp->mode) {
+    case BX_VCON_MODE_STDIO:
+      vp->fd_in = 0;
+      vp->fd_out = 1;
+      if (isatty(0) && (tcgetattr(0, &vp->term_orig) == 0)) {
+        struct termios term_new = vp->term_orig;
+        // pass keys unbuffered and without echo, but keep ^C for Bochs
+        term_new.c_lflag &= ~(ICANON | ECHO);
+        term_new.c_cc[VMIN] = 1;
+        term_new.c_cc[VTIME] = 0;
+        tcsetattr(0, TCSAFLUSH, &term_new);
+        vp->term_saved = 1;
+      }
+      vp->host_connected = 1;
+      break;
+    case BX_VCON_MODE_PIPE:
+      {
+        char in_name[BX_PATHNAME_LEN + 4], out_name[BX_PATHNAME_LEN + 4];
+        sprintf(in_name, "%s.in", vp->dev);
+        sprintf(out_name, "%s.out", vp->dev);
+        if ((access(in_name, F_OK) == 0) && (access(out_name, F_OK) == 0)) {
+          vp->fd_in = open(in_name, O_RDWR);
+          vp->fd_out = open(out_name, O_RDWR);
+        } else {
+          vp->fd_in = vp->fd_out = open(vp->dev, O_RDWR);
+        }
+        if ((vp->fd_in < 0) || (vp->fd_out < 0)) {
+          BX_PANIC(("port %d: could not open pipe '%s'", p, vp->dev));
+          return 0;
+        }
+        fcntl(vp->fd_in, F_SETFL, fcntl(vp->fd_in, F_GETFL) | O_NONBLOCK);
+        fcntl(vp->fd_out, F_SETFL, fcntl(vp->fd_out, F_GETFL) | O_NONBLOCK);
+        vp->host_connected = 1;
+      }
+      break;
+    case BX_VCON_MODE_SOCKET_CLIENT:
+    case BX_VCON_MODE_SOCKET_SERVER:
+      {
+        struct sockaddr_un sa;
+        struct stat st;
+        int fd;
+
+        if (strlen(vp->dev) >= sizeof(sa.sun_path)) {
+          BX_PANIC(("port %d: socket path '%s' too long", p, vp->dev));
+          return 0;
+        }
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strcpy(sa.sun_path, vp->dev);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+          BX_PANIC(("port %d: socket() failed", p));
+          return 0;
+        }
+        if (vp->mode == BX_VCON_MODE_SOCKET_CLIENT) {
+          if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+            BX_ERROR(("port %d: connect() to '%s' failed", p, vp->dev));
+            close(fd);
+            return 0;
+          }
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+          vp->fd_in = vp->fd_out = fd;
+          vp->host_connected = 1;
+        } else {
+          // remove a stale socket left by a previous session
+          if ((stat(vp->dev, &st) == 0) && S_ISSOCK(st.st_mode)) {
+            unlink(vp->dev);
+          }
+          if ((bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) || (listen(fd, 1) < 0)) {
+            BX_PANIC(("port %d: bind() or listen() failed (%s)", p, vp->dev));
+            close(fd);
+            return 0;
+          }
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+          vp->listen_fd = fd;
+          BX_INFO(("port %d: waiting for connection on '%s'", p, vp->dev));
+        }
+      }
+      break;
+  }
+  return 1;
+#else
+  BX_PANIC(("port %d: only 'file' mode is supported on this host", p));
+  return 0;
+#endif
+}
+
+void bx_virtio_console_c::backend_close(unsigned p)
+{
+  bx_vcon_port_t *vp = &port[p];
+
+  if (vp->output != NULL) {
+    fclose(vp->output);
+    vp->output = NULL;
+  }
+#ifdef BX_VCON_POSIX
+  if ((vp->mode != BX_VCON_MODE_STDIO) && (vp->fd_in >= 0)) {
+    close(vp->fd_in);
+  }
+  if ((vp->mode != BX_VCON_MODE_STDIO) && (vp->fd_out >= 0) && (vp->fd_out != vp->fd_in)) {
+    close(vp->fd_out);
+  }
+#endif
+  vp->fd_in = vp->fd_out = -1;
+  vp->out_len = 0;
+}
+
+void bx_virtio_console_c::backend_accept(unsigned p)
+{
+#ifdef BX_VCON_POSIX
+  int fd = accept(port[p].listen_fd, NULL, NULL);
+  if (fd >= 0) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    port[p].fd_in = port[p].fd_out = fd;
+    host_connect(p, 1);
+  }
+#endif
+}
+
+bool bx_virtio_console_c::backend_can_read(unsigned p)
+{
+#ifdef BX_VCON_POSIX
+  struct timeval tval = {0, 0};
+  fd_set fds;
+
+  if (port[p].fd_in < 0) return 0;
+  FD_ZERO(&fds);
+  FD_SET(port[p].fd_in, &fds);
+  return select(port[p].fd_in + 1, &fds, NULL, NULL, &tval) == 1;
+#else
+  return 0;
+#endif
+}
+
+// Returns the number of bytes read. On end of input the input side is
+// closed and a socket connection is dropped.
+int bx_virtio_console_c::backend_read(unsigned p, Bit8u *buf, int len)
+{
+#ifdef BX_VCON_POSIX
+  bx_vcon_port_t *vp = &port[p];
+  int n = read(vp->fd_in, buf, len);
+
+  if (n > 0) return n;
+  if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR))) return 0;
+  if ((vp->mode == BX_VCON_MODE_SOCKET_CLIENT) || (vp->mode == BX_VCON_MODE_SOCKET_SERVER)) {
+    backend_close(p);
+    host_connect(p, 0);
+  } else {
+    BX_INFO(("port %d: end of host input", p));
+    if (vp->fd_in != vp->fd_out) close(vp->fd_in);
+    vp->fd_in = -1;
+  }
+#endif
+  return -1;
+}
+
+// The host descriptors are non-blocking (except for stdio, which is shared
+// with the Bochs console). Output the host can't take right now is queued
+// and written by the poll timer; handle_tx() takes no more guest output
+// until the queue is drained.
+void bx_virtio_console_c::backend_write(unsigned p, const Bit8u *buf, int len)
+{
+  bx_vcon_port_t *vp = &port[p];
+
+  if (vp->output != NULL) {
+    fwrite(buf, 1, len, vp->output);
+    fflush(vp->output);
+    return;
+  }
+  if (vp->out_len == 0) {
+    int n = backend_send(p, buf, len);
+    if (n < 0) return;
+    buf += n;
+    len -= n;
+  }
+  if (len > 0) {
+    backend_queue(p, buf, len);
+  }
+}
+
+// returns the number of bytes the host took or -1 if the connection failed
+int bx_virtio_console_c::backend_send(unsigned p, const Bit8u *buf, int len)
+{
+  bx_vcon_port_t *vp = &port[p];
+  int done = 0;
+
+#ifdef BX_VCON_POSIX
+  while ((done < len) && (vp->fd_out >= 0)) {
+    int n;
+    if ((vp->mode == BX_VCON_MODE_SOCKET_CLIENT) || (vp->mode == BX_VCON_MODE_SOCKET_SERVER)) {
+#ifdef MSG_NOSIGNAL
+      n = send(vp->fd_out, buf + done, len - done, MSG_NOSIGNAL);
+#else
+      n = send(vp->fd_out, buf + done, len - done, 0);
+#endif
+    } else {
+      n = write(vp->fd_out, buf + done, len - done);
+    }
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) break;
+      BX_ERROR(("port %d: write to host failed", p));
+      if ((vp->mode == BX_VCON_MODE_SOCKET_CLIENT) || (vp->mode == BX_VCON_MODE_SOCKET_SERVER)) {
+        backend_close(p);
+        host_connect(p, 0);
+      }
+      return -1;
+    }
+    done += n;
+  }
+  if (vp->fd_out < 0) return -1;
+  return done;
+#else
+  return len;
+#endif
+}
+
+void bx_virtio_console_c::backend_queue(unsigned p, const Bit8u *buf, int len)
+{
+  bx_vcon_port_t *vp = &port[p];
+
+  if ((vp->out_len + len) > vp->out_size) {
+    unsigned size = (vp->out_size > 0) ? vp->out_size : BX_VCON_BUF_SIZE;
+    while ((size < (vp->out_len + len)) && (size < BX_VCON_OUT_MAX)) {
+      size <<= 1;
+    }
+    if (size < (vp->out_len + len)) {
+      BX_ERROR(("port %d: host output queue full, %d bytes dropped", p, len));
+      return;
+    }
+    Bit8u *new_buf = new Bit8u[size];
+    if (vp->out_len > 0) {
+      memcpy(new_buf, vp->out_buf, vp->out_len);
+    }
+    if (vp->out_buf != NULL) {
+      delete [] vp->out_buf;
+    }
+    vp->out_buf = new_buf;
+    vp->out_size = size;
+  }
+  memcpy(vp->out_buf + vp->out_len, buf, len);
+  vp->out_len += len;
+}
+
+// write as much of the queued output as the host takes now
+void bx_virtio_console_c::backend_flush(unsigned p)
+{
+  bx_vcon_port_t *vp = &port[p];
+
+  int n = backend_send(p, vp->out_buf, vp->out_len);
+  if (n <= 0) return;
+  vp->out_len -= n;
+  if (vp->out_len > 0) {
+    memmove(vp->out_buf, vp->out_buf + n, vp->out_len);
+  }
+}
+
+#endif // BX_SUPPORT_PCI && BX_SUPPORT_VIRTIO
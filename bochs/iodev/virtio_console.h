@@ -0,0 +1,150 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BX_IODEV_VIRTIO_CONSOLE_H
+#define BX_IODEV_VIRTIO_CONSOLE_H
+
+// stdio, pipe and socket backends need a POSIX host
+#if !defined(WIN32) || defined(__CYGWIN__)
+#define BX_VCON_POSIX
+extern "C" {
+#include <termios.h>
+};
+#endif
+
+#define VIRTIO_CONSOLE_DEVICE_ID   0x1003
+#define VIRTIO_ID_CONSOLE          3
+
+#define BX_VCON_MAX_PORTS          4
+#define BX_VCON_QUEUE_SIZE         128
+#define BX_VCON_BUF_SIZE           65536
+#define BX_VCON_OUT_MAX            (1024 * 1024)
+#define BX_VCON_POLL_USEC          1000
+#define BX_VCON_CTRL_QUEUE_SIZE    32
+
+// feature bits
+#define VIRTIO_CONSOLE_F_SIZE      0
+#define VIRTIO_CONSOLE_F_MULTIPORT 1
+#define VIRTIO_CONSOLE_F_EMERG_WRITE 2
+
+// device config layout
+#define VIRTIO_CONSOLE_CFG_COLS    0
+#define VIRTIO_CONSOLE_CFG_ROWS    2
+#define VIRTIO_CONSOLE_CFG_MAXPORTS 4
+#define VIRTIO_CONSOLE_CFG_EMERG_WR 8
+#define VIRTIO_CONSOLE_CFG_SIZE    12
+
+// control queue events
+#define VIRTIO_CONSOLE_DEVICE_READY  0
+#define VIRTIO_CONSOLE_DEVICE_ADD    1
+#define VIRTIO_CONSOLE_DEVICE_REMOVE 2
+#define VIRTIO_CONSOLE_PORT_READY    3
+#define VIRTIO_CONSOLE_CONSOLE_PORT  4
+#define VIRTIO_CONSOLE_RESIZE        5
+#define VIRTIO_CONSOLE_PORT_OPEN     6
+#define VIRTIO_CONSOLE_PORT_NAME     7
+
+// port modes
+enum {
+  BX_VCON_MODE_NONE = 0,
+  BX_VCON_MODE_STDIO,
+  BX_VCON_MODE_FILE,
+  BX_VCON_MODE_PIPE,
+  BX_VCON_MODE_SOCKET_CLIENT,
+  BX_VCON_MODE_SOCKET_SERVER
+};
+
+typedef struct {
+  Bit32u id;
+  Bit16u event;
+  Bit16u value;
+} bx_vcon_ctrl_msg_t;
+
+typedef struct {
+  int    mode;
+  const char *dev;
+  const char *name;
+  FILE   *output;       // file mode
+  int    fd_in;         // other modes: host side file descriptors
+  int    fd_out;
+  int    listen_fd;     // socket server mode
+  Bit8u  *out_buf;      // output the host could not take yet
+  unsigned out_len;
+  unsigned out_size;
+  bool   host_connected;
+#ifdef BX_VCON_POSIX
+  bool   term_saved;
+  struct termios term_orig;
+#endif
+  bool   guest_ready;   // PORT_READY received from the guest
+  bool   guest_open;    // port opened by a guest application
+} bx_vcon_port_t;
+
+class bx_virtio_console_c : public bx_virtio_pci_c {
+public:
+  bx_virtio_console_c();
+  virtual ~bx_virtio_console_c();
+  virtual void init(void);
+  virtual void reset(unsigned type);
+  virtual void register_state(void);
+  virtual void after_restore_state(void);
+
+protected:
+  virtual void virtio_queue_notify(unsigned q);
+  virtual void virtio_config_write(unsigned offset, Bit32u value, unsigned len);
+  virtual void virtio_device_reset(void);
+
+private:
+  static unsigned rx_queue(unsigned port) {return (port == 0) ? 0 : (port * 2 + 2);}
+  static unsigned tx_queue(unsigned port) {return (port == 0) ? 1 : (port * 2 + 3);}
+  bool multiport(void) const {return virtio_has_feature(VIRTIO_CONSOLE_F_MULTIPORT);}
+
+  void   handle_tx(unsigned port);
+  void   handle_rx(unsigned port);
+  void   handle_control(void);
+  void   send_control(Bit32u id, Bit16u event, Bit16u value);
+  void   flush_control(void);
+  void   host_connect(unsigned port, bool connected);
+
+  bool   backend_open(unsigned port);
+  void   backend_close(unsigned port);
+  void   backend_accept(unsigned port);
+  bool   backend_can_read(unsigned port);
+  int    backend_read(unsigned port, Bit8u *buf, int len);
+  void   backend_write(unsigned port, const Bit8u *buf, int len);
+  int    backend_send(unsigned port, const Bit8u *buf, int len);
+  void   backend_queue(unsigned port, const Bit8u *buf, int len);
+  void   backend_flush(unsigned port);
+
+  static void poll_timer_handler(void *this_ptr);
+  void   poll_timer(void);
+
+  Bit8u  devfunc;
+  int    timer_index;
+  unsigned nports;
+  bx_vcon_port_t port[BX_VCON_MAX_PORTS];
+  bool   device_ready;
+  Bit8u  ctrl_count;
+  bx_vcon_ctrl_msg_t ctrl_queue[BX_VCON_CTRL_QUEUE_SIZE];
+  Bit8u  *xfer_buf;
+};
+
+#endif
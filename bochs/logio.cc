@@ -40,6 +40,38 @@ const int MAGIC_LOGNUM = 0x12345678;
 static int Allocio=0;
 BX_MUTEX(logio_mutex);
 
+// Asynchronous output: out() formats the message and copies it together
+// with the values needed for the prefix into a ring buffer. The writer
+// thread formats the prefix and does the file I/O. Producers are
+// serialized by logio_mutex, the writer only touches the tail.
+
+#define BX_LOG_RING_SIZE (256 * 1024)
+#define BX_LOG_WRITER_PERIOD 10 // msec
+
+typedef struct {
+  Bit32u size;     // size of the entry, 0 marks a wrap to the ring start
+  Bit32u eip;
+  Bit64u ticks;
+  Bit8u  level;
+  char   prefix[15];
+  // followed by the message
+} bx_log_entry_t;
+
+struct bx_log_async_t {
+  Bit8u ring[BX_LOG_RING_SIZE];
+  Bit32u head;
+  Bit32u tail;
+  bool stop;
+  BX_THREAD_VAR(thread);
+};
+
+static BX_THREAD_FUNC(log_writer_thread, indata)
+{
+  iofunctions *iof = (iofunctions*) indata;
+  iof->async_drain_loop();
+  BX_THREAD_EXIT;
+}
+
 const char* iofunctions::getlevel(int i) const
 {
   static const char *loglevel[N_LOGLEV] = {
@@ -93,6 +125,8 @@ void iofunctions::init(void)
   // sets the default logprefix
   strcpy(logprefix,"%t%e%d");
   n_logfn = 0;
+  rate_limit = 0;
+  async = NULL;
   init_log(stderr);
   log = new logfunc_t(this);
   log->put("logio", "IO");
@@ -177,6 +211,7 @@ void iofunctions::init_log(int fd)
 // called at simulation exit
 void iofunctions::exit_log()
 {
+  set_async(0);
   flush();
   if (logfd != stderr) {
     fclose(logfd);
@@ -200,23 +235,16 @@ void iofunctions::exit_log2()
 // 1. timer, 2. event, 3. cpu0 eip, 4. device
 void iofunctions::set_log_prefix(const char* prefix)
 {
+  BX_LOCK(logio_mutex);
+  async_flush();
   strcpy(logprefix, prefix);
+  BX_UNLOCK(logio_mutex);
 }
 
-//  iofunctions::out(level, prefix, fmt, ap)
-//  DO NOT nest out() from ::info() and the like.
-//    fmt and ap retained for direct printinf from iofunctions only!
-
-void iofunctions::out(int level, const char *prefix, const char *fmt, va_list ap)
+void iofunctions::format_prefix(char *msgpfx, int level, const char *prefix, Bit64u ticks, Bit32u eip)
 {
   char c = ' ', *s;
-  char tmpstr[80], msgpfx[80], msg[1024];
-
-  assert(magic==MAGIC_LOGNUM);
-  assert(this != NULL);
-  assert(logfd != NULL);
-
-  BX_LOCK(logio_mutex);
+  char tmpstr[80];
 
   switch (level) {
     case LOGLEV_INFO: c='i'; break;
@@ -238,11 +266,12 @@ void iofunctions::out(int level, const char *prefix, const char *fmt, va_list ap
             sprintf(tmpstr, "%s", prefix==NULL?"":prefix);
             break;
           case 't':
-            sprintf(tmpstr, FMT_TICK, bx_pc_system.time_ticks());
+            sprintf(tmpstr, FMT_TICK, ticks);
             break;
           case 'i':
+            tmpstr[0] = 0;
 #if BX_SUPPORT_SMP == 0
-            sprintf(tmpstr, "%08x", BX_CPU(0)->get_eip());
+            sprintf(tmpstr, "%08x", eip);
 #endif
             break;
           case 'e':
@@ -261,21 +290,157 @@ void iofunctions::out(int level, const char *prefix, const char *fmt, va_list ap
     strcat(msgpfx, tmpstr);
     s++;
   }
+}
 
+void iofunctions::write_msg(int level, const char *msgpfx, const char *msg)
+{
   fprintf(logfd,"%s ", msgpfx);
 
   if(level==LOGLEV_PANIC)
     fprintf(logfd, ">>PANIC<< ");
 
-  vsnprintf(msg, sizeof(msg), fmt, ap);
   fprintf(logfd, "%s\n", msg);
+}
+
+// enable or disable the writer thread, pending messages are written first
+void iofunctions::set_async(bool enable)
+{
+  BX_LOCK(logio_mutex);
+  if (enable && (async == NULL) && !SIM->has_log_viewer()) {
+    async = new bx_log_async_t;
+    async->head = async->tail = 0;
+    async->stop = 0;
+    BX_THREAD_CREATE(log_writer_thread, this, async->thread);
+  } else if (!enable && (async != NULL)) {
+    BX_ATOMIC_STORE(async->stop, 1);
+    BX_THREAD_JOIN(async->thread);
+    delete async;
+    async = NULL;
+  }
+  BX_UNLOCK(logio_mutex);
+}
+
+// called with logio_mutex held
+void iofunctions::async_put(int level, const char *prefix, const char *msg)
+{
+  size_t len = strlen(msg) + 1;
+  Bit32u size = (Bit32u)((sizeof(bx_log_entry_t) + len + 7) & ~7);
+  Bit32u pos = async->head % BX_LOG_RING_SIZE;
+  Bit32u room = BX_LOG_RING_SIZE - pos;
+  // an entry does not wrap around, skip the rest of the ring instead
+  Bit32u need = (room < size) ? (room + size) : size;
+
+  while ((BX_LOG_RING_SIZE - (async->head - BX_ATOMIC_LOAD(async->tail))) < need) {
+    BX_MSLEEP(1);
+  }
+  if (room < size) {
+    ((bx_log_entry_t*) &async->ring[pos])->size = 0;
+    async->head += room;
+    pos = 0;
+  }
+  bx_log_entry_t *entry = (bx_log_entry_t*) &async->ring[pos];
+  entry->size = size;
+  entry->level = level;
+  entry->ticks = bx_pc_system.time_ticks();
+#if BX_SUPPORT_SMP == 0
+  entry->eip = BX_CPU(0)->get_eip();
+#else
+  entry->eip = 0;
+#endif
+  strncpy(entry->prefix, (prefix == NULL) ? "" : prefix, sizeof(entry->prefix) - 1);
+  entry->prefix[sizeof(entry->prefix) - 1] = 0;
+  memcpy(entry + 1, msg, len);
+  BX_ATOMIC_STORE(async->head, async->head + size);
+}
+
+// writer thread: write all queued messages
+void iofunctions::async_drain(void)
+{
+  char msgpfx[80];
+  Bit32u head = BX_ATOMIC_LOAD(async->head);
+  Bit32u tail = async->tail;
+
+  if (tail == head) return;
+  while (tail != head) {
+    Bit32u pos = tail % BX_LOG_RING_SIZE;
+    bx_log_entry_t *entry = (bx_log_entry_t*) &async->ring[pos];
+    if (entry->size == 0) {
+      tail += BX_LOG_RING_SIZE - pos;
+      continue;
+    }
+    format_prefix(msgpfx, entry->level, entry->prefix, entry->ticks, entry->eip);
+    write_msg(entry->level, msgpfx, (const char*)(entry + 1));
+    tail += entry->size;
+  }
   fflush(logfd);
-  if (SIM->has_log_viewer()) {
-    SIM->log_msg(msgpfx, level, msg);
+  BX_ATOMIC_STORE(async->tail, tail);
+}
+
+void iofunctions::async_drain_loop(void)
+{
+  while (!BX_ATOMIC_LOAD(async->stop)) {
+    async_drain();
+    BX_MSLEEP(BX_LOG_WRITER_PERIOD);
+  }
+  async_drain();
+}
+
+// called with logio_mutex held: wait until the writer is done
+void iofunctions::async_flush(void)
+{
+  if (async != NULL) {
+    while (BX_ATOMIC_LOAD(async->tail) != async->head) {
+      BX_MSLEEP(1);
+    }
+  }
+}
+
+//  iofunctions::out(level, prefix, fmt, ap)
+//  DO NOT nest out() from ::info() and the like.
+//    fmt and ap retained for direct printinf from iofunctions only!
+
+void iofunctions::out(int level, const char *prefix, const char *fmt, va_list ap)
+{
+  char msgpfx[80], msg[1024];
+
+  assert(magic==MAGIC_LOGNUM);
+  assert(this != NULL);
+  assert(logfd != NULL);
+
+  BX_LOCK(logio_mutex);
+
+  // the arguments might not outlive this call, so format them here
+  vsnprintf(msg, sizeof(msg), fmt, ap);
+  if (async != NULL) {
+    async_put(level, prefix, msg);
+    // errors are often followed by console output or a dialog
+    if (level >= LOGLEV_ERROR) async_flush();
+  } else {
+    format_prefix(msgpfx, level, prefix, bx_pc_system.time_ticks(),
+#if BX_SUPPORT_SMP == 0
+                  BX_CPU(0)->get_eip()
+#else
+                  0
+#endif
+                 );
+    write_msg(level, msgpfx, msg);
+    fflush(logfd);
+    if (SIM->has_log_viewer()) {
+      SIM->log_msg(msgpfx, level, msg);
+    }
   }
   BX_UNLOCK(logio_mutex);
 }
 
+void iofunctions::outf(int level, const char *prefix, const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  out(level, prefix, fmt, ap);
+  va_end(ap);
+}
+
 iofunctions::iofunctions(FILE *fs)
 {
   init();
@@ -328,6 +493,9 @@ logfunctions::logfunctions(void)
   name = NULL;
   prefix = NULL;
   put("?", " ");
+  rate_second = 0;
+  rate_count = 0;
+  rate_dropped = 0;
   if (io == NULL && Allocio == 0) {
     Allocio = 1;
     io = new iofunc_t(stderr);
@@ -344,6 +512,9 @@ logfunctions::logfunctions(iofunc_t *iofunc)
   name = NULL;
   prefix = NULL;
   put("?", " ");
+  rate_second = 0;
+  rate_count = 0;
+  rate_dropped = 0;
   setio(iofunc);
   // BUG: unfortunately this can be called before the bochsrc is read,
   // which means that the bochsrc has no effect on the actions.
@@ -406,6 +577,31 @@ void logfunctions::put(const char *n, const char *p)
   prefix = tmpbuf;
 }
 
+// Drop the message if the module exceeds the configured number of
+// messages per emulated second. The number of dropped messages is
+// reported with the first message of the next second.
+bool logfunctions::rate_limited(void)
+{
+  Bit32u limit = logio->get_rate_limit();
+
+  if ((limit == 0) || !SIM->get_init_done()) return 0;
+
+  Bit64u second = bx_pc_system.time_usec() / 1000000;
+  if (second != rate_second) {
+    rate_second = second;
+    rate_count = 0;
+    if (rate_dropped > 0) {
+      logio->outf(LOGLEV_INFO, prefix, "%u messages suppressed", rate_dropped);
+      rate_dropped = 0;
+    }
+  }
+  if (++rate_count > limit) {
+    rate_dropped++;
+    return 1;
+  }
+  return 0;
+}
+
 void logfunctions::info(const char *fmt, ...)
 {
   va_list ap;
@@ -414,9 +610,11 @@ void logfunctions::info(const char *fmt, ...)
 
   if (onoff[LOGLEV_INFO] == ACT_IGNORE) return;
 
-  va_start(ap, fmt);
-  logio->out(LOGLEV_INFO, prefix, fmt, ap);
-  va_end(ap);
+  if (!rate_limited()) {
+    va_start(ap, fmt);
+    logio->out(LOGLEV_INFO, prefix, fmt, ap);
+    va_end(ap);
+  }
 
   // the actions warn(), ask() and fatal() are not supported here
 }
@@ -429,9 +627,11 @@ void logfunctions::lwarn(const char *fmt, ...)
 
   if (onoff[LOGLEV_WARN] == ACT_IGNORE) return;
 
-  va_start(ap, fmt);
-  logio->out(LOGLEV_INFO, prefix, fmt, ap);
-  va_end(ap);
+  if (!rate_limited()) {
+    va_start(ap, fmt);
+    logio->out(LOGLEV_INFO, prefix, fmt, ap);
+    va_end(ap);
+  }
 
   if (onoff[LOGLEV_WARN] == ACT_WARN) {
     va_start(ap, fmt);
@@ -450,9 +650,11 @@ void logfunctions::error(const char *fmt, ...)
 
   if (onoff[LOGLEV_ERROR] == ACT_IGNORE) return;
 
-  va_start(ap, fmt);
-  logio->out(LOGLEV_ERROR, prefix, fmt, ap);
-  va_end(ap);
+  if (!rate_limited()) {
+    va_start(ap, fmt);
+    logio->out(LOGLEV_ERROR, prefix, fmt, ap);
+    va_end(ap);
+  }
 
   if (onoff[LOGLEV_ERROR] == ACT_WARN) {
     va_start(ap, fmt);
@@ -505,9 +707,11 @@ void logfunctions::ldebug(const char *fmt, ...)
 
   if (onoff[LOGLEV_DEBUG] == ACT_IGNORE) return;
 
-  va_start(ap, fmt);
-  logio->out(LOGLEV_DEBUG, prefix, fmt, ap);
-  va_end(ap);
+  if (!rate_limited()) {
+    va_start(ap, fmt);
+    logio->out(LOGLEV_DEBUG, prefix, fmt, ap);
+    va_end(ap);
+  }
 
   // the actions warn(), ask() and fatal() are not supported here
 }
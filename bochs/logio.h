@@ -49,9 +49,14 @@ typedef class BOCHSAPI logfunctions
   char *prefix;
   int onoff[N_LOGLEV];
   class iofunctions *logio;
+  // rate limiting state, see iofunctions::set_rate_limit()
+  Bit64u rate_second;
+  Bit32u rate_count;
+  Bit32u rate_dropped;
   // default log actions for all devices, declared and initialized
   // in logio.cc.
   BOCHSAPI_CYGONLY static int default_onoff[N_LOGLEV];
+  bool rate_limited(void);
 public:
   logfunctions(void);
   logfunctions(class iofunctions *);
@@ -79,6 +84,8 @@ public:
     assert (level>=0 && level<N_LOGLEV);
     return onoff[level];
   }
+  // used by the BX_DEBUG() etc. macros to skip ignored messages inline
+  bool log_enabled(int level) const { return onoff[level] != ACT_IGNORE; }
   static void set_default_action(int loglev, int action) {
     assert (loglev >= 0 && loglev < N_LOGLEV);
     assert (action >= 0 && action < N_ACT);
@@ -97,8 +104,15 @@ class BOCHSAPI iofunctions {
   char logprefix[BX_LOGPREFIX_LEN + 1];
   FILE *logfd;
   class logfunctions *log;
+  Bit32u rate_limit;
+  struct bx_log_async_t *async;
   void init(void);
   void flush(void);
+  void format_prefix(char *msgpfx, int level, const char *prefix, Bit64u ticks, Bit32u eip);
+  void write_msg(int level, const char *msgpfx, const char *msg);
+  void async_put(int level, const char *prefix, const char *msg);
+  void async_drain(void);
+  void async_flush(void);
 
 // Log Class types
 public:
@@ -109,6 +123,7 @@ public:
  ~iofunctions(void);
 
   void out(int level, const char *pre, const char *fmt, va_list ap);
+  void outf(int level, const char *pre, const char *fmt, ...) BX_CPP_AttrPrintf(4, 5);
 
   void init_log(const char *fn);
   void init_log(int fd);
@@ -116,6 +131,10 @@ public:
   void exit_log();
   void exit_log2();
   void set_log_prefix(const char *prefix);
+  void set_async(bool enable);
+  void async_drain_loop(void);
+  void set_rate_limit(Bit32u limit) { rate_limit = limit; }
+  Bit32u get_rate_limit() const { return rate_limit; }
   int get_n_logfns() const { return n_logfn; }
   logfunc_t *get_logfn(int index) { return logfn_list[index]; }
   void add_logfn(logfunc_t *fn);
@@ -152,10 +171,12 @@ typedef class iofunctions iofunc_t;
 
 #else
 
-#define BX_DEBUG(x) (LOG_THIS ldebug) x
-#define BX_INFO(x)  (LOG_THIS info) x
-#define BX_WARN(x)  (LOG_THIS lwarn) x
-#define BX_ERROR(x) (LOG_THIS error) x
+// the level check is done inline, the arguments of ignored messages
+// are not evaluated
+#define BX_DEBUG(x) ((LOG_THIS log_enabled(LOGLEV_DEBUG)) ? (LOG_THIS ldebug) x : (void) 0)
+#define BX_INFO(x)  ((LOG_THIS log_enabled(LOGLEV_INFO))  ? (LOG_THIS info) x   : (void) 0)
+#define BX_WARN(x)  ((LOG_THIS log_enabled(LOGLEV_WARN))  ? (LOG_THIS lwarn) x  : (void) 0)
+#define BX_ERROR(x) ((LOG_THIS log_enabled(LOGLEV_ERROR)) ? (LOG_THIS error) x  : (void) 0)
 #define BX_PANIC(x) (LOG_THIS panic) x
 #define BX_FATAL(x) (LOG_THIS fatal1) x
 
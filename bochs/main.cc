@@ -75,6 +75,7 @@ void bx_cleanup_options(void);
 void bx_init_bx_dbg(void);
 
 static const char *divider = "========================================================================";
+static Bit64u benchmark_start_usec = 0;
 
 bx_startup_flags_t bx_startup_flags;
 bool bx_user_quit;
@@ -580,6 +581,8 @@ void print_usage(void)
     "  -benchmark N     run Bochs in benchmark mode for N millions of emulated ticks\n"
 #if BX_ENABLE_STATISTICS
     "  -dumpstats N     dump Bochs stats every N millions of emulated ticks\n"
+    "  -metrics path    export Bochs stats through a local socket\n"
+    "  -ioheatmap       log the hottest I/O ports and MMIO pages at exit\n"
 #endif
     "  -r path          restore the Bochs state from path\n"
     "  -log filename    specify Bochs log file name\n"
@@ -696,6 +699,10 @@ int bx_init_main(int argc, char *argv[])
 #if BX_SUPPORT_USB_XHCI
           fprintf(stderr, "usb_xhci\n");
 #endif
+#if BX_SUPPORT_VIRTIO
+          fprintf(stderr, "virtio_console\n");
+          fprintf(stderr, "virtio_9p\n");
+#endif
 #if BX_GDBSTUB
           fprintf(stderr, "gdbstub\n");
 #endif
@@ -778,6 +785,13 @@ int bx_init_main(int argc, char *argv[])
       if (++arg >= argc) BX_PANIC(("-dumpstats must be followed by a number"));
       else SIM->get_param_num(BXPN_DUMP_STATS)->set(atoi(argv[arg]));
     }
+    else if (!strcmp("-metrics", argv[arg])) {
+      if (++arg >= argc) BX_PANIC(("-metrics must be followed by a path"));
+      else SIM->get_param_string(BXPN_METRICS_SOCKET)->set(argv[arg]);
+    }
+    else if (!strcmp("-ioheatmap", argv[arg])) {
+      SIM->get_param_bool(BXPN_HEATMAP)->set(1);
+    }
 #endif
     else if (!strcmp("-r", argv[arg])) {
       if (++arg >= argc) BX_PANIC(("-r must be followed by a path"));
@@ -1218,6 +1232,8 @@ void bx_init_hardware()
   }
 
   io->set_log_prefix(SIM->get_param_string(BXPN_LOG_PREFIX)->getptr());
+  io->set_rate_limit((Bit32u) SIM->get_param_num(BXPN_LOG_RATE_LIMIT)->get());
+  io->set_async(SIM->get_param_bool(BXPN_LOG_ASYNC)->get());
 
   // Output to the log file the cpu and device settings
   // This will by handy for bug reports
@@ -1401,6 +1417,19 @@ void bx_init_hardware()
   bx_gui->init_signal_handlers();
   bx_pc_system.start_timers();
 
+  if (SIM->get_param_num(BXPN_BOCHS_BENCHMARK)->get()) {
+    benchmark_start_usec = bx_get_realtime64_usec();
+  }
+
+#if BX_ENABLE_STATISTICS
+  if (!SIM->get_param_string(BXPN_METRICS_SOCKET)->isempty()) {
+    bx_metrics_start(SIM->get_param_string(BXPN_METRICS_SOCKET)->getptr());
+  }
+  if (SIM->get_param_bool(BXPN_HEATMAP)->get()) {
+    bx_heatmap.init();
+  }
+#endif
+
   BX_DEBUG(("bx_init_hardware is setting signal handlers"));
 // if not using debugger, then we can take control of SIGINT.
 #if BX_DEBUGGER
@@ -1444,6 +1473,25 @@ int bx_atexit(void)
 {
   if (!SIM->get_init_done()) return 1; // protect from reentry
 
+#if BX_ENABLE_STATISTICS
+  bx_metrics_stop();
+  bx_heatmap.report();
+#endif
+
+  // report the benchmark results, whether the benchmark timer expired or
+  // the guest stopped the simulation on its own
+  if (benchmark_start_usec) {
+    Bit64u elapsed = bx_get_realtime64_usec() - benchmark_start_usec;
+    Bit64u icount = 0;
+    for (int cpu=0; cpu<BX_SMP_PROCESSORS; cpu++)
+      if (BX_CPU(cpu)) icount += BX_CPU(cpu)->get_icount();
+    if (elapsed == 0) elapsed = 1;
+    BX_INFO(("benchmark: " FMT_LL "u ticks, " FMT_LL "u instructions, %.3f seconds, %.3f MIPS",
+      bx_pc_system.time_ticks(), icount, (double) elapsed / 1000000.0,
+      (double) icount / (double) elapsed));
+    benchmark_start_usec = 0;
+  }
+
   // in case we ended up in simulation mode, change back to config mode
   // so that the user can see any messages left behind on the console.
   SIM->set_display_mode(DISP_MODE_CONFIG);
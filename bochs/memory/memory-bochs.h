@@ -132,6 +132,11 @@ struct memory_handler_struct {
   memory_handler_t read_handler;
   memory_handler_t write_handler;
   memory_direct_access_handler_t da_handler;
+#if BX_ENABLE_STATISTICS
+  Bit64u *reads;    // statistics.mmio.<range>.reads/writes
+  Bit64u *writes;
+  bx_heat_slot_t *heat; // heatmap slots for the pages in this 1MB chunk
+#endif
 };
 
 #define BIOS_MAP_LAST128K(addr) (((addr) | 0xfff00000) & BIOS_MASK)
@@ -159,6 +164,10 @@ enum memory_area_t {
 class BOCHSAPI BX_MEM_C : public BX_MEMORY_STUB_C {
 private:
   struct memory_handler_struct **memory_handlers;
+#if BX_ENABLE_STATISTICS
+  Bit64u *dma_read_bytes;  // statistics.dma.read_bytes/write_bytes
+  Bit64u *dma_write_bytes;
+#endif
   bool pci_enabled;
   bool bios_write_enabled;
 
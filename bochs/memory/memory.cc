@@ -46,6 +46,9 @@ void BX_MEM_C::writePhysicalPage(BX_CPU_C *cpu, bx_phy_address addr, unsigned le
   bx_phy_address linear_addr = bx_translate_gpa_to_linear(a20addr);
 
   struct memory_handler_struct *memory_handler = NULL;
+#if BX_ENABLE_STATISTICS
+  Bit64u heat_start = 0;
+#endif
 
   // Note: accesses should always be contained within a single page
   if ((addr>>12) != ((addr+len-1)>>12)) {
@@ -103,12 +106,20 @@ void BX_MEM_C::writePhysicalPage(BX_CPU_C *cpu, bx_phy_address addr, unsigned le
   }
 
   memory_handler = BX_MEM_THIS memory_handlers[a20addr >> 20];
+#if BX_ENABLE_STATISTICS
+  if (memory_handler && bx_heatmap.enabled) heat_start = bx_heatmap.start();
+#endif
   while (memory_handler) {
     if (memory_handler->write_handler != NULL) {
       if (memory_handler->begin <= a20addr &&
           memory_handler->end >= a20addr &&
           memory_handler->write_handler(a20addr, len, data, memory_handler->param))
       {
+        INC_STAT(*memory_handler->writes);
+#if BX_ENABLE_STATISTICS
+        if (bx_heatmap.enabled)
+          bx_heatmap.mmio_access(&memory_handler->heat, memory_handler->param, a20addr, 1, heat_start);
+#endif
         return;
       }
     }
@@ -221,6 +232,9 @@ void BX_MEM_C::readPhysicalPage(BX_CPU_C *cpu, bx_phy_address addr, unsigned len
   bx_phy_address linear_addr = bx_translate_gpa_to_linear(a20addr);
 
   struct memory_handler_struct *memory_handler = NULL;
+#if BX_ENABLE_STATISTICS
+  Bit64u heat_start = 0;
+#endif
 
   // Note: accesses should always be contained within a single page
   if ((addr>>12) != ((addr+len-1)>>12)) {
@@ -268,11 +282,19 @@ void BX_MEM_C::readPhysicalPage(BX_CPU_C *cpu, bx_phy_address addr, unsigned len
   }
 
   memory_handler = BX_MEM_THIS memory_handlers[a20addr >> 20];
+#if BX_ENABLE_STATISTICS
+  if (memory_handler && bx_heatmap.enabled) heat_start = bx_heatmap.start();
+#endif
   while (memory_handler) {
     if (memory_handler->begin <= a20addr &&
           memory_handler->end >= a20addr &&
           memory_handler->read_handler(a20addr, len, data, memory_handler->param))
     {
+      INC_STAT(*memory_handler->reads);
+#if BX_ENABLE_STATISTICS
+      if (bx_heatmap.enabled)
+        bx_heatmap.mmio_access(&memory_handler->heat, memory_handler->param, a20addr, 0, heat_start);
+#endif
 #if BX_SUPPORT_PCI
       if (BX_MEM_THIS pci_enabled && ((a20addr & 0xfffc0000) == 0x000c0000)) {
         unsigned area = (unsigned)(a20addr >> 14) & 0x0f;
@@ -410,6 +432,7 @@ void BX_MEM_C::dmaReadPhysicalPage(bx_phy_address addr, unsigned len, Bit8u *dat
   if ((addr>>12) != ((addr+len-1)>>12)) {
     BX_PANIC(("dmaReadPhysicalPage: cross page access at address 0x" FMT_PHY_ADDRX ", len=%d", addr, len));
   }
+  ADD_STAT(*BX_MEM_THIS dma_read_bytes, len);
 
   Bit8u *memptr = getHostMemAddr(NULL, addr, BX_READ);
   if (memptr != NULL) {
@@ -428,6 +451,7 @@ void BX_MEM_C::dmaWritePhysicalPage(bx_phy_address addr, unsigned len, Bit8u *da
   if ((addr>>12) != ((addr+len-1)>>12)) {
     BX_PANIC(("dmaWritePhysicalPage: cross page access at address 0x" FMT_PHY_ADDRX ", len=%d", addr, len));
   }
+  ADD_STAT(*BX_MEM_THIS dma_write_bytes, len);
 
   Bit8u *memptr = getHostMemAddr(NULL, addr, BX_WRITE);
   if (memptr != NULL) {
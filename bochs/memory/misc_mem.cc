@@ -64,6 +64,10 @@ void BX_MEM_C::init_memory(Bit64u guest, Bit64u host, Bit32u block_size)
   BX_MEM_THIS memory_handlers = new struct memory_handler_struct *[BX_MEM_HANDLERS];
   for (idx = 0; idx < BX_MEM_HANDLERS; idx++)
     BX_MEM_THIS memory_handlers[idx] = NULL;
+#if BX_ENABLE_STATISTICS
+  BX_MEM_THIS dma_read_bytes = bx_stats_counter("dma", NULL, "read_bytes");
+  BX_MEM_THIS dma_write_bytes = bx_stats_counter("dma", NULL, "write_bytes");
+#endif
 
   BX_MEM_THIS pci_enabled = SIM->get_param_bool(BXPN_PCI_ENABLED)->get();
   BX_MEM_THIS bios_write_enabled = false;
@@ -891,6 +895,12 @@ BX_MEM_C::registerMemoryHandlers(void *param, memory_handler_t read_handler,
     return false;
   bool ro_handler = (!write_handler && !da_handler);
   BX_INFO(("Register memory access handlers: 0x" FMT_PHY_ADDRX " - 0x" FMT_PHY_ADDRX, begin_addr, end_addr));
+#if BX_ENABLE_STATISTICS
+  char range[40];
+  sprintf(range, FMT_PHY_ADDRX "-" FMT_PHY_ADDRX, begin_addr, end_addr);
+  Bit64u *reads = bx_stats_counter("mmio", range, "reads");
+  Bit64u *writes = bx_stats_counter("mmio", range, "writes");
+#endif
   for (Bit32u page_idx = (Bit32u)(begin_addr >> 20); page_idx <= (Bit32u)(end_addr >> 20); page_idx++) {
     Bit16u bitmap = 0xffff;
     bool overlap = false;
@@ -922,6 +932,11 @@ BX_MEM_C::registerMemoryHandlers(void *param, memory_handler_t read_handler,
     memory_handler->end = end_addr;
     memory_handler->bitmap = bitmap;
     memory_handler->overlap = overlap;
+#if BX_ENABLE_STATISTICS
+    memory_handler->reads = reads;
+    memory_handler->writes = writes;
+    memory_handler->heat = NULL;
+#endif
 #if BX_WASM_DIRECT_RAM_FASTPATH
     update_handler_bitmap(page_idx, true);
 #endif
@@ -968,6 +983,9 @@ bool BX_MEM_C::unregisterMemoryHandlers(void *param, bx_phy_address begin_addr,
       prev->next = memory_handler->next;
     else
       BX_MEM_THIS memory_handlers[page_idx] = memory_handler->next;
+#if BX_ENABLE_STATISTICS
+    delete [] memory_handler->heat;
+#endif
     delete memory_handler;
 #if BX_WASM_DIRECT_RAM_FASTPATH
     // Clear bitmap bit if no more handlers for this 1MB region
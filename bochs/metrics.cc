@@ -0,0 +1,556 @@
+/////////////////////////////////////////////////////////////////////////
+// $Id$
+/////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2026  The Bochs Project
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+/////////////////////////////////////////////////////////////////////////
+
+// Metrics export: a thread serves the statistics tree through a local
+// (Unix domain) socket in the Prometheus text format or as JSON. The
+// simulation only increments plain counters, the values are read by the
+// metrics thread when a client connects.
+//
+// Protocol: the client may send a request line. "json" selects JSON,
+// anything else (or nothing within 100 ms) the Prometheus format. HTTP
+// GET requests are answered with a HTTP response, a path containing
+// "json" selects JSON:
+//
+//   curl --unix-socket /tmp/bochs.sock http://localhost/metrics
+
+#include "bochs.h"
+#include "bxthread.h"
+#include "pc_system.h"
+#include "cpu/cpu.h"
+#include "gui/siminterface.h"
+#include "iodev/iodev.h"
+
+#if BX_ENABLE_STATISTICS
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define LOG_THIS genlog->
+
+// counter owned by its param, see bx_stats_counter()
+class bx_stats_counter_c : public bx_shadow_num_c {
+public:
+  bx_stats_counter_c(bx_param_c *parent, const char *name)
+    : bx_shadow_num_c(parent, name, &value) { value = 0; }
+  Bit64u value;
+};
+
+static Bit64u stats_dummy;
+static bool metrics_running = 0;
+static BX_MUTEX(stats_mutex);
+
+static bx_list_c *get_stats_list(bx_list_c *parent, const char *name)
+{
+  bx_param_c *param = parent->get_by_name(name);
+
+  if (param == NULL)
+    return new bx_list_c(parent, name, name);
+  if (param->get_type() != BXT_LIST)
+    return NULL;
+  return (bx_list_c*) param;
+}
+
+static Bit64u stats_value(bx_param_c *param)
+{
+  return (Bit64u) ((bx_param_num_c*) param)->get64();
+}
+
+// Returns the counter statistics.<group>.<name>.<counter> (without the
+// <name> level if name is NULL). The counter stays valid until the
+// statistics tree is cleaned up at exit.
+Bit64u *bx_stats_counter(const char *group, const char *name, const char *counter)
+{
+  bx_list_c *list;
+  Bit64u *ptr = &stats_dummy;
+
+  if (SIM == NULL) return ptr;
+  list = SIM->get_statistics_root();
+  if (list == NULL) return ptr;
+
+  if (metrics_running) {
+    BX_LOCK(stats_mutex);
+  }
+  list = get_stats_list(list, group);
+  if ((list != NULL) && (name != NULL)) {
+    list = get_stats_list(list, name);
+  }
+  if (list != NULL) {
+    bx_param_c *param = list->get_by_name(counter);
+    if (param == NULL) {
+      ptr = &(new bx_stats_counter_c(list, counter))->value;
+    } else {
+      bx_stats_counter_c *stat = dynamic_cast<bx_stats_counter_c*>(param);
+      if (stat != NULL) {
+        ptr = &stat->value;
+      } else {
+        BX_ERROR(("statistics: '%s' in '%s' is not a counter", counter, group));
+      }
+    }
+  }
+  if (metrics_running) {
+    BX_UNLOCK(stats_mutex);
+  }
+  return ptr;
+}
+
+#ifndef WIN32
+
+static int metrics_fd = -1;
+static char metrics_path[BX_PATHNAME_LEN];
+static bool metrics_stop;
+static BX_THREAD_VAR(metrics_thread);
+
+// output buffer
+typedef struct {
+  char *buf;
+  size_t len, size;
+} metrics_buf_t;
+
+static void mb_printf(metrics_buf_t *mb, const char *fmt, ...) BX_CPP_AttrPrintf(2, 3);
+
+static void mb_printf(metrics_buf_t *mb, const char *fmt, ...)
+{
+  va_list ap;
+
+  for (;;) {
+    va_start(ap, fmt);
+    int n = vsnprintf(mb->buf + mb->len, mb->size - mb->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (mb->len + n < mb->size) {
+      mb->len += n;
+      return;
+    }
+    size_t newsize = mb->size * 2 + n;
+    char *newbuf = (char*) realloc(mb->buf, newsize);
+    if (newbuf == NULL) return;
+    mb->buf = newbuf;
+    mb->size = newsize;
+  }
+}
+
+// metric names may only contain [a-zA-Z0-9_]
+static void mb_name(metrics_buf_t *mb, const char *name)
+{
+  for (const char *p = name; *p; p++) {
+    mb_printf(mb, "%c", isalnum((unsigned char) *p) ? *p : '_');
+  }
+}
+
+// escaped string for label values and JSON
+static void mb_string(metrics_buf_t *mb, const char *str)
+{
+  mb_printf(mb, "\"");
+  for (const char *p = str; *p; p++) {
+    if (*p == '"' || *p == '\\')
+      mb_printf(mb, "\\%c", *p);
+    else if (*p == '\n')
+      mb_printf(mb, "\\n");
+    else if ((unsigned char) *p >= 0x20)
+      mb_printf(mb, "%c", *p);
+  }
+  mb_printf(mb, "\"");
+}
+
+// Prometheus text format: the numbers in statistics.<group> become
+// bochs_<group>_<counter>_total, the numbers one level deeper get the
+// name of their list as label.
+static void prometheus_group(metrics_buf_t *mb, bx_list_c *group)
+{
+  int i, j, k;
+
+  for (i = 0; i < group->get_size(); i++) {
+    bx_param_c *param = group->get(i);
+    if (param->get_type() == BXT_PARAM_NUM) {
+      mb_printf(mb, "# TYPE bochs_");
+      mb_name(mb, group->get_name());
+      mb_printf(mb, "_");
+      mb_name(mb, param->get_name());
+      mb_printf(mb, "_total counter\nbochs_");
+      mb_name(mb, group->get_name());
+      mb_printf(mb, "_");
+      mb_name(mb, param->get_name());
+      mb_printf(mb, "_total " FMT_LL "u\n", stats_value(param));
+    }
+  }
+  // all samples of a metric must be written together
+  for (i = 0; i < group->get_size(); i++) {
+    if (group->get(i)->get_type() != BXT_LIST) continue;
+    bx_list_c *list = (bx_list_c*) group->get(i);
+    for (j = 0; j < list->get_size(); j++) {
+      const char *counter = list->get(j)->get_name();
+      if (list->get(j)->get_type() != BXT_PARAM_NUM) continue;
+      // skip counters already written for a previous list
+      bool done = 0;
+      for (k = 0; k < i && !done; k++) {
+        if (group->get(k)->get_type() == BXT_LIST &&
+            ((bx_list_c*) group->get(k))->get_by_name(counter) != NULL) done = 1;
+      }
+      for (k = 0; k < j && !done; k++) {
+        if (!stricmp(list->get(k)->get_name(), counter)) done = 1;
+      }
+      if (done) continue;
+      mb_printf(mb, "# TYPE bochs_");
+      mb_name(mb, group->get_name());
+      mb_printf(mb, "_");
+      mb_name(mb, counter);
+      mb_printf(mb, "_total counter\n");
+      for (k = i; k < group->get_size(); k++) {
+        if (group->get(k)->get_type() != BXT_LIST) continue;
+        bx_param_c *param = ((bx_list_c*) group->get(k))->get_by_name(counter);
+        if ((param == NULL) || (param->get_type() != BXT_PARAM_NUM)) continue;
+        mb_printf(mb, "bochs_");
+        mb_name(mb, group->get_name());
+        mb_printf(mb, "_");
+        mb_name(mb, counter);
+        mb_printf(mb, "_total{name=");
+        mb_string(mb, group->get(k)->get_name());
+        mb_printf(mb, "} " FMT_LL "u\n", stats_value(param));
+      }
+    }
+  }
+}
+
+static void prometheus_output(metrics_buf_t *mb)
+{
+  mb_printf(mb, "# TYPE bochs_ticks_total counter\n");
+  mb_printf(mb, "bochs_ticks_total " FMT_LL "u\n", bx_pc_system.time_ticks());
+  mb_printf(mb, "# TYPE bochs_cpu_instructions_total counter\n");
+  for (unsigned i = 0; i < BX_SMP_PROCESSORS; i++) {
+    mb_printf(mb, "bochs_cpu_instructions_total{name=");
+    mb_string(mb, BX_CPU(i)->get_name());
+    mb_printf(mb, "} " FMT_LL "u\n", BX_CPU(i)->get_icount());
+  }
+  bx_list_c *root = SIM->get_statistics_root();
+  for (int i = 0; i < root->get_size(); i++) {
+    if (root->get(i)->get_type() == BXT_LIST)
+      prometheus_group(mb, (bx_list_c*) root->get(i));
+  }
+}
+
+static void json_tree(metrics_buf_t *mb, bx_list_c *list)
+{
+  int n = 0;
+
+  mb_printf(mb, "{");
+  for (int i = 0; i < list->get_size(); i++) {
+    bx_param_c *param = list->get(i);
+    if (param->get_type() != BXT_PARAM_NUM && param->get_type() != BXT_LIST)
+      continue;
+    if (n++ > 0) mb_printf(mb, ",");
+    mb_string(mb, param->get_name());
+    mb_printf(mb, ":");
+    if (param->get_type() == BXT_LIST)
+      json_tree(mb, (bx_list_c*) param);
+    else
+      mb_printf(mb, FMT_LL "u", stats_value(param));
+  }
+  mb_printf(mb, "}");
+}
+
+static void json_output(metrics_buf_t *mb)
+{
+  mb_printf(mb, "{\"ticks\":" FMT_LL "u,\"cpu\":[", bx_pc_system.time_ticks());
+  for (unsigned i = 0; i < BX_SMP_PROCESSORS; i++) {
+    mb_printf(mb, "%s{\"name\":", i ? "," : "");
+    mb_string(mb, BX_CPU(i)->get_name());
+    mb_printf(mb, ",\"instructions\":" FMT_LL "u}", BX_CPU(i)->get_icount());
+  }
+  mb_printf(mb, "],\"statistics\":");
+  json_tree(mb, SIM->get_statistics_root());
+  mb_printf(mb, "}\n");
+}
+
+static void metrics_client(int fd)
+{
+  char request[1024];
+  size_t len = 0;
+  struct timeval tv;
+  fd_set fds;
+  metrics_buf_t mb;
+
+  // read the request line, if any
+  while (len < sizeof(request) - 1) {
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+    if (select(fd + 1, &fds, NULL, NULL, &tv) != 1) break;
+    ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+    if (n <= 0) break;
+    len += n;
+    request[len] = 0;
+    if (strchr(request, '\n') != NULL) break;
+  }
+  request[len] = 0;
+
+  bool http = !strncmp(request, "GET ", 4);
+  char *eol = strpbrk(request, "\r\n");
+  if (eol != NULL) *eol = 0;
+  bool json = (strstr(request, "json") != NULL);
+
+  mb.size = 65536;
+  mb.len = 0;
+  mb.buf = (char*) malloc(mb.size);
+  if (mb.buf == NULL) return;
+  BX_LOCK(stats_mutex);
+  if (json)
+    json_output(&mb);
+  else
+    prometheus_output(&mb);
+  BX_UNLOCK(stats_mutex);
+
+  if (http) {
+    char header[160];
+    int n = sprintf(header, "HTTP/1.0 200 OK\r\nContent-Type: %s\r\n"
+                    "Content-Length: %u\r\n\r\n",
+                    json ? "application/json" : "text/plain; version=0.0.4",
+                    (unsigned) mb.len);
+    send(fd, header, n, MSG_NOSIGNAL);
+  }
+  for (size_t pos = 0; pos < mb.len; ) {
+    ssize_t n = send(fd, mb.buf + pos, mb.len - pos, MSG_NOSIGNAL);
+    if (n <= 0) break;
+    pos += n;
+  }
+  free(mb.buf);
+}
+
+static BX_THREAD_FUNC(metrics_thread_func, indata)
+{
+  struct timeval tv;
+  fd_set fds;
+
+  UNUSED(indata);
+  while (!BX_ATOMIC_LOAD(metrics_stop)) {
+    FD_ZERO(&fds);
+    FD_SET(metrics_fd, &fds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+    if (select(metrics_fd + 1, &fds, NULL, NULL, &tv) != 1) continue;
+    int fd = accept(metrics_fd, NULL, NULL);
+    if (fd < 0) continue;
+    metrics_client(fd);
+    close(fd);
+  }
+  BX_THREAD_EXIT;
+}
+
+void bx_metrics_start(const char *path)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+
+  if (metrics_running) return;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    BX_ERROR(("metrics: socket path '%s' too long", path));
+    return;
+  }
+  metrics_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (metrics_fd < 0) {
+    BX_ERROR(("metrics: cannot create socket"));
+    return;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  // only remove a socket left over from a previous session
+  if (lstat(path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      BX_ERROR(("metrics: '%s' exists and is not a socket", path));
+      close(metrics_fd);
+      metrics_fd = -1;
+      return;
+    }
+    unlink(path);
+  }
+  if ((bind(metrics_fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) ||
+      (listen(metrics_fd, 8) < 0)) {
+    BX_ERROR(("metrics: cannot listen on '%s': %s", path, strerror(errno)));
+    close(metrics_fd);
+    metrics_fd = -1;
+    return;
+  }
+  strcpy(metrics_path, path);
+  BX_INIT_MUTEX(stats_mutex);
+  metrics_stop = 0;
+  metrics_running = 1;
+  BX_THREAD_CREATE(metrics_thread_func, NULL, metrics_thread);
+  BX_INFO(("metrics available at '%s'", path));
+}
+
+void bx_metrics_stop(void)
+{
+  if (!metrics_running) return;
+  BX_ATOMIC_STORE(metrics_stop, 1);
+  BX_THREAD_JOIN(metrics_thread);
+  close(metrics_fd);
+  metrics_fd = -1;
+  unlink(metrics_path);
+  metrics_running = 0;
+  BX_FINI_MUTEX(stats_mutex);
+}
+
+#else
+
+void bx_metrics_start(const char *path)
+{
+  BX_ERROR(("metrics: not supported on this platform"));
+}
+
+void bx_metrics_stop(void) {}
+
+#endif
+
+// I/O port and MMIO access heatmap
+
+bx_heatmap_c bx_heatmap;
+
+void bx_heatmap_c::init(void)
+{
+  // one slot per port and direction
+  io_slots = new bx_heat_slot_t[0x20000];
+  memset(io_slots, 0, 0x20000 * sizeof(bx_heat_slot_t));
+  enabled = 1;
+  BX_INFO(("heatmap: sampling 1 of %d I/O port and MMIO accesses",
+           BX_HEATMAP_SAMPLE_RATE));
+}
+
+void bx_heatmap_c::io_access(Bit16u port, bool write, const void *handler,
+                             const char *name, Bit64u start)
+{
+  bx_heat_slot_t *slot = &io_slots[(write ? 0x10000 : 0) + port];
+
+  // look up the counters again if another device took over the port
+  if (slot->owner != handler) {
+    char entry[BX_PATHNAME_LEN];
+    snprintf(entry, sizeof(entry), "0x%04x %s", port, name);
+    slot->count = bx_stats_counter("heatmap_io", entry, write ? "writes" : "reads");
+    slot->cycles = bx_stats_counter("heatmap_io", entry, "cycles");
+    slot->samples = bx_stats_counter("heatmap_io", entry, "samples");
+    slot->owner = handler;
+  }
+  account(slot, start);
+}
+
+void bx_heatmap_c::mmio_access(bx_heat_slot_t **slots, void *param,
+                               bx_phy_address addr, bool write, Bit64u start)
+{
+  // two slots for each page of the 1MB chunk of the memory handler
+  if (*slots == NULL) {
+    *slots = new bx_heat_slot_t[512];
+    memset(*slots, 0, 512 * sizeof(bx_heat_slot_t));
+  }
+  bx_heat_slot_t *slot = &(*slots)[((addr >> 12) & 0xff) * 2 + write];
+
+  if (slot->count == NULL) {
+    char entry[BX_PATHNAME_LEN];
+    // MMIO handlers have no name, use the one of the device I/O handlers
+    const char *name = bx_devices.get_device_name(param);
+    snprintf(entry, sizeof(entry), "0x" FMT_PHY_ADDRX " %s",
+             (bx_phy_address) (addr & ~BX_CONST64(0xfff)), name ? name : "mmio");
+    slot->count = bx_stats_counter("heatmap_mmio", entry, write ? "writes" : "reads");
+    slot->cycles = bx_stats_counter("heatmap_mmio", entry, "cycles");
+    slot->samples = bx_stats_counter("heatmap_mmio", entry, "samples");
+    slot->owner = param;
+  }
+  account(slot, start);
+}
+
+typedef struct {
+  const char *type;
+  const char *name;
+  Bit64u reads, writes;
+  Bit64u avg;   // cycles per sampled access
+  Bit64u total; // estimated cycles of all accesses
+} heat_entry_t;
+
+static int heat_entry_cmp(const void *a, const void *b)
+{
+  Bit64u ta = ((const heat_entry_t*) a)->total;
+  Bit64u tb = ((const heat_entry_t*) b)->total;
+  return (ta < tb) ? 1 : (ta > tb) ? -1 : 0;
+}
+
+static Bit64u heat_counter(bx_list_c *list, const char *name)
+{
+  bx_param_c *param = list->get_by_name(name);
+  return (param != NULL) ? stats_value(param) : 0;
+}
+
+// Logs the ports and MMIO pages sorted by the estimated host cycles spent
+// in their handlers (average of the samples times the access count).
+void bx_heatmap_c::report(void)
+{
+  static const char *types[2] = { "io", "mmio" };
+  bx_list_c *root = SIM->get_statistics_root();
+  heat_entry_t *entries;
+  Bit64u sum = 0;
+  int i, t, n = 0, size = 0;
+
+  if (!enabled || (root == NULL)) return;
+  bx_list_c *groups[2] = {
+    (bx_list_c*) root->get_by_name("heatmap_io"),
+    (bx_list_c*) root->get_by_name("heatmap_mmio")
+  };
+  for (t = 0; t < 2; t++) {
+    if (groups[t] != NULL) size += groups[t]->get_size();
+  }
+  if (size == 0) {
+    BX_INFO(("heatmap: no I/O port or MMIO accesses"));
+    return;
+  }
+  entries = new heat_entry_t[size];
+  for (t = 0; t < 2; t++) {
+    if (groups[t] == NULL) continue;
+    for (i = 0; i < groups[t]->get_size(); i++) {
+      bx_list_c *list = (bx_list_c*) groups[t]->get(i);
+      heat_entry_t *e = &entries[n];
+      Bit64u samples = heat_counter(list, "samples");
+      e->type = types[t];
+      e->name = list->get_name();
+      e->reads = heat_counter(list, "reads");
+      e->writes = heat_counter(list, "writes");
+      if ((e->reads + e->writes) == 0) continue;
+      e->avg = samples ? heat_counter(list, "cycles") / samples : 0;
+      e->total = e->avg * (e->reads + e->writes);
+      sum += e->total;
+      n++;
+    }
+  }
+  qsort(entries, n, sizeof(heat_entry_t), heat_entry_cmp);
+  BX_INFO(("heatmap: %-4s %-36s %12s %12s %10s %6s", "type", "port/page device",
+           "reads", "writes", "cyc/access", "share"));
+  for (i = 0; i < n; i++) {
+    BX_INFO(("heatmap: %-4s %-36s %12" FMT_64 "u %12" FMT_64 "u %10" FMT_64 "u %5.1f%%",
+             entries[i].type, entries[i].name, entries[i].reads, entries[i].writes,
+             entries[i].avg, sum ? (100.0 * entries[i].total / sum) : 0.0));
+  }
+  delete [] entries;
+}
+
+#endif
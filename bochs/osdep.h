@@ -349,6 +349,15 @@ BOCHSAPI extern Bit64u bx_get_realtime64_usec (void);
 BOCHSAPI_MSVCONLY extern void bx_init_realtime64_usec (void);
 #endif
 
+// host timestamp counter, used for sampling the cost of device handlers
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+BX_CPP_INLINE Bit64u bx_host_cycles(void) { return __builtin_ia32_rdtsc(); }
+#elif BX_HAVE_REALTIME_USEC
+#define bx_host_cycles() bx_get_realtime64_usec()
+#else
+#define bx_host_cycles() ((Bit64u) 0)
+#endif
+
 #ifdef WIN32
 #undef BX_HAVE_MSLEEP
 #define BX_HAVE_MSLEEP 1
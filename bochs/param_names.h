@@ -30,6 +30,8 @@
 #define BXPN_BOCHS_START                 "general.start_mode"
 #define BXPN_BOCHS_BENCHMARK             "general.benchmark"
 #define BXPN_DUMP_STATS                  "general.dumpstats"
+#define BXPN_METRICS_SOCKET              "general.metrics_socket"
+#define BXPN_HEATMAP                     "general.heatmap"
 #define BXPN_RESTORE_FLAG                "general.restore"
 #define BXPN_RESTORE_PATH                "general.restore_path"
 #define BXPN_DEBUG_RUNNING               "general.debug_running"
@@ -135,6 +137,7 @@
 #define BXPN_USB_XHCI                    "ports.usb.xhci"
 #define BXPN_XHCI_ENABLED                "ports.usb.xhci.enabled"
 #define BXPN_XHCI_MODEL                  "ports.usb.xhci.model"
+#define BXPN_VIRTIO_CONSOLE              "ports.virtio_console"
 #define BXPN_XHCI_N_PORTS                "ports.usb.xhci.n_ports"
 #define BXPN_USB_DEBUG                   "ports.usb_debug"
 #define BXPN_USB_DEBUG_TYPE              "ports.usb_debug.type"
@@ -163,10 +166,13 @@
 #define BXPN_PORT_E9_HACK_ALL_RINGS      "misc.port_e9_hack.all_rings"
 #define BXPN_FW_CFG_ROOT                 "misc.fw_cfg"
 #define BXPN_FW_CFG_ENABLED              "misc.fw_cfg.enabled"
+#define BXPN_VIRTIO_9P                   "misc.virtio_9p"
 #define BXPN_IODEBUG_ALL_RINGS           "misc.iodebug_all_rings"
 #define BXPN_GDBSTUB                     "misc.gdbstub"
 #define BXPN_LOG_FILENAME                "log.filename"
 #define BXPN_LOG_PREFIX                  "log.prefix"
+#define BXPN_LOG_ASYNC                   "log.async"
+#define BXPN_LOG_RATE_LIMIT              "log.rate_limit"
 #define BXPN_DEBUGGER_LOG_FILENAME       "log.debugger_filename"
 #define BXPN_MENU_DISK                   "menu.disk"
 #define BXPN_MENU_DISK_WIN32             "menu.disk_win32"
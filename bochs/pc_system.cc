@@ -71,6 +71,13 @@ void bx_pc_system_c::initialize(Bit32u ips)
   HRQ = 0;
   kill_bochs_request = 0;
 
+#if BX_ENABLE_STATISTICS
+  // timers registered by static objects predate the statistics tree
+  for (unsigned i = 0; i < numTimers; i++) {
+    timer[i].expirations = bx_stats_counter("timers", (i == 0) ? "null" : timer[i].id, "expirations");
+  }
+#endif
+
   // parameter 'ips' is the processor speed in Instructions-Per-Second
   m_ips = double(ips) / 1000000.0L;
 
@@ -300,6 +307,9 @@ int bx_pc_system_c::register_timer_ticks(void* this_ptr, bx_timer_handler_t func
   strncpy(timer[i].id, id, BxMaxTimerIDLen);
   timer[i].id[BxMaxTimerIDLen-1] = 0; // Null terminate if not already.
   timer[i].param      = 0;
+#if BX_ENABLE_STATISTICS
+  timer[i].expirations = bx_stats_counter("timers", timer[i].id, "expirations");
+#endif
 
   if (active) {
     if (ticks < Bit64u(currCountdown)) {
@@ -380,6 +390,7 @@ void bx_pc_system_c::countdownEvent(void)
     // timer period or deactivate etc.
     if (triggered[i] && (timer[i].funct != NULL)) {
       triggeredTimer = i;
+      INC_STAT(*timer[i].expirations);
       timer[i].funct(timer[i].this_ptr);
       triggeredTimer = 0;
     }
@@ -54,6 +54,9 @@ private:
 #define BxMaxTimerIDLen 32
     char id[BxMaxTimerIDLen];  // String ID of timer.
     Bit32u param;              // Device-specific value assigned to timer (optional)
+#if BX_ENABLE_STATISTICS
+    Bit64u *expirations;       // statistics.timers.<id>.expirations
+#endif
   } timer[BX_MAX_TIMERS];
 
   unsigned   numTimers;  // Number of currently allocated timers.
@@ -993,6 +993,9 @@ plugin_t bx_builtin_plugins[] = {
 #if BX_WITH_AMIGAOS
   BUILTIN_GUI_PLUGIN_ENTRY(amigaos),
 #endif
+#if BX_WITH_CAPTURE
+  BUILTIN_GUI_PLUGIN_ENTRY(capture),
+#endif
 #if BX_WITH_CARBON
   BUILTIN_GUI_PLUGIN_ENTRY(carbon),
 #endif
@@ -1085,6 +1088,10 @@ plugin_t bx_builtin_plugins[] = {
 #if BX_SUPPORT_USB_XHCI
   BUILTIN_OPTPCI_PLUGIN_ENTRY(usb_xhci),
 #endif
+#if BX_SUPPORT_VIRTIO
+  BUILTIN_OPTPCI_PLUGIN_ENTRY(virtio_console),
+  BUILTIN_OPTPCI_PLUGIN_ENTRY(virtio_9p),
+#endif
 #if BX_SUPPORT_SOUNDLOW
   BUILTIN_SND_PLUGIN_ENTRY(dummy),
   BUILTIN_SND_PLUGIN_ENTRY(file),
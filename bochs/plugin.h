@@ -77,6 +77,8 @@ extern "C" {
 #define BX_PLUGIN_IOAPIC    "ioapic"
 #define BX_PLUGIN_HPET      "hpet"
 #define BX_PLUGIN_VOODOO    "voodoo"
+#define BX_PLUGIN_VIRTIO_CONSOLE "virtio_console"
+#define BX_PLUGIN_VIRTIO_9P "virtio_9p"
 
 
 #define BX_REGISTER_DEVICE_DEVMODEL(a,b,c,d) pluginRegisterDeviceDevmodel(a,b,c,d)
@@ -445,11 +447,14 @@ PLUGIN_ENTRY_FOR_MODULE(iodebug);
 PLUGIN_ENTRY_FOR_MODULE(ioapic);
 PLUGIN_ENTRY_FOR_MODULE(hpet);
 PLUGIN_ENTRY_FOR_MODULE(voodoo);
+PLUGIN_ENTRY_FOR_MODULE(virtio_console);
+PLUGIN_ENTRY_FOR_MODULE(virtio_9p);
 // config interface plugins
 PLUGIN_ENTRY_FOR_MODULE(textconfig);
 PLUGIN_ENTRY_FOR_MODULE(win32config);
 // gui plugins
 PLUGIN_ENTRY_FOR_GUI_MODULE(amigaos);
+PLUGIN_ENTRY_FOR_GUI_MODULE(capture);
 PLUGIN_ENTRY_FOR_GUI_MODULE(carbon);
 PLUGIN_ENTRY_FOR_GUI_MODULE(macintosh);
 PLUGIN_ENTRY_FOR_GUI_MODULE(nogui);